@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  ForwardBench.cpp
+
+  Cost of forwarding a pub or sub at a hop which is not the rendezvous:
+  decode it off the wire, find the constraint it is routed on, and
+  serialize it again for the next hop. "full" also decodes the event 
+  (interest), as every hop used to; "lazy" leaves it in its bytes.
+
+***************************************************************************/
+
+#include <mercury/Event.h>
+#include <mercury/Interest.h>
+#include <mercury/Message.h>
+#include <mercury/Packet.h>
+#include "microbench.h"
+
+#define BENCH_HUB       0
+#define BENCH_SPACE     100000
+
+static Packet *_Wire (Message *msg)
+{
+    Packet *pkt = new Packet (msg->GetLength ());
+    msg->Serialize (pkt);
+    return pkt;
+}
+
+static Packet *_PubWire (IPEndPoint& creator, int nattrs)
+{
+    PointEvent ev;
+    for (int attr = 0; attr < nattrs; attr++) {
+	int v = (int) (drand48 () * BENCH_SPACE);
+	Constraint c (attr, Value (v), Value (v));
+	ev.AddConstraint (c);
+    }
+    MsgPublication pmsg (BENCH_HUB, creator, &ev, creator);
+    return _Wire (&pmsg);
+}
+
+static Packet *_SubWire (IPEndPoint& creator, int nattrs)
+{
+    Interest in (creator, GUID::CreateRandom ());
+    for (int attr = 0; attr < nattrs; attr++) {
+	int lo = (int) (drand48 () * BENCH_SPACE);
+	Constraint c (attr, Value (lo), Value (lo + 1000));
+	in.AddConstraint (c);
+    }
+    MsgSubscription smsg (BENCH_HUB, creator, &in, creator);
+    return _Wire (&smsg);
+}
+
+static void _TimeForward (const char *name, Packet *wire, int nattrs, bool full)
+{
+    int iters = g_MicrobenchPrefs.iters;
+    uint64 check = 0;
+    uint64 start = BenchNowUsec ();
+
+    for (int i = 0; i < iters; i++) {
+	wire->ResetBufPosition ();
+	Message *msg = CreateObject<Message> (wire);
+
+	Constraint *cst;
+	if (msg->GetType () == MSG_PUB) {
+	    MsgPublication *pmsg = (MsgPublication *) msg;
+	    if (full)
+		pmsg->GetEvent ();
+	    cst = pmsg->GetRouteConstraint ();
+	}
+	else {
+	    MsgSubscription *smsg = (MsgSubscription *) msg;
+	    if (full)
+		smsg->GetInterest ();
+	    cst = smsg->GetRouteConstraint ();
+	}
+	check += cst->GetAttrIndex ();
+
+	msg->hopCount++;
+	Packet *out = _Wire (msg);
+	check += out->GetUsed ();
+
+	delete out;
+	delete msg;
+    }
+    uint64 elapsed = BenchNowUsec () - start;
+
+    cout << merc_va ("%-4s %-5s attrs=%-3d bytes=%-5d msgs/sec=%-12.1f (%llu)", name, 
+		     full ? "full" : "lazy", nattrs, wire->GetUsed (), 
+		     BenchRate (iters, elapsed), check) << endl;
+}
+
+void BenchForward ()
+{
+    IPEndPoint creator (0x7f000001, 20001);
+    int nattrs[] = { 1, 3, 8 };
+
+    for (uint32 n = 0; n < sizeof (nattrs) / sizeof (int); n++) {
+	Packet *pub = _PubWire (creator, nattrs[n]);
+	Packet *sub = _SubWire (creator, nattrs[n]);
+
+	_TimeForward ("pub", pub, nattrs[n], true);
+	_TimeForward ("pub", pub, nattrs[n], false);
+	_TimeForward ("sub", sub, nattrs[n], true);
+	_TimeForward ("sub", sub, nattrs[n], false);
+
+	delete pub;
+	delete sub;
+    }
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
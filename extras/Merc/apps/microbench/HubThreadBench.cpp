@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+
+/**************************************************************************
+  HubThreadBench.cpp
+
+  Matching throughput with --hub-threads. Splits the pubs over K hubs,
+  each with its own store of N subscriptions, and times matching them
+  all on one thread against handing them to a HubWorker per hub, the
+  way PubsubRouter does. Speedup over one thread should track the
+  number of cores, up to K.
+
+  The mixed run also stores a sub every few pubs, taking the store
+  from the worker (lock, then reap) like PubsubRouter's StoreAccess;
+  that shows what the turn-taking costs.
+
+***************************************************************************/
+
+#include <mercury/PubsubStore.h>
+#include <mercury/HubWorker.h>
+#include <mercury/Interest.h>
+#include <mercury/Event.h>
+#include <mercury/Message.h>
+#include <unistd.h>
+#include <sched.h>
+#include "microbench.h"
+
+#define BENCH_NATTRS    3
+#define BENCH_SPACE     100000
+#define BENCH_SUBWIDTH  1000
+#define BENCH_SUBS      10000     // per hub
+#define BENCH_MAXHUBS   16
+#define BENCH_SUBEVERY  16        // mixed run: one sub per this many pubs
+
+static Interest *_RandomInterest (IPEndPoint& sub)
+{
+    Interest *in = new Interest (sub, GUID::CreateRandom ());
+
+    for (int attr = 0; attr < BENCH_NATTRS; attr++) {
+	int lo = (int) (drand48 () * (BENCH_SPACE - BENCH_SUBWIDTH));
+	Constraint c (attr, Value (lo), Value (lo + (int) (drand48 () * BENCH_SUBWIDTH)));
+	in->AddConstraint (c);
+    }
+    return in;
+}
+
+static MsgPublication *_RandomPublication (IPEndPoint& creator, int hub)
+{
+    PointEvent ev;
+    for (int attr = 0; attr < BENCH_NATTRS; attr++) {
+	int v = (int) (drand48 () * BENCH_SPACE);
+	Constraint c (attr, Value (v), Value (v));
+	ev.AddConstraint (c);
+    }
+    return new MsgPublication (hub, creator, &ev, creator);
+}
+
+// jobs here point at the bench's pubs, so don't DeleteJob them
+static uint64 _ReapAll (HubWorker *worker, uint32 *left)
+{
+    uint64 nmatched = 0;
+    HubWorker::Job *job;
+    while ((job = worker->Reap ()) != NULL) {
+	nmatched += job->matches.size ();
+	delete job;
+	if (left)
+	    (*left)--;
+    }
+    return nmatched;
+}
+
+static void _StoreSub (PubsubStore *store, HubWorker *worker, IPEndPoint& sub, 
+		       uint32 *left, uint64 *nmatched)
+{
+    Interest *in = _RandomInterest (sub);
+
+    if (worker) {
+	worker->LockStore ();
+	*nmatched += _ReapAll (worker, left);
+    }
+    store->StoreSub (in);
+    if (worker)
+	worker->UnlockStore ();
+    delete in;
+}
+
+static uint64 _MatchInline (vector<PubsubStore *>& stores, vector<MsgPublication *>& pubs,
+			    IPEndPoint& sub, bool mixed, uint64 *nmatched)
+{
+    uint64 start = BenchNowUsec ();
+
+    for (int i = 0, len = pubs.size (); i < len; i++) {
+	PubsubStore *store = stores[pubs[i]->hubID];
+	list<Interest *> matches;
+	store->GetOverlapSubs (pubs[i], &matches);
+	*nmatched += matches.size ();
+
+	if (mixed && i % BENCH_SUBEVERY == 0)
+	    _StoreSub (store, NULL, sub, NULL, nmatched);
+    }
+    return BenchNowUsec () - start;
+}
+
+static uint64 _MatchThreaded (vector<PubsubStore *>& stores, vector<MsgPublication *>& pubs,
+			      IPEndPoint& sub, bool mixed, uint64 *nmatched)
+{
+    vector<HubWorker *> workers;
+    for (uint32 h = 0; h < stores.size (); h++) {
+	workers.push_back (new HubWorker (stores[h]));
+	workers[h]->Start ();
+    }
+
+    uint64 start = BenchNowUsec ();
+    uint32 left = pubs.size ();
+
+    for (int i = 0, len = pubs.size (); i < len; i++) {
+	int hub = pubs[i]->hubID;
+	HubWorker::Job *job = new HubWorker::Job ();
+	job->pmsg = pubs[i];
+	job->pubMatchesLeft = false;
+
+	// the network thread would fall back to matching inline; 
+	// here we reap and retry, so every pub goes through a worker
+	while (!workers[hub]->Submit (job)) {
+	    for (uint32 h = 0; h < workers.size (); h++)
+		*nmatched += _ReapAll (workers[h], &left);
+	    sched_yield ();
+	}
+
+	if (mixed && i % BENCH_SUBEVERY == 0)
+	    _StoreSub (stores[hub], workers[hub], sub, &left, nmatched);
+    }
+    while (left > 0) {
+	for (uint32 h = 0; h < workers.size (); h++)
+	    *nmatched += _ReapAll (workers[h], &left);
+	sched_yield ();
+    }
+    uint64 elapsed = BenchNowUsec () - start;
+
+    for (uint32 h = 0; h < workers.size (); h++) {
+	workers[h]->Shutdown ();
+	delete workers[h];
+    }
+    return elapsed;
+}
+
+static void _Run (int nhubs, bool mixed, IPEndPoint& sub, IPEndPoint& creator)
+{
+    vector<Constraint> bounds;
+    for (int attr = 0; attr < BENCH_NATTRS; attr++)
+	bounds.push_back (Constraint (attr, Value (0), Value (BENCH_SPACE)));
+
+    // the same subs and pubs for both runs. In the mixed run, a pub
+    // still queued when a sub goes in may match it, which inline it
+    // couldn't, so only the pure matching counts have to agree
+    vector<PubsubStore *> stores[2];
+    long seed = lrand48 ();
+    for (int run = 0; run < 2; run++) {
+	srand48 (seed);
+	for (int h = 0; h < nhubs; h++) {
+	    stores[run].push_back (new SoAPubsubStore (h, bounds));
+	    for (int i = 0; i < BENCH_SUBS; i++) {
+		Interest *in = _RandomInterest (sub);
+		stores[run][h]->StoreSub (in);
+		delete in;
+	    }
+	}
+    }
+
+    vector<MsgPublication *> pubs;
+    for (int i = 0; i < g_MicrobenchPrefs.iters; i++)
+	pubs.push_back (_RandomPublication (creator, i % nhubs));
+
+    uint64 inline_matched = 0, threaded_matched = 0;
+    srand48 (seed + 1);
+    uint64 inline_usecs = _MatchInline (stores[0], pubs, sub, mixed, &inline_matched);
+    srand48 (seed + 1);
+    uint64 threaded_usecs = _MatchThreaded (stores[1], pubs, sub, mixed, &threaded_matched);
+
+    double inline_rate = BenchRate (pubs.size (), inline_usecs);
+    double threaded_rate = BenchRate (pubs.size (), threaded_usecs);
+    cout << merc_va ("%-6s hubs=%-3d inline pubs/sec=%-12.1f threaded pubs/sec=%-12.1f "
+		     "speedup=%.2f%s", mixed ? "mixed" : "match", nhubs, inline_rate, 
+		     threaded_rate, inline_rate == 0 ? 0.0 : threaded_rate / inline_rate,
+		     mixed || inline_matched == threaded_matched ? "" : " MISMATCH") << endl;
+
+    for (int run = 0; run < 2; run++) {
+	for (int h = 0; h < nhubs; h++)
+	    delete stores[run][h];
+    }
+    for (int i = 0, len = pubs.size (); i < len; i++)
+	delete pubs[i];
+}
+
+void BenchHubThreads ()
+{
+    IPEndPoint sub (0x7f000001, 20000), creator (0x7f000001, 20001);
+
+    cout << "cpus=" << sysconf (_SC_NPROCESSORS_ONLN) << endl;
+    for (int mixed = 0; mixed < 2; mixed++) {
+	for (int nhubs = 1; nhubs <= BENCH_MAXHUBS; nhubs *= 2)
+	    _Run (nhubs, mixed, sub, creator);
+    }
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
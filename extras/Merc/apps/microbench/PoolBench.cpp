@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+/**************************************************************************
+  PoolBench.cpp
+
+  Allocation traffic of the publication path as a node sees it: encode
+  a pub into a packet (RealNet's _MakePacket), receive it into a
+  MAX_UDP_MSGSIZE packet (UDPTransport::_ServiceOnce), decode it
+  (CreateObject) and release both packets and the message (FreePacket,
+  FreeMessage). Run with and without --packet-pool; reports heap
+  allocations (counted by the operator new below, which stands in for
+  the global one in this binary) and per-publication latency.
+
+***************************************************************************/
+
+#include <new>
+#include <algorithm>
+#include <mercury/Event.h>
+#include <mercury/Message.h>
+#include <mercury/Packet.h>
+#include "microbench.h"
+
+#define BENCH_HUB       0
+#define BENCH_SPACE     100000
+#define BENCH_MSGSIZE   4096    // UDPTransport::MAX_UDP_MSGSIZE
+
+static uint64 s_NumAllocs = 0;
+
+void *operator new (size_t size)
+{
+    s_NumAllocs++;
+    void *ptr = malloc (size == 0 ? 1 : size);
+    if (ptr == NULL)
+	throw std::bad_alloc ();
+    return ptr;
+}
+
+void *operator new[] (size_t size)
+{
+    return operator new (size);
+}
+
+void operator delete (void *ptr) throw ()
+{
+    free (ptr);
+}
+
+void operator delete[] (void *ptr) throw ()
+{
+    free (ptr);
+}
+
+static inline uint64 _NowNsec ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static MsgPublication *_MakePub (IPEndPoint& creator, int nattrs)
+{
+    PointEvent ev;
+    for (int attr = 0; attr < nattrs; attr++) {
+	int v = (int) (drand48 () * BENCH_SPACE);
+	Constraint c (attr, Value (v), Value (v));
+	ev.AddConstraint (c);
+    }
+    return new MsgPublication (BENCH_HUB, creator, &ev, creator);
+}
+
+static void _TimePubPath (MsgPublication *pmsg, int nattrs, bool pool)
+{
+    int iters = g_MicrobenchPrefs.iters;
+    vector<uint64> lat (iters);
+    uint64 check = 0;
+
+    g_Preferences.packet_pool = pool;
+
+    // one round to fill the free lists
+    for (int i = 0; i < 2 && pool; i++) {
+	Packet *out = new Packet (pmsg->GetLength ());
+	pmsg->Serialize (out);
+	Packet *in = new Packet (BENCH_MSGSIZE);
+	memcpy (in->GetBuffer (), out->GetBuffer (), out->GetUsed ());
+	in->ResetBufPosition ();
+	in->IncrBufPosition (out->GetUsed ());
+	delete out;
+	in->ResetBufPosition ();
+	RecycleObject<Message> (CreateObject<Message> (in));
+	delete in;
+    }
+
+    uint64 allocs = s_NumAllocs;
+    uint64 start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	uint64 t = _NowNsec ();
+
+	// send
+	Packet *out = new Packet (pmsg->GetLength ());
+	pmsg->Serialize (out);
+
+	// receive
+	Packet *in = new Packet (BENCH_MSGSIZE);
+	memcpy (in->GetBuffer (), out->GetBuffer (), out->GetUsed ());
+	in->ResetBufPosition ();
+	in->IncrBufPosition (out->GetUsed ());
+	delete out;
+
+	in->ResetBufPosition ();
+	Message *msg = CreateObject<Message> (in);
+	check += ((MsgPublication *) msg)->GetEvent ()->GetNumConstraints ();
+	delete in;
+	RecycleObject<Message> (msg);
+
+	lat[i] = _NowNsec () - t;
+    }
+    uint64 elapsed = BenchNowUsec () - start;
+    allocs = s_NumAllocs - allocs;
+
+    sort (lat.begin (), lat.end ());
+    cout << merc_va ("%-4s attrs=%-3d allocs/pub=%-6.2f allocs/sec=%-12.1f pubs/sec=%-12.1f p50=%-6.2f p99=%-6.2f usec (%llu)",
+		     pool ? "pool" : "heap", nattrs, (double) allocs / iters, 
+		     BenchRate (allocs, elapsed), BenchRate (iters, elapsed),
+		     lat[iters / 2] / 1000.0, lat[(iters * 99) / 100] / 1000.0, check) << endl;
+}
+
+void BenchPool ()
+{
+    IPEndPoint creator (0x7f000001, 20001);
+    int nattrs[] = { 1, 3, 8 };
+    bool saved = g_Preferences.packet_pool;
+
+    for (uint32 n = 0; n < sizeof (nattrs) / sizeof (int); n++) {
+	MsgPublication *pmsg = _MakePub (creator, nattrs[n]);
+
+	_TimePubPath (pmsg, nattrs[n], false);
+	_TimePubPath (pmsg, nattrs[n], true);
+
+	delete pmsg;
+    }
+
+    g_Preferences.packet_pool = saved;
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
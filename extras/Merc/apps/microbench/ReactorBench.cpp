@@ -0,0 +1,288 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+
+/**************************************************************************
+  ReactorBench.cpp
+
+  One turn of a node's receive loop -- RealNet::DoWorkUsec, then
+  GetNextMessage -- on the TCP transport with N live connections, one of
+  which has a message waiting. "poll" is --use-poll: every turn each
+  transport refills the descriptor set, poll runs over all of them, and
+  TCPTransport::GetReadyConnection asks each connection in turn whether
+  it has data. "epoll" is --use-epoll: sockets were registered when they
+  were accepted and only the ready one comes back.
+
+  The other ends of the connections are in a child process, which sends
+  one message on connection k whenever the parent asks for k on a pipe.
+  The pipe round trip is in both numbers.
+
+  The poll path collects descriptors in an fd_set, so it cannot take
+  sockets numbered FD_SETSIZE (1024) or above; it is only timed where
+  the connections fit. select has the same limit and is left out.
+
+***************************************************************************/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <mercury/Message.h>
+#include <mercury/Packet.h>
+#include <wan-env/RealNet.h>
+#include <wan-env/WANScheduler.h>
+#include <wan-env/TCPTransport.h>
+#include "microbench.h"
+
+#define REACTOR_PEERPORT  20000      // app-level ids of the child's ends
+#define REACTOR_WAIT_USEC 10000      // DoWorkUsec timeout, as RealNet::DoWork
+#define REACTOR_SETUP_SEC 120        // to connect and hear from everyone
+
+// connections the child opens before waiting for the parent to hear
+// from them; more than the listen backlog and SYNs get dropped
+#define REACTOR_BATCH     (TCPTransport::MAX_PENDING_REQUESTS / 2)
+
+static bool _RaiseFdLimit (int nfds)
+{
+    struct rlimit rl;
+    if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < (rlim_t) nfds) {
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit (RLIMIT_NOFILE, &rl);
+	getrlimit (RLIMIT_NOFILE, &rl);
+    }
+    if (rl.rlim_cur < (rlim_t) nfds) {
+	cout << "fd limit " << rl.rlim_cur << " is too low for " << nfds << " sockets" << endl;
+	return false;
+    }
+    return true;
+}
+
+// the descriptor the next socket will get
+static int _NextFd ()
+{
+    int fd = dup (0);
+    if (fd >= 0)
+	close (fd);
+    return fd;
+}
+
+// a loopback port nobody is listening on right now
+static int _FreePort ()
+{
+    struct sockaddr_in a;
+    socklen_t len = sizeof (a);
+    memset (&a, 0, sizeof (a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    int sock = socket (AF_INET, SOCK_STREAM, 0);
+    int port = -1;
+    if (sock >= 0 && bind (sock, (struct sockaddr *) &a, sizeof (a)) == 0 &&
+	getsockname (sock, (struct sockaddr *) &a, &len) == 0)
+	port = ntohs (a.sin_port);
+    if (sock >= 0)
+	close (sock);
+    return port;
+}
+
+// the child: open 'nconns' connections to 'port', introduce each as
+// TCPTransport::_Connect_TCP does, and send 'pkt' once on each, a batch
+// at a time (the parent writes to 'cmd' once it has heard a batch).
+// Then send it again on connection k for every k read from 'cmd',
+// until EOF.
+static void _RunPeers (int port, int nconns, Packet *pkt, int cmd)
+{
+    struct sockaddr_in a;
+    memset (&a, 0, sizeof (a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    a.sin_port = htons (port);
+
+    // length-prefixed, as TCPTransport::_Send_TCP frames it
+    vector<byte> frame (sizeof (uint32) + pkt->GetUsed ());
+    uint32 len = htonl (pkt->GetUsed ());
+    memcpy (&frame[0], &len, sizeof (len));
+    memcpy (&frame[sizeof (len)], pkt->GetBuffer (), pkt->GetUsed ());
+
+    vector<int> socks;
+    int k;
+    for (int i = 0; i < nconns; i++) {
+	int sock = socket (AF_INET, SOCK_STREAM, 0);
+	if (sock < 0 || connect (sock, (struct sockaddr *) &a, sizeof (a)) < 0) {
+	    perror ("connect");
+	    _exit (1);
+	}
+	// as on the node's own sockets (which inherit it from the listen
+	// socket); otherwise each introduction waits out a delayed ack
+	int nonagle = 1;
+	setsockopt (sock, IPPROTO_TCP, TCP_NODELAY, (char *) &nonagle, sizeof (nonagle));
+
+	uint32 ip = a.sin_addr.s_addr;
+	uint16 id = htons (REACTOR_PEERPORT + i);
+	RealNet::WriteBlock (sock, (byte *) &ip, sizeof (ip));
+	RealNet::WriteBlock (sock, (byte *) &id, sizeof (id));
+	RealNet::WriteBlock (sock, &frame[0], frame.size ());
+	socks.push_back (sock);
+
+	if ((i + 1) % REACTOR_BATCH == 0 && read (cmd, &k, sizeof (k)) != sizeof (k))
+	    _exit (1);
+    }
+
+    while (read (cmd, &k, sizeof (k)) == sizeof (k)) {
+	if (k >= 0 && k < nconns)
+	    RealNet::WriteBlock (socks[k], &frame[0], frame.size ());
+    }
+    _exit (0);
+}
+
+// turn the node's receive loop until 'n' messages have come in, or
+// until 'deadline' (usecs; 0 = none). returns how many came in.
+static int _Receive (RealNet *net, int n, uint64 deadline)
+{
+    IPEndPoint from;
+    Message *msg;
+    int got = 0;
+
+    while (got < n) {
+	if (deadline > 0 && BenchNowUsec () > deadline)
+	    break;
+
+	RealNet::DoWorkUsec (REACTOR_WAIT_USEC);
+	while (got < n) {
+	    msg = NULL;
+	    if (net->GetNextMessage (&from, &msg) == CONN_NOMSG)
+		break;
+	    if (msg != NULL) {
+		net->FreeMessage (msg);
+		got++;
+	    }
+	}
+    }
+    return got;
+}
+
+static void _TimeTransport (const char *name, int nconns, bool epoll)
+{
+    int iters = g_MicrobenchPrefs.iters;
+
+    g_Preferences.use_epoll = epoll;
+    g_Preferences.use_poll  = !epoll;
+
+    int port = _FreePort ();
+    if (port < 0) {
+	cout << "no free port: " << strerror (errno) << endl;
+	return;
+    }
+
+    WANScheduler sched;
+    IPEndPoint self ((char *) "127.0.0.1", port);
+    RealNet *net = new RealNet (&sched, self);
+    net->StartListening (PROTO_TCP);
+
+    MsgLinkBreak msg (0, self);
+    Packet *pkt = SerializeMessage (&msg);
+
+    int cmd[2];
+    if (pipe (cmd) < 0) {
+	cout << "pipe failed: " << strerror (errno) << endl;
+	delete pkt;
+	delete net;
+	return;
+    }
+    pid_t pid = fork ();
+    if (pid == 0) {
+	close (cmd[1]);
+	_RunPeers (port, nconns, pkt, cmd[0]);
+    }
+    close (cmd[0]);
+
+    // everyone is accepted and registered once their first message is in
+    uint64 deadline = BenchNowUsec () + REACTOR_SETUP_SEC * USEC_IN_SEC;
+    int got = 0;
+    while (pid > 0 && got < nconns) {
+	int batch = MIN (REACTOR_BATCH, nconns - got);
+	int heard = _Receive (net, batch, deadline);
+	got += heard;
+	if (heard < batch)
+	    break;
+	if (got % REACTOR_BATCH == 0)
+	    write (cmd[1], &got, sizeof (got));
+    }
+
+    if (got < nconns) {
+	cout << name << " conns=" << nconns << ": heard from only " << got << endl;
+    }
+    else {
+	uint64 check = 0;
+	uint64 start = BenchNowUsec ();
+	for (int it = 0; it < iters; it++) {
+	    int k = (int) (drand48 () * nconns);
+	    write (cmd[1], &k, sizeof (k));
+	    check += _Receive (net, 1, 0);
+	}
+	uint64 elapsed = BenchNowUsec () - start;
+
+	cout << merc_va ("%-5s conns=%-6d rounds/sec=%-12.1f usec/round=%-8.2f (%llu)", name, nconns, 
+			 BenchRate (iters, elapsed), (double) elapsed / iters, check) << endl;
+    }
+
+    close (cmd[1]);
+    if (pid > 0)
+	waitpid (pid, NULL, 0);
+    delete pkt;
+    delete net;
+}
+
+void BenchReactor ()
+{
+    int nconns[] = { 1000, 10000 };
+    bool use_poll = g_Preferences.use_poll, use_epoll = g_Preferences.use_epoll;
+
+    for (uint32 n = 0; n < sizeof (nconns) / sizeof (int); n++) {
+	// (the child holds the other ends; the limit is per process)
+	if (!_RaiseFdLimit (nconns[n] + 64))
+	    continue;
+
+	// the listen socket, the pipe, and then one per connection
+	if (_NextFd () + 3 + nconns[n] <= FD_SETSIZE)
+	    _TimeTransport ("poll", nconns[n], false);
+	else
+	    cout << "poll  conns=" << nconns[n] << ": past FD_SETSIZE, not timed" << endl;
+
+	_TimeTransport ("epoll", nconns[n], true);
+    }
+
+    g_Preferences.use_poll = use_poll;
+    g_Preferences.use_epoll = use_epoll;
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,278 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+
+/**************************************************************************
+  RoutingTableBench.cpp
+
+  Checks RangeTable::Lookup (what MemberHub::GetNearestPeer now uses)
+  against the walk GetNearestPeer used to do over m_SortedPeers, on
+  random peer tables, and times both. Each of --iters trials builds 
+  three tables: a consistent one (a subset of one ring's ranges, some
+  wrapping), a stale one (some ranges moved at random) and one whose
+  ranges are changed one at a time afterwards, as Peer::SetRange does.
+  Any mismatch fails the check. Where peers share a range min, the old
+  map and the table may pick different ones to stand for them; those
+  are counted apart as "list-order ties".
+
+***************************************************************************/
+
+#include <map>
+#include <algorithm>
+#include <mercury/RangeTable.h>
+#include "microbench.h"
+
+#define BENCH_SPACE     1000      // small, so ranges collide and wrap
+#define BENCH_MAXPEERS  32
+#define BENCH_LOOKUPS   5000      // per table
+
+struct _BenchPeer {
+    NodeRange range;
+
+    _BenchPeer () : range (0, Value (0), Value (0)) {}
+    const NodeRange& GetRange () const { return range; }
+};
+
+class _BenchTable : public RangeTable<_BenchPeer> {
+ public:
+    _BenchTable (const Value& absmax) : RangeTable<_BenchPeer> (absmax) {}
+    bool IsOrdered () const { return m_Ordered; }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// the old lookup, as it was in Hub.cpp: m_SortedPeers was a map keyed by
+// pointers to each peer's range min, rebuilt from the peer lists (first
+// peer with a given min wins) whenever they changed.
+
+struct _less_value_ptr {
+    bool operator () (const Value *a, const Value *b) const {
+	return *a < *b;
+    }
+};
+
+typedef map<const Value *, _BenchPeer *, _less_value_ptr> _SortedPeers;
+
+static void _SortPeers (_SortedPeers& sorted, vector<_BenchPeer>& peers)
+{
+    sorted.clear ();
+    for (int i = 0, n = peers.size (); i < n; i++)
+	sorted.insert (_SortedPeers::value_type (&peers[i].range.GetMin (), &peers[i]));
+}
+
+// the same, but peers sharing a range min are taken in the order the 
+// table has them (the first to get a position there keeps it). the 
+// old map took them in peer list order; the two differ only once a 
+// peer's range changes to a min another peer already has.
+static void _SortPeers (_SortedPeers& sorted, _BenchTable& table)
+{
+    sorted.clear ();
+    for (int i = 0, n = table.Size (); i < n; i++) {
+	_BenchPeer *p = table[i].item;
+	sorted.insert (_SortedPeers::value_type (&p->range.GetMin (), p));
+    }
+}
+
+static bool _Less (const Value& val, const Value& other, const Value& absmax)
+{
+    if (val == absmax) 
+	return val <= other;
+    else
+	return val < other;
+}
+
+static _BenchPeer *_OldNearestPeer (_SortedPeers& sorted, const Value& val, const Value& absmax)
+{
+    _BenchPeer *nearest = NULL;
+
+    for (_SortedPeers::iterator it = sorted.begin (); it != sorted.end (); ++it) {
+	const NodeRange& cur = it->second->GetRange ();
+
+	_SortedPeers::iterator nit (it);
+	++nit;
+
+	if (nit != sorted.end ()) {
+	    const NodeRange& next = nit->second->GetRange ();
+
+	    Value comp = next.GetMax ();
+	    if (next.GetMin () > next.GetMax ())
+		comp = absmax;
+
+	    if (val >= cur.GetMax () && _Less (val, comp, absmax)) {
+		if (val < next.GetMin ())
+		    nearest = it->second;
+		else
+		    nearest = nit->second;
+		break;
+	    }
+	}
+	else {
+	    if (val >= cur.GetMax ())
+		nearest = it->second;
+	    else { 
+		const NodeRange& first = sorted.begin ()->second->GetRange ();
+		if (val >= first.GetMin ())
+		    nearest = sorted.begin ()->second;
+		else
+		    nearest = it->second;
+	    }
+	    break;
+	}
+    }
+    return nearest;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static Value _RandomValue ()
+{
+    return Value ((long) (drand48 () * BENCH_SPACE));
+}
+
+// a random subset of the ranges of a ring cut at random points; the 
+// last range wraps unless a cut falls on 0.
+static void _MakeRing (vector<_BenchPeer>& peers)
+{
+    int nodes = 1 + (int) (drand48 () * 2 * BENCH_MAXPEERS);
+    vector<long> cuts;
+    for (int i = 0; i < nodes; i++)
+	cuts.push_back ((long) (drand48 () * BENCH_SPACE));
+    sort (cuts.begin (), cuts.end ());
+    cuts.erase (unique (cuts.begin (), cuts.end ()), cuts.end ());
+
+    peers.clear ();
+    for (int i = 0, n = cuts.size (); i < n; i++) {
+	if (peers.size () >= BENCH_MAXPEERS || (drand48 () < 0.5 && i < n - 1))
+	    continue;
+	_BenchPeer p;
+	p.range = NodeRange (0, Value (cuts[i]), Value (cuts[(i + 1) % n]));
+	peers.push_back (p);
+    }
+    // the order peers reach the hub in is not ring order
+    for (int i = peers.size () - 1; i > 0; i--)
+	swap (peers[i], peers[(int) (drand48 () * (i + 1))]);
+}
+
+static void _MoveRange (_BenchPeer& p)
+{
+    if (drand48 () < 0.5)
+	p.range = NodeRange (0, _RandomValue (), p.range.GetMax ());
+    else
+	p.range = NodeRange (0, p.range.GetMin (), _RandomValue ());
+}
+
+struct _BenchCase {
+    const char *name;
+    uint64      tables, ordered, lookups, mismatches, ties;
+    uint64      oldUsec, newUsec;
+};
+
+static void _Compare (_BenchCase& c, vector<_BenchPeer>& peers, _BenchTable& table,
+		      const Value& absmax)
+{
+    _SortedPeers sorted, listed;
+    _SortPeers (sorted, table);
+    _SortPeers (listed, peers);
+
+    vector<Value> vals;
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+	vals.push_back (drand48 () < 0.01 ? absmax : _RandomValue ());
+
+    vector<_BenchPeer *> want (BENCH_LOOKUPS), got (BENCH_LOOKUPS);
+    uint64 start = BenchNowUsec ();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+	want[i] = _OldNearestPeer (sorted, vals[i], absmax);
+    c.oldUsec += BenchNowUsec () - start;
+
+    start = BenchNowUsec ();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+	got[i] = table.Lookup (vals[i]);
+    c.newUsec += BenchNowUsec () - start;
+
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+	if (want[i] != got[i])
+	    c.mismatches++;
+	if (_OldNearestPeer (listed, vals[i], absmax) != got[i])
+	    c.ties++;
+    }
+    c.lookups += BENCH_LOOKUPS;
+
+    // a lookup that falls through to the walk agrees trivially; count
+    // how often the binary search was what got checked
+    c.tables++;
+    if (table.IsOrdered ())
+	c.ordered++;
+}
+
+void BenchRoutingTable ()
+{
+    Value absmax (BENCH_SPACE);
+    _BenchCase cases[] = {
+	{ "consistent", 0, 0, 0, 0, 0, 0, 0 },
+	{ "stale",      0, 0, 0, 0, 0, 0, 0 },
+	{ "updated",    0, 0, 0, 0, 0, 0, 0 },
+    };
+
+    for (int t = 0; t < g_MicrobenchPrefs.iters; t++) {
+	vector<_BenchPeer> peers;
+	_MakeRing (peers);
+
+	// the table holds pointers into 'peers', which must not move now
+	_BenchTable table (absmax);
+	for (int i = 0, n = peers.size (); i < n; i++)
+	    table.Insert (&peers[i]);
+	_Compare (cases[0], peers, table, absmax);
+
+	for (int i = 0, n = peers.size (); i < n; i++) {
+	    if (drand48 () < 0.25) {
+		_MoveRange (peers[i]);
+		table.Update (&peers[i]);
+	    }
+	}
+	_Compare (cases[1], peers, table, absmax);
+
+	// back to a consistent ring, one peer at a time, checking as we go
+	vector<_BenchPeer> ring;
+	_MakeRing (ring);
+	for (int i = 0, n = MIN (peers.size (), ring.size ()); i < n; i++) {
+	    peers[i].range = ring[i].range;
+	    table.Update (&peers[i]);
+	    if (i % 4 == 3 || i == n - 1)
+		_Compare (cases[2], peers, table, absmax);
+	}
+    }
+
+    for (int i = 0; i < 3; i++) {
+	_BenchCase& c = cases[i];
+	cout << merc_va ("%-10s tables=%-6llu ordered=%-6llu lookups=%-10llu mismatches=%llu "
+			 "(list-order ties=%llu) %s", c.name, c.tables, c.ordered, c.lookups,
+			 c.mismatches, c.ties, c.mismatches == 0 ? "PASS" : "FAIL") << endl;
+	cout << merc_va ("%-10s old ops/sec=%-14.1f new ops/sec=%-14.1f", c.name,
+			 BenchRate (c.lookups, c.oldUsec), BenchRate (c.lookups, c.newUsec)) << endl;
+    }
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+/**************************************************************************
+  SerializeBench.cpp
+
+  CPU per sent message for big messages: a publication with many
+  attributes and a subscription list. "sized" is the old send path:
+  GetLength() for the size check and again for the packet, then
+  Serialize() into a packet of exactly that size. "onepass" is
+  SerializeMessage(): one Serialize() into a packet which grows.
+
+***************************************************************************/
+
+#include <mercury/Event.h>
+#include <mercury/Interest.h>
+#include <mercury/Message.h>
+#include <mercury/Packet.h>
+#include "microbench.h"
+
+#define BENCH_HUB       0
+#define BENCH_SPACE     100000
+
+static MsgPublication *_MakePub (IPEndPoint& creator, int nattrs)
+{
+    PointEvent ev;
+    for (int attr = 0; attr < nattrs; attr++) {
+	int v = (int) (drand48 () * BENCH_SPACE);
+	Constraint c (attr, Value (v), Value (v));
+	ev.AddConstraint (c);
+    }
+    return new MsgPublication (BENCH_HUB, creator, &ev, creator);
+}
+
+static MsgSubscriptionList *_MakeSubList (IPEndPoint& creator, int nsubs)
+{
+    MsgSubscriptionList *lmsg = new MsgSubscriptionList (BENCH_HUB, creator);
+    for (int i = 0; i < nsubs; i++) {
+	Interest in (creator, GUID::CreateRandom ());
+	for (int attr = 0; attr < 3; attr++) {
+	    int lo = (int) (drand48 () * BENCH_SPACE);
+	    Constraint c (attr, Value (lo), Value (lo + 1000));
+	    in.AddConstraint (c);
+	}
+	lmsg->AddSubscription (&in);
+    }
+    return lmsg;
+}
+
+static void _TimeSerialize (const char *name, int n, Message *msg, bool onepass)
+{
+    int iters = g_MicrobenchPrefs.iters;
+    uint64 check = 0;
+    int bytes = 0;
+
+    uint64 start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	Packet *pkt;
+	if (onepass) 
+	    pkt = SerializeMessage (msg);
+	else {
+	    int len = msg->GetLength ();
+	    check += len;
+	    pkt = new Packet (msg->GetLength ());
+	    msg->Serialize (pkt);
+	}
+	bytes = pkt->GetUsed ();
+	check += bytes;
+	delete pkt;
+    }
+    uint64 elapsed = BenchNowUsec () - start;
+
+    cout << merc_va ("%-7s n=%-4d %-7s bytes=%-6d msgs/sec=%-12.1f usec/msg=%-8.3f (%llu)", name, n,
+		     onepass ? "onepass" : "sized", bytes, BenchRate (iters, elapsed), 
+		     (double) elapsed / iters, check) << endl;
+}
+
+void BenchSerialize ()
+{
+    IPEndPoint creator (0x7f000001, 20001);
+    int nattrs[] = { 8, 32 };
+    int nsubs[] = { 64, 512 };
+
+    for (uint32 n = 0; n < sizeof (nattrs) / sizeof (int); n++) {
+	Message *msg = _MakePub (creator, nattrs[n]);
+	_TimeSerialize ("pub", nattrs[n], msg, false);
+	_TimeSerialize ("pub", nattrs[n], msg, true);
+	delete msg;
+    }
+
+    for (uint32 n = 0; n < sizeof (nsubs) / sizeof (int); n++) {
+	Message *msg = _MakeSubList (creator, nsubs[n]);
+	_TimeSerialize ("sublist", nsubs[n], msg, false);
+	_TimeSerialize ("sublist", nsubs[n], msg, true);
+	delete msg;
+    }
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
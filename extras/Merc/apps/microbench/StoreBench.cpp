@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  StoreBench.cpp
+
+  Matching throughput of the built-in pubsub stores. Stores N random
+  x/y/z subscriptions (x is the hub attribute) and times
+  GetOverlapSubs () for point publications.
+
+***************************************************************************/
+
+#include <mercury/PubsubStore.h>
+#include <mercury/Interest.h>
+#include <mercury/Event.h>
+#include <mercury/Message.h>
+#include "microbench.h"
+
+#define BENCH_HUB       0
+#define BENCH_NATTRS    3
+#define BENCH_SPACE     100000
+#define BENCH_SUBWIDTH  1000      // subscription side, in value units
+
+static Interest *_RandomInterest (IPEndPoint& sub)
+{
+    Interest *in = new Interest (sub, GUID::CreateRandom ());
+
+    for (int attr = 0; attr < BENCH_NATTRS; attr++) {
+	int lo = (int) (drand48 () * (BENCH_SPACE - BENCH_SUBWIDTH));
+	Constraint c (attr, Value (lo), Value (lo + (int) (drand48 () * BENCH_SUBWIDTH)));
+	in->AddConstraint (c);
+    }
+    return in;
+}
+
+static MsgPublication *_RandomPublication (IPEndPoint& creator)
+{
+    PointEvent ev;
+    for (int attr = 0; attr < BENCH_NATTRS; attr++) {
+	int v = (int) (drand48 () * BENCH_SPACE);
+	Constraint c (attr, Value (v), Value (v));
+	ev.AddConstraint (c);
+    }
+    return new MsgPublication (BENCH_HUB, creator, &ev, creator);
+}
+
+static void _TimeStore (const char *name, PubsubStore *store, vector<MsgPublication *>& pubs, int nsubs)
+{
+    uint64 nmatched = 0;
+    uint64 start = BenchNowUsec ();
+
+    for (int i = 0, len = pubs.size (); i < len; i++) {
+	list<Interest *> matches;
+	store->GetOverlapSubs (pubs[i], &matches);
+	nmatched += matches.size ();
+    }
+    uint64 elapsed = BenchNowUsec () - start;
+
+    cout << merc_va ("%-10s subs=%-7d pubs/sec=%-12.1f matches=%llu", name, nsubs,
+		     BenchRate (pubs.size (), elapsed), nmatched) << endl;
+}
+
+void BenchPubsubStore ()
+{
+    IPEndPoint sub (0x7f000001, 20000), creator (0x7f000001, 20001);
+    int sizes[] = { 1000, 10000, 100000 };
+
+    vector<MsgPublication *> pubs;
+    for (int i = 0; i < g_MicrobenchPrefs.iters; i++)
+	pubs.push_back (_RandomPublication (creator));
+
+    vector<Constraint> bounds;
+    for (int attr = 0; attr < BENCH_NATTRS; attr++)
+	bounds.push_back (Constraint (attr, Value (0), Value (BENCH_SPACE)));
+
+    for (uint32 s = 0; s < sizeof (sizes) / sizeof (int); s++) {
+	MercPubsubStore list_store;
+	IntervalPubsubStore interval_store (BENCH_HUB);
+	RTreePubsubStore rtree_store (BENCH_HUB, bounds);
+	SoAPubsubStore soa_store (BENCH_HUB, bounds);
+
+	for (int i = 0; i < sizes[s]; i++) {
+	    Interest *in = _RandomInterest (sub);
+	    list_store.StoreSub (in);
+	    interval_store.StoreSub (in);
+	    rtree_store.StoreSub (in);
+	    soa_store.StoreSub (in);
+	    delete in;
+	}
+
+	_TimeStore ("list", &list_store, pubs, sizes[s]);
+	_TimeStore ("interval", &interval_store, pubs, sizes[s]);
+	_TimeStore ("rtree", &rtree_store, pubs, sizes[s]);
+	_TimeStore (BoxOverlapKernelName (), &soa_store, pubs, sizes[s]);
+
+	list_store.Clear ();
+    }
+
+    for (int i = 0, len = pubs.size (); i < len; i++)
+	delete pubs[i];
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+/**************************************************************************
+  UDPFloodBench.cpp
+
+  Loopback UDP flood through the two UDPTransport paths. "single" is
+  the default: one sendto() per datagram out, and one recvmsg() per
+  datagram in, each into a freshly allocated MAX_UDP_MSGSIZE packet.
+  "batch=N" is --udp-batch N: N datagrams per sendmmsg()/recvmmsg(),
+  received into a ring and copied out into exactly-sized packets.
+
+***************************************************************************/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <mercury/Packet.h>
+#include "microbench.h"
+
+#define FLOOD_MSGSIZE  4096   // UDPTransport::MAX_UDP_MSGSIZE
+#define FLOOD_DGRAM    160    // about one small publication
+#define FLOOD_WINDOW   64     // datagrams in flight, well under SO_RCVBUF
+
+struct _flood_socks {
+    int                rd, wr;
+    struct sockaddr_in addr;
+};
+
+static bool _OpenFlood (_flood_socks *s)
+{
+    socklen_t len = sizeof (s->addr);
+    memset (&s->addr, 0, sizeof (s->addr));
+    s->addr.sin_family = AF_INET;
+    s->addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    s->rd = socket (AF_INET, SOCK_DGRAM, 0);
+    s->wr = socket (AF_INET, SOCK_DGRAM, 0);
+    if (s->rd < 0 || s->wr < 0 ||
+	bind (s->rd, (struct sockaddr *) &s->addr, sizeof (s->addr)) < 0 ||
+	getsockname (s->rd, (struct sockaddr *) &s->addr, &len) < 0) {
+	cout << "could not open sockets: " << strerror (errno) << endl;
+	return false;
+    }
+
+    // same receive-side setup as UDPTransport::StartListening
+    int on = 1;
+    fcntl (s->rd, F_SETFL, fcntl (s->rd, F_GETFL) | O_NONBLOCK);
+    setsockopt (s->rd, SOL_SOCKET, SO_TIMESTAMP, (char *) &on, sizeof (on));
+    return true;
+}
+
+static void _CloseFlood (_flood_socks *s)
+{
+    if (s->rd >= 0)
+	close (s->rd);
+    if (s->wr >= 0)
+	close (s->wr);
+}
+
+static void _Report (const char *name, int batch, int iters, uint64 elapsed, uint64 check)
+{
+    cout << merc_va ("%-6s batch=%-3d dgrams/sec=%-12.1f usec/dgram=%-8.3f (%llu)", name, batch,
+		     BenchRate (iters, elapsed), (double) elapsed / iters, check) << endl;
+}
+
+static void _TimeSingle (_flood_socks *s)
+{
+    int iters = g_MicrobenchPrefs.iters;
+    byte out[FLOOD_DGRAM];
+    char ctrl[CMSG_SPACE (sizeof (struct timeval))];
+    uint64 check = 0;
+
+    memset (out, 'x', sizeof (out));
+
+    uint64 start = BenchNowUsec ();
+    for (int done = 0; done < iters; ) {
+	int n = MIN (FLOOD_WINDOW, iters - done);
+	for (int i = 0; i < n; i++)
+	    sendto (s->wr, out, sizeof (out), 0, (struct sockaddr *) &s->addr, sizeof (s->addr));
+
+	for (int i = 0; i < n; ) {
+	    Packet *pkt = new Packet (FLOOD_MSGSIZE);
+	    struct sockaddr_in from;
+	    struct iovec iov;
+	    struct msghdr msg;
+
+	    memset (&msg, 0, sizeof (msg));
+	    iov.iov_base = pkt->GetBuffer ();
+	    iov.iov_len = pkt->GetMaxSize ();
+	    msg.msg_name = &from;
+	    msg.msg_namelen = sizeof (from);
+	    msg.msg_iov = &iov;
+	    msg.msg_iovlen = 1;
+	    msg.msg_control = ctrl;
+	    msg.msg_controllen = sizeof (ctrl);
+
+	    int len = recvmsg (s->rd, &msg, 0);
+	    if (len > 0) {
+		check += len;
+		i++;
+	    }
+	    delete pkt;
+	}
+	done += n;
+    }
+    _Report ("single", 1, iters, BenchNowUsec () - start, check);
+}
+
+static void _TimeBatch (_flood_socks *s, int batch)
+{
+    int iters = g_MicrobenchPrefs.iters;
+    int ctrllen = CMSG_SPACE (sizeof (struct timeval));
+    byte out[FLOOD_DGRAM];
+    uint64 check = 0;
+
+    vector<struct mmsghdr>     shdrs (batch), rhdrs (batch);
+    vector<struct iovec>       siovs (batch), riovs (batch);
+    vector<struct sockaddr_in> raddrs (batch);
+    vector<byte>               ring (batch * FLOOD_MSGSIZE);
+    vector<char>               ctrl (batch * ctrllen);
+
+    memset (out, 'x', sizeof (out));
+    memset (&shdrs[0], 0, batch * sizeof (struct mmsghdr));
+    memset (&rhdrs[0], 0, batch * sizeof (struct mmsghdr));
+    for (int i = 0; i < batch; i++) {
+	siovs[i].iov_base = out;
+	siovs[i].iov_len = sizeof (out);
+	shdrs[i].msg_hdr.msg_name = &s->addr;
+	shdrs[i].msg_hdr.msg_namelen = sizeof (s->addr);
+	shdrs[i].msg_hdr.msg_iov = &siovs[i];
+	shdrs[i].msg_hdr.msg_iovlen = 1;
+
+	riovs[i].iov_base = &ring[i * FLOOD_MSGSIZE];
+	riovs[i].iov_len = FLOOD_MSGSIZE;
+	rhdrs[i].msg_hdr.msg_name = &raddrs[i];
+	rhdrs[i].msg_hdr.msg_iov = &riovs[i];
+	rhdrs[i].msg_hdr.msg_iovlen = 1;
+	rhdrs[i].msg_hdr.msg_control = &ctrl[i * ctrllen];
+    }
+
+    uint64 start = BenchNowUsec ();
+    for (int done = 0; done < iters; ) {
+	int n = MIN (MIN (FLOOD_WINDOW, batch), iters - done);
+	for (int sent = 0; sent < n; ) {
+	    int ret = sendmmsg (s->wr, &shdrs[sent], n - sent, 0);
+	    if (ret > 0)
+		sent += ret;
+	}
+
+	for (int got = 0; got < n; ) {
+	    for (int i = 0; i < batch; i++) {
+		rhdrs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+		rhdrs[i].msg_hdr.msg_controllen = ctrllen;
+	    }
+	    int ret = recvmmsg (s->rd, &rhdrs[0], batch, MSG_DONTWAIT, NULL);
+	    for (int i = 0; i < ret; i++) {
+		int len = rhdrs[i].msg_len;
+		Packet *pkt = new Packet (len);
+		memcpy (pkt->GetBuffer (), &ring[i * FLOOD_MSGSIZE], len);
+		check += len;
+		delete pkt;
+	    }
+	    if (ret > 0)
+		got += ret;
+	}
+	done += n;
+    }
+    _Report ("batch", batch, iters, BenchNowUsec () - start, check);
+}
+
+void BenchUDPFlood ()
+{
+    int batches[] = { 8, 32, 64 };
+
+    _flood_socks s;
+    if (!_OpenFlood (&s)) {
+	_CloseFlood (&s);
+	return;
+    }
+
+    _TimeSingle (&s);
+    for (uint32 b = 0; b < sizeof (batches) / sizeof (int); b++)
+	_TimeBatch (&s, batches[b]);
+
+    _CloseFlood (&s);
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
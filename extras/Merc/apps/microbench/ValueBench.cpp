@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  ValueBench.cpp
+
+  Cost of Value on the routing and matching hot paths: the range scan
+  MemberHub::GetNearestPeer does, Constraint::GetRouteDirections, 
+  Constraint::Overlaps/Covers, and (de)serializing constraints. Run it
+  once per Value build (default GMP, VALUE=fixed64, VALUE=fixed128) to
+  compare them.
+
+***************************************************************************/
+
+#include <mercury/Constraint.h>
+#include <mercury/Packet.h>
+#include "microbench.h"
+
+#define BENCH_NPEERS    64        // ranges in the routing scan
+#define BENCH_SPACE     (1 << 30)
+
+#ifndef MERCURY_FIXED_VALUE
+#define BENCH_VALUE_NAME "gmp"
+#elif MERCURY_FIXED_VALUE == 128
+#define BENCH_VALUE_NAME "fixed128"
+#else
+#define BENCH_VALUE_NAME "fixed64"
+#endif
+
+static Value _RandomValue ()
+{
+    return Value ((long) (drand48 () * BENCH_SPACE));
+}
+
+static void _Report (const char *name, uint64 ops, uint64 elapsed, uint64 check)
+{
+    cout << merc_va ("%-8s %-16s ops/sec=%-14.1f (%llu)", BENCH_VALUE_NAME, name,
+		     BenchRate (ops, elapsed), check) << endl;
+}
+
+// the comparisons of MemberHub::GetNearestPeer, over sorted ranges
+static int _NearestRange (vector<NodeRange>& ranges, const Value& val)
+{
+    for (int i = 0, len = ranges.size (); i < len - 1; i++) {
+	const NodeRange& cur = ranges[i];
+	const NodeRange& next = ranges[i + 1];
+
+	if (val >= cur.GetMax () && val < next.GetMax ())
+	    return val < next.GetMin () ? i : i + 1;
+    }
+    return ranges.size () - 1;
+}
+
+void BenchValue ()
+{
+    int iters = g_MicrobenchPrefs.iters;
+    vector<Value> vals;
+    vector<Constraint> csts;
+    for (int i = 0; i < iters; i++) {
+	vals.push_back (_RandomValue ());
+	Value lo = _RandomValue ();
+	csts.push_back (Constraint (0, lo, lo + Value ((long) (drand48 () * 1000))));
+    }
+
+    vector<NodeRange> ranges;
+    for (int i = 0; i < BENCH_NPEERS; i++)
+	ranges.push_back (NodeRange (0, Value ((long) i * (BENCH_SPACE / BENCH_NPEERS)),
+				     Value ((long) (i + 1) * (BENCH_SPACE / BENCH_NPEERS))));
+
+    uint64 check = 0, start, elapsed;
+
+    start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++)
+	check += _NearestRange (ranges, vals[i]);
+    elapsed = BenchNowUsec () - start;
+    _Report ("nearest-peer", iters, elapsed, check);
+
+    check = 0;
+    start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	bool left, center, right;
+	csts[i].GetRouteDirections (ranges[i % BENCH_NPEERS], left, center, right, false);
+	check += left + center + right;
+    }
+    elapsed = BenchNowUsec () - start;
+    _Report ("route-directions", iters, elapsed, check);
+
+    check = 0;
+    start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	const Constraint& c = csts[i];
+	check += c.Overlaps (csts[(i + 1) % iters]) + c.Covers (vals[i]);
+	check += IsBetween (vals[i], c.GetMin (), c.GetMax ());
+    }
+    elapsed = BenchNowUsec () - start;
+    _Report ("match", iters, elapsed, check);
+
+    check = 0;
+    start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	Packet pkt (csts[i].GetLength ());
+	csts[i].Serialize (&pkt);
+	pkt.ResetBufPosition ();
+	Constraint c (&pkt);
+	check += c.GetAttrIndex () + pkt.GetUsed ();
+    }
+    elapsed = BenchNowUsec () - start;
+    _Report ("serialize", iters, elapsed, check);
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
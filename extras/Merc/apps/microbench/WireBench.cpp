@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+/**************************************************************************
+  WireBench.cpp
+
+  Serialize and deserialize throughput of the messages which go
+  through the PacketWriter/PacketReader fast path: pubs, subs,
+  liveness pings and bare constraints. Deserializing a pub or sub is
+  what a forwarding hop does: the event (interest) is left undecoded.
+
+***************************************************************************/
+
+#include <mercury/Event.h>
+#include <mercury/Interest.h>
+#include <mercury/Message.h>
+#include <mercury/Packet.h>
+#include "microbench.h"
+
+#define BENCH_HUB       0
+#define BENCH_SPACE     100000
+#define BENCH_NATTRS    4
+
+static Constraint _MakeConstraint (int attr, int width)
+{
+    int lo = (int) (drand48 () * BENCH_SPACE);
+    return Constraint (attr, Value (lo), Value (lo + width));
+}
+
+static void _Report (const char *name, const char *what, int bytes, int iters, uint64 elapsed)
+{
+    cout << merc_va ("%-8s %-6s bytes=%-5d ops/sec=%-12.1f usec/op=%-7.3f MB/sec=%.1f", 
+		     name, what, bytes, BenchRate (iters, elapsed), (double) elapsed / iters, 
+		     BenchRate ((uint64) iters * bytes, elapsed) / (1024 * 1024)) << endl;
+}
+
+// the packet is reused, as the send path would with --packet-pool
+static void _TimeMessage (const char *name, Message *msg)
+{
+    int iters = g_MicrobenchPrefs.iters;
+    Packet pkt (Packet::DEFAULT_PACKET_SIZE);
+    uint32 check = 0;
+
+    uint64 start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	pkt.ResetBufPosition ();
+	msg->Serialize (&pkt);
+    }
+    uint64 elapsed = BenchNowUsec () - start;
+    int bytes = pkt.GetBufPosition ();
+    _Report (name, "ser", bytes, iters, elapsed);
+
+    start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	pkt.ResetBufPosition ();
+	Message *copy = CreateObject<Message> (&pkt);
+	check += copy->nonce;
+	delete copy;
+    }
+    elapsed = BenchNowUsec () - start;
+    _Report (name, "deser", bytes, iters, elapsed);
+
+    if (check != (uint32) iters * msg->nonce)
+	cout << name << ": deserialized nonce does not match" << endl;
+}
+
+static void _TimeConstraint (const char *name, Constraint& cst)
+{
+    int iters = g_MicrobenchPrefs.iters;
+    Packet pkt (Packet::DEFAULT_PACKET_SIZE);
+    int check = 0;
+
+    uint64 start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	pkt.ResetBufPosition ();
+	cst.Serialize (&pkt);
+    }
+    uint64 elapsed = BenchNowUsec () - start;
+    int bytes = pkt.GetBufPosition ();
+    _Report (name, "ser", bytes, iters, elapsed);
+
+    start = BenchNowUsec ();
+    for (int i = 0; i < iters; i++) {
+	pkt.ResetBufPosition ();
+	Constraint copy (&pkt);
+	check += copy.GetAttrIndex ();
+    }
+    elapsed = BenchNowUsec () - start;
+    _Report (name, "deser", bytes, iters, elapsed);
+
+    if (check != iters * cst.GetAttrIndex ())
+	cout << name << ": deserialized attr does not match" << endl;
+}
+
+void BenchWire ()
+{
+    IPEndPoint creator (0x7f000001, 20001);
+
+    Constraint cst = _MakeConstraint (1, 1000);
+    _TimeConstraint ("cst", cst);
+
+    NodeRange range = _MakeConstraint (BENCH_HUB, BENCH_SPACE / 4);
+    MsgLivenessPing ping (BENCH_HUB, creator, range, 7);
+    _TimeMessage ("ping", &ping);
+
+    PointEvent ev;
+    for (int attr = 0; attr < BENCH_NATTRS; attr++) {
+	Constraint c = _MakeConstraint (attr, 0);
+	ev.AddConstraint (c);
+    }
+    MsgPublication pub (BENCH_HUB, creator, &ev, creator);
+    _TimeMessage ("pub", &pub);
+
+    Interest in (creator, GUID::CreateRandom ());
+    for (int attr = 0; attr < BENCH_NATTRS; attr++) {
+	Constraint c = _MakeConstraint (attr, 1000);
+	in.AddConstraint (c);
+    }
+    MsgSubscription sub (BENCH_HUB, creator, &in, creator);
+    _TimeMessage ("sub", &sub);
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+#include <Mercury.h>
+#include <util/debug.h>
+#include <util/Options.h>
+#include <unistd.h>
+#include "microbench.h"
+
+struct _microbench_prefs_t g_MicrobenchPrefs;
+
+OptionType g_MicrobenchOptions [] = 
+    {
+	{ '#', "bench", OPT_STR, "benchmark to run (or 'all')",
+	  g_MicrobenchPrefs.bench, "all", NULL },
+	{ '#', "iters", OPT_INT, "number of operations to time per data point",
+	  &g_MicrobenchPrefs.iters, "1000", NULL },
+	{ 0, 0, 0, 0, 0, 0, 0 }
+    };
+
+typedef struct {
+    const char *name;
+    void      (*func) ();
+} BenchEntry;
+
+static BenchEntry g_Benchmarks [] = {
+    { "pubsubstore", BenchPubsubStore },
+    { "value",       BenchValue },
+    { "forward",     BenchForward },
+    { "reactor",     BenchReactor },
+    { "udpflood",    BenchUDPFlood },
+    { "pool",        BenchPool },
+    { "serialize",   BenchSerialize },
+    { "wire",        BenchWire },
+    { "hubthreads",  BenchHubThreads },
+    { "routingtable", BenchRoutingTable },
+    { NULL, NULL }
+};
+
+int main (int argc, char *argv[])
+{
+    DBG_INIT (&SID_NONE);
+    InitializeMercury (&argc, argv, g_MicrobenchOptions, false);
+    srand48 (42);
+
+    bool ran = false;
+    for (BenchEntry *b = g_Benchmarks; b->name != NULL; b++) {
+	if (strcmp (g_MicrobenchPrefs.bench, "all") && strcmp (g_MicrobenchPrefs.bench, b->name))
+	    continue;
+
+	cout << "==== " << b->name << " ====" << endl;
+	b->func ();
+	ran = true;
+    }
+
+    if (!ran) {
+	cerr << "unknown benchmark: " << g_MicrobenchPrefs.bench << endl;
+	return 1;
+    }
+    return 0;
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  microbench.h
+
+  Small, single-process benchmarks for the hot paths inside a Mercury
+  node (matching, serialization, ...). Each benchmark is a function
+  registered in the table in main.cpp and selected with --bench.
+
+***************************************************************************/
+
+#ifndef __MICROBENCH__H
+#define __MICROBENCH__H
+
+#include <mercury/common.h>
+#include <util/TimeVal.h>
+
+struct _microbench_prefs_t {
+    char bench[255];
+    int  iters;
+};
+
+extern struct _microbench_prefs_t g_MicrobenchPrefs;
+
+// wall clock in usecs; no slowdown games
+inline uint64 BenchNowUsec () {
+    TimeVal v;
+    gettimeofday (&v, NULL);
+    return ((uint64) v.tv_sec * USEC_IN_SEC) + v.tv_usec;
+}
+
+inline double BenchRate (uint64 count, uint64 usecs) {
+    return usecs == 0 ? 0.0 : (double) count * USEC_IN_SEC / usecs;
+}
+
+/// benchmarks
+void BenchPubsubStore ();
+void BenchValue ();
+void BenchForward ();
+void BenchReactor ();
+void BenchUDPFlood ();
+void BenchPool ();
+void BenchSerialize ();
+void BenchWire ();
+void BenchHubThreads ();
+void BenchRoutingTable ();
+
+#endif // __MICROBENCH__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+////////////////////////////////////////////////////////////////////////////////
+
+// Handover cost against store size. Once the ring has formed, one node
+// is filled, in a few growing steps, with subscriptions and triggers 
+// drawn from its own range and its predecessor's, as it would hold them
+// just before the predecessor joined and took its share. At every step
+// it hands over to the predecessor and we time that; about the 
+// predecessor's share of the items (half, on an even ring) moves each
+// time. The moved items are put back (untimed) after every handover, 
+// so each rep moves the same state. Run it once per --pubsub-store to 
+// compare what finding and deleting them costs in each store.
+
+#include <mercury/PubsubRouter.h>
+
+typedef vector<SimMercuryNode *> MNVec;
+typedef MNVec::iterator MNVecIter;
+
+MNVec nlist;
+
+#define CHURN_REPS      5          // handovers timed per store size
+#define CHURN_SUBWIDTH  0.01       // subscription side, as a fraction of the filled span
+
+static int s_ChurnSizes[] = { 1000, 4000, 16000, 64000 };
+
+class CreateNodeEvent : public SchedulerEvent {
+    SimMercuryNode *m_Node;
+public:
+    CreateNodeEvent (SimMercuryNode *n) : m_Node (n) {}
+
+    void Execute (Node& node, TimeVal& timenow) {
+	m_Node->StartUp ();
+    }
+};
+
+static uint64 _NowUsec ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (uint64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// a random value in 'range' (which may wrap around the attribute)
+static Value _RandomValueIn (const NodeRange& range, double span)
+{
+    const Value& absmin = g_MercuryAttrRegistry[range.GetAttrIndex ()].absmin;
+    const Value& absmax = g_MercuryAttrRegistry[range.GetAttrIndex ()].absmax;
+
+    Value v = range.GetMin ();
+    v += Value ((uint32) (drand48 () * span));
+    if (v > absmax) {
+	v -= absmax;
+	v += absmin;
+    }
+    return v;
+}
+
+static Constraint _RandomConstraintIn (const NodeRange& range, double span)
+{
+    const Value& absmax = g_MercuryAttrRegistry[range.GetAttrIndex ()].absmax;
+
+    Value lo = _RandomValueIn (range, span);
+    Value hi = lo;
+    hi += Value ((uint32) (drand48 () * CHURN_SUBWIDTH * span));
+    if (hi > absmax)
+	hi = absmax;
+    return Constraint (range.GetAttrIndex (), lo, hi);
+}
+
+static void _AddSub (SimMercuryNode *self, Constraint c, TimeVal& timenow, uint32 lifetime)
+{
+    Interest *in = new Interest (self->GetAddress (), GUID::CreateRandom ());
+    in->AddConstraint (c);
+    in->SetLifeTime (lifetime);
+    in->SetDeathTime (timenow + lifetime);
+    PM(self)->AddNewInterest (in);
+    delete in;
+}
+
+static void _AddTrigger (SimMercuryNode *self, Constraint c, uint32 lifetime)
+{
+    IPEndPoint me = self->GetAddress ();
+    MercuryEvent ev;
+    ev.AddConstraint (c);
+    ev.SetLifeTime (lifetime);
+    MsgPublication *pmsg = new MsgPublication (GetHub (self)->GetID (), me, &ev, me);
+    PM(self)->AddNewTrigger (pmsg);
+    delete pmsg;
+}
+
+class ChurnEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+public:
+    ChurnEvent (MNVec *n) : m_Nodes (n) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	SimMercuryNode *self = (*m_Nodes)[m_Nodes->size () / 2];
+	MemberHub *hub = GetHub (self);
+
+	if (hub->GetPredecessor () == NULL) {
+	    cerr << "churn: " << self->GetAddress () << " has not joined; giving up" << endl;
+	    return;
+	}
+
+	// the span from the start of the predecessor's range to the end
+	// of ours: what we held before the predecessor took its share.
+	NodeRange range = *hub->GetRange ();
+	const NodeRange& prange = hub->GetPredecessor ()->GetRange ();
+	NodeRange filled (range.GetAttrIndex (), prange.GetMin (), range.GetMax ());
+	Value pspan = prange.GetSpan (hub->GetAbsMin (), hub->GetAbsMax () - MercuryID(1));
+	double span = pspan.getd () + hub->GetRangeSpan ().getd ();
+	IPEndPoint pred = hub->GetPredecessor ()->GetAddress ();
+
+	uint32 lifetime = g_DriverPrefs.simulation_time * 1000;
+
+	// the handover deletes whatever no longer overlaps our range;
+	// keep those to put back between reps. The router only stores 
+	// items overlapping the hub's range, so we own 'filled' again 
+	// while adding them.
+	vector<Constraint> moved_subs, moved_trigs;
+
+	int nstored = 0;
+	for (uint32 s = 0; s < sizeof (s_ChurnSizes) / sizeof (int); s++) {
+	    hub->SetRange (filled);
+	    for ( ; nstored < s_ChurnSizes[s]; nstored++) {
+		Constraint c = _RandomConstraintIn (filled, span);
+		_AddSub (self, c, timenow, lifetime);
+		if (!c.OverlapsNodeRange (range))
+		    moved_subs.push_back (c);
+
+		c = _RandomConstraintIn (filled, span);
+		_AddTrigger (self, c, lifetime);
+		if (!c.OverlapsNodeRange (range))
+		    moved_trigs.push_back (c);
+	    }
+	    hub->SetRange (range);
+
+	    uint64 subs_usec = 0, trig_usec = 0;
+	    int nsubs = 0, ntrigs = 0;
+	    for (int r = 0; r < CHURN_REPS; r++) {
+		uint64 start = _NowUsec ();
+		vector<int> ss = PM(self)->HandoverSubscriptions (&pred);
+		subs_usec += _NowUsec () - start;
+
+		start = _NowUsec ();
+		vector<int> st = PM(self)->HandoverTriggers (&pred);
+		trig_usec += _NowUsec () - start;
+
+		nsubs += ss[0];
+		ntrigs += st[0];
+
+		hub->SetRange (filled);
+		for (uint32 i = 0; i < moved_subs.size (); i++)
+		    _AddSub (self, moved_subs[i], timenow, lifetime);
+		for (uint32 i = 0; i < moved_trigs.size (); i++)
+		    _AddTrigger (self, moved_trigs[i], lifetime);
+		hub->SetRange (range);
+	    }
+
+	    cout << merc_va ("churn store=%s items=%d handover_subs_usec=%.1f handover_triggers_usec=%.1f handed_subs=%d handed_triggers=%d",
+			     g_Preferences.pubsub_store, nstored,
+			     (double) subs_usec / CHURN_REPS, (double) trig_usec / CHURN_REPS, 
+			     nsubs / CHURN_REPS, ntrigs / CHURN_REPS) << endl;
+	}
+    }
+};
+
+void create_nodes (MNVec *p_nlist)
+{
+    DummyApp *app = new DummyApp ();     // dont care about leak!
+
+    for (int i = 0; i < g_DriverPrefs.nodes; i++) {
+	IPEndPoint ip ("gs203.sp.cs.cmu.edu", i + 1);
+	SimMercuryNode *mn = new SimMercuryNode (g_Simulator, g_Simulator, ip);
+
+	mn->RegisterApplication (app);
+	g_Simulator->AddNode (*mn);
+	p_nlist->push_back (mn);
+
+	g_Simulator->RaiseEvent (new refcounted<CreateNodeEvent> (mn), SID_NONE, 100 + i * g_DriverPrefs.inter_arrival_time);
+    }
+}
+
+void run_script () {
+    int tjoin = g_DriverPrefs.nodes * g_DriverPrefs.inter_arrival_time + 5000;
+    g_Simulator->RaiseEvent (new refcounted<ChurnEvent> (&nlist), SID_NONE, tjoin);
+
+    create_nodes (&nlist);
+}
+
+void finish_script () 
+{
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
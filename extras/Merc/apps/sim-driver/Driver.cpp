@@ -162,7 +162,13 @@ void start_bootstrap ()
 
 // #include "LoadTest.cxx"
 #include "PubTest.cxx"
+// #include "ChurnTest.cxx"
+// #include "RoutedPubTest.cxx"
+// #include "RangeTest.cxx"
+// #include "SubTest.cxx"
 // #include "SampleTest.cxx"
+// #include "PlacementTest.cxx"
+// #include "ProximityTest.cxx"
 
 int main (int argc, char *argv[])
 {
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+////////////////////////////////////////////////////////////////////////////////
+
+// Join placement under skewed load (the bootstrap's --policy). The 
+// first PL_SEEDS nodes form the ring; then a steady stream of pubs 
+// starts, most of them in a hot spot, and the rest of the nodes join 
+// one every --arrive-int. Every PL_SAMPLE msecs we count how many of
+// the pubs since the last sample landed in each joined node's range 
+// (its rendezvous load) and print the max/mean ratio. The time to 
+// balance is how long after the first of those joins the ratio drops
+// to PL_TARGET for good; a policy which splits the hot ranges should
+// get there in fewer joins, or never leave it. The nodes only measure
+// their load with --loadbal-routeload, which --policy load-aware 
+// needs.
+//
+// The nodes sit at random in a plane, and the RTT between two is their
+// distance. When a node is first seen joined, we note its RTT to its 
+// successor and predecessor; with --place-candidates > 1 it should have
+// picked a position near them.
+
+#include <mercury/PubsubRouter.h>
+
+typedef vector<SimMercuryNode *> MNVec;
+typedef MNVec::iterator MNVecIter;
+
+MNVec nlist;
+
+#define PL_SEEDS        4
+#define PL_SETTLE       15000      // msecs for the seeds to form the ring
+#define PL_TICK         100        // msecs between bursts of pubs
+#define PL_PUBS         20         // pubs per burst
+#define PL_HOTSPOT      0.1        // the hot spot, as a fraction of the attribute
+#define PL_HOTFRAC      0.8        // fraction of pubs in the hot spot
+#define PL_SAMPLE       5000       // msecs between samples
+#define PL_TARGET       3.0
+#define PL_PLANE        300.0      // side of the plane, in msec of RTT
+#define PL_MINRTT       2.0        // between any two nodes
+
+static vector<Value> s_Window;     // the values published since the last sample
+static int s_tJoins;               // when the non-seed nodes start joining
+static int s_tBalanced;            // the first sample since which we are at PL_TARGET
+static int s_JoinsToBalance;
+static double s_LastRatio;
+
+static vector< vector<float> > s_RTT;       // by node index (port - 1)
+static vector<bool> s_Seen;                  // joined when last looked
+static vector<double> s_NbrRTT;              // to succ + pred, at join
+
+static int _NodeIndex (const IPEndPoint& addr)
+{
+    int i = (int) addr.GetPort () - 1;
+    return i >= 0 && i < (int) s_RTT.size () ? i : -1;
+}
+
+static u_long _Latency (IPEndPoint& from, IPEndPoint& to)
+{
+    int a = _NodeIndex (from), b = _NodeIndex (to);
+
+    // the bootstrap is not on the map
+    if (a < 0 || b < 0)
+	return Simulator::NODE_TO_NODE_LATENCY;
+    return (u_long) (s_RTT[a][b] / 2);
+}
+
+static void _MakeRandomMap (int n)
+{
+    vector<double> x (n), y (n);
+    for (int i = 0; i < n; i++) {
+	x[i] = drand48 () * PL_PLANE;
+	y[i] = drand48 () * PL_PLANE;
+    }
+
+    s_RTT = vector< vector<float> > (n, vector<float> (n, 0));
+    for (int i = 0; i < n; i++) {
+	for (int j = 0; j < n; j++) {
+	    if (i != j)
+		s_RTT[i][j] = MAX (PL_MINRTT, sqrt ((x[i] - x[j]) * (x[i] - x[j]) + (y[i] - y[j]) * (y[i] - y[j])));
+	}
+    }
+}
+
+class CreateNodeEvent : public SchedulerEvent {
+    SimMercuryNode *m_Node;
+public:
+    CreateNodeEvent (SimMercuryNode *n) : m_Node (n) {}
+
+    void Execute (Node& node, TimeVal& timenow) {
+	m_Node->StartUp ();
+    }
+};
+
+static Value _SkewedValue ()
+{
+    const Value& absmin = g_MercuryAttrRegistry[0].absmin;
+    const Value& absmax = g_MercuryAttrRegistry[0].absmax;
+    double span = absmax.getd () - absmin.getd ();
+
+    // the hot spot sits in the middle of the attribute
+    double off;
+    if (drand48 () < PL_HOTFRAC)
+	off = (0.5 - PL_HOTSPOT / 2 + drand48 () * PL_HOTSPOT) * span;
+    else
+	off = drand48 () * span;
+
+    Value v = absmin;
+    v += Value ((uint32) off);
+    return v;
+}
+
+static bool _HasJoined (SimMercuryNode *n)
+{
+    MemberHub *hub = GetHub (n);
+    return hub != NULL && hub->GetRange () != NULL && hub->GetPredecessor () != NULL;
+}
+
+// the neighbors of a joiner change as more nodes join, so look at 
+// them as soon as it has joined
+static void _NoteNewJoins (MNVec *nodes)
+{
+    for (int i = PL_SEEDS, len = nodes->size (); i < len; i++) {
+	if (s_Seen[i] || !_HasJoined ((*nodes)[i]))
+	    continue;
+	s_Seen[i] = true;
+
+	MemberHub *hub = GetHub ((*nodes)[i]);
+	if (hub->GetSuccessor () == NULL)
+	    continue;
+	int succ = _NodeIndex (hub->GetSuccessor ()->GetAddress ());
+	int pred = _NodeIndex (hub->GetPredecessor ()->GetAddress ());
+	if (succ >= 0 && pred >= 0)
+	    s_NbrRTT.push_back (s_RTT[i][succ] + s_RTT[i][pred]);
+    }
+}
+
+class SendPubsEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+public:
+    SendPubsEvent (MNVec *n) : m_Nodes (n) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	_NoteNewJoins (m_Nodes);
+	for (int i = 0; i < PL_PUBS; i++) {
+	    SimMercuryNode *self = (*m_Nodes)[(int) (drand48 () * PL_SEEDS)];
+	    Value v = _SkewedValue ();
+
+	    MercuryEvent *ev = new MercuryEvent ();
+	    Constraint c (0, v, v);
+	    ev->AddConstraint (c);
+	    self->SendEvent (ev);
+	    delete ev;
+	    s_Window.push_back (v);
+	}
+	g_Simulator->RaiseEvent (new refcounted<SendPubsEvent> (m_Nodes), SID_NONE, PL_TICK);
+    }
+};
+
+class SampleEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+    int m_Time;
+public:
+    SampleEvent (MNVec *n, int t) : m_Nodes (n), m_Time (t) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	int joined = 0, max = 0, total = 0;
+	for (MNVecIter it = m_Nodes->begin (); it != m_Nodes->end (); ++it) {
+	    if (!_HasJoined (*it))
+		continue;
+
+	    NodeRange *range = GetHub (*it)->GetRange ();
+	    int load = 0;
+	    for (int i = 0, len = s_Window.size (); i < len; i++) {
+		if (Constraint (0, s_Window[i], s_Window[i]).OverlapsNodeRange (*range))
+		    load++;
+	    }
+	    joined++;
+	    total += load;
+	    if (load > max)
+		max = load;
+	}
+	s_Window.clear ();
+
+	if (joined > 0 && total > 0) {
+	    s_LastRatio = (double) max * joined / total;
+	    if (m_Time >= s_tJoins && s_LastRatio > PL_TARGET)
+		s_tBalanced = -1;
+	    else if (m_Time >= s_tJoins && s_tBalanced < 0) {
+		s_tBalanced = m_Time;
+		s_JoinsToBalance = joined - PL_SEEDS;
+	    }
+	    cout << merc_va ("placement t=%d joined=%d max/mean=%.2f", m_Time, joined, s_LastRatio) << endl;
+	}
+	g_Simulator->RaiseEvent (new refcounted<SampleEvent> (m_Nodes, m_Time + PL_SAMPLE), SID_NONE, PL_SAMPLE);
+    }
+};
+
+void create_nodes (MNVec *p_nlist)
+{
+    DummyApp *app = new DummyApp ();     // dont care about leak!
+
+    for (int i = 0; i < g_DriverPrefs.nodes; i++) {
+	IPEndPoint ip ("gs203.sp.cs.cmu.edu", i + 1);
+	SimMercuryNode *mn = new SimMercuryNode (g_Simulator, g_Simulator, ip);
+
+	mn->RegisterApplication (app);
+	g_Simulator->AddNode (*mn);
+	p_nlist->push_back (mn);
+
+	int t = 100 + i * g_DriverPrefs.inter_arrival_time;
+	if (i >= PL_SEEDS)
+	    t = s_tJoins + (i - PL_SEEDS) * g_DriverPrefs.inter_arrival_time;
+	g_Simulator->RaiseEvent (new refcounted<CreateNodeEvent> (mn), SID_NONE, t);
+    }
+}
+
+void run_script () {
+    int tload = PL_SEEDS * g_DriverPrefs.inter_arrival_time + PL_SETTLE;
+    // let the seeds measure the load first
+    s_tJoins = tload + 10000;
+    s_tBalanced = -1;
+
+    _MakeRandomMap (g_DriverPrefs.nodes);
+    s_Seen = vector<bool> (g_DriverPrefs.nodes, false);
+    g_Simulator->SetLatencyFunc (_Latency);
+
+    g_Simulator->RaiseEvent (new refcounted<SendPubsEvent> (&nlist), SID_NONE, tload);
+    g_Simulator->RaiseEvent (new refcounted<SampleEvent> (&nlist, tload + PL_SAMPLE), SID_NONE, tload + PL_SAMPLE);
+
+    create_nodes (&nlist);
+}
+
+void finish_script () 
+{
+    double nbr = 0;
+    for (int i = 0, len = s_NbrRTT.size (); i < len; i++)
+	nbr += s_NbrRTT[i] / len;
+    cout << merc_va ("placement joins=%d mean rtt to succ+pred=%.1f msecs", (int) s_NbrRTT.size (), nbr) << endl;
+
+    if (s_tBalanced < 0)
+	cout << merc_va ("placement policy=%s balanced=never final max/mean=%.2f", 
+			 g_BootstrapPreferences.choosingPolicy, s_LastRatio) << endl;
+    else
+	cout << merc_va ("placement policy=%s balanced_after=%d msecs (%d joins) final max/mean=%.2f", 
+			 g_BootstrapPreferences.choosingPolicy, MAX (s_tBalanced - s_tJoins, 0), 
+			 s_JoinsToBalance, s_LastRatio) << endl;
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
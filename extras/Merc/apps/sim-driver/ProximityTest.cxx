@@ -0,0 +1,283 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+////////////////////////////////////////////////////////////////////////////////
+
+// Route latency over a latency map, with and without proximity routing
+// (--prs-slack) and neighbor selection (--pns-samples). The map is read
+// from --latency-file, in the format DelayedTransport reads in the WAN
+// build: "node <id> <host> ..." lines declare nodes, and "<id>,<id> <rtt>"
+// lines give the RTT between two of them, in msec. The i-th node declared
+// stands for the i-th simulated node. Without a file, nodes are placed at
+// random in a plane and the RTT between two is their distance. Each hop
+// costs half the RTT between its two ends.
+//
+// Once the ring has formed and peers have RTT estimates (and PNS has 
+// pruned its candidates), random nodes send point pubs to random values.
+// We report the hops and latency from publisher to rendezvous, and the
+// stretch: that latency over the direct one from publisher to rendezvous.
+//
+// Long pointers (and so PNS) need the node-count estimate from the 
+// bootstrap's histograms: run with --histograms.
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+typedef vector<SimMercuryNode *> MNVec;
+typedef MNVec::iterator MNVecIter;
+
+MNVec nlist;
+
+#define PX_NPUBS        2000
+#define PX_GAP          10         // msec between pubs
+#define PX_SETTLE       60000      // msec after the last join before pubs
+#define PX_PLANE        300.0      // side of the plane, in msec of RTT
+#define PX_MINRTT       2.0        // between any two nodes
+
+static vector< vector<float> > s_RTT;       // by node index (port - 1)
+
+struct PXPub {
+    TimeVal sent;
+    int     from;
+};
+static map<Value, PXPub> s_Sent;            // by value, which is unique
+
+static vector<int>    s_Hops;
+static vector<double> s_Latency, s_Stretch;
+
+static int _NodeIndex (const IPEndPoint& addr)
+{
+    int i = (int) addr.GetPort () - 1;
+    return i >= 0 && i < (int) s_RTT.size () ? i : -1;
+}
+
+static u_long _Latency (IPEndPoint& from, IPEndPoint& to)
+{
+    int a = _NodeIndex (from), b = _NodeIndex (to);
+
+    // the bootstrap is not on the map
+    if (a < 0 || b < 0)
+	return Simulator::NODE_TO_NODE_LATENCY;
+    return (u_long) (s_RTT[a][b] / 2);
+}
+
+static void _MakeRandomMap (int n)
+{
+    vector<double> x (n), y (n);
+    for (int i = 0; i < n; i++) {
+	x[i] = drand48 () * PX_PLANE;
+	y[i] = drand48 () * PX_PLANE;
+    }
+
+    s_RTT = vector< vector<float> > (n, vector<float> (n, 0));
+    for (int i = 0; i < n; i++) {
+	for (int j = 0; j < n; j++) {
+	    if (i != j)
+		s_RTT[i][j] = MAX (PX_MINRTT, sqrt ((x[i] - x[j]) * (x[i] - x[j]) + (y[i] - y[j]) * (y[i] - y[j])));
+	}
+    }
+}
+
+static void _ReadMap (int n, const char *filename)
+{
+    ifstream ifs (filename);
+    if (!ifs)
+	Debug::die ("couldn't open latency graph file: %s", filename);
+
+    // pairs missing from the file cost what the simulator charges by default
+    s_RTT = vector< vector<float> > (n, vector<float> (n, 2 * Simulator::NODE_TO_NODE_LATENCY));
+    for (int i = 0; i < n; i++)
+	s_RTT[i][i] = 0;
+
+    map<int, int> index;
+    string line;
+    while (getline (ifs, line)) {
+	replace (line.begin (), line.end (), ',', ' ');
+	istringstream words (line);
+	string first;
+	if (!(words >> first) || first[0] == '#')
+	    continue;
+
+	if (first == "node") {
+	    int id;
+	    if (words >> id && index.find (id) == index.end ()) {
+		int i = index.size ();
+		index[id] = i;
+	    }
+	    continue;
+	}
+
+	int id2;
+	float rtt;
+	if (!(words >> id2 >> rtt))
+	    continue;
+
+	map<int, int>::iterator a = index.find (atoi (first.c_str ()));
+	map<int, int>::iterator b = index.find (id2);
+	if (a == index.end () || b == index.end () || a->second >= n || b->second >= n)
+	    continue;
+	s_RTT[a->second][b->second] = s_RTT[b->second][a->second] = rtt;
+    }
+
+    if ((int) index.size () < n)
+	Debug::die ("latency graph %s has %d nodes; need %d", filename, index.size (), n);
+}
+
+class CreateNodeEvent : public SchedulerEvent {
+    SimMercuryNode *m_Node;
+public:
+    CreateNodeEvent (SimMercuryNode *n) : m_Node (n) {}
+
+    void Execute (Node& node, TimeVal& timenow) {
+	m_Node->StartUp ();
+    }
+};
+
+class ProximityApp : public DummyApp {
+public:
+    bool InspectsRoutedData () { return false; }
+
+    EventProcessType EventAtRendezvous (Event *ev, const IPEndPoint& lastHop, int nhops) {
+	Constraint *c = ev->GetConstraintByAttr (0);
+	map<Value, PXPub>::iterator it = s_Sent.find (c->GetMin ());
+	if (it == s_Sent.end ())
+	    return EV_MATCH_AND_STORE;
+
+	// the node holding 'c' is the one whose event this is
+	SimMercuryNode *at = NULL;
+	for (MNVecIter nit = nlist.begin (); nit != nlist.end (); ++nit) {
+	    MemberHub *hub = GetHub (*nit);
+	    if (hub && hub->GetRange () && hub->GetRange ()->Covers (c->GetMin ()))
+		at = *nit;
+	}
+	if (at == NULL)
+	    return EV_MATCH_AND_STORE;
+
+	double lat = g_Simulator->TimeNow () - it->second.sent;
+	int to = _NodeIndex (at->GetAddress ());
+	double direct = s_RTT[it->second.from][to] / 2;
+
+	s_Hops.push_back (nhops);
+	s_Latency.push_back (lat);
+	if (direct > 0)
+	    s_Stretch.push_back (lat / direct);
+	s_Sent.erase (it);
+	return EV_MATCH_AND_STORE;
+    }
+};
+
+class SendPubEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+public:
+    SendPubEvent (MNVec *n) : m_Nodes (n) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	int from = (int) (drand48 () * m_Nodes->size ());
+	SimMercuryNode *self = (*m_Nodes)[from];
+
+	const Value& absmin = g_MercuryAttrRegistry[0].absmin;
+	const Value& absmax = g_MercuryAttrRegistry[0].absmax;
+	Value v;
+	do {
+	    v = absmin;
+	    v += Value ((uint32) (drand48 () * (absmax.getd () - absmin.getd ())));
+	} while (s_Sent.find (v) != s_Sent.end ());
+
+	PXPub p;
+	p.sent = timenow;
+	p.from = from;
+	s_Sent[v] = p;
+
+	Constraint c (0, v, v);
+	MercuryEvent *ev = new MercuryEvent ();
+	ev->AddConstraint (c);
+	self->SendEvent (ev);
+	delete ev;
+    }
+};
+
+void create_nodes (MNVec *p_nlist)
+{
+    ProximityApp *app = new ProximityApp ();     // dont care about leak!
+
+    for (int i = 0; i < g_DriverPrefs.nodes; i++) {
+	IPEndPoint ip ("gs203.sp.cs.cmu.edu", i + 1);
+	SimMercuryNode *mn = new SimMercuryNode (g_Simulator, g_Simulator, ip);
+
+	mn->RegisterApplication (app);
+	g_Simulator->AddNode (*mn);
+	p_nlist->push_back (mn);
+
+	g_Simulator->RaiseEvent (new refcounted<CreateNodeEvent> (mn), SID_NONE, 100 + i * g_DriverPrefs.inter_arrival_time);
+    }
+}
+
+void run_script () {
+    if (g_Preferences.latency_file[0])
+	_ReadMap (g_DriverPrefs.nodes, g_Preferences.latency_file);
+    else
+	_MakeRandomMap (g_DriverPrefs.nodes);
+    g_Simulator->SetLatencyFunc (_Latency);
+
+    int tjoin = g_DriverPrefs.nodes * g_DriverPrefs.inter_arrival_time + PX_SETTLE;
+    for (int i = 0; i < PX_NPUBS; i++)
+	g_Simulator->RaiseEvent (new refcounted<SendPubEvent> (&nlist), SID_NONE, tjoin + i * PX_GAP);
+
+    create_nodes (&nlist);
+}
+
+static double _Mean (vector<double>& v)
+{
+    double sum = 0;
+    for (int i = 0, n = v.size (); i < n; i++)
+	sum += v[i];
+    return v.empty () ? 0 : sum / v.size ();
+}
+
+static double _Percentile (vector<double>& v, double p)
+{
+    if (v.empty ())
+	return 0;
+    sort (v.begin (), v.end ());
+    return v[MIN ((int) (p * v.size ()), (int) v.size () - 1)];
+}
+
+void finish_script () 
+{
+    double hops = 0;
+    for (int i = 0, n = s_Hops.size (); i < n; i++)
+	hops += s_Hops[i];
+    if (!s_Hops.empty ())
+	hops /= s_Hops.size ();
+
+    cout << merc_va ("proximity prs-slack=%.2f pns-samples=%d pubs=%d delivered=%d hops=%.2f "
+		     "latency mean=%.1f p50=%.1f p90=%.1f stretch mean=%.2f p90=%.2f",
+		     g_Preferences.prs_slack, g_Preferences.pns_samples, PX_NPUBS, (int) s_Hops.size (),
+		     hops, _Mean (s_Latency), _Percentile (s_Latency, 0.5), _Percentile (s_Latency, 0.9),
+		     _Mean (s_Stretch), _Percentile (s_Stretch, 0.9)) << endl;
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,204 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+////////////////////////////////////////////////////////////////////////////////
+
+// Range pub delivery latency against range width. Once the ring has
+// formed, random nodes publish range pubs of a few widths, one width 
+// at a time. Every node a pub reaches notes when it got there; at the
+// end we print, per width, how many nodes a pub reached, how long the
+// last of them took and the most hops any copy took. Run it plain,
+// with --fanoutpubs, and with --fanoutpubs --fanout-degree N to compare
+// walking the range successor by successor with the fanout tree.
+
+typedef vector<SimMercuryNode *> MNVec;
+typedef MNVec::iterator MNVecIter;
+
+MNVec nlist;
+
+#define RANGE_PUBS       50        // pubs sent per width
+#define RANGE_GAP        5000      // msec between widths; every pub must be done by then
+#define RANGE_PUB_GAP    20        // msec between pubs of one width
+
+static double s_RangeWidths[] = { 0.001, 0.01, 0.05, 0.1, 0.25, 0.5 };
+#define NWIDTHS   ((int) (sizeof (s_RangeWidths) / sizeof (double)))
+
+struct RangeProbe {
+    int      width;      // index into s_RangeWidths
+    TimeVal  sent;
+    sint64   latency;    // msec until the last node got it
+    int      nodes;      // how many nodes got it
+    int      maxhops;
+};
+
+// keyed by the pub's range min, which is random enough to be unique
+typedef map<Value, RangeProbe> ProbeMap;
+typedef ProbeMap::iterator ProbeMapIter;
+
+static ProbeMap s_Probes;
+
+class CreateNodeEvent : public SchedulerEvent {
+    SimMercuryNode *m_Node;
+public:
+    CreateNodeEvent (SimMercuryNode *n) : m_Node (n) {}
+
+    void Execute (Node& node, TimeVal& timenow) {
+	m_Node->StartUp ();
+    }
+};
+
+class RApp : public DummyApp {
+public:
+    bool InspectsRoutedData () { return false; }
+
+    EventProcessType EventAtRendezvous (Event *ev, const IPEndPoint& lastHop, int nhops) {
+	Constraint *c = ev->GetConstraintByAttr (0);
+	if (c == NULL)
+	    return EV_NUKE;
+
+	ProbeMapIter it = s_Probes.find (c->GetMin ());
+	if (it == s_Probes.end ())
+	    return EV_NUKE;
+
+	RangeProbe& p = it->second;
+	sint64 lat = g_Simulator->TimeNow () - p.sent;
+	if (lat > p.latency)
+	    p.latency = lat;
+	if (nhops > p.maxhops)
+	    p.maxhops = nhops;
+	p.nodes++;
+	return EV_NUKE;        // nothing to match; we only wanted to see it
+    }
+};
+
+class SendRangePubEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+    int    m_Width;
+public:
+    SendRangePubEvent (MNVec *n, int w) : m_Nodes (n), m_Width (w) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	SimMercuryNode *self = (*m_Nodes)[(int) (drand48 () * m_Nodes->size ())];
+
+	vector<Constraint> vc = self->GetHubConstraints ();
+	double max = vc[0].GetMax ().getd ();
+	double w = s_RangeWidths[m_Width];
+
+	Value m = (uint32) (drand48 () * (1 - w) * max);
+	Value M = m;
+	M += Value ((uint32) (w * max));
+
+	if (s_Probes.find (m) != s_Probes.end ())
+	    return;
+
+	RangeProbe p;
+	p.width = m_Width;
+	p.sent = timenow;
+	p.latency = 0;
+	p.nodes = 0;
+	p.maxhops = 0;
+	s_Probes.insert (ProbeMap::value_type (m, p));
+
+	MercuryEvent *ev = new MercuryEvent ();
+	Constraint c (0, m, M);
+	ev->AddConstraint (c);
+	self->SendEvent (ev);
+	delete ev;
+    }
+};
+
+class ReportEvent : public SchedulerEvent {
+public:
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	int    npubs[NWIDTHS], nodes[NWIDTHS], maxhops[NWIDTHS];
+	double lat[NWIDTHS];
+	sint64 maxlat[NWIDTHS];
+
+	for (int i = 0; i < NWIDTHS; i++) {
+	    npubs[i] = nodes[i] = maxhops[i] = 0;
+	    lat[i] = 0;
+	    maxlat[i] = 0;
+	}
+
+	for (ProbeMapIter it = s_Probes.begin (); it != s_Probes.end (); ++it) {
+	    RangeProbe& p = it->second;
+	    if (p.nodes == 0)
+		continue;
+
+	    npubs[p.width]++;
+	    nodes[p.width] += p.nodes;
+	    lat[p.width] += p.latency;
+	    if (p.latency > maxlat[p.width])
+		maxlat[p.width] = p.latency;
+	    if (p.maxhops > maxhops[p.width])
+		maxhops[p.width] = p.maxhops;
+	}
+
+	for (int i = 0; i < NWIDTHS; i++) {
+	    if (npubs[i] == 0)
+		continue;
+	    cout << merc_va ("range width=%.3f fanout=%d degree=%d pubs=%d avg_nodes=%.1f avg_latency_msec=%.1f max_latency_msec=%d max_hops=%d",
+			     s_RangeWidths[i], (int) g_Preferences.fanout_pubs, g_Preferences.fanout_degree,
+			     npubs[i], (double) nodes[i] / npubs[i], lat[i] / npubs[i], 
+			     (int) maxlat[i], maxhops[i]) << endl;
+	}
+    }
+};
+
+void create_nodes (MNVec *p_nlist)
+{
+    RApp *app = new RApp ();     // dont care about leak!
+
+    for (int i = 0; i < g_DriverPrefs.nodes; i++) {
+	IPEndPoint ip ("gs203.sp.cs.cmu.edu", i + 1);
+	SimMercuryNode *mn = new SimMercuryNode (g_Simulator, g_Simulator, ip);
+
+	mn->RegisterApplication (app);
+	g_Simulator->AddNode (*mn);
+	p_nlist->push_back (mn);
+
+	g_Simulator->RaiseEvent (new refcounted<CreateNodeEvent> (mn), SID_NONE, 100 + i * g_DriverPrefs.inter_arrival_time);
+    }
+}
+
+void run_script () {
+    int tjoin = g_DriverPrefs.nodes * g_DriverPrefs.inter_arrival_time + 5000;
+
+    for (int w = 0; w < NWIDTHS; w++) {
+	for (int i = 0; i < RANGE_PUBS; i++) {
+	    g_Simulator->RaiseEvent (new refcounted<SendRangePubEvent> (&nlist, w), SID_NONE, 
+				     tjoin + w * RANGE_GAP + i * RANGE_PUB_GAP);
+	}
+    }
+    g_Simulator->RaiseEvent (new refcounted<ReportEvent> (), SID_NONE, tjoin + NWIDTHS * RANGE_GAP);
+
+    create_nodes (&nlist);
+}
+
+void finish_script () 
+{
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+////////////////////////////////////////////////////////////////////////////////
+
+// Routed pubs and subs through an application which inspects what it
+// routes (InspectsRoutedData () is true, as it is for any app that does
+// not say otherwise), so the event (interest) is decoded at every hop,
+// on the way to the rendezvous and along the range. Once everything
+// has arrived, every sub must have been matched by exactly the pubs it
+// overlaps (save those published by its own subscriber, which are not
+// sent back without --backpub).
+
+#include <set>
+
+typedef vector<SimMercuryNode *> MNVec;
+typedef MNVec::iterator MNVecIter;
+
+MNVec nlist;
+
+#define RP_NSUBS        200
+#define RP_NPUBS        400
+#define RP_SUBWIDTH     0.05       // sub side, as a fraction of the attribute
+#define RP_PUBWIDTH     0.02       // range pub side; half the pubs are points
+
+static vector<Constraint> s_Subs;
+static vector<IPEndPoint> s_Subscribers;
+static map<guid_t, int, less_GUID> s_SubIndex;
+static vector<Constraint> s_Pubs;
+static vector<IPEndPoint> s_Publishers;
+static map<Value, int> s_PubIndex;          // by the lower end, which is unique
+
+static set< pair<int, int> > s_Matched;
+static int s_Spurious;
+static int s_Routed;
+
+class CreateNodeEvent : public SchedulerEvent {
+    SimMercuryNode *m_Node;
+public:
+    CreateNodeEvent (SimMercuryNode *n) : m_Node (n) {}
+
+    void Execute (Node& node, TimeVal& timenow) {
+	m_Node->StartUp ();
+    }
+};
+
+class InspectingApp : public DummyApp {
+public:
+    int EventRoute (Event *ev, const IPEndPoint& lastHop) {
+	ASSERT (ev->GetConstraintByAttr (0) != NULL);
+	s_Routed++;
+	return 1;
+    }
+    int InterestRoute (Interest *in, const IPEndPoint& lastHop) {
+	ASSERT (in->GetConstraintByAttr (0) != NULL);
+	s_Routed++;
+	return 1;
+    }
+
+    void EventInterestMatch (const Event *ev, const Interest *in, const IPEndPoint& subscriber) {
+	Constraint *pc = ((Event *) ev)->GetConstraintByAttr (0);
+	map<Value, int>::iterator pit = s_PubIndex.find (pc->GetMin ());
+	map<guid_t, int, less_GUID>::iterator sit = s_SubIndex.find (in->GetGUID ());
+
+	if (pit == s_PubIndex.end () || sit == s_SubIndex.end ()) {
+	    s_Spurious++;
+	    return;
+	}
+	s_Matched.insert (pair<int, int> (pit->second, sit->second));
+    }
+};
+
+static Constraint _RandomConstraint (double width, bool unique)
+{
+    const Value& absmin = g_MercuryAttrRegistry[0].absmin;
+    const Value& absmax = g_MercuryAttrRegistry[0].absmax;
+    double span = absmax.getd () - absmin.getd ();
+
+    Value lo;
+    do {
+	lo = absmin;
+	lo += Value ((uint32) (drand48 () * (1.0 - width) * span));
+    } while (unique && s_PubIndex.find (lo) != s_PubIndex.end ());
+
+    Value hi = lo;
+    hi += Value ((uint32) (width * span));
+    return Constraint (0, lo, hi);
+}
+
+class SendSubsEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+public:
+    SendSubsEvent (MNVec *n) : m_Nodes (n) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	uint32 lifetime = g_DriverPrefs.simulation_time * 1000;
+
+	for (int i = 0; i < RP_NSUBS; i++) {
+	    SimMercuryNode *self = (*m_Nodes)[(int) (drand48 () * m_Nodes->size ())];
+	    IPEndPoint me = self->GetAddress ();
+	    Constraint c = _RandomConstraint (RP_SUBWIDTH, false);
+
+	    Interest *in = new Interest (me, GUID::CreateRandom ());
+	    in->AddConstraint (c);
+	    in->SetLifeTime (lifetime);
+	    s_SubIndex[in->GetGUID ()] = s_Subs.size ();
+	    s_Subs.push_back (c);
+	    s_Subscribers.push_back (me);
+
+	    self->RegisterInterest (in);
+	    delete in;
+	}
+    }
+};
+
+class SendPubsEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+public:
+    SendPubsEvent (MNVec *n) : m_Nodes (n) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	for (int i = 0; i < RP_NPUBS; i++) {
+	    SimMercuryNode *self = (*m_Nodes)[(int) (drand48 () * m_Nodes->size ())];
+	    Constraint c = _RandomConstraint (i % 2 ? RP_PUBWIDTH : 0.0, true);
+
+	    MercuryEvent *ev = new MercuryEvent ();
+	    ev->AddConstraint (c);
+	    s_PubIndex[c.GetMin ()] = s_Pubs.size ();
+	    s_Pubs.push_back (c);
+	    s_Publishers.push_back (self->GetAddress ());
+
+	    self->SendEvent (ev);
+	    delete ev;
+	}
+    }
+};
+
+void create_nodes (MNVec *p_nlist)
+{
+    InspectingApp *app = new InspectingApp ();     // dont care about leak!
+
+    for (int i = 0; i < g_DriverPrefs.nodes; i++) {
+	IPEndPoint ip ("gs203.sp.cs.cmu.edu", i + 1);
+	SimMercuryNode *mn = new SimMercuryNode (g_Simulator, g_Simulator, ip);
+
+	mn->RegisterApplication (app);
+	g_Simulator->AddNode (*mn);
+	p_nlist->push_back (mn);
+
+	g_Simulator->RaiseEvent (new refcounted<CreateNodeEvent> (mn), SID_NONE, 100 + i * g_DriverPrefs.inter_arrival_time);
+    }
+}
+
+void run_script () {
+    // subs sent much sooner than this can miss part of their range
+    // while the ring is still settling
+    int tjoin = g_DriverPrefs.nodes * g_DriverPrefs.inter_arrival_time + 15000;
+    g_Simulator->RaiseEvent (new refcounted<SendSubsEvent> (&nlist), SID_NONE, tjoin);
+    g_Simulator->RaiseEvent (new refcounted<SendPubsEvent> (&nlist), SID_NONE, tjoin + 2000);
+
+    create_nodes (&nlist);
+}
+
+void finish_script () 
+{
+    int expected = 0, missing = 0, extra = 0;
+
+    for (int p = 0; p < (int) s_Pubs.size (); p++) {
+	for (int s = 0; s < (int) s_Subs.size (); s++) {
+	    bool overlaps = s_Subs[s].Overlaps (s_Pubs[p]);
+	    if (!g_Preferences.send_backpub && s_Subscribers[s] == s_Publishers[p])
+		overlaps = false;
+	    bool matched = s_Matched.find (pair<int, int> (p, s)) != s_Matched.end ();
+
+	    if (overlaps)
+		expected++;
+	    if (overlaps && !matched)
+		missing++;
+	    if (!overlaps && matched)
+		extra++;
+	}
+    }
+
+    bool ok = expected > 0 && missing == 0 && extra == 0 && s_Spurious == 0;
+    cout << merc_va ("routedpub expected=%d missing=%d extra=%d spurious=%d routed=%d %s",
+		     expected, missing, extra, s_Spurious, s_Routed, ok ? "PASS" : "FAIL") << endl;
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+////////////////////////////////////////////////////////////////////////////////
+
+// Stored sub replicas with and without --subselect. Run with a schema
+// of two or more hubs (e.g., configs/schema_twohubs.cfg). Once the ring
+// has formed, random nodes register subs with a constraint on every 
+// hub's attribute, each of a random width. (A node is a member of only
+// one of the hubs here, so it compares hubs by the share of the 
+// attribute each constraint spans; see HubManager::PickNarrowestHub.) A sub is stored once on every node its constraint on
+// the chosen hub spans; we count those stores and print the average
+// per sub. Sending subs to the hub where they are narrowest should
+// bring it down to about what the narrowest constraint alone spans.
+
+typedef vector<SimMercuryNode *> MNVec;
+typedef MNVec::iterator MNVecIter;
+
+MNVec nlist;
+
+#define SUB_COUNT       500        // subs registered
+#define SUB_GAP         10         // msec between subs
+#define SUB_SETTLE      5000       // msec after the last sub to report
+#define SUB_MINWIDTH    0.001      // constraint widths are log-uniform in 
+#define SUB_MAXWIDTH    0.5        // [MINWIDTH, MAXWIDTH] of the attribute
+
+static int s_SubsSent, s_SubReplicas;
+
+class CreateNodeEvent : public SchedulerEvent {
+    SimMercuryNode *m_Node;
+public:
+    CreateNodeEvent (SimMercuryNode *n) : m_Node (n) {}
+
+    void Execute (Node& node, TimeVal& timenow) {
+	m_Node->StartUp ();
+    }
+};
+
+class SApp : public DummyApp {
+public:
+    bool InspectsRoutedData () { return false; }
+
+    InterestProcessType InterestAtRendezvous (Interest *in, const IPEndPoint& lastHop) {
+	s_SubReplicas++;
+	return IN_STORE;
+    }
+};
+
+class SendSubEvent : public SchedulerEvent {
+    MNVec *m_Nodes;
+public:
+    SendSubEvent (MNVec *n) : m_Nodes (n) {}
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	SimMercuryNode *self = (*m_Nodes)[(int) (drand48 () * m_Nodes->size ())];
+	vector<Constraint> vc = self->GetHubConstraints ();
+	if (vc.size () == 0)
+	    return;
+
+	Interest *in = new Interest ();
+	for (vector<Constraint>::iterator it = vc.begin (); it != vc.end (); ++it) {
+	    double max = it->GetMax ().getd ();
+	    double w = SUB_MINWIDTH * exp (drand48 () * log (SUB_MAXWIDTH / SUB_MINWIDTH));
+
+	    Value m = (uint32) (drand48 () * (1 - w) * max);
+	    Value M = m;
+	    M += Value ((uint32) (w * max));
+
+	    Constraint c (it->GetAttrIndex (), m, M);
+	    in->AddConstraint (c);
+	}
+	self->RegisterInterest (in);
+	delete in;
+
+	s_SubsSent++;
+    }
+};
+
+class ReportEvent : public SchedulerEvent {
+public:
+    virtual void Execute (Node& node, TimeVal& timenow) {
+	cout << merc_va ("subselect=%d subs=%d replicas=%d avg_replicas=%.2f",
+			 (int) g_Preferences.sub_selectivity, s_SubsSent, s_SubReplicas,
+			 s_SubsSent > 0 ? (double) s_SubReplicas / s_SubsSent : 0.0) << endl;
+    }
+};
+
+void create_nodes (MNVec *p_nlist)
+{
+    SApp *app = new SApp ();     // dont care about leak!
+
+    for (int i = 0; i < g_DriverPrefs.nodes; i++) {
+	IPEndPoint ip ("gs203.sp.cs.cmu.edu", i + 1);
+	SimMercuryNode *mn = new SimMercuryNode (g_Simulator, g_Simulator, ip);
+
+	mn->RegisterApplication (app);
+	g_Simulator->AddNode (*mn);
+	p_nlist->push_back (mn);
+
+	g_Simulator->RaiseEvent (new refcounted<CreateNodeEvent> (mn), SID_NONE, 100 + i * g_DriverPrefs.inter_arrival_time);
+    }
+}
+
+void run_script () {
+    int tjoin = g_DriverPrefs.nodes * g_DriverPrefs.inter_arrival_time + 5000;
+
+    // subs must not expire before we count them
+    g_Preferences.sub_lifetime = SUB_COUNT * SUB_GAP + 2 * SUB_SETTLE;
+
+    for (int i = 0; i < SUB_COUNT; i++)
+	g_Simulator->RaiseEvent (new refcounted<SendSubEvent> (&nlist), SID_NONE, tjoin + i * SUB_GAP);
+    g_Simulator->RaiseEvent (new refcounted<ReportEvent> (), SID_NONE, tjoin + SUB_COUNT * SUB_GAP + SUB_SETTLE);
+
+    create_nodes (&nlist);
+}
+
+void finish_script () 
+{
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
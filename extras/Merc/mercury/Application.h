@@ -45,9 +45,48 @@ class PubsubStore {
     virtual void DeleteTriggers (callback<bool, MsgPublication *>::ref delpred) = 0;
     virtual void DeleteSubs (callback<bool, Interest *>::ref delpred) = 0;
 
+    // with --hub-threads this runs on the hub's worker thread (see 
+    // HubWorker.h), so it must not touch shared state -- the START/STOP
+    // benchmark macros included.
     virtual void GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch) = 0;
     virtual void GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch) = 0;
 
+    // pmatch[i] gets the subs overlapping pubs[i]. used when pubs
+    // are delivered in batches (--pub-batch); stores which can share 
+    // one traversal across the whole batch should override this.
+    virtual void GetOverlapSubsBatch (vector<MsgPublication *>& pubs, vector< list<Interest *> > *pmatch) {
+	pmatch->resize (pubs.size ());
+	for (uint32 i = 0; i < pubs.size (); i++)
+	    GetOverlapSubs (pubs[i], &(*pmatch)[i]);
+    }
+
+    // same as DeleteTriggers/DeleteSubs, except that the predicate only
+    // sees items whose constraint on 'attr' overlaps 'range' (which may
+    // wrap around; see Constraint::OverlapsNodeRange). this is what
+    // handing over data after a range change needs; stores which index
+    // 'attr' only have to visit those items. the defaults walk everything.
+    virtual void DeleteTriggersInRange (int attr, const NodeRange& range, callback<bool, MsgPublication *>::ref delpred);
+    virtual void DeleteSubsInRange (int attr, const NodeRange& range, callback<bool, Interest *>::ref delpred);
+
+    // the stored sub with GUID 'g', for subscription covering 
+    // (--subcover). stores which do not index subs by GUID return
+    // NULL, which turns covering off for them.
+    virtual Interest *FindSub (const guid_t& g) { return NULL; }
+
+    // drop (and free) one stored sub; false (and 'in' is left alone)
+    // if it is not stored here. the default walks with DeleteSubs.
+    virtual bool DeleteSub (Interest *in);
+
+    // drop soft-state which has expired by 'now'. the defaults walk
+    // everything with DeleteSubs/DeleteTriggers (see PubsubStore.cpp).
+    virtual void ExpireSubs (const TimeVal& now);
+    virtual void ExpireTriggers (const TimeVal& now);
+
+    // true if Expire* only costs as much as what expires. mercury then
+    // expires right before matching instead of checking the death time
+    // of every match.
+    virtual bool HasExpiryIndex () { return false; }
+
     virtual void Clear () = 0;
 };
 
@@ -74,8 +113,8 @@ class Application {
  public:
     /**
      * Returns the pubsub storage container for a hub with this
-     * hubId. If NULL is returned, Mercury uses its default pubsub
-     * storage (linear-time matching).
+     * hubId. If NULL is returned, Mercury uses one of its built-in
+     * stores (see PubsubStore.h), chosen by --pubsub-store.
      **/
     virtual PubsubStore* GetPubsubStore (int hubId) = 0;
     /**
@@ -185,6 +224,14 @@ class Application {
      * (Mercury layer) can perform a leave-join for load-balancing
      **/
     virtual bool IsLeaveJoinOK () = 0;
+
+    /**
+     * Return false if EventRoute () and InterestRoute () do not look
+     * at their arguments and always return > 0. Mercury then skips 
+     * them, and pubs and subs which are only passing through this 
+     * node are forwarded without being decoded.
+     **/
+    virtual bool InspectsRoutedData () { return true; }
 };
 
 class DummyApp : public Application {
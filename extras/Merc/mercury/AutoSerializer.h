@@ -25,6 +25,8 @@
 
 // $Id: AutoSerializer.h 2382 2005-11-03 22:54:59Z ashu $
 
+#include <new>
+#include <typeinfo>
 #include <mercury/common.h>
 #include <mercury/Packet.h>
 
@@ -46,17 +48,14 @@
 // automatically (or at least enforce it) would be very useful.
 
 #define MAX_DER_TYPES 256         // max derived classes per type
+#define MAX_FREE_OBJECTS 256      // recycled objects kept per derived type
 
 typedef Serializable * (*ConstructorType)(Packet *pkt);
 
-template<class T>
-Serializable *ConstructType(Packet *pkt) {
-    return new T(pkt);
-}
-
 struct TypeInfo {
     ConstructorType constructor;
     const char *description;
+    const std::type_info *rtti;   // exactly this class (not a subclass)
 };
 
 // this class stores information about each base class 'T' -
@@ -75,6 +74,11 @@ public:
     static byte type_pool;
     static TypeInfo typeinfo[MAX_DER_TYPES];	
     static int  num_dtypes() { return (int) type_pool; }
+
+    // --packet-pool: storage of destroyed objects, per derived type,
+    // linked through their first word
+    static POOL_LOCAL void *freelist[MAX_DER_TYPES];
+    static POOL_LOCAL int   numfree[MAX_DER_TYPES];
 };
 
 template<class T>
@@ -83,6 +87,52 @@ byte BaseclassInfo<T>::type_pool = 0;
 template<class T>
 TypeInfo BaseclassInfo<T>::typeinfo[MAX_DER_TYPES];
 
+template<class T>
+POOL_LOCAL void *BaseclassInfo<T>::freelist[MAX_DER_TYPES];
+
+template<class T>
+POOL_LOCAL int BaseclassInfo<T>::numfree[MAX_DER_TYPES];
+
+// storage for an object of derived type 'type': recycled if we have
+// some, else fresh from operator new (so 'delete' can free it either way)
+template<class T>
+void *AllocObject(byte type, size_t size)
+{
+    void *mem = BaseclassInfo<T>::freelist[type];
+    if (mem == NULL)
+	return ::operator new (size);
+
+    BaseclassInfo<T>::freelist[type] = *(void **) mem;
+    BaseclassInfo<T>::numfree[type]--;
+    return mem;
+}
+
+// drop 'obj' like 'delete' would, but keep its storage for the next
+// object of the same type CreateObject() makes. objects whose class
+// did not register itself (a subclass without its own DECLARE_TYPE)
+// are just deleted.
+template<class T>
+void RecycleObject(T *obj)
+{
+    if (obj == NULL)
+	return;
+
+    byte type = obj->GetType ();
+    if (!g_Preferences.packet_pool ||
+	type >= BaseclassInfo<T>::num_dtypes() ||
+	typeid (*obj) != *BaseclassInfo<T>::typeinfo[type].rtti ||
+	BaseclassInfo<T>::numfree[type] >= MAX_FREE_OBJECTS) {
+	delete obj;
+	return;
+    }
+
+    void *mem = dynamic_cast<void *> (obj);
+    obj->~T ();
+    *(void **) mem = BaseclassInfo<T>::freelist[type];
+    BaseclassInfo<T>::freelist[type] = mem;
+    BaseclassInfo<T>::numfree[type]++;
+}
+
 // Decide which constructor to call.
 
 template<class T>
@@ -118,6 +168,11 @@ public:
 template<class T, class ET>
 byte PSerializable<T, ET>::type;
 
+template<class T, class ET>
+Serializable *ConstructType(Packet *pkt) {
+    return new (AllocObject<T>(PSerializable<T, ET>::type, sizeof (ET))) ET(pkt);
+}
+
 // Register an extended type ET into the typeinfo for base
 // class T. Register its constructor... The 'type' returned 
 // can be stored by the app for demultiplexing. For example, 
@@ -128,8 +183,9 @@ int RegisterType(const char *description)
 {
     byte type;
     type = PSerializable<T, ET>::type = BaseclassInfo<T>::type_pool++;
-    BaseclassInfo<T>::typeinfo[type].constructor = ConstructType<ET>;
+    BaseclassInfo<T>::typeinfo[type].constructor = ConstructType<T, ET>;
     BaseclassInfo<T>::typeinfo[type].description = strdup (description);
+    BaseclassInfo<T>::typeinfo[type].rtti = &typeid (ET);
     return type;
 }
 
@@ -34,6 +34,7 @@ copyright            : (C) 2003-2005 Ashwin R. Bharambe ( ashu@cs.cmu.edu   )
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <cmath>
 #include <fstream>
 
 #include <mercury/BootstrapNode.h>
@@ -501,7 +502,7 @@ void BootstrapNode::ReceiveMessage(IPEndPoint * from, Message * msg)
 {
     MsgType t = msg->GetType ();
 
-    if (t == MSG_HEARTBEAT)
+    if (t == MSG_HEARTBEAT || t == MSG_LOAD_HEARTBEAT)
 	HandleHeartbeat(from, (MsgHeartBeat *) msg);
     else if (t == MSG_BOOTSTRAP_REQUEST) {
 
@@ -600,6 +601,110 @@ IPEndPoint BootstrapNode::ChooseRoundRobin (BootstrapHubInfo *hinfo)
     return addr;
 }
 
+// a joiner offered a range takes a while to probe, join and show up
+// in the heartbeats; if the range has not changed by then, it went 
+// elsewhere.
+static sint64 _SplitChargeTTL ()
+{
+    return Parameters::PlaceProbeTimeout + Parameters::JoinRequestTimeout + 
+	2 * Parameters::BootstrapHeartbeatInterval;
+}
+
+struct heavier_t {
+    bool operator () (const pair<double, NodeState *>& a, const pair<double, NodeState *>& b) const {
+	return a.first > b.first;
+    }
+};
+
+// the joiner takes over the lower half of the representative's range
+// (see LinkMaintainer::HandleJoinRequest), so choosing the rep chooses
+// the range to split: split the most loaded ranges first. the rep and
+// its predecessor become the joiner's ring neighbors, and only the 
+// joiner can tell how close it is to them. so a joiner is offered the
+// ranges within --place-slack of the heaviest (at most 
+// --place-candidates of them), each with its predecessor, and joins 
+// the one it measures closest (see HubManager::ProbePlacement); the 
+// rep returned, the heaviest, is where it goes if it measures nothing.
+// 'joiner' is NULL if the node will not join the hub.
+IPEndPoint BootstrapNode::ChooseLoadAware (BootstrapHubInfo *hinfo, HubInitInfo *joiner)
+{
+    Value total = hinfo->m_AbsMax;
+    total -= hinfo->m_AbsMin;
+    if (total == Value::ZERO)
+	return ChooseRoundRobin (hinfo);
+
+    // nodes which have not measured their load yet (say, they just 
+    // split) are charged the load density of those which have.
+    double known_load = 0, known_share = 0;
+    for (NodeListIter it = hinfo->m_Nodelist.begin (); it != hinfo->m_Nodelist.end (); ++it) {
+	if (it->GetRange () == NULL || it->m_Load <= 0)
+	    continue;
+	known_load += it->m_Load;
+	known_share += it->GetRange ()->GetSpan (hinfo->m_AbsMin, hinfo->m_AbsMax).double_div (total);
+    }
+    double density = (known_load > 0 && known_share > 0) ? known_load / known_share : 1.0;
+
+    TimeVal now = m_Scheduler->TimeNow ();
+    vector< pair<double, NodeState *> > est;
+    double max_est = 0;
+    for (NodeListIter it = hinfo->m_Nodelist.begin (); it != hinfo->m_Nodelist.end (); ++it) {
+	if (it->GetRange () == NULL)
+	    continue;
+
+	double e;
+	if (it->m_Load > 0)
+	    e = it->m_Load;
+	else
+	    e = density * it->GetRange ()->GetSpan (hinfo->m_AbsMin, hinfo->m_AbsMax).double_div (total);
+
+	// each joiner which split this range lately took half of it
+	if (it->m_Splits > 0 && now - it->m_tSplit > _SplitChargeTTL ())
+	    it->m_Splits = 0;
+	e /= pow (2.0, (double) it->m_Splits);
+
+	est.push_back (pair<double, NodeState *> (e, &*it));
+	if (e > max_est)
+	    max_est = e;
+    }
+
+    // nobody has told us its range yet
+    if (max_est <= 0)
+	return ChooseRoundRobin (hinfo);
+
+    stable_sort (est.begin (), est.end (), heavier_t ());
+    int ncands = joiner ? MAX (g_BootstrapPreferences.placeCandidates, 1) : 1;
+    while ((int) est.size () > ncands || est.back ().first < max_est * (1 - g_BootstrapPreferences.placeSlack))
+	est.pop_back ();
+
+    if (joiner == NULL) 
+	return est[0].second->GetAddress ();
+
+    for (int i = 0, len = est.size (); len > 1 && i < len; i++) {
+	NodeState *c = est[i].second;
+	IPEndPoint pred = SID_NONE;
+	for (NodeListIter it = hinfo->m_Nodelist.begin (); it != hinfo->m_Nodelist.end (); ++it) {
+	    if (it->GetRange () != NULL && &*it != c && it->GetRange ()->GetMax () == c->GetRange ()->GetMin ()) {
+		pred = it->GetAddress ();
+		break;
+	    }
+	}
+	joiner->placeReps.push_back (c->GetAddress ());
+	joiner->placePreds.push_back (pred);
+    }
+
+    // the joiner takes one of them; charge each its share, so the next
+    // joiners of a burst go elsewhere
+    for (int i = 0, len = est.size (); i < len; i++) {
+	est[i].second->m_Splits += 1.0 / len;
+	est[i].second->m_tSplit = now;
+    }
+
+    NodeState *best = est[0].second;
+    DBG_DO { INFO << "choose address " << best->GetAddress () << " est-load=" << max_est 
+		  << " offered=" << est.size () << endl; }
+    return best->GetAddress ();
+}
+
 /*
 IPEndPoint BootstrapNode::ChooseFromIdentMap(IPEndPoint *from, BootstrapHubInfo * hinfo)
 {
@@ -651,7 +756,7 @@ IPEndPoint BootstrapNode::ChooseFromIdentMap(IPEndPoint *from, BootstrapHubInfo
 }
 */
 
-IPEndPoint BootstrapNode::ChooseRepresentative(IPEndPoint *from, BootstrapHubInfo * hinfo)
+IPEndPoint BootstrapNode::ChooseRepresentative(IPEndPoint *from, BootstrapHubInfo * hinfo, HubInitInfo *joiner)
 {
     IPEndPoint addr = SID_NONE;
 
@@ -662,6 +767,8 @@ IPEndPoint BootstrapNode::ChooseRepresentative(IPEndPoint *from, BootstrapHubInf
 	    addr = ChooseRoundRobin (hinfo);
 	else if (!strcmp (g_BootstrapPreferences.choosingPolicy, "sim-distrib"))
 	    addr = ChooseSimulateDistributedJoin (hinfo);
+	else if (!strcmp (g_BootstrapPreferences.choosingPolicy, "load-aware"))
+	    addr = ChooseLoadAware (hinfo, joiner);
 	else if (!strcmp (g_BootstrapPreferences.choosingPolicy, "ident-map"))
 	    //addr = ChooseFromIdentMap(from, hinfo);
 	    ASSERT(false); // should not get here!
@@ -923,9 +1030,11 @@ void BootstrapNode::HandleBootstrapRequest(IPEndPoint * from,
 	newinfo.absmin = info->m_AbsMin;
 	newinfo.absmax = info->m_AbsMax;
 	newinfo.isMember = false;
-	newinfo.rep = ChooseRepresentative (from, info);
 
-	if (info->m_Nodelist.size() < hubSparenessThreshold) {	/* this hub is still sparse, new node MUST join it! */
+	bool sparse = info->m_Nodelist.size() < hubSparenessThreshold;
+	newinfo.rep = ChooseRepresentative (from, info, sparse ? &newinfo : NULL);
+
+	if (sparse) {	/* this hub is still sparse, new node MUST join it! */
 	    newinfo.isMember = true;
 	    memberOfSomeHub = true;
 
@@ -961,7 +1070,7 @@ void BootstrapNode::HandleBootstrapRequest(IPEndPoint * from,
 	BootstrapHubInfo *info = m_HubInfoVec[hub_index];
 
 	resp->hubInfoVec[hub_index]->isMember = true;
-	resp->hubInfoVec[hub_index]->rep = ChooseRepresentative (from, info);
+	resp->hubInfoVec[hub_index]->rep = ChooseRepresentative (from, info, resp->hubInfoVec[hub_index]);
 
 	NodeState state (bmsg->sender, now);
 	//FixKnownRanges(state, *resp->hubInfoVec[hub_index], info);
@@ -1015,7 +1124,13 @@ void BootstrapNode::HandleHeartbeat(IPEndPoint * from,
 	
 	if (addr == hmsg->sender) {
 	    (*it).m_tLastHeartBeat = now;
+	    // a split (or a load-balancing move) changed the range; the
+	    // load hints describe the new range from here on
+	    if ((*it).GetRange() == NULL || *(*it).GetRange() != *range)
+		(*it).m_Splits = 0;
 	    (*it).SetRange(range);
+	    if (hmsg->GetType () == MSG_LOAD_HEARTBEAT)
+		(*it).m_Load = ((MsgLoadHeartBeat *) hmsg)->load;
 	    (*it).SetIsJoined(); // HBs are only sent after node is ST_JOINED
 	    done = true;
 	    break;
@@ -1025,6 +1140,8 @@ void BootstrapNode::HandleHeartbeat(IPEndPoint * from,
 	NodeState state = NodeState (hmsg->sender, now);
 	state.SetRange (range);
 	state.SetIsJoined();
+	if (hmsg->GetType () == MSG_LOAD_HEARTBEAT)
+	    state.m_Load = ((MsgLoadHeartBeat *) hmsg)->load;
 	hinfo->m_Nodelist.push_back(state);
 	
 	if (hinfo->m_Nodelist.size() > HUB_FIFO_SIZE)
@@ -1086,8 +1203,12 @@ OptionType g_BootstrapOptions[] =
       &(g_BootstrapPreferences.haveHistograms), "0",   (void *) "1"},
     { '#', "schema", OPT_STR, "schema file to read",
       g_BootstrapPreferences.schemaFile, "" , NULL }, 
-    { '#', "policy", OPT_STR, "representative choosing policy",
+    { '#', "policy", OPT_STR, "representative choosing policy (random, round-robin, sim-distrib, load-aware, ident-map); load-aware needs nodes run with --loadbal-routeload",
       g_BootstrapPreferences.choosingPolicy, "round-robin" , NULL }, 
+    { '#', "place-slack", OPT_FLT, "load-aware policy: offer the joiner the ranges with load within this fraction of the heaviest",
+      &g_BootstrapPreferences.placeSlack, "0.2" , NULL }, 
+    { '#', "place-candidates", OPT_INT, "load-aware policy: offer the joiner at most this many ranges, to choose from by RTT (1 = the heaviest)",
+      &g_BootstrapPreferences.placeCandidates, "4" , NULL }, 
     { '#', "ident-map", OPT_STR, "forced node identity map file",
       g_BootstrapPreferences.identMapFile, "" , NULL }, 
     { '#', "buckets", OPT_INT, "number of buckets in the histogram",
@@ -1126,7 +1247,9 @@ BootstrapNode::BootstrapNode (NetworkLayer *network, Scheduler *scheduler, IPEnd
     if (!ok)
 	Debug::die ("Error reading/parsing the schema file, terminating\n");
 
+#ifndef MERCURY_FIXED_VALUE
     gmp_randinit_default (m_GMPRandState);
+#endif
     INFO << "read schema file successfully..." << endl;
 
     if ( strcmp(g_BootstrapPreferences.identMapFile, "") ) {
@@ -1141,9 +1264,21 @@ BootstrapNode::BootstrapNode (NetworkLayer *network, Scheduler *scheduler, IPEnd
 
 Value BootstrapNode::GetRandom (const Value& max)
 {
+#ifdef MERCURY_FIXED_VALUE
+    // fill every bit from lrand48 (31 bits at a time), modulo max
+    Value ret = 0;
+    for (int bits = 0; bits < Value::BITS; bits += 31) {
+	ret <<= 31;
+	ret |= Value ((long) lrand48 ());
+    }
+    if (ret < 0)
+	ret = ~ret;
+    return ret % max;
+#else
     Value ret = VALUE_NONE;
     mpz_urandomm ((MP_INT *) &ret, m_GMPRandState, &max);
     return ret;
+#endif
 }
 
 struct cmp_ns_range_t { 
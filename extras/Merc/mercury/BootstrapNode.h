@@ -53,18 +53,28 @@ copyright            : (C) 2003-2005 Ashwin R. Bharambe ( ashu@cs.cmu.edu   )
 	// a node is joined after bootstrap and after integrating into the hub
 	bool        m_IsJoined;
 
-	NodeState() {}
+	// the load from MsgLoadHeartBeat (0 = not reported) and how many
+	// of the joiners offered this node's range (the last at m_tSplit)
+	// are expected to have split it since its range last changed. 
+	// used by the "load-aware" policy.
+	float       m_Load;
+	float       m_Splits;
+	TimeVal     m_tSplit;
+
+	NodeState() : m_Range (0), m_IsJoined (false), m_Level (0), m_Load (0), m_Splits (0), m_tSplit (TIME_NONE) {}
 	~NodeState () {
 	    if (m_Range) 
 		delete m_Range;
 	}
 
 	NodeState(IPEndPoint addr, TimeVal t) : 
-	    m_Addr(addr), m_Range (0), m_tLastHeartBeat(t),  m_IsJoined(false), m_Level (0)
+	    m_Addr(addr), m_Range (0), m_tLastHeartBeat(t),  m_IsJoined(false), m_Level (0),
+	    m_Load (0), m_Splits (0), m_tSplit (TIME_NONE)
 	    {}
 
 	NodeState (const NodeState& os) 
-	    : m_Addr (os.GetAddress ()), m_tLastHeartBeat (os.m_tLastHeartBeat), m_IsJoined (os.IsJoined ()), m_Level (os.GetLevel ())
+	    : m_Addr (os.GetAddress ()), m_tLastHeartBeat (os.m_tLastHeartBeat), m_IsJoined (os.IsJoined ()), m_Level (os.GetLevel ()),
+	    m_Load (os.m_Load), m_Splits (os.m_Splits), m_tSplit (os.m_tSplit)
 	    {
 		if (os.GetRange () != NULL)
 		    m_Range = new NodeRange (*os.GetRange ());
@@ -79,6 +89,9 @@ copyright            : (C) 2003-2005 Ashwin R. Bharambe ( ashu@cs.cmu.edu   )
 	    m_tLastHeartBeat = os.m_tLastHeartBeat;
 	    m_IsJoined = os.IsJoined ();
 	    m_Level = os.GetLevel ();
+	    m_Load = os.m_Load;
+	    m_Splits = os.m_Splits;
+	    m_tSplit = os.m_tSplit;
 
 	    if (os.GetRange () != NULL)
 		m_Range = new NodeRange (*os.GetRange ());
@@ -133,6 +146,8 @@ struct _bootstrap_prefs_t {
     int  nServers;
     bool oneNodePerHub;
     char choosingPolicy[80];
+    float placeSlack;
+    int  placeCandidates;
     char identMapFile[80];
 };
 
@@ -146,7 +161,9 @@ class BootstrapNode : public Node {
     int m_NumAssigned;
     set<IPEndPoint, less_SID> m_BootedServers;
 
+#ifndef MERCURY_FIXED_VALUE
     gmp_randstate_t m_GMPRandState;        // for large random numbers
+#endif
     bool m_AllJoined;
 
     // Jeff: added this data structure to allow the bootstrap to
@@ -181,7 +198,7 @@ class BootstrapNode : public Node {
     bool ReadIdentMap(const char *file);
 
     //bool ChooseIdent(MercuryID& ret, IPEndPoint *from, BootstrapHubInfo *hinfo);
-    IPEndPoint ChooseRepresentative(IPEndPoint *from, BootstrapHubInfo *hinfo);
+    IPEndPoint ChooseRepresentative(IPEndPoint *from, BootstrapHubInfo *hinfo, HubInitInfo *joiner = NULL);
     Value GetRandom (const Value& max);
 
     //void StartProcessingBootReqs();
@@ -199,6 +216,7 @@ class BootstrapNode : public Node {
     IPEndPoint ChooseSimulateDistributedJoin (BootstrapHubInfo *hinfo);
     IPEndPoint ChooseRandom (BootstrapHubInfo *hinfo);
     IPEndPoint ChooseRoundRobin (BootstrapHubInfo *hinfo);
+    IPEndPoint ChooseLoadAware (BootstrapHubInfo *hinfo, HubInitInfo *joiner);
     //IPEndPoint ChooseFromIdentMap (IPEndPoint *from, BootstrapHubInfo *hinfo);
 
     //void FixKnownRanges(NodeState& state, HubInitInfo& newinfo, BootstrapHubInfo *info);
@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+#include <mercury/BoxTable.h>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void BoxOverlapKernelScalar (sint32 * const *mins, sint32 * const *maxs, int ndim, int nrows,
+			     const sint32 *qmin, const sint32 *qmax, vector<int> *hits)
+{
+    for (int r = 0; r < nrows; r++) {
+	bool ok = true;
+	for (int d = 0; d < ndim && ok; d++) 
+	    ok = mins[d][r] <= qmax[d] && maxs[d][r] >= qmin[d];
+	if (ok)
+	    hits->push_back (r);
+    }
+}
+
+// 'mask' has bit i set if row (base + i) overlaps
+static inline void _PushHits (unsigned int mask, int base, int nrows, vector<int> *hits)
+{
+    while (mask) {
+	int r = base + __builtin_ctz (mask);
+	if (r >= nrows)        // padding
+	    break;
+	hits->push_back (r);
+	mask &= mask - 1;
+    }
+}
+
+#if defined(__AVX512F__)
+
+const char *BoxOverlapKernelName () { return "avx512"; }
+
+void BoxOverlapKernel (sint32 * const *mins, sint32 * const *maxs, int ndim, int nrows,
+		       const sint32 *qmin, const sint32 *qmax, vector<int> *hits)
+{
+    __m512i qminv[ndim], qmaxv[ndim];
+    for (int d = 0; d < ndim; d++) {
+	qminv[d] = _mm512_set1_epi32 (qmin[d]);
+	qmaxv[d] = _mm512_set1_epi32 (qmax[d]);
+    }
+
+    for (int r = 0; r < nrows; r += 16) {
+	__mmask16 ok = 0xFFFF;
+
+	// compares come out as masks; rows already missed are left out
+	for (int d = 0; d < ndim && ok; d++) {
+	    __m512i mn = _mm512_loadu_si512 ((const void *) (mins[d] + r));
+	    __m512i mx = _mm512_loadu_si512 ((const void *) (maxs[d] + r));
+
+	    ok = _mm512_mask_cmple_epi32_mask (ok, mn, qmaxv[d]);
+	    ok = _mm512_mask_cmpge_epi32_mask (ok, mx, qminv[d]);
+	}
+
+	_PushHits (ok, r, nrows, hits);
+    }
+}
+
+#elif defined(__AVX2__)
+
+const char *BoxOverlapKernelName () { return "avx2"; }
+
+void BoxOverlapKernel (sint32 * const *mins, sint32 * const *maxs, int ndim, int nrows,
+		       const sint32 *qmin, const sint32 *qmax, vector<int> *hits)
+{
+    __m256i qminv[ndim], qmaxv[ndim];
+    for (int d = 0; d < ndim; d++) {
+	qminv[d] = _mm256_set1_epi32 (qmin[d]);
+	qmaxv[d] = _mm256_set1_epi32 (qmax[d]);
+    }
+
+    for (int r = 0; r < nrows; r += 8) {
+	__m256i ok = _mm256_set1_epi32 (-1);
+
+	for (int d = 0; d < ndim; d++) {
+	    __m256i mn = _mm256_loadu_si256 ((const __m256i *) (mins[d] + r));
+	    __m256i mx = _mm256_loadu_si256 ((const __m256i *) (maxs[d] + r));
+
+	    // miss if min > qmax or qmin > max
+	    __m256i miss = _mm256_or_si256 (_mm256_cmpgt_epi32 (mn, qmaxv[d]), 
+					    _mm256_cmpgt_epi32 (qminv[d], mx));
+	    ok = _mm256_andnot_si256 (miss, ok);
+	    if (_mm256_testz_si256 (ok, ok))
+		break;
+	}
+
+	_PushHits (_mm256_movemask_ps (_mm256_castsi256_ps (ok)), r, nrows, hits);
+    }
+}
+
+#elif defined(__SSE2__)
+
+const char *BoxOverlapKernelName () { return "sse2"; }
+
+void BoxOverlapKernel (sint32 * const *mins, sint32 * const *maxs, int ndim, int nrows,
+		       const sint32 *qmin, const sint32 *qmax, vector<int> *hits)
+{
+    __m128i qminv[ndim], qmaxv[ndim];
+    for (int d = 0; d < ndim; d++) {
+	qminv[d] = _mm_set1_epi32 (qmin[d]);
+	qmaxv[d] = _mm_set1_epi32 (qmax[d]);
+    }
+
+    for (int r = 0; r < nrows; r += 4) {
+	__m128i ok = _mm_set1_epi32 (-1);
+
+	for (int d = 0; d < ndim; d++) {
+	    __m128i mn = _mm_loadu_si128 ((const __m128i *) (mins[d] + r));
+	    __m128i mx = _mm_loadu_si128 ((const __m128i *) (maxs[d] + r));
+
+	    __m128i miss = _mm_or_si128 (_mm_cmpgt_epi32 (mn, qmaxv[d]), 
+					 _mm_cmpgt_epi32 (qminv[d], mx));
+	    ok = _mm_andnot_si128 (miss, ok);
+	}
+
+	_PushHits (_mm_movemask_ps (_mm_castsi128_ps (ok)), r, nrows, hits);
+    }
+}
+
+#else
+
+const char *BoxOverlapKernelName () { return "scalar"; }
+
+void BoxOverlapKernel (sint32 * const *mins, sint32 * const *maxs, int ndim, int nrows,
+		       const sint32 *qmin, const sint32 *qmax, vector<int> *hits)
+{
+    BoxOverlapKernelScalar (mins, maxs, ndim, nrows, qmin, qmax, hits);
+}
+
+#endif
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  BoxTable.h
+
+  A packed, column-per-attribute table of boxes (one [min, max] pair
+  of 32-bit integers per attribute per row) and a batch kernel which
+  tests one query box against many rows at a time. 
+
+  How many rows one compare tests depends on the build (SIMD= in
+  toprules.make): 16 with AVX-512 (SIMD=avx512), 8 with AVX2
+  (SIMD=avx2), and 4 with SSE2, which every other x86-64 build has.
+  Elsewhere it is plain C. Callers decide how values are squeezed into
+  32 bits; see SoAPubsubStore.
+
+***************************************************************************/
+
+#ifndef __BOXTABLE__H
+#define __BOXTABLE__H
+
+#include <vector>
+#include <climits>
+#include <hash_map.h>
+#include <util/types.h>
+#include <util/debug.h>
+#include <mercury/ID.h>
+
+// rows are padded to a multiple of this so the kernel never 
+// needs a scalar tail loop
+#define BOXTABLE_PAD 16
+
+/**
+ * Append the index of every row r < nrows with
+ *    mins[d][r] <= qmax[d] && maxs[d][r] >= qmin[d]   for all d
+ * to 'hits'. Columns must hold a multiple of BOXTABLE_PAD entries.
+ **/
+void BoxOverlapKernel (sint32 * const *mins, sint32 * const *maxs, int ndim, int nrows,
+		       const sint32 *qmin, const sint32 *qmax, vector<int> *hits);
+
+/**
+ * Same as above without any vector instructions; always available.
+ **/
+void BoxOverlapKernelScalar (sint32 * const *mins, sint32 * const *maxs, int ndim, int nrows,
+			     const sint32 *qmin, const sint32 *qmax, vector<int> *hits);
+
+/**
+ * Name of the kernel BoxOverlapKernel () was compiled as.
+ **/
+const char *BoxOverlapKernelName ();
+
+// T is a pointer type; an item can be in the table only once.
+template<class T>
+class BoxTable {
+    typedef hash_map<T, int, hash_ptr, equal_ptr> RowMap;
+
+    int                      m_Dim;
+    int                      m_Rows;
+    vector<vector<sint32> >  m_Mins, m_Maxs;     // [attribute][row]
+    vector<T>                m_Items;
+    RowMap                   m_RowOf;
+
+    // scratch for the kernel; column base pointers
+    vector<sint32 *>         m_MinPtrs, m_MaxPtrs;
+
+ public:
+    BoxTable (int dim) : m_Dim (dim), m_Rows (0), m_Mins (dim), m_Maxs (dim), 
+	m_MinPtrs (dim), m_MaxPtrs (dim) {}
+
+    int size () const { return m_Rows; }
+    int GetDim () const { return m_Dim; }
+    T GetItem (int row) const { return m_Items[row]; }
+
+    /**
+     * Add a row; returns its index. Indices change on Remove ().
+     **/
+    int Add (T item, const sint32 *min, const sint32 *max) {
+	if (m_Rows % BOXTABLE_PAD == 0) {
+	    // open a new padded block; padding rows never match
+	    // anything narrower than the whole space, and the 
+	    // kernel drops rows >= m_Rows anyway
+	    for (int d = 0; d < m_Dim; d++) {
+		m_Mins[d].resize (m_Rows + BOXTABLE_PAD, INT_MAX);
+		m_Maxs[d].resize (m_Rows + BOXTABLE_PAD, INT_MIN);
+	    }
+	}
+	for (int d = 0; d < m_Dim; d++) {
+	    m_Mins[d][m_Rows] = min[d];
+	    m_Maxs[d][m_Rows] = max[d];
+	}
+	m_Items.push_back (item);
+	m_RowOf[item] = m_Rows;
+	return m_Rows++;
+    }
+
+    /**
+     * Remove a row by moving the last row into its place.
+     **/
+    void Remove (int row) {
+	ASSERT (row >= 0 && row < m_Rows);
+	int last = m_Rows - 1;
+
+	for (int d = 0; d < m_Dim; d++) {
+	    m_Mins[d][row] = m_Mins[d][last];
+	    m_Maxs[d][row] = m_Maxs[d][last];
+	    m_Mins[d][last] = INT_MAX;
+	    m_Maxs[d][last] = INT_MIN;
+	}
+	m_RowOf.erase (m_Items[row]);
+	if (row != last)
+	    m_RowOf[m_Items[last]] = row;
+	m_Items[row] = m_Items[last];
+	m_Items.pop_back ();
+	m_Rows--;
+
+	if (m_Rows % BOXTABLE_PAD == 0) {
+	    for (int d = 0; d < m_Dim; d++) {
+		m_Mins[d].resize (m_Rows);
+		m_Maxs[d].resize (m_Rows);
+	    }
+	}
+    }
+
+    bool RemoveItem (T item) {
+	typename RowMap::iterator it = m_RowOf.find (item);
+	if (it == m_RowOf.end ())
+	    return false;
+	Remove (it->second);
+	return true;
+    }
+
+    void GetOverlaps (const sint32 *qmin, const sint32 *qmax, vector<T> *out) {
+	if (m_Rows == 0)
+	    return;
+
+	for (int d = 0; d < m_Dim; d++) {
+	    m_MinPtrs[d] = &m_Mins[d][0];
+	    m_MaxPtrs[d] = &m_Maxs[d][0];
+	}
+
+	vector<int> hits;
+	BoxOverlapKernel (&m_MinPtrs[0], &m_MaxPtrs[0], m_Dim, m_Rows, qmin, qmax, &hits);
+
+	for (int i = 0, len = hits.size (); i < len; i++)
+	    out->push_back (m_Items[hits[i]]);
+    }
+
+    void Clear () {
+	for (int d = 0; d < m_Dim; d++) {
+	    m_Mins[d].clear ();
+	    m_Maxs[d].clear ();
+	}
+	m_Items.clear ();
+	m_RowOf.clear ();
+	m_Rows = 0;
+    }
+};
+
+#endif // __BOXTABLE__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -23,8 +23,10 @@
 
 #include <mercury/Cache.h>
 #include <mercury/Constraint.h>
-#include <time.h>
 #include <mercury/Hub.h>
+#include <mercury/MercuryNode.h>
+#include <mercury/RangeTable.h>
+#include <mercury/Parameters.h>
 #include <map>
 
 const char *g_CacheTypeStrings[] = {
@@ -40,9 +42,9 @@ const char *g_pubsub_strs[] = {
 };
 
 CacheEntry::CacheEntry(IPEndPoint address, NodeRange &range) :
-    m_Address(address), m_Range(range), m_NumUsed(0)
+    m_Address(address), m_Range(range), m_NumUsed(0), 
+    m_Timestamp(TIME_NONE), m_Newer(NULL), m_Older(NULL)
 {
-    m_Timestamp = time(0);
 }
 
 void CacheEntry::Print(FILE * stream)
@@ -57,7 +59,7 @@ void CacheEntry::Print(FILE * stream)
 
     min.Print(stream);     
     max.Print(stream);
-    fprintf(stream, "time=%u\n", (unsigned int) m_Timestamp);
+    fprintf(stream, "time=%.3f used=%d\n", timeval_to_float(m_Timestamp), m_NumUsed);
 }
 
 CacheEntry::~CacheEntry()
@@ -66,44 +68,50 @@ CacheEntry::~CacheEntry()
 
 /////////////////////////////////////////////////////////////////////
 
-struct less_Value {
-    bool operator() (const Value *av, const Value *bv) const {
-	return av < bv;
-    }
-};
-
-typedef map<const Value *, CacheEntry *, less_Value> CacheMap;
-typedef CacheMap::iterator CacheMapIter;
+typedef map<SID, CacheEntry *, less_SID> CacheAddrMap;
+typedef CacheAddrMap::iterator CacheAddrMapIter;
 
 class CacheImpl {
-    CacheMap entries;
-
 public:
-    CacheImpl() {}
+    RangeTable<CacheEntry> table;     // by range, for lookups
+    CacheAddrMap           byaddr;    // by node, for acks
+    CacheEntry            *newest, *oldest;
+
+    CacheImpl(const Value& absmax) : table(absmax), newest(NULL), oldest(NULL) {}
     ~CacheImpl() {
-	for (CacheMapIter it = entries.begin(); it != entries.end(); it++) 
+	for (CacheAddrMapIter it = byaddr.begin(); it != byaddr.end(); it++) 
 	    delete it->second;
-	entries.clear();
+	byaddr.clear();
     }
 
-    CacheMapIter begin() { return entries.begin(); }
-    CacheMapIter end() { return entries.end(); }
-    size_t size() { return entries.size(); }
-    void erase(CacheMapIter it) { 
-	delete it->second;
-	entries.erase(it); 
+    void Unlink(CacheEntry *e) {
+	if (e->m_Newer)
+	    e->m_Newer->m_Older = e->m_Older;
+	else
+	    newest = e->m_Older;
+	if (e->m_Older)
+	    e->m_Older->m_Newer = e->m_Newer;
+	else
+	    oldest = e->m_Newer;
+	e->m_Newer = e->m_Older = NULL;
     }
 
-    // I own it!
-    void AddEntry(CacheEntry *entry) {
-	entries.insert(CacheMap::value_type(&entry->GetRange().GetMin(), entry));
+    void PushNewest(CacheEntry *e) {
+	e->m_Newer = NULL;
+	e->m_Older = newest;
+	if (newest)
+	    newest->m_Newer = e;
+	else
+	    oldest = e;
+	newest = e;
     }
 };
 
 Cache::Cache(CacheType type, int maxsize, Hub *hub) :
-    m_Type(type), m_Maxsize(maxsize), m_Hub(hub)
+    m_Type(type), m_Maxsize(maxsize), m_Hub(hub), 
+    m_Scheduler(hub->GetMercuryNode()->GetScheduler())
 {
-    m_Impl = new CacheImpl();
+    m_Impl = new CacheImpl(hub->GetAbsMax());
 }
 
 Cache::~Cache()
@@ -111,146 +119,114 @@ Cache::~Cache()
     delete m_Impl;
 }
 
-bool Cache::Less (const Value& val, const Value& other)
+int Cache::GetSize()
 {
-    if (val == m_Hub->GetAbsMax ()) 
-	return val <= other;
-    else
-	return val < other;
+    return m_Impl->table.Size();
 }
 
-// this code is similar to the code in Hub::GetNearestPeer. 
 // our caller should compare whether the entry returned by 
 // the Cache or the one returned by Hub::GetNearestPeer is
 // closer to 'want'
 
 CacheEntry *Cache::LookupEntry(const Value &val)
 {
-    if (m_Impl->size() == 0)
+    m_Stats.lookups++;
+    if (m_Impl->table.Empty())
 	return NULL;
 
-    CacheEntry *nearest = NULL;
-
-    for (CacheMapIter it = m_Impl->begin () ; it != m_Impl->end(); ++it)
-    {
-	const NodeRange& cur = it->second->GetRange ();
-	DB (10) << " <<<<<< considering entry=" << it->second << endl;
-
-	// GetMax () for a peer remains same even when other nodes join 
-	// near that peer (since other nodes install themselves as 
-	// predecessors) - so this way, information is less likely 
-	// to be stale
-
-	CacheMapIter nit (it);
-	++nit;
-
-	if (nit != m_Impl->end ()) {
-	    const NodeRange& next = nit->second->GetRange ();
-
-	    if (val >= cur.GetMax () && Less (val, next.GetMax ())) {
-		if (val < next.GetMin ())
-		    nearest = it->second;
-		else
-		    nearest = nit->second;
-
-		DB (10) << " <<<<<<<<<<<<<<< found nearest " << nearest->GetRange () << endl;
-		break;
-	    }
-	}
-	else {
-	    if (val >= cur.GetMax ())
-		nearest = it->second;
-	    else { 
-		// this can only happen when val < first.GetMax ()
-
-		const NodeRange& first = m_Impl->begin ()->second->GetRange ();
-		ASSERT (val < first.GetMax ());
-		if (val >= first.GetMin ())  // belongs to first guy
-		    nearest = m_Impl->begin ()->second;
-		else                         // between last and first
-		    nearest = it->second;
-	    }
-	    DB (10) << " <<<<<<<<<<<<<<< found nearest " << nearest->GetRange () << endl;
-	    break;
-	}
-    }
-
-    ASSERT (nearest != NULL);
+    CacheEntry *nearest = m_Impl->table.Lookup(val);
+    DB (10) << " <<<<<<<<<<<<<<< found nearest " << nearest->GetRange () << endl;
     return nearest;
 }
 
-void Cache::Print(FILE * stream)
+void Cache::Used(CacheEntry *e)
 {
-    fprintf(stream, "********* Cache ********************* \n");
-    int i = 0;
-    for (CacheMapIter it = m_Impl->begin(); it != m_Impl->end(); it++, i++) 	{
-	CacheEntry *entry = it->second;
+    m_Stats.hits++;
+    e->Used();
 
-	fprintf(stream, "\t>> entry(%d):\n", i);
-	entry->Print(stream);
-    }
-
-    fprintf(stream, "---------- end ---------------------\n");
+    m_Impl->Unlink(e);
+    m_Impl->PushNewest(e);
 }
 
-void SingleCache::InsertEntry(CacheEntry * e)
+CacheEntry *Cache::LookupOwner(const Value &val)
 {
-    if (m_Impl->size() == 0) {
-	m_Impl->AddEntry(e);
-	return;
+    CacheEntry *entry = LookupEntry(val);
+    if (!entry)
+	return NULL;
+
+    const NodeRange& r = entry->GetRange();
+    if (!IsBetweenLeftInclusive(val, r.GetMin(), r.GetMax()))
+	return NULL;
+
+    if (m_Scheduler->TimeNow() - entry->m_Timestamp > Parameters::CacheEntryTimeout) {
+	m_Stats.expired++;
+	Evict(entry);
+	return NULL;
     }
 
-    m_Impl->erase(m_Impl->begin());
-    m_Impl->AddEntry(e);
+    Used(entry);
+    return entry;
 }
 
+void Cache::Evict(CacheEntry *e)
+{
+    m_Impl->Unlink(e);
+    m_Impl->table.Erase(e);
+    m_Impl->byaddr.erase(e->GetAddress());
+    delete e;
+}
 
-void LRUCache::InsertEntry(CacheEntry * e)
+void Cache::InsertEntry(CacheEntry * e)
 {
-    // Check to see if the same entry is present or not.
+    CacheAddrMapIter it = m_Impl->byaddr.find(e->GetAddress());
 
-    for (CacheMapIter it = m_Impl->begin(); it != m_Impl->end(); it++) 	{
+    if (it != m_Impl->byaddr.end()) {
 	CacheEntry *entry = it->second;
 
-	if (! (entry->GetAddress() == e->GetAddress()))
-	    continue;
-	if (entry->GetRange() == e->GetRange()) {
-	    entry->m_Timestamp = time(0);
-	    delete e;
-	    return;
+	// routes through the old range may have gone to the wrong node
+	if (entry->GetRange() != e->GetRange()) {
+	    m_Stats.stale += entry->m_NumUsed;
+	    entry->m_Range = e->GetRange();
+	    m_Impl->table.Update(entry);
 	}
-    }
+	entry->m_NumUsed = 0;
+	entry->m_Timestamp = m_Scheduler->TimeNow();
 
-    if ((int) m_Impl->size() < m_Maxsize) {
-	e->m_NumUsed = 0;
-	m_Impl->AddEntry(e);
+	m_Impl->Unlink(entry);
+	m_Impl->PushNewest(entry);
+	delete e;
 	return;
     }
 
-    CacheMapIter to_kick = m_Impl->end();
-    int min = INT_MAX;
-
-    for (CacheMapIter it = m_Impl->begin(); it != m_Impl->end(); ++it) 	{
-	CacheEntry *entry = it->second;
-
-	if (entry->m_NumUsed < min) {
-	    min = entry->m_NumUsed;
-	    to_kick = it;
-	}
+    if (m_Maxsize <= 0) {
+	delete e;
+	return;
+    }
+    if (GetSize() >= m_Maxsize) {
+	m_Stats.evictions++;
+	Evict(m_Impl->oldest);
     }
 
-    ASSERT(to_kick != m_Impl->end());
-    m_Impl->erase(to_kick);
-    m_Impl->AddEntry(e);
+    e->m_NumUsed = 0;
+    e->m_Timestamp = m_Scheduler->TimeNow();
+    m_Impl->byaddr.insert(CacheAddrMap::value_type(e->GetAddress(), e));
+    m_Impl->table.Insert(e);
+    m_Impl->PushNewest(e);
 }
 
-CacheEntry *LRUCache::LookupEntry(const Value& want)
+void Cache::Print(FILE * stream)
 {
-    CacheEntry *ent = Cache::LookupEntry(want);
-    if (ent)
-	ent->Used();     // FIXME: the caller may not use us! so really the caller should call 'Used()'
+    fprintf(stream, "********* Cache ********************* \n");
+    for (int i = 0; i < m_Impl->table.Size(); i++) {
+	CacheEntry *entry = m_Impl->table[i].item;
 
-    return ent;
+	fprintf(stream, "\t>> entry(%d):\n", i);
+	entry->Print(stream);
+    }
+    fprintf(stream, "lookups=%u hits=%u stale=%u evictions=%u expired=%u\n", 
+	    m_Stats.lookups, m_Stats.hits, m_Stats.stale, m_Stats.evictions, m_Stats.expired);
+
+    fprintf(stream, "---------- end ---------------------\n");
 }
 // vim: set sw=4 sts=4 ts=8 noet: 
 // Local Variables:
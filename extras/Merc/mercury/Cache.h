@@ -29,7 +29,6 @@
 
 #include <mercury/IPEndPoint.h>
 #include <mercury/Constraint.h>
-#include <time.h>
 
 // make sure this matches g_cache_strs in global_strings.cpp
 typedef enum { CACHE_SINGLE, CACHE_LRU, CACHE_UNIFORM } CacheType;
@@ -38,12 +37,15 @@ extern const char* g_CacheTypeStrings[];
 extern const char* g_pubsub_strs[];
 
 class Hub;
+class Scheduler;
 
 struct CacheEntry {
     IPEndPoint m_Address;
     NodeRange  m_Range;
-    int        m_NumUsed;
-    time_t     m_Timestamp;
+    int        m_NumUsed;      // routed through since m_Range was last confirmed
+    TimeVal    m_Timestamp;    // when m_Range was last confirmed (scheduler time)
+
+    CacheEntry *m_Newer, *m_Older;    // LRU order (see Cache)
 
     CacheEntry(IPEndPoint addr, NodeRange &range);
     ~CacheEntry();
@@ -58,38 +60,66 @@ struct CacheEntry {
     void Print(FILE *stream);
 };
 
+// for sizing --cachesize. misses = lookups - hits.
+struct CacheStats {
+    uint32 lookups;      // LookupEntry () calls
+    uint32 hits;         // lookups the caller routed through (Used ())
+    uint32 stale;        // hits on a range which the node's next ack changed
+    uint32 evictions;
+    uint32 expired;      // LookupOwner () found the owner, but too long unconfirmed
+
+    CacheStats () : lookups (0), hits (0), stale (0), evictions (0), expired (0) {}
+};
+
 class CacheImpl;
 
+// Routes learnt from acks: one entry per node, with the range it last
+// told us. Entries are indexed by range (see RangeTable.h), and the 
+// least recently used one goes when the cache is full.
+
 class Cache {
  protected:
     CacheType     m_Type;
     int           m_Maxsize;
     CacheImpl    *m_Impl;
     Hub          *m_Hub;
+    Scheduler    *m_Scheduler;
+    CacheStats    m_Stats;
+
+    void Evict (CacheEntry *e);
  public:
     Cache(CacheType type, int maxsize, Hub *hub);
     virtual ~Cache();    
     CacheType GetType() { return m_Type; }
+    int GetSize ();
+    const CacheStats& GetStats () const { return m_Stats; }
 
     void Print(FILE *stream);
+
+    // the entry nearest 'want' as Hub::GetNearestPeer picks peers, or
+    // NULL if the cache is empty. call Used () if you route through it.
     virtual CacheEntry *LookupEntry(const Value &want);
-    virtual void InsertEntry(CacheEntry *) = 0;
+    virtual void Used (CacheEntry *e);
+
+    // the entry whose range holds 'want', if its node confirmed that 
+    // range within Parameters::CacheEntryTimeout; else NULL. for hubs
+    // we have no ring in, where a wrong guess cannot be routed around.
+    // a hit is marked Used.
+    CacheEntry *LookupOwner (const Value &want);
+
+    // I own it!
+    virtual void InsertEntry(CacheEntry *e);
     virtual void Expire() {}
- private:
-    bool Less (const Value& val, const Value& other);
 };
 
 class SingleCache : public Cache {
  public:
     SingleCache(Hub *hub) : Cache(CACHE_SINGLE, 1, hub) {}
-    void InsertEntry(CacheEntry *);
 };
 
 class LRUCache : public Cache {
  public:
     LRUCache(int maxsize, Hub *hub) : Cache(CACHE_LRU, maxsize, hub) {}
-    void InsertEntry(CacheEntry *);
-    CacheEntry *LookupEntry(const Value &want); 
 };
 #endif // __CACHE__H
 // vim: set sw=4 sts=4 ts=8 noet: 
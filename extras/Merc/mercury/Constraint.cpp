@@ -51,6 +51,11 @@ Constraint::Constraint(Packet *pkt) : m_AttrIndex (pkt->ReadInt ())
 {
 }
 
+Constraint::Constraint(PacketReader& r) : m_AttrIndex (r.Need (4).GetInt ())
+					, m_Min (r), m_Max (r)
+{
+}
+
 void Constraint::Clamp (const Value& amin, const Value& amax) {
     if (m_Min < amin) {
 	DB_DO(10) {	WARN << "clamping left end: " << m_Min << " to " << amin << endl;}
@@ -146,6 +151,11 @@ bool Constraint::Overlaps (const Constraint& oc) const
 	(oc.GetMin () >= m_Min && oc.GetMin () <= m_Max);
 }
 
+bool Constraint::Contains (const Constraint& oc) const
+{
+    return m_Min <= oc.GetMin () && oc.GetMax () <= m_Max;
+}
+
 bool Constraint::OverlapsNodeRange (const NodeRange& nr) const
 {
     if (nr.GetMin () < nr.GetMax ()) 
@@ -224,9 +234,16 @@ uint32 Constraint::GetLength()
 
 void Constraint::Serialize(Packet * pkt)
 {
-    pkt->WriteInt(m_AttrIndex);
-    m_Min.Serialize(pkt);
-    m_Max.Serialize(pkt);
+    PacketWriter w(pkt);
+    Serialize(w);
+}
+
+void Constraint::Serialize(PacketWriter& w)
+{
+    w.Reserve(4);
+    w.PutInt(m_AttrIndex);
+    m_Min.Serialize(w);
+    m_Max.Serialize(w);
 }
 
 void Constraint::Print(FILE * stream)
@@ -64,6 +64,7 @@ class Constraint : public Serializable {
     }
 
     Constraint(Packet *pkt);
+    Constraint(PacketReader& r);
     virtual ~Constraint() {}
 
     const Value& GetMin() const { return m_Min; }
@@ -74,6 +75,7 @@ class Constraint : public Serializable {
     void GetRouteDirections (NodeRange& r, bool& left, bool& center, bool& right, bool amRightmost);
     bool Covers (const Value& val) const ;
     bool Overlaps (const Constraint& cst) const;
+    bool Contains (const Constraint& cst) const;   // [min, max] includes all of 'cst'
     bool OverlapsNodeRange (const NodeRange& nr) const;
 
     Value GetSpan (const Value& absmin, const Value& absmax) const;
@@ -82,6 +84,7 @@ class Constraint : public Serializable {
     ////////////////////////////////////////////////////////
     // Serialization
     void   Serialize(Packet *pkt);
+    void   Serialize(PacketWriter& w);
     uint32 GetLength();
     void   Print(FILE *stream);
 
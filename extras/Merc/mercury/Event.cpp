@@ -83,6 +83,18 @@ void Event::Serialize(Packet * pkt)
 	pkt->WriteByte (0x0);
 }
 
+uint32 Event::GetNonceOffset()
+{
+    return 1;       // GetType()
+}
+
+uint32 Event::GetLifeTimeOffset()
+{
+    uint32 offset = 1;
+    OBJECT_LOG_DO( offset += 4 );
+    return offset;
+}
+
 uint32 Event::GetLength()
 {
     uint32 length = 0;
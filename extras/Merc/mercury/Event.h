@@ -85,6 +85,12 @@ class Event : public virtual Serializable {
     void    SetNonce(uint32 nonce) { m_Nonce = nonce; }
     uint32  GetNonce() { return m_Nonce; }
 
+    // where Event::Serialize puts these, counted from the start of 
+    // the event; subclasses serialize the Event part first. there is 
+    // a nonce only with ENABLE_OBJECT_LOGS.
+    static uint32 GetNonceOffset();
+    static uint32 GetLifeTimeOffset();
+
     // used by MercuryNode ONLY to manage this as softstate
     void SetDeathTime(TimeVal time) { m_DeathTime = time; }
     const TimeVal& GetDeathTime() const { return m_DeathTime; }
@@ -102,10 +108,14 @@ class Event : public virtual Serializable {
 
     /**
      * this method is used (ultimately) as the comparator in 
-     * the Event hashtable used for publication overwriting
+     * the Event index used for publication overwriting (see 
+     * OverwriteIndex.h); it must be a strict weak ordering. by 
+     * default no two events are the same object.
      **/
     virtual bool LessThan (const Event *oe) const {
-	return GetType () < oe->GetType () || (this < oe);
+	if (GetType () != oe->GetType ())
+	    return GetType () < oe->GetType ();
+	return this < oe;
     }
 
     /**
@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  ExpiryIndex.h
+
+  Orders the items of a pubsub store by death time, so that dropping
+  expired soft-state costs time proportional to the number of items
+  which actually expired (plus a log factor) instead of a walk over
+  everything stored. 
+
+  Items are pointers; each may be in the index at most once. The death
+  time is captured on Insert (); re-insert if it changes. A store which
+  finds its items by position (say, a list iterator) can index the 
+  positions instead, given a hash H and an equality E for them.
+
+***************************************************************************/
+
+#ifndef __EXPIRYINDEX__H
+#define __EXPIRYINDEX__H
+
+#include <map>
+#include <vector>
+#include <hash_map.h>
+#include <util/TimeVal.h>
+#include <mercury/ID.h>
+
+template<class T, class H = hash_ptr, class E = equal_ptr>
+class ExpiryIndex {
+    typedef multimap<TimeVal, T>                               TimeMap;
+    typedef typename TimeMap::iterator                         TimeMapIter;
+    typedef hash_map<T, TimeMapIter, H, E>                     PosMap;
+
+    TimeMap  m_ByTime;
+    PosMap   m_Pos;
+
+ public:
+    void Insert (const TimeVal& death, T item) {
+	ASSERT (m_Pos.find (item) == m_Pos.end ());
+	m_Pos[item] = m_ByTime.insert (typename TimeMap::value_type (death, item));
+    }
+
+    void Erase (T item) {
+	typename PosMap::iterator it = m_Pos.find (item);
+	if (it == m_Pos.end ())
+	    return;
+	m_ByTime.erase (it->second);
+	m_Pos.erase (it);
+    }
+
+    /**
+     * Erase a batch (say, a range handed over to a neighbor) in one 
+     * pass over the position map only. Their entries in the time 
+     * order are left behind and dropped by PopExpired when their 
+     * death time comes, rather than rebalancing the tree once per 
+     * item now. An item may be inserted again meanwhile.
+     **/
+    void Erase (const vector<T>& items) {
+	for (int i = 0, len = items.size (); i < len; i++)
+	    m_Pos.erase (items[i]);
+    }
+
+    /**
+     * Take every item whose death time is <= now out of the index 
+     * and append it to 'out', earliest first.
+     **/
+    void PopExpired (const TimeVal& now, vector<T> *out) {
+	while (!m_ByTime.empty ()) {
+	    TimeMapIter it = m_ByTime.begin ();
+	    if (now < it->first)
+		break;
+
+	    // skip what a batch Erase left behind
+	    typename PosMap::iterator pos = m_Pos.find (it->second);
+	    if (pos != m_Pos.end () && pos->second == it) {
+		out->push_back (it->second);
+		m_Pos.erase (pos);
+	    }
+	    m_ByTime.erase (it);
+	}
+    }
+
+    // may be true for entries left by a batch Erase only
+    bool HasExpired (const TimeVal& now) const {
+	return !m_ByTime.empty () && !(now < m_ByTime.begin ()->first);
+    }
+
+    int size () const { return m_Pos.size (); }
+    bool empty () const { return m_Pos.empty (); }
+
+    void Clear () {
+	m_ByTime.clear ();
+	m_Pos.clear ();
+    }
+};
+
+#endif // __EXPIRYINDEX__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+#ifdef MERCURY_FIXED_VALUE
+
+#include <mercury/common.h>
+#include <mercury/MercuryID.h>
+#include <mercury/Packet.h>
+#include <sstream>
+
+const FixedValue FixedValue::ZERO = FixedValue (0);
+const FixedValue FixedValue::ONE  = FixedValue (1);
+
+static int fixed_digit (char c)
+{
+    if (c >= '0' && c <= '9')
+	return c - '0';
+    if (c >= 'a' && c <= 'z')
+	return c - 'a' + 10;
+    if (c >= 'A' && c <= 'Z')
+	return c - 'A' + 10;
+    return 36;
+}
+
+FixedValue::FixedValue (const char *s, int base) : m_Val (0)
+{
+    // "%N" is the largest N-bit number, as for MercuryID
+    if (s[0] == '%') {
+	char *end = NULL;
+	int pow = strtol (s + 1, &end, base);
+	ASSERT (*end == '\0');
+	if (pow >= BITS) {
+	    WARN << "merc id " << s << " does not fit in " << BITS 
+		 << " bits; rebuild without VALUE=fixed" << endl;
+	    ASSERT (0);
+	}
+	m_Val = ((fixed_value_t) 1 << pow) - 1;
+	return;
+    }
+
+    const char *p = s;
+    bool neg = false;
+    while (isspace (*p))
+	p++;
+    if (*p == '-' || *p == '+')
+	neg = (*p++ == '-');
+
+    // same prefixes mpz_set_str takes for base 0
+    if (base == 0) {
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+	    base = 16, p += 2;
+	else if (p[0] == '0' && (p[1] == 'b' || p[1] == 'B'))
+	    base = 2, p += 2;
+	else if (p[0] == '0' && p[1] != '\0')
+	    base = 8, p++;
+	else
+	    base = 10;
+    }
+
+    const fixed_value_t lim = ~((fixed_value_t) 1 << (BITS - 1));
+    bool ok = (*p != '\0');
+    for (; *p && ok; p++) {
+	int d = fixed_digit (*p);
+	if (d >= base || m_Val > (lim - d) / base)
+	    ok = false;
+	else
+	    m_Val = m_Val * base + d;
+    }
+    if (!ok) {
+	WARN << "bad merc id string: " << s << " base=" << base << endl;
+	ASSERT (0);
+    }
+    if (neg)
+	m_Val = -m_Val;
+}
+
+// the wire format of MercuryID::Serialize: a length, then the value
+// as big-endian two's complement in (nbits/8)+1 bytes (none for 0).
+
+FixedValue::FixedValue (Packet *pkt) : m_Val (0)
+{
+    PacketReader r (pkt);
+    *this = FixedValue (r);
+}
+
+FixedValue::FixedValue (PacketReader& r) : m_Val (0)
+{
+    uint32 size = r.Need (4).GetInt ();
+    byte buf[sizeof (fixed_value_t) + 1];
+
+    if (size > sizeof (buf)) {
+	WARN << "merc id of " << size << " bytes does not fit in " 
+	     << BITS << " bits" << endl;
+	ASSERT (0);
+    }
+    r.Need (size).GetBuffer (buf, size);
+    if (size == 0)
+	return;
+    // a full-width value fits only if its first byte is pure sign
+    if (size == sizeof (buf) && buf[0] != ((buf[1] & 0x80) ? 0xff : 0)) {
+	WARN << "merc id does not fit in " << BITS << " bits" << endl;
+	ASSERT (0);
+    }
+
+    m_Val = (buf[0] & 0x80) ? -1 : 0;
+    for (uint32 i = 0; i < size; i++)
+	m_Val = (fixed_value_t) ((m_Val << 8) | buf[i]);
+}
+
+void FixedValue::Serialize (Packet *pkt) const
+{
+    PacketWriter w (pkt);
+    Serialize (w);
+}
+
+void FixedValue::Serialize (PacketWriter& w) const
+{
+    uint32 size = GetLength () - 4;
+    byte buf[sizeof (fixed_value_t) + 1];
+    fixed_value_t v = m_Val;
+
+    for (int i = (int) size - 1; i >= 0; i--) {
+	buf[i] = (byte) (v & 0xff);
+	v >>= 8;
+    }
+
+    w.Reserve (4 + size);
+    w.PutInt (size);
+    w.PutBuffer (buf, (int) size);
+}
+
+uint32 FixedValue::GetLength () const
+{
+    uint32 n = nbits ();
+
+    uint32 len = 4;             // the length itself
+    if (n)
+	len += (n >> 3) + 1;	/* Not (n+7)/8, because we need sign bit */
+
+    return len;
+}
+
+#define BIG_INT_NUM (1U << 20)
+
+void FixedValue::double_mul (double d)
+{
+    // same rounding as MercuryID::double_mul. divide first, so only
+    // a result which does not fit can overflow: with m = q*BIG + r,
+    // m*di/BIG truncates to q*di + r*di/BIG (r*di has the sign of q*di)
+    fixed_value_t di = (fixed_value_t) (d * BIG_INT_NUM);
+    fixed_value_t q = m_Val / BIG_INT_NUM, r = m_Val % BIG_INT_NUM;
+
+    m_Val = q * di + r * di / BIG_INT_NUM;
+}
+
+void FixedValue::Print (FILE *stream) const
+{
+    ostringstream os;
+    os << *this;
+    fprintf (stream, "%s", os.str ().c_str ());
+}
+
+#ifdef MERCURYID_PRINT_HEX
+#define FIXED_PRINT_BASE 16
+#else
+#define FIXED_PRINT_BASE 10
+#endif
+
+// prints as MercuryID does ("%Zd" or "%ZX"); ostream has no __int128
+ostream& operator<< (ostream& out, const FixedValue *id)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    fixed_value_t v = id->get ();
+    char buf[48], *p = buf + sizeof (buf);
+    bool neg = v < 0;
+
+    *--p = '\0';
+    do {
+	int d = (int) (v % FIXED_PRINT_BASE);
+	*--p = digits[d < 0 ? -d : d];
+	v /= FIXED_PRINT_BASE;
+    } while (v != 0);
+    if (neg)
+	*--p = '-';
+    return out << p;
+}
+
+ostream& operator<< (ostream& out, const FixedValue& id)
+{
+    return out << &id;
+}
+
+#endif // MERCURY_FIXED_VALUE
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
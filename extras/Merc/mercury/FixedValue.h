@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  FixedValue.h
+
+  A fixed-width integer Value, used instead of the GMP-backed MercuryID
+  when Mercury is built with VALUE=fixed64 or VALUE=fixed128 (which
+  define MERCURY_FIXED_VALUE to 64 or 128; see toprules.make). Copying,
+  comparing and adding values then costs what it costs for a machine
+  integer, with no allocation and no mpz_* call.
+
+  Values are signed (VALUE_NONE is -1, and range arithmetic goes below
+  zero), so attribute spaces must fit in 63 (or 127) bits.
+
+  On the wire a FixedValue looks exactly like a MercuryID: a 4-byte 
+  length and then that many bytes of big-endian two's complement, as 
+  few as hold the value. The length is the width tag; so fixed and GMP
+  nodes interoperate as long as the values fit. Reading a value too 
+  wide for this build is an error.
+
+***************************************************************************/
+
+#ifndef __FIXEDVALUE__H
+#define __FIXEDVALUE__H
+
+#include <mercury/common.h>
+#include <string>
+#include <climits>
+
+#if MERCURY_FIXED_VALUE == 128
+typedef __int128 fixed_value_t;
+typedef unsigned __int128 ufixed_value_t;
+#else
+typedef sint64 fixed_value_t;
+typedef uint64 ufixed_value_t;
+#endif
+
+class Packet;
+class PacketWriter;
+class PacketReader;
+
+class FixedValue {
+    fixed_value_t m_Val;
+ public:
+    static const int BITS = 8 * sizeof (fixed_value_t);
+
+    FixedValue () : m_Val (0) {}
+    FixedValue (int si) : m_Val (si) {}
+    FixedValue (u_int ui) : m_Val (ui) {}
+    FixedValue (long si) : m_Val (si) {}
+    FixedValue (u_long ui) : m_Val (ui) {}
+    FixedValue (long long si) : m_Val (si) {}
+    FixedValue (unsigned long long ui) : m_Val (ui) {}
+#if MERCURY_FIXED_VALUE == 128
+    FixedValue (__int128 si) : m_Val (si) {}
+#endif
+
+    const static FixedValue ZERO;
+    const static FixedValue ONE;
+
+    /**
+     * Same strings as MercuryID: a number in 'base' (0 = by prefix), 
+     * or "%N" for the largest N-bit number.
+     **/
+    explicit FixedValue (const char *s, int base = 0);
+
+    FixedValue (Packet *pkt);
+    void Serialize (Packet *pkt) const;
+    FixedValue (PacketReader& r);
+    void Serialize (PacketWriter& w) const;
+    uint32 GetLength () const;
+    void Print (FILE *stream) const;
+
+    FixedValue& operator= (const char *s) { *this = FixedValue (s); return *this; }
+    // one per integer constructor: otherwise 'v = 0' picks the 
+    // const char * overload above with a NULL string
+    FixedValue& operator= (int si) { m_Val = si; return *this; }
+    FixedValue& operator= (u_int ui) { m_Val = ui; return *this; }
+    FixedValue& operator= (long si) { m_Val = si; return *this; }
+    FixedValue& operator= (u_long ui) { m_Val = ui; return *this; }
+    FixedValue& operator= (long long si) { m_Val = si; return *this; }
+    FixedValue& operator= (unsigned long long ui) { m_Val = ui; return *this; }
+#if MERCURY_FIXED_VALUE == 128
+    FixedValue& operator= (__int128 si) { m_Val = si; return *this; }
+#endif
+
+    FixedValue& operator+= (const FixedValue& b) { m_Val += b.m_Val; return *this; }
+    FixedValue& operator-= (const FixedValue& b) { m_Val -= b.m_Val; return *this; }
+    FixedValue& operator*= (const FixedValue& b) { m_Val *= b.m_Val; return *this; }
+    FixedValue& operator/= (const FixedValue& b) { m_Val /= b.m_Val; return *this; }
+    FixedValue& operator%= (const FixedValue& b) { m_Val %= b.m_Val; return *this; }
+    FixedValue& operator&= (const FixedValue& b) { m_Val &= b.m_Val; return *this; }
+    FixedValue& operator^= (const FixedValue& b) { m_Val ^= b.m_Val; return *this; }
+    FixedValue& operator|= (const FixedValue& b) { m_Val |= b.m_Val; return *this; }
+    FixedValue& operator<<= (u_long n) { m_Val <<= n; return *this; }
+    FixedValue& operator>>= (u_long n) { m_Val >>= n; return *this; }
+
+    const FixedValue& operator++ () { ++m_Val; return *this; }
+    const FixedValue& operator-- () { --m_Val; return *this; }
+    FixedValue operator++ (int) { FixedValue t = *this; ++m_Val; return t; }
+    FixedValue operator-- (int) { FixedValue t = *this; --m_Val; return t; }
+
+    fixed_value_t get () const { return m_Val; }
+    long getsi () const { return (long) m_Val; }
+    u_long getui () const { return (u_long) m_Val; }
+    int64_t gets64 () const { return (int64_t) m_Val; }
+    u_int64_t getu64 () const { return (u_int64_t) m_Val; }
+    double getd () const { return (double) m_Val; }
+
+    // bits in the magnitude, as mpz_sizeinbase2 (unsigned, since the
+    // most negative value has no positive counterpart)
+    size_t nbits () const {
+	ufixed_value_t v = m_Val < 0 ? -(ufixed_value_t) m_Val : (ufixed_value_t) m_Val;
+	size_t n = 0;
+	for (; v != 0; v >>= 1)
+	    n++;
+	return n;
+    }
+
+    void swap (FixedValue& b) { fixed_value_t t = m_Val; m_Val = b.m_Val; b.m_Val = t; }
+
+    double double_div (const FixedValue& c) const { return (double) m_Val / (double) c.m_Val; }
+    void double_mul (double d);
+};
+
+#define FIXED_BINOP(X)							\
+inline FixedValue operator X (const FixedValue& a, const FixedValue& b)	\
+{									\
+    FixedValue r = a;							\
+    return r X##= b;							\
+}
+FIXED_BINOP (+)
+FIXED_BINOP (-)
+FIXED_BINOP (*)
+FIXED_BINOP (/)
+FIXED_BINOP (%)
+FIXED_BINOP (&)
+FIXED_BINOP (^)
+FIXED_BINOP (|)
+#undef FIXED_BINOP
+
+#define FIXED_CMPOP(X)							\
+inline bool operator X (const FixedValue& a, const FixedValue& b)	\
+{									\
+    return a.get () X b.get ();						\
+}
+FIXED_CMPOP (<)
+FIXED_CMPOP (>)
+FIXED_CMPOP (<=)
+FIXED_CMPOP (>=)
+FIXED_CMPOP (==)
+FIXED_CMPOP (!=)
+#undef FIXED_CMPOP
+
+inline FixedValue operator<< (const FixedValue& a, u_long n) { FixedValue r = a; return r <<= n; }
+inline FixedValue operator>> (const FixedValue& a, u_long n) { FixedValue r = a; return r >>= n; }
+inline FixedValue operator- (const FixedValue& a) { return FixedValue::ZERO - a; }
+inline FixedValue operator~ (const FixedValue& a) { return FixedValue (~a.get ()); }
+inline const FixedValue& operator+ (const FixedValue& a) { return a; }
+inline bool operator! (const FixedValue& a) { return a.get () == 0; }
+
+inline int sgn (const FixedValue& a) { return a.get () < 0 ? -1 : (a.get () > 0 ? 1 : 0); }
+inline FixedValue abs (const FixedValue& a) { return a.get () < 0 ? -a : a; }
+
+inline void swap (FixedValue& a, FixedValue& b) { a.swap (b); }
+
+ostream& operator<< (ostream& out, const FixedValue *id);
+ostream& operator<< (ostream& out, const FixedValue& id);
+
+#endif // __FIXEDVALUE__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -125,6 +125,38 @@ int Histogram::GetBucketForValue (const Value &val)
     return -1;
 }
 
+float Histogram::GetTotal () const
+{
+    float total = 0;
+    for (int i = 0, len = m_Buckets.size (); i < len; i++)
+	total += m_Buckets[i].GetValue ();
+    return total;
+}
+
+float Histogram::GetValueInRange (const Constraint& c, const Value& absmin, const Value& absmax) const
+{
+    float sum = 0;
+    for (int i = 0, len = m_Buckets.size (); i < len; i++) {
+	const HistElem *he = &m_Buckets[i];
+	const NodeRange& r = he->GetRange ();
+
+	Value span = r.GetSpan (absmin, absmax);
+	if (span <= Value (0))
+	    continue;
+
+	// a bucket which wraps is the two pieces either side of the wrap
+	Value overlap;
+	if (r.GetMin () < r.GetMax ())
+	    overlap = c.GetOverlap (r);
+	else {
+	    overlap = c.GetOverlap (NodeRange (r.GetAttrIndex (), r.GetMin (), absmax));
+	    overlap += c.GetOverlap (NodeRange (r.GetAttrIndex (), absmin, r.GetMax ()));
+	}
+	sum += he->GetValue () * (float) overlap.double_div (span);
+    }
+    return sum;
+}
+
 ostream& operator<<(ostream& os, const Histogram *histo) {
     return os << *histo;
 }
@@ -75,6 +75,13 @@ class Histogram : public Serializable {
     void SortBuckets ();
     int GetBucketForValue (const Value &val);
 
+    // the total value of the buckets, and the part of it which falls
+    // in 'c' (taking each bucket's value to be spread evenly over its
+    // range). buckets may wrap around the attribute's [absmin, absmax];
+    // 'c' must not.
+    float GetTotal () const;
+    float GetValueInRange (const Constraint& c, const Value& absmin, const Value& absmax) const;
+
     uint32 GetLength();
     void Serialize(Packet *pkt);
     void Print(FILE *stream);
@@ -51,6 +51,8 @@ HubInitInfo::HubInitInfo(const HubInitInfo& h) {
     absmax = hh.absmax;
     isMember = hh.isMember;
     rep = hh.rep;
+    placeReps = hh.placeReps;
+    placePreds = hh.placePreds;
     
     staticjoin = hh.staticjoin;
     range = hh.range;
@@ -62,6 +64,11 @@ HubInitInfo::HubInitInfo(Packet *pkt) {
     ID = pkt->ReadByte();
     pkt->ReadString(name);
     rep = IPEndPoint(pkt);
+    uint32 nplaces = pkt->ReadInt();
+    for (uint32 i = 0; i < nplaces; i++) {
+	placeReps.push_back(IPEndPoint(pkt));
+	placePreds.push_back(IPEndPoint(pkt));
+    }
     isMember = (bool) pkt->ReadByte();
     absmin = Value(pkt);
     absmax = Value(pkt);
@@ -90,6 +97,11 @@ void HubInitInfo::Serialize(Packet *pkt) {
     pkt->WriteByte(ID);
     pkt->WriteString(name);
     rep.Serialize(pkt);
+    pkt->WriteInt(placeReps.size());
+    for (uint32 i = 0; i < placeReps.size(); i++) {
+	placeReps[i].Serialize(pkt);
+	placePreds[i].Serialize(pkt);
+    }
     pkt->WriteByte((byte)isMember);
     absmin.Serialize(pkt);
     absmax.Serialize(pkt);
@@ -116,6 +128,10 @@ uint32 HubInitInfo::GetLength() {
 	1 + (name.length()/* + 1*/ + 4) + rep.GetLength() + 
 	1 + absmin.GetLength() + absmax.GetLength();
     
+    len += 4;
+    for (uint32 i = 0; i < placeReps.size(); i++)
+	len += placeReps[i].GetLength() + placePreds[i].GetLength();
+    
     len += 1;
     
     if (staticjoin) {
@@ -208,6 +224,21 @@ void Hub::HandleAck(IPEndPoint * from, MsgAck * amsg)
     }
 }
 
+float Hub::GetSelectivity(Constraint *cst, Histogram *h)
+{
+    Histogram even;
+    if (h == NULL) {
+	even.AddBucket(NodeRange(GetID(), GetAbsMin(), GetAbsMax()), 1.0f);
+	h = &even;
+    }
+
+    float total = h->GetTotal();
+    if (total <= 0)
+	return 1.0f;
+
+    return h->GetValueInRange(*cst, GetAbsMin(), GetAbsMax()) / total;
+}
+
 void Hub::Print(FILE *stream)
 {
     fprintf(stream, "(Hub;id=%d name=%s rep=%s", m_Initinfo.ID, m_Initinfo.name.c_str(), m_Initinfo.rep.ToString());
@@ -224,6 +255,15 @@ ostream& operator<<(ostream& out, HubInitInfo *info)
 {
     out << "id=" << (int) info->ID << " name=" << info->name << " ismember=" << info->isMember;
     out << " rep=" << info->rep << " absmin=" << info->absmin << " absmax=" << info->absmax;
+    if (info->placeReps.size() > 0) {
+	out << " places=[";
+	for (uint32 i = 0; i < info->placeReps.size(); i++) {
+	    if (i > 0)
+		out << " ";
+	    out << "(" << info->placeReps[i] << "," << info->placePreds[i] << ")";
+	}
+	out << "]";
+    }
     out << " staticjoin=" << info->staticjoin;
     if (info->staticjoin) {
 	out << " range=" << info->range;
@@ -260,9 +300,24 @@ NonMemberHub::NonMemberHub(MercuryNode *mnode, BufferManager *bm, HubInitInfo &i
     //	mnode->RegisterMessageHandler(MSG_PUB, this);
 }
 
+IPEndPoint *NonMemberHub::GetNextHop(const Value& val)
+{
+    if (m_Cache) {
+	CacheEntry *entry = m_Cache->LookupOwner(val);
+	if (entry)
+	    return (IPEndPoint *) &entry->GetAddress();
+    }
+    return GetRepAddress();
+}
+
 void NonMemberHub::Print(FILE * stream)
 {
     Hub::Print(stream);
+    if (m_Cache) {
+	const CacheStats& cs = m_Cache->GetStats();
+	fprintf(stream, " cache size=%d lookups=%u hits=%u expired=%u", 
+		m_Cache->GetSize(), cs.lookups, cs.hits, cs.expired);
+    }
 }
 
 ostream& operator<<(ostream& out, NonMemberHub *hub)
@@ -339,6 +394,13 @@ public:
 		    cerr << p->GetAddress () << " " << p->GetRange () << endl;
 		}
 	    }
+	    if (m_Hub->GetCache ()) {
+		Cache *c = m_Hub->GetCache ();
+		const CacheStats& cs = c->GetStats ();
+		cerr << "CACHE size=" << c->GetSize () << " lookups=" << cs.lookups 
+		     << " hits=" << cs.hits << " stale=" << cs.stale 
+		     << " evictions=" << cs.evictions << " expired=" << cs.expired << endl;
+	    }
 	    PrintLine (cerr, '-');
 
 	    _RescheduleTimer (NBR_PRINTER_INTERVAL);
@@ -387,7 +449,8 @@ MemberHub::MemberHub(MercuryNode *mnode, IPEndPoint& bootstrap,
     m_SuccessorList (PList (this, m_PeersByAddress, PEER_SUCCESSOR)),
     m_LongNeighborsList (PList (this, m_PeersByAddress, PEER_LONG_NBR)),
     m_PredecessorList (PList (this, m_PeersByAddress, PEER_PREDECESSOR)),
-    m_ReverseLongNeighborsList (PList (this, m_PeersByAddress, PEER_REV_LONG_NBR))
+    m_ReverseLongNeighborsList (PList (this, m_PeersByAddress, PEER_REV_LONG_NBR)),
+    m_RoutingTable (GetAbsMax ())
 
 {
     m_BufferManager = bufferManager;
@@ -470,6 +533,8 @@ void PList::Add (const IPEndPoint& addr, const NodeRange& range, listpos_t where
 {
     ref<Peer> p = Register (addr, range);
     p->AddPeerType (m_PeerType);
+    if (m_PeerType != PEER_REV_LONG_NBR)
+	m_Hub->m_RoutingTable.Add (p);
 
     for (PeerListIter it = m_List.begin (); it != m_List.end (); ++it) {
 	ref<Peer> t = *it;
@@ -496,6 +561,8 @@ Peer* PList::Lookup (const IPEndPoint& addr)
 void PList::remove_peer (ref<Peer> p)
 {
     p->RemovePeerType (m_PeerType);
+    if (!(p->GetPeerType () & (PEER_SUCCESSOR | PEER_PREDECESSOR | PEER_LONG_NBR)))
+	m_Hub->m_RoutingTable.Remove (p);
     if (p->GetPeerType () == PEER_NONE)
 	UnRegister (p->GetAddress ());    
 }
@@ -726,7 +793,6 @@ void MemberHub::SetSuccessorList (PeerInfoList *ml)
 
     // if (m_Range)
     // 	m_SuccessorList.Sort (greater_peer_t (m_Range->GetMin ()));
-    UpdateSortedPeerList();
 }
 
 // All we want to do is a simple thing: our succlist = succ + (succ's
@@ -807,9 +873,6 @@ void MemberHub::MergeSuccessorList (PeerInfoList *newlist)
     
     // sort the succ list to ensure its still in the right order
     m_SuccessorList.Sort (greater_peer_t (m_Range->GetMin ()));
-    
-    // update the peer list
-    UpdateSortedPeerList();
 }
 
 void MemberHub::PrintSuccessorList ()
@@ -836,11 +899,10 @@ void MemberHub::PrintLongNeighborList ()
 void MemberHub::PrintSortedPeers ()
 {
     cerr  << "sorted peers=[" << endl;
-    for (PeerMapIter it = m_SortedPeers.begin (); it != m_SortedPeers.end (); ++it)
+    for (int i = 0; i < m_RoutingTable.Size (); i++)
     {
-	if (it != m_SortedPeers.begin ()) cerr << ", ";
-	Peer *p = it->second;
-	cerr << p;
+	if (i != 0) cerr << ", ";
+	cerr << m_RoutingTable[i].item;
     }
 }
 
@@ -887,7 +949,17 @@ void MemberHub::AddLongNeighbor (const IPEndPoint& addr, const NodeRange& range)
 	}
     }
     m_LongNeighborsList.Add (addr, range);
-    UpdateSortedPeerList ();
+}
+
+void MemberHub::RemoveLongNeighbor (const IPEndPoint& addr)
+{
+    if (m_LongNeighborsList.Lookup (addr) == NULL)
+	return;
+
+    DB_DO (-1) { 
+	MTDB (-1) << " dropping LONG neighbor " << addr << endl;
+    }
+    m_LongNeighborsList.Remove (addr);
 }
 
 void MemberHub::AddPredecessor (const IPEndPoint& addr, const NodeRange& range)
@@ -900,7 +972,6 @@ void MemberHub::AddPredecessor (const IPEndPoint& addr, const NodeRange& range)
     m_PredecessorList.Add (addr, range);
     if (m_Range)
 	m_PredecessorList.Sort (less_peer_t (m_Range->GetMin ()));
-    UpdateSortedPeerList ();
 }
 
 void MemberHub::AddReverseLongNeighbor (const IPEndPoint& addr, const NodeRange& range)
@@ -921,8 +992,6 @@ void MemberHub::SetPredecessor (const IPEndPoint& addr, const NodeRange& range)
     m_PredecessorList.Add (addr, range, PLIST_FRONT);
     if (m_Range)
 	m_PredecessorList.Sort (less_peer_t (m_Range->GetMin ()));
-
-    UpdateSortedPeerList();
 }
 
 // Get rid of the successor list. and set this 
@@ -936,7 +1005,6 @@ void MemberHub::SetSuccessor (const IPEndPoint& addr, const NodeRange& range)
     }
     m_SuccessorList.Clear ();
     m_SuccessorList.Add (addr, range, PLIST_FRONT);
-    UpdateSortedPeerList ();
 }
 
 void MemberHub::MergeSuccessor (const IPEndPoint& addr, const NodeRange& range)
@@ -965,8 +1033,6 @@ void MemberHub::RemovePeer (const IPEndPoint addr)
     if (p->IsReverseLongNeighbor ())
 	m_ReverseLongNeighborsList.Remove (addr);
 
-    UpdateSortedPeerList ();
-
     m_LinkMaintainer->OnPeerDeath (p);
 }
 
@@ -982,26 +1048,21 @@ void MemberHub::HandleLivenessPong (IPEndPoint *from, MsgLivenessPong *msg)
 
     ref<Peer> p = it->second;
 
-    bool rangeChanged = false;
     bool nonContiguous = false;
 
     const NodeRange& newr = msg->GetRange ();
     const NodeRange& oldr = p->GetRange ();
 
-    if (newr != oldr) 
-	rangeChanged = true;
     if (newr.GetMin () != oldr.GetMin () && newr.GetMax () != oldr.GetMax ())
 	nonContiguous = true;
 
     if (nonContiguous) 
 	RemovePeer (*from);
     else {
+	// a new range re-sorts p in the routing table
 	if (p->IsSuccessor () || p->IsLongNeighbor ())
 	    p->HandleLivenessPong (msg);
     }
-
-    if (rangeChanged || nonContiguous) 
-	UpdateSortedPeerList ();
 }
 
 void MemberHub::HandleLivenessPing (IPEndPoint *from, MsgLivenessPing *ping)
@@ -1055,73 +1116,11 @@ void MemberHub::HandleLivenessPing (IPEndPoint *from, MsgLivenessPing *ping)
     delete pong;
 }
 
-// This function is kind of expensive (list clearing and copying
-// destroys 'Peer' objects and re-creates them); however, it should not
-// be called more than twice a second or something. So, optimizing it
-// may not be worthwhile. - Ashwin [01/24/2005]
-
-struct less_peer_ptr {
-    bool operator () (const Peer *a, const Peer *b) const {
-	return a->GetRange ().GetMin () < b->GetRange ().GetMin ();
-    }
-};
-
-/// This (having m_SortedPeers do a bunch of things)
-//  is very dangerous and incorrect for two reasons: - Ashwin [03/21/2005]
-//  
-//  (a) GetMin () can be updated due to a LivenessPong () without 
-//      making any changes to the map!
-//
-//  (b) Because SortedPeers is just a map (and not a multi-map), 
-//      if two neighbors happen to have the same GetMin () (due 
-//      to staleness), we will insert only one in SortedPeers. 
-//      Only this guy will be sent heartbeats! Finally, as pongs
-//      from the other guy come and if m_SortedPeers is updated, 
-//      we will suddenly start sending pings to this guy -- but then
-//      we will also notice that he hasn't sent us a pong from a 
-//      long time and then kick him out!
-
-// FIXES: (b) we must have a separate address based hash of peers. 
-//            this should be used for looking up peers.
-//
-//        (a) handle liveness pong should call UpdateSortedPeerList ()
-// <these fixes have been implemented>
-
-void MemberHub::UpdateSortedPeerList()
-{
-    m_SortedPeers.clear ();
-
-    // given that SortedPeers is a map, this will make sure peers 
-    // with the same min-value (i.e., same peers) will not get 
-    // inserted twice
-
-    for (PeerListIter it = m_SuccessorList.begin (); it != m_SuccessorList.end (); ++it) {
-	ref<Peer> p = *it;
-
-	Value *v = (Value *) &(p->GetRange ().GetMin ());
-	m_SortedPeers.insert (PeerMap::value_type (v, p));
-    }
-
-    for (PeerListIter it = m_LongNeighborsList.begin (); it != m_LongNeighborsList.end (); it++) {
-	ref<Peer> p = *it;
-
-	Value *v = (Value *) &(p->GetRange ().GetMin ());
-	m_SortedPeers.insert (PeerMap::value_type (v, p));
-    }
-
-    for (PeerListIter it = m_PredecessorList.begin (); it != m_PredecessorList.end (); it++) {
-	ref<Peer> p = *it;
-
-	Value *v = (Value *) &(p->GetRange ().GetMin ());
-	m_SortedPeers.insert (PeerMap::value_type (v, p));
-    }
-}
-
 // returns all nodes in my peer list which will intersect
-// the range 'cst'. for the linear-pub-routing purposes, 
-// this routine also ends up returning the nodes in sorted
-// order (since "stuff can't wrap around because we do this
-// after reaching the left-most end") - Ashwin [03/07/2005]
+// the range 'cst', in absolute order of their range starts.
+// the peer holding the wrap-around comes last even if it holds
+// the start of 'cst'; PubsubRouter::DoFanout puts them in ring 
+// order from cst's min.
 
 void MemberHub::GetCoveringPeers (Constraint *cst, vector<Peer *> *nodes)
 {
@@ -1131,8 +1130,12 @@ void MemberHub::GetCoveringPeers (Constraint *cst, vector<Peer *> *nodes)
 	return;
 
     MDB (20) << " -- [cst=" << cst << "]----------------- " << endl;
-    for (PeerMapIter it = m_SortedPeers.begin (); it != m_SortedPeers.end (); ++it) {
-	Peer *p = it->second;
+    for (int i = 0; i < m_RoutingTable.Size (); i++) {
+	// one peer per range start, as GetNearestPeer sees them
+	if (i > 0 && m_RoutingTable[i].min == m_RoutingTable[i - 1].min)
+	    continue;
+
+	Peer *p = m_RoutingTable[i].item;
 	NodeRange *r = (NodeRange *) &p->GetRange ();
 
 	MDB (20) << "considering " << p ; 
@@ -1147,91 +1150,80 @@ void MemberHub::GetCoveringPeers (Constraint *cst, vector<Peer *> *nodes)
     }
 }
 
-bool MemberHub::Less (const Value& val, const Value& other)
-{
-    if (val == GetAbsMax ()) 
-	return val <= other;
-    else
-	return val < other;
-}
-
 // Preconditions: 'val' is not in my range
-//                SortedPeerList contains at least 1 entry (successor must be there!)
+//                m_RoutingTable contains at least 1 entry (successor must be there!)
 
 extern bool loopingMessage;
 
 Peer *MemberHub::GetNearestPeer(const Value &val)
 {
     // (---- p1 --- p2 --- p3 --- val --- p4 --- p5 --- p6 ----)
-    Peer *nearest = NULL;
-
-    if (m_SortedPeers.size () == 0) 
+    if (m_RoutingTable.Empty ()) 
 	return NULL;
 
     MDB (10) << " <<< val=" << val << endl;
 
-    //// XXX: this function is way more complex than it needs to 
-    //// be. despite the fact that wrapped circle causes problems. - Ashwin [06/28/2005]
+    Peer *nearest = m_RoutingTable.Lookup (val);
 
-    for (PeerMapIter it = m_SortedPeers.begin () ; it != m_SortedPeers.end(); ++it)
-    {
-	const NodeRange& cur = it->second->GetRange ();
-	MDB (10) << " <<<<<< considering peer=" << it->second << endl;
-	if (loopingMessage) {
-	    MDB (-5) << " <<<<<< considering peer=" << it->second << endl;
-	}
+    MDB (10) << " <<<<<<<<<<<<<<< found nearest " << nearest->GetRange () << endl;
+    if (loopingMessage) {
+	MDB (-5) << " <<<<<<<<<<<<<<< found nearest " << nearest << endl;
+    }
+    return nearest;
+}
+
+// how far clockwise 'to' is from 'from'
+static double _RingDistance (const Value& from, const Value& to, const Value& absmin, const Value& absmax)
+{
+    Value d = to;
+    if (to >= from) 
+	d -= from;
+    else {
+	d += absmax;
+	d -= from;
+	d -= absmin;
+    }
+    return d.getd ();
+}
 
-	// GetMax () for a peer remains same even when other nodes join 
-	// near that peer (since other nodes install themselves as 
-	// predecessors) - so this way, information is less likely 
-	// to be stale
+// proximity route selection (--prs-slack): 'nearest' gets closest to
+// 'val', but any peer which gets most of the way there does about as 
+// well on hop count; take the one of those with the lowest RTT. every
+// peer considered is closer to 'val' than we are, so routes still 
+// cannot loop.
 
-	PeerMapIter nit (it);
-	++nit;
+Peer *MemberHub::GetNearbyPeer (const Value &val, Peer *nearest)
+{
+    // the owner of 'val' is the last hop; anyone else adds one
+    const NodeRange& nr = nearest->GetRange ();
+    if (IsBetweenLeftInclusive (val, nr.GetMin (), nr.GetMax ()))
+	return nearest;
+    if (m_Range == NULL || !nearest->HasRTTEstimate ())
+	return nearest;
 
-	if (nit != m_SortedPeers.end ()) {
-	    const NodeRange& next = nit->second->GetRange ();
+    double mine = _RingDistance (m_Range->GetMin (), val, GetAbsMin (), GetAbsMax ());
+    double best = _RingDistance (nr.GetMin (), val, GetAbsMin (), GetAbsMax ());
+    if (best >= mine)
+	return nearest;
 
-	    Value comp = next.GetMax ();
-	    if (next.GetMin () > next.GetMax ())
-		comp = GetAbsMax ();
+    // how close to 'val' a peer must get
+    double bound = best + g_Preferences.prs_slack * (mine - best);
 
-	    if (val >= cur.GetMax () && Less (val, comp)) {
-		if (val < next.GetMin ())
-		    nearest = it->second;
-		else
-		    nearest = nit->second;
+    Peer *pick = nearest;
+    for (int i = 0; i < m_RoutingTable.Size (); i++) {
+	Peer *p = m_RoutingTable[i].item;
+	if (p == nearest || !p->HasRTTEstimate () || p->GetSmoothedRTT () >= pick->GetSmoothedRTT ())
+	    continue;
 
-		MDB (10) << " <<<<<<<<<<<<<<< found nearest " << nearest->GetRange () << endl;
-		if (loopingMessage) {
-		    MDB (-5) << " <<<<<<<<<<<<<<< found nearest A " << nearest << endl;
-		}
-		break;
-	    }
-	}
-	else {
-	    if (val >= cur.GetMax ())
-		nearest = it->second;
-	    else { 
-		// this can only happen when val < first.GetMax ()
-
-		const NodeRange& first = m_SortedPeers.begin ()->second->GetRange ();
-		ASSERT (val < first.GetMax ());
-		if (val >= first.GetMin ())  // belongs to first guy
-		    nearest = m_SortedPeers.begin ()->second;
-		else                         // between last and first
-		    nearest = it->second;
-	    }
-	    MDB (10) << " <<<<<<<<<<<<<<< found nearest " << nearest->GetRange () << endl;
-	    if (loopingMessage) {
-		MDB (-5) << " <<<<<<<<<<<<<<< found nearest B " << nearest << endl;
-	    }
-	    break;
-	}
+	double d = _RingDistance (p->GetRange ().GetMin (), val, GetAbsMin (), GetAbsMax ());
+	if (d < mine && d <= bound)
+	    pick = p;
     }
 
-    ASSERT (nearest != NULL);
-    return nearest;
+    if (pick != nearest)
+	MDB (10) << " prs: " << pick->GetAddress () << " (rtt=" << pick->GetSmoothedRTT () 
+		 << ") instead of " << nearest->GetAddress () << " (rtt=" << nearest->GetSmoothedRTT () << ")" << endl;
+    return pick;
 }
 
 void MemberHub::HandleMercPub(IPEndPoint *from, MsgPublication *msg )
@@ -1350,7 +1342,7 @@ void MemberHub::PrepareLeave()
     }
     delete lb;
 
-    m_SortedPeers.clear ();
+    m_RoutingTable.Clear ();
 
     // this will clear the underlying hash-tables as well
     m_LongNeighborsList.Clear ();
@@ -2047,6 +2039,16 @@ void MemberHub::MakeHistogram ()
     delete local;
 }
 
+// whichever node-count histogram routing uses: the bootstrap's, or
+// our own with --selfhistos (see MakeHistogram)
+Histogram *MemberHub::GetNodeHistogram ()
+{
+    Histogram *h = m_HistogramMaintainer->GetHistogram ();
+    if (h == NULL || h->GetTotal () <= 0)
+	return NULL;
+    return h;
+}
+
 ostream& operator<<(ostream& out, MemberHub *hub)
 {
     // call the super class...
@@ -27,6 +27,7 @@
 #include <list>
 #include <mercury/common.h>
 #include <mercury/Peer.h>
+#include <mercury/RoutingTable.h>
 #include <mercury/IPEndPoint.h>
 #include <mercury/ID.h>
 #include <map>
@@ -65,6 +66,12 @@ struct HubInitInfo : public Serializable {
     bool        isMember;         // Am I a member of this hub?
     IPEndPoint  rep;              // Address of a representative of this hub  
 
+    // ring positions a joiner may take instead of joining at 'rep'
+    // (the bootstrap's "load-aware" policy): a representative and its
+    // predecessor (SID_NONE if unknown) each, the joiner's would-be 
+    // neighbors. empty unless there is a choice.
+    vector<IPEndPoint> placeReps, placePreds;
+
     bool staticjoin;
     NodeRange range;
     PeerInfoList succs;
@@ -120,6 +127,15 @@ class Hub : public MessageHandler {
     Cache        *GetCache()     {   return m_Cache; }
     void         HandleAck(IPEndPoint *from, MsgAck *ack);
 
+    // the node-count histogram of this hub, if we have one
+    virtual Histogram *GetNodeHistogram() { return NULL; }
+
+    // the fraction of this hub's nodes a sub with constraint 'cst' on 
+    // this hub's attribute would be stored on, going by node-count 
+    // histogram 'h'. with none, nodes are taken to be spread evenly over
+    // the attribute.
+    float GetSelectivity(Constraint *cst, Histogram *h);
+
     virtual void ProcessMessage(IPEndPoint *from, Message *msg) = 0;
     virtual void Print(FILE *stream);
 };
@@ -155,12 +171,6 @@ class NodeCountSampler;
 class NCMetric;
 class LoadBalancer;
 
-struct less_value_ptr {
-    bool operator () (const Value *a, const Value *b) const {
-	return *a < *b;
-    }
-};
-
 class MemberHub;
 
 // what we want is a registry of peers by their addresses
@@ -172,9 +182,6 @@ typedef SIDPeerMap::iterator SIDPeerMapIter;
 typedef list<ref<Peer> > PeerList;
 typedef PeerList::iterator PeerListIter;
 
-typedef map<Value *, ref<Peer>, less_value_ptr> PeerMap;
-typedef PeerMap::iterator PeerMapIter;
-
 typedef vector<Sample* > PSVec;
 typedef PSVec::iterator PSVecIter;
 
@@ -229,6 +236,7 @@ class MemberHub : public Hub {
     friend class LoadBalancer;
     friend class KickOldPeersTimer;
     friend class NbrPrinter;
+    friend class PList;
 
     ProtoStatusType      m_Status;                // "mostly" obsolete...
 
@@ -249,7 +257,7 @@ class MemberHub : public Hub {
     PList                m_LongNeighborsList;     // long pointers obtained using sampling
     PList                m_ReverseLongNeighborsList;    // "back pointers" - useful for responding to pings
 
-    PeerMap              m_SortedPeers;           // sorted according to ranges
+    RoutingTable         m_RoutingTable;          // succs, long nbrs and preds, sorted by range
 
     PubsubRouter        *m_PubsubRouter;
     LinkMaintainer      *m_LinkMaintainer;
@@ -341,8 +349,12 @@ class MemberHub : public Hub {
     Peer *LookupSuccessor (const IPEndPoint& addr);
 
     void RemovePeer (const IPEndPoint addr);
+    // a live long neighbor we no longer want: unlike RemovePeer, its 
+    // other roles stay and no repair follows
+    void RemoveLongNeighbor (const IPEndPoint& addr);
 
     Peer *GetNearestPeer(const Value &val);
+    Peer *GetNearbyPeer(const Value &val, Peer *nearest);
     void GetCoveringPeers (Constraint *cst, vector<Peer *> *nodes);
 
     //////////////////////////////////////////////////////////////////////////
@@ -353,6 +365,7 @@ class MemberHub : public Hub {
     void PrepareLeave ();
     void StartJoin();
     Histogram* GetNCHistogram () { return m_NCHistogram; }
+    Histogram *GetNodeHistogram ();
 
     //////////////////////////////////////////////////////////////////////////
     // Sampling
@@ -392,10 +405,6 @@ class MemberHub : public Hub {
 
     void Print(FILE *stream);
  private:
-    bool Less (const Value& val, const Value& other);
-
-    void UpdateSortedPeerList();
-
     PList& GetSuccessorList () { return m_SuccessorList; }
     PList& GetPredecessorList () { return m_PredecessorList; }
     PList& GetLongNeighborsList () { return m_LongNeighborsList; }
@@ -430,6 +439,10 @@ class NonMemberHub : public Hub {
 
     IPEndPoint *GetRepAddress() { return &(m_Initinfo.rep); }
 
+    // where to send a pub routed by 'val' in this hub: straight to the
+    // node which acked owning 'val' (with --cache), else to the rep.
+    IPEndPoint *GetNextHop(const Value& val);
+
     //////////////////////////////////////////////////////////////////////////
     // Other functions
     void ProcessMessage(IPEndPoint *from, Message *msg);
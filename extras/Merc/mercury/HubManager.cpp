@@ -52,6 +52,14 @@ public:
     void OnTimeout();
 };
 
+class PlaceProbeTimer : public Timer {
+public:
+    HubManager    *m_HubManager;
+
+    PlaceProbeTimer(HubManager *hm, int timeout) : Timer(timeout), m_HubManager(hm) {}
+    void OnTimeout() { m_HubManager->FinishPlacement(); }
+};
+
 ///////////////////////// ///  BootstrapRequestTimer //////////////////
 //
 BootstrapRequestTimer::BootstrapRequestTimer(HubManager *hm, int timeout)  : Timer(timeout)
@@ -82,7 +90,7 @@ BootstrapHeartbeatTimer::BootstrapHeartbeatTimer(HubManager *hm, int timeout) :
 
 void BootstrapHeartbeatTimer::OnTimeout()
 {
-    MsgHeartBeat *hbeat;
+    MsgLoadHeartBeat *hbeat;
 
     HubManager *hm = m_HubManager;
     for (int i = 0, len = hm->GetNumHubs(); i < len; i++) {
@@ -101,7 +109,10 @@ void BootstrapHeartbeatTimer::OnTimeout()
 	    continue;
 	}
 
-	hbeat = new MsgHeartBeat(hub->GetID(), hm->GetAddress(), *hub->GetRange());
+	// the load is only used by the bootstrap's "load-aware" join
+	// placement; it is cheap enough to always send.
+	hbeat = new MsgLoadHeartBeat(hub->GetID(), hm->GetAddress(), *hub->GetRange(),
+				     hub->GetPubsubRouter ()->GetRoutingLoad ());
 	m_HubManager->m_Network->SendMessage(hbeat, &hm->GetBootstrapIP (), Parameters::TransportProto);
 	delete hbeat;
     }
@@ -116,9 +127,11 @@ HubManager::HubManager(MercuryNode *mnode, BufferManager *bufferManager)
     m_MercuryNode (mnode), 
     m_Network (mnode->GetNetwork ()), 
     m_Scheduler (mnode->GetScheduler ()), 
-    m_Address (mnode->GetAddress ()), m_BufferManager (bufferManager)
+    m_Address (mnode->GetAddress ()), m_BufferManager (bufferManager),
+    m_PlaceProbeTimer (NULL)
 {
     m_MercuryNode->RegisterMessageHandler(MSG_BOOTSTRAP_RESPONSE, this);
+    m_MercuryNode->RegisterMessageHandler(MSG_PING, this);
 }
 
 void HubManager::BootstrapUsingServer(char *bootstrap)
@@ -212,6 +225,8 @@ void HubManager::ProcessMessage(IPEndPoint *from, Message *msg)
 {
     if (msg->GetType () == MSG_BOOTSTRAP_RESPONSE)
 	HandleBootstrapResponse(from, (MsgBootstrapResponse *) msg);
+    else if (msg->GetType () == MSG_PING)
+	HandlePing(from, (MsgPing *) msg);
     else
 	MWARN << merc_va("HubManager:: received some idiotic message [%s]", msg->TypeString()) << endl;
 }
@@ -273,18 +288,127 @@ void HubManager::StartJoin()
 	    m_MercuryNode->GetApplication ()->JoinBegin (m_Address);
 	    hub->OnJoinComplete();
 	} 
+	else if (hub->m_Initinfo.placeReps.size() > 1)
+	    ProbePlacement(hub);
 	else 
-	{
-	    TINFO << "starting join; hubrep is " << hubRep << endl;
-	    hub->StartJoin();
-	    //
-	    // now, we will receive the join response when we process our packets from our
-	    // successor ... if an error occured, we can handle it there
-	    // and, now we have a successor, our predecessor will connect to us
-	    // when he receives the UPDATE_SUCCESSOR from our successor
-	    //
+	    StartHubJoin(hub);
+    }
+
+    if (m_Placing.size() > 0) {
+	m_PlaceProbeTimer = new refcounted<PlaceProbeTimer> (this, Parameters::PlaceProbeTimeout);
+	m_Scheduler->RaiseEvent (m_PlaceProbeTimer, m_Address, m_PlaceProbeTimer->GetNextDelay ());
+    }
+}
+
+void HubManager::StartHubJoin(MemberHub *hub)
+{
+    TINFO << "starting join; hubrep is " << hub->GetBootstrapRep() << endl;
+    hub->StartJoin();
+    //
+    // now, we will receive the join response when we process our packets from our
+    // successor ... if an error occured, we can handle it there
+    // and, now we have a successor, our predecessor will connect to us
+    // when he receives the UPDATE_SUCCESSOR from our successor
+    //
+}
+
+// the bootstrap offered several ring positions to split (see 
+// BootstrapNode::ChooseLoadAware); ping the nodes which would be our
+// neighbors at each. pings which carry a time are probes, and are 
+// sent back without one.
+void HubManager::ProbePlacement(MemberHub *hub)
+{
+    HubInitInfo& info = hub->m_Initinfo;
+    TimeVal now = m_Scheduler->TimeNow ();
+    set<IPEndPoint, less_SID> pinged;
+
+    for (uint32 i = 0; i < info.placeReps.size(); i++) {
+	IPEndPoint nbrs[2] = { info.placeReps[i], info.placePreds[i] };
+	for (int j = 0; j < 2; j++) {
+	    if (nbrs[j] == SID_NONE || pinged.find(nbrs[j]) != pinged.end())
+		continue;
+	    pinged.insert(nbrs[j]);
+
+	    MsgPing *ping = new MsgPing();
+	    ping->sender = m_Address;
+	    ping->time = now;
+
+	    PlaceProbe& p = m_PlaceProbes[ping->pingNonce];
+	    p.hubID = hub->GetID();
+	    p.addr = nbrs[j];
+	    p.sent = now;
+	    p.rtt = -1;
+
+	    m_Network->SendMessage(ping, &nbrs[j], Parameters::TransportProto);
+	    delete ping;
+	}
+    }
+    m_Placing.push_back(hub);
+}
+
+void HubManager::HandlePing(IPEndPoint *from, MsgPing *ping)
+{
+    if (ping->time != TIME_NONE) {
+	MsgPing *pong = new MsgPing();
+	pong->sender = m_Address;
+	pong->pingNonce = ping->pingNonce;
+	m_Network->SendMessage(pong, &ping->sender, Parameters::TransportProto);
+	delete pong;
+	return;
+    }
+
+    // late pongs find nothing
+    map<uint32, PlaceProbe>::iterator it = m_PlaceProbes.find(ping->pingNonce);
+    if (it == m_PlaceProbes.end())
+	return;
+    it->second.rtt = m_Scheduler->TimeNow () - it->second.sent;
+
+    for (it = m_PlaceProbes.begin(); it != m_PlaceProbes.end(); ++it) {
+	if (it->second.rtt < 0)
+	    return;
+    }
+    if (m_PlaceProbeTimer != NULL)
+	m_PlaceProbeTimer->Cancel();
+    FinishPlacement();
+}
+
+// join at the position whose would-be neighbors answered the soonest,
+// summing the RTTs to both; a predecessor which did not answer (or is
+// unknown) counts as far as its rep. if no rep answered, join where the
+// bootstrap said.
+void HubManager::FinishPlacement()
+{
+    for (uint32 h = 0; h < m_Placing.size(); h++) {
+	MemberHub *hub = m_Placing[h];
+	HubInitInfo& info = hub->m_Initinfo;
+
+	sint64 best = -1;
+	for (uint32 i = 0; i < info.placeReps.size(); i++) {
+	    sint64 rtt[2] = { -1, -1 };
+	    for (map<uint32, PlaceProbe>::iterator it = m_PlaceProbes.begin(); it != m_PlaceProbes.end(); ++it) {
+		if (it->second.hubID != hub->GetID())
+		    continue;
+		if (it->second.addr == info.placeReps[i])
+		    rtt[0] = it->second.rtt;
+		else if (it->second.addr == info.placePreds[i])
+		    rtt[1] = it->second.rtt;
+	    }
+	    if (rtt[0] < 0)
+		continue;
+	    if (rtt[1] < 0)
+		rtt[1] = rtt[0];
+	    if (best < 0 || rtt[0] + rtt[1] < best) {
+		best = rtt[0] + rtt[1];
+		info.rep = info.placeReps[i];
+	    }
 	}
+
+	MDB(1) << "placement: joining at " << info.rep << " of " << info.placeReps.size() 
+	       << " offered; rtt to neighbors=" << best << endl;
+	StartHubJoin(hub);
     }
+    m_Placing.clear();
+    m_PlaceProbes.clear();
 }
 
 AttrInfo *g_MercuryAttrRegistry = NULL;
@@ -309,6 +433,8 @@ void HubManager::RegisterHubInfo(vector<HubInitInfo *> &infovec)
 
 	g_MercuryAttrRegistry[i].index = i;
 	g_MercuryAttrRegistry[i].name  = info->name;
+	g_MercuryAttrRegistry[i].absmin = info->absmin;
+	g_MercuryAttrRegistry[i].absmax = info->absmax;
 
 	if (info->isMember) {
 	    hub = new MemberHub(m_MercuryNode, m_BootstrapIP, m_BufferManager, *info);
@@ -412,20 +538,63 @@ void HubManager::SendAppPublication(MsgPublication * pmsg)
 	} 
 	else 
 	{
-	    // FIXME: utilize the hub cache here.
+	    // the rendezvous acks pubs (--cache), so after the first 
+	    // few we can usually skip the rep and its route to the value
 	    NonMemberHub *nhub = (NonMemberHub *) hub;
-	    IPEndPoint *rep = nhub->GetRepAddress();
+	    Constraint *cst = npmsg->GetEvent ()->GetConstraintByAttr (hub->GetID());
+	    IPEndPoint *to = nhub->GetNextHop (cst->GetMin ());
 
-	    m_Network->SendMessage(npmsg, rep, Parameters::TransportProto);
+	    m_Network->SendMessage(npmsg, to, Parameters::TransportProto);
 	}
 
 	delete npmsg;
     }
 }
 
+// index into 'indexes' of the hub where 'sub' has the lowest
+// selectivity; ties (e.g., several point constraints) go to a random 
+// one of them, as without --subselect. the hubs are compared by one 
+// estimate: their node-count histograms if they all have one, else 
+// (as non-member hubs have none) the share of the attribute's range.
+
+#define SELECTIVITY_EPSILON 1e-6
+
+int HubManager::PickNarrowestHub(Interest *sub, vector<int>& indexes)
+{
+    int best = -1, nbest = 0;
+    float bestsel = 0;
+
+    bool bynodes = true;
+    for (int i = 0, len = indexes.size(); i < len; i++) {
+	if (m_HubVec[indexes[i]]->GetNodeHistogram() == NULL)
+	    bynodes = false;
+    }
+
+    for (int i = 0, len = indexes.size(); i < len; i++) {
+	Hub *hub = m_HubVec[indexes[i]];
+	Constraint *cst = sub->GetConstraintByAttr(hub->GetID());
+	float sel = hub->GetSelectivity(cst, bynodes ? hub->GetNodeHistogram() : NULL);
+
+	MDB (20) << " hub " << hub->GetName() << " selectivity=" << sel << endl;
+	if (best < 0 || sel < bestsel - SELECTIVITY_EPSILON) {
+	    best = i;
+	    bestsel = sel;
+	    nbest = 1;
+	}
+	else if (sel <= bestsel + SELECTIVITY_EPSILON) {
+	    // keep each of the tied hubs with equal probability
+	    nbest++;
+	    if (G_GetRandom() * nbest < 1.0f)
+		best = i;
+	}
+    }
+    return best;
+}
+
 //
 // this is the first place a subscription comes from the app. Now, we need to
-// send this to one random attribute hub.
+// send this to one attribute hub: a random one, or with --subselect the 
+// one where it is narrowest.
 //
 void HubManager::SendAppSubscription(MsgSubscription * smsg)
 {
@@ -460,9 +629,14 @@ void HubManager::SendAppSubscription(MsgSubscription * smsg)
 	return;
     }
 
-    //////////////////////////////////////////////////////////////////////////
-    // TODO: This is where subscription selectivity can be done using histograms
-    int r = (int) ((float) indexes.size() * G_GetRandom());
+    // a sub is stored on every node its constraint on the hub's 
+    // attribute spans, and matched against every pub which reaches 
+    // them; so send it where that constraint is narrowest
+    int r;
+    if (g_Preferences.sub_selectivity)
+	r = PickNarrowestHub (sub, indexes);
+    else
+	r = (int) ((float) indexes.size() * G_GetRandom());
 
     ///// MEASUREMENT
     if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
@@ -30,6 +30,7 @@
 #include <fstream>
 
 struct MsgBootstrapResponse;
+struct MsgPing;
 class HubManager;
 struct IPEndPoint;
 
@@ -39,6 +40,7 @@ typedef HubVec::iterator HubVecIter;
 
 struct MsgPublication;
 struct MsgSubscription;
+class Interest;
 class BufferManager;
 class MercuryNode;
 class Scheduler;
@@ -47,6 +49,7 @@ class HubManager : public MessageHandler
 {
     friend class BootstrapRequestTimer;
     friend class BootstrapHeartbeatTimer;
+    friend class PlaceProbeTimer;
     friend ostream& operator<<(ostream& out, HubManager *hm);
 
     HubVec         m_HubVec;
@@ -62,6 +65,17 @@ class HubManager : public MessageHandler
     BufferManager *m_BufferManager;
     IPEndPoint     m_BootstrapIP;
 
+    // pings to the ring positions the bootstrap offered, by nonce
+    struct PlaceProbe {
+	byte       hubID;
+	IPEndPoint addr;
+	TimeVal    sent;
+	sint64     rtt;           // msecs; < 0 until the pong
+    };
+    map<uint32, PlaceProbe> m_PlaceProbes;
+    vector<MemberHub *>     m_Placing;        // hubs waiting for them
+    ptr<Timer>              m_PlaceProbeTimer;
+
  public:
     HubManager(MercuryNode *mnode, BufferManager *bufferManager);
     virtual ~HubManager() {}
@@ -91,6 +105,11 @@ class HubManager : public MessageHandler
     void HandleBootstrapResponse(IPEndPoint * from, MsgBootstrapResponse * bmsg);
     void RegisterHubInfo(vector<HubInitInfo *>& v);
     void StartJoin();
+    void StartHubJoin(MemberHub *hub);
+    void ProbePlacement(MemberHub *hub);
+    void HandlePing(IPEndPoint *from, MsgPing *ping);
+    void FinishPlacement();
+    int  PickNarrowestHub(Interest *sub, vector<int>& indexes);
 };
 
 ostream& operator<<(ostream& out, Hub *hub);
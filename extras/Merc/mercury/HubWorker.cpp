@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+#include <mercury/HubWorker.h>
+#include <mercury/Message.h>
+#include <mercury/Application.h>
+
+HubWorker::HubWorker (PubsubStore *store) 
+    : m_Store (store), m_Todo (QUEUE_SIZE), m_Done (QUEUE_SIZE), 
+      m_Submitted (0), m_Reaped (0), m_Sleeping (false), m_Stopping (false)
+{
+}
+
+HubWorker::~HubWorker ()
+{
+}
+
+bool HubWorker::Submit (Job *job)
+{
+    // with no more jobs out than m_Done holds, the worker never
+    // waits for room there (holding the store)
+    if (m_Submitted - m_Reaped >= QUEUE_SIZE || !m_Todo.Push (job))
+	return false;
+    m_Submitted++;
+
+    // pairs with the one in _WaitForWork: either we see it asleep,
+    // or it sees this job before going to sleep.
+    __sync_synchronize ();
+    if (m_Sleeping) {
+	m_Wakeup.Acquire ();
+	m_Wakeup.Signal ();
+	m_Wakeup.Release ();
+    }
+    return true;
+}
+
+HubWorker::Job *HubWorker::Reap ()
+{
+    Job *job;
+    if (!m_Done.Pop (&job))
+	return NULL;
+    m_Reaped++;
+    return job;
+}
+
+void HubWorker::Shutdown ()
+{
+    m_Wakeup.Acquire ();
+    m_Stopping = true;
+    m_Wakeup.Signal ();
+    m_Wakeup.Release ();
+    Join ();
+
+    Job *job;
+    while (m_Todo.Pop (&job))
+	DeleteJob (job);
+    while ((job = Reap ()) != NULL)
+	DeleteJob (job);
+    m_Submitted = m_Reaped = 0;
+}
+
+void HubWorker::DeleteJob (Job *job)
+{
+    delete job->pmsg;
+    delete job;
+}
+
+// false once we are told to stop
+bool HubWorker::_WaitForWork ()
+{
+    m_Wakeup.Acquire ();
+    m_Sleeping = true;
+    __sync_synchronize ();
+    while (m_Todo.Empty () && !m_Stopping)
+	m_Wakeup.Wait ();
+    m_Sleeping = false;
+    bool stopping = m_Stopping;
+    m_Wakeup.Release ();
+
+    return !stopping;
+}
+
+void HubWorker::Run ()
+{
+    while (true) {
+	Job *job;
+	if (!m_Todo.Pop (&job)) {
+	    if (!_WaitForWork ())
+		return;
+	    continue;
+	}
+
+	// handed back before we let go of the store, so the network 
+	// thread reaps it before it deletes any of the matched subs
+	m_StoreLock.Acquire ();
+	m_Store->GetOverlapSubs (job->pmsg, &job->matches);
+	bool pushed = m_Done.Push (job);
+	m_StoreLock.Release ();
+	ASSERT (pushed);
+    }
+}
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
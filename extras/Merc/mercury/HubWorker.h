@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  HubWorker.h
+
+  Per-hub matching thread (--hub-threads). Matching pubs against a 
+  hub's store is where a rendezvous spends its time, and each member 
+  hub has a store of its own; so instead of matching on the network
+  thread, PubsubRouter hands the pub to its hub's worker and sends the
+  matched pub out when the worker hands the matches back.
+
+  The worker only matches: it calls the store's GetOverlapSubs (and 
+  whatever Event and Interest methods that uses), and nothing else --
+  no network, no scheduler, no other app callbacks. Everything that 
+  changes the store, storing triggers included (so Clone, 
+  OverwriteEvent and LessThan), stays on the network thread. The two
+  take turns on the store with LockStore; the worker holds it only 
+  while it matches one pub, so the network thread waits for at most
+  that one, not for the whole queue. Finished jobs point at Interests
+  in the store, so the network thread must reap them before it
+  deletes any subs (see PubsubRouter's StoreAccess). A pub the worker 
+  can't take (its queue is full, or the network thread holds the 
+  store) is matched on the network thread as before.
+
+  The worker is never started in the simulator (threads would make it
+  non-deterministic) nor with --pub-batch, which matches batches on 
+  the network thread instead.
+
+  Jobs go in and come back through lock-free queues; the worker sleeps
+  on a condition variable only when it has nothing to do.
+
+***************************************************************************/
+
+#ifndef __HUBWORKER__H
+#define __HUBWORKER__H
+
+#include <list>
+#include <util/Thread.h>
+#include <util/Mutex.h>
+#include <util/CondVar.h>
+#include <util/LockFreeQueue.h>
+
+struct MsgPublication;
+class Interest;
+class PubsubStore;
+
+class HubWorker : public Thread {
+ public:
+    struct Job {
+	MsgPublication  *pmsg;           // a copy, which the job owns
+	bool             pubMatchesLeft;
+	list<Interest *> matches;        // filled in by the worker
+	uint64           submitted;      // REAL_CurrentTimeTicks at Submit
+    };
+
+    HubWorker (PubsubStore *store);
+    virtual ~HubWorker ();
+
+    // the rest is for the network thread only.
+
+    /**
+     * Queue a job; false if the worker is too far behind to take it.
+     */
+    bool Submit (Job *job);
+
+    /**
+     * A job the worker has finished, or NULL. The caller owns it.
+     */
+    Job *Reap ();
+
+    /**
+     * True if some submitted job has not been reaped yet.
+     */
+    bool Busy () { return m_Submitted != m_Reaped; }
+
+    /**
+     * Keep the worker off the store until UnlockStore.
+     */
+    void LockStore () { m_StoreLock.Acquire (); }
+    void UnlockStore () { m_StoreLock.Release (); }
+
+    /**
+     * Stop the thread (which must have been Start()ed) and delete 
+     * whatever jobs are left.
+     */
+    void Shutdown ();
+
+    void Run ();
+
+    static void DeleteJob (Job *job);
+ private:
+    static const uint32 QUEUE_SIZE = 1024;
+
+    PubsubStore *m_Store;
+    Mutex        m_StoreLock;
+
+    LockFreeQueue<Job *> m_Todo, m_Done;
+    uint32 m_Submitted, m_Reaped;
+
+    CondVar m_Wakeup;
+    volatile bool m_Sleeping, m_Stopping;
+
+    bool _WaitForWork ();
+};
+
+#endif /* __HUBWORKER__H */
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -72,7 +72,15 @@ struct IPEndPoint : public Serializable {
     IPEndPoint(Packet *pkt);
     void Serialize(Packet *pkt);
     uint32 GetLength() {
-	return sizeof(m_IP) + sizeof(m_Port);
+	return WIRE_LENGTH;
+    }
+
+    // the caller checks for WIRE_LENGTH bytes (see PacketWriter)
+    static const int WIRE_LENGTH = sizeof(uint32) + sizeof(uint16);
+    IPEndPoint(PacketReader& r) : m_IP(r.GetIntNoSwap()), m_Port(r.GetShort()) {}
+    void Serialize(PacketWriter& w) {
+	w.PutIntNoSwap(m_IP);
+	w.PutShort(m_Port);
     }
     void Print(FILE *stream) {
 	fprintf(stream, "%s", ToString());
@@ -186,6 +186,20 @@ bool Interest::IsEqual(Interest * other)
     return m_GUID == other->GetGUID();
 }
 
+bool Interest::Covers (Interest *other)
+{
+    for (int i = 0, len = m_Constraints.size(); i < len; i++)
+    {
+	Constraint *c = &(m_Constraints[i]);
+	Constraint *oc = other->GetConstraintByAttr (c->GetAttrIndex ());
+
+	// 'other' spans all of this attribute
+	if (oc == NULL || !c->Contains (*oc))
+	    return false;
+    }
+    return true;
+}
+
 
 void Interest::Print(FILE * stream)
 {
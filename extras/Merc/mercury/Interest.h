@@ -84,6 +84,9 @@ class Interest : public virtual Serializable {
 
     bool IsEqual(Interest *);
 
+    // true if every event overlapping 'other' overlaps this too
+    bool Covers (Interest *other);
+
     void SetLifeTime(uint32 lifetime) { m_LifeTime = lifetime; }
     uint32 GetLifeTime() const { return m_LifeTime; }
 
@@ -0,0 +1,326 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  IntervalTree.h
+
+  An interval tree over Mercury values. Used by the pubsub stores to find
+  the stored items whose range on a hub attribute overlaps a query range
+  without looking at every item.
+
+  The tree is a treap ordered on (low endpoint, item); every node also
+  remembers the largest high endpoint in its subtree so that a query can
+  skip subtrees which end before the query begins. Endpoints are _not_
+  copied: the caller passes pointers into the stored item (usually the
+  Constraint of a cloned Interest or Event) and must keep them alive and
+  unchanged while the item is in the tree.
+
+  Intervals are closed, like Constraint::Overlaps ().
+
+***************************************************************************/
+
+#ifndef __INTERVALTREE__H
+#define __INTERVALTREE__H
+
+#include <vector>
+#include <functional>
+#include <util/callback.h>
+#include <mercury/MercuryID.h>
+
+template<class T>
+class IntervalTree {
+    struct Node {
+	const Value *lo, *hi;
+	const Value *maxhi;       // largest 'hi' in this subtree
+	T            item;
+	long         prio;
+	Node        *left, *right;
+
+	Node (const Value *l, const Value *h, T it) 
+	    : lo (l), hi (h), maxhi (h), item (it), prio (lrand48 ()), 
+	      left (NULL), right (NULL) {}
+    };
+
+    Node *m_Root;
+    int   m_Size;
+
+ public:
+    IntervalTree () : m_Root (NULL), m_Size (0) {}
+    ~IntervalTree () { Clear (); }
+
+    int size () const { return m_Size; }
+    bool empty () const { return m_Size == 0; }
+
+    /**
+     * Add 'item' covering [*lo, *hi]. The same item may not be 
+     * inserted twice with the same low endpoint.
+     **/
+    void Insert (const Value *lo, const Value *hi, T item) {
+	ASSERT (*lo <= *hi);
+	m_Root = _Insert (m_Root, new Node (lo, hi, item));
+	m_Size++;
+    }
+
+    /**
+     * Remove 'item' which was inserted with low endpoint 'lo'. 
+     * Returns false if it was not found.
+     **/
+    bool Erase (const Value& lo, T item) {
+	bool found = false;
+	m_Root = _Erase (m_Root, lo, item, &found);
+	if (found)
+	    m_Size--;
+	return found;
+    }
+
+    /**
+     * Append every item whose interval overlaps [lo, hi] to 'out'.
+     **/
+    void GetOverlaps (const Value& lo, const Value& hi, vector<T> *out) const {
+	_GetOverlaps (m_Root, lo, hi, out);
+    }
+
+    /**
+     * Offer every item whose interval overlaps the range from 'lo' to
+     * 'hi' to 'pred', once each; those it returns true for are taken
+     * out of the tree and appended to 'out'. Unless lo < hi the range
+     * wraps around, as a NodeRange does: [lo, +inf) and (-inf, hi].
+     *
+     * The items starting inside the range are split off as one 
+     * subtree, filtered, and joined back, so apart from the items 
+     * offered this costs O(log n) expected, however many are taken. 
+     * Items starting before the range are found as in GetOverlaps.
+     * 'pred' must not change the tree.
+     **/
+    void Extract (const Value& lo, const Value& hi, typename callback<bool, T>::ref pred, vector<T> *out) {
+	int before = out->size ();
+	Node *a, *b, *c;
+
+	if (lo < hi) {
+	    // a: starts before lo; b: starts in [lo, hi]; c: after hi
+	    _Split (m_Root, lo, false, &a, &b);
+	    _Split (b, hi, true, &b, &c);
+	    a = _Extract (a, &lo, pred, out);
+	    b = _Extract (b, NULL, pred, out);
+	}
+	else {
+	    // a: starts at or before hi; b: between hi and lo; c: from lo on
+	    _Split (m_Root, hi, true, &a, &b);
+	    _Split (b, lo, false, &b, &c);
+	    a = _Extract (a, NULL, pred, out);
+	    b = _Extract (b, &lo, pred, out);
+	    c = _Extract (c, NULL, pred, out);
+	}
+
+	m_Root = _Merge (_Merge (a, b), c);
+	m_Size -= out->size () - before;
+    }
+
+    /**
+     * Append every item to 'out', in order of low endpoints.
+     **/
+    void GetAll (vector<T> *out) const {
+	_GetAll (m_Root, out);
+    }
+
+    /**
+     * Drop all nodes; the items themselves are not touched.
+     **/
+    void Clear () {
+	_Free (m_Root);
+	m_Root = NULL;
+	m_Size = 0;
+    }
+
+ private:
+    static bool _Less (const Value& alo, T a, const Value& blo, T b) {
+	if (alo < blo)
+	    return true;
+	if (blo < alo)
+	    return false;
+	return less<T> () (a, b);
+    }
+
+    static void _Update (Node *n) {
+	n->maxhi = n->hi;
+	if (n->left && *n->left->maxhi > *n->maxhi)
+	    n->maxhi = n->left->maxhi;
+	if (n->right && *n->right->maxhi > *n->maxhi)
+	    n->maxhi = n->right->maxhi;
+    }
+
+    static Node *_RotateRight (Node *n) {
+	Node *l = n->left;
+	n->left = l->right;
+	l->right = n;
+	_Update (n);
+	_Update (l);
+	return l;
+    }
+
+    static Node *_RotateLeft (Node *n) {
+	Node *r = n->right;
+	n->right = r->left;
+	r->left = n;
+	_Update (n);
+	_Update (r);
+	return r;
+    }
+
+    static Node *_Insert (Node *n, Node *nn) {
+	if (n == NULL)
+	    return nn;
+
+	if (_Less (*nn->lo, nn->item, *n->lo, n->item)) {
+	    n->left = _Insert (n->left, nn);
+	    if (n->left->prio > n->prio)
+		return _RotateRight (n);
+	}
+	else {
+	    n->right = _Insert (n->right, nn);
+	    if (n->right->prio > n->prio)
+		return _RotateLeft (n);
+	}
+	_Update (n);
+	return n;
+    }
+
+    // all keys in 'a' are smaller than all keys in 'b'
+    static Node *_Merge (Node *a, Node *b) {
+	if (a == NULL) return b;
+	if (b == NULL) return a;
+
+	if (a->prio > b->prio) {
+	    a->right = _Merge (a->right, b);
+	    _Update (a);
+	    return a;
+	}
+	b->left = _Merge (a, b->left);
+	_Update (b);
+	return b;
+    }
+
+    // 'l' gets the nodes starting before 'v' (at or before, if 
+    // 'inclusive'), 'r' the rest
+    static void _Split (Node *n, const Value& v, bool inclusive, Node **l, Node **r) {
+	if (n == NULL) {
+	    *l = *r = NULL;
+	    return;
+	}
+
+	if (inclusive ? *n->lo <= v : *n->lo < v) {
+	    _Split (n->right, v, inclusive, &n->right, r);
+	    *l = n;
+	}
+	else {
+	    _Split (n->left, v, inclusive, l, &n->left);
+	    *r = n;
+	}
+	_Update (n);
+    }
+
+    // offer the items ending at or after 'from' (all, if NULL) to 
+    // 'pred' in order; unlink those it takes. returns the new subtree.
+    static Node *_Extract (Node *n, const Value *from, typename callback<bool, T>::ref& pred, vector<T> *out) {
+	if (n == NULL || (from && *n->maxhi < *from))
+	    return n;
+
+	n->left = _Extract (n->left, from, pred, out);
+	bool take = (!from || *n->hi >= *from) && pred (n->item);
+	if (take)
+	    out->push_back (n->item);
+	n->right = _Extract (n->right, from, pred, out);
+
+	if (take) {
+	    Node *rest = _Merge (n->left, n->right);
+	    delete n;
+	    return rest;
+	}
+	_Update (n);
+	return n;
+    }
+
+    static Node *_Erase (Node *n, const Value& lo, T item, bool *found) {
+	if (n == NULL)
+	    return NULL;
+
+	if (n->item == item && *n->lo == lo) {
+	    Node *ret = _Merge (n->left, n->right);
+	    delete n;
+	    *found = true;
+	    return ret;
+	}
+
+	if (_Less (lo, item, *n->lo, n->item))
+	    n->left = _Erase (n->left, lo, item, found);
+	else
+	    n->right = _Erase (n->right, lo, item, found);
+	_Update (n);
+	return n;
+    }
+
+    static void _GetOverlaps (Node *n, const Value& lo, const Value& hi, vector<T> *out) {
+	// nothing in this subtree reaches 'lo'
+	if (n == NULL || *n->maxhi < lo)
+	    return;
+
+	_GetOverlaps (n->left, lo, hi, out);
+
+	// this node and everything to the right starts after 'hi'
+	if (*n->lo > hi)
+	    return;
+
+	if (*n->hi >= lo)
+	    out->push_back (n->item);
+
+	_GetOverlaps (n->right, lo, hi, out);
+    }
+
+    static void _GetAll (Node *n, vector<T> *out) {
+	if (n == NULL)
+	    return;
+	_GetAll (n->left, out);
+	out->push_back (n->item);
+	_GetAll (n->right, out);
+    }
+
+    static void _Free (Node *n) {
+	if (n == NULL)
+	    return;
+	_Free (n->left);
+	_Free (n->right);
+	delete n;
+    }
+
+    // no copying
+    IntervalTree (const IntervalTree&);
+    IntervalTree& operator= (const IntervalTree&);
+};
+
+#endif // __INTERVALTREE__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -101,6 +101,10 @@ void LinkMaintainer::ProcessMessage(IPEndPoint *from, Message *msg)
 
 void LinkMaintainer::Start()
 {
+    // a joiner may have picked another rep by now (see HubManager::ProbePlacement)
+    if (m_JoinRequestTimer->GetRepAddress () != m_Hub->GetBootstrapRep ())
+	m_JoinRequestTimer = new refcounted<JoinRequestTimer> (m_Hub, m_Hub->GetBootstrapRep (), 0);
+
     m_MercuryNode->GetApplication ()->JoinBegin (m_JoinRequestTimer->GetRepAddress ());
 
     m_Scheduler->RaiseEvent (m_JoinRequestTimer, m_Address, m_JoinRequestTimer->GetNextDelay ());
@@ -718,9 +722,17 @@ void LinkMaintainer::HandleNeighborRequest (IPEndPoint *from, MsgNeighborRequest
     m_Network->SendMessage (req, (IPEndPoint *) next_hop, Parameters::TransportProto);
 }
 
-Value LinkMaintainer::GenerateHarmonicValue (int nodeCount)
+Value LinkMaintainer::GenerateHarmonicValue (int nodeCount, int *pdist)
 {
     int dist = (int) exp(G_GetRandom() * log((float) (nodeCount - 1)));
+
+    *pdist = dist;
+    return GetNeighborValue (dist);
+}
+
+// a value about 'dist' nodes after us, or VALUE_NONE if that is us
+Value LinkMaintainer::GetNeighborValue (int dist)
+{
     Value dest_val = 0;
 
     if (!m_Hub->m_HistogramMaintainer->GetValueAtDistance(dist, dest_val)) {
@@ -752,6 +764,9 @@ void NeighborRequestTimer::OnTimeout () {
     m_LM->RepairPointer (m_Nonce, -1);
 }
 
+// long enough for the sampled pointers to answer and get pinged a couple of times
+#define PNS_PROBE_TIME (Parameters::LongNeighborResponseTimeout + 2 * Parameters::PeerPingInterval)
+
 void LinkMaintainer::RepairPointer (uint32 oldnonce, int nodeCount)
 {
     // -1 when it is called from the timer;
@@ -764,8 +779,9 @@ void LinkMaintainer::RepairPointer (uint32 oldnonce, int nodeCount)
     // here is a good idea.
 
     int attempts = 0;
+    int dist = 0;
     Value dest_val = VALUE_NONE;
-    while (attempts < 3 && ((dest_val = GenerateHarmonicValue (nodeCount)) == VALUE_NONE))
+    while (attempts < 3 && ((dest_val = GenerateHarmonicValue (nodeCount, &dist)) == VALUE_NONE))
 	attempts++;
 
     if (attempts >= 3) {  // forget it 
@@ -781,6 +797,66 @@ void LinkMaintainer::RepairPointer (uint32 oldnonce, int nodeCount)
     m_NRTimers.insert (NRTMap::value_type (nonce, nrt));
 
     m_Scheduler->RaiseEvent (nrt, m_Address, Parameters::LongNeighborResponseTimeout);
+
+    // proximity neighbor selection: the nodes right after the target
+    // would do about as well as it, so ask a few of them too, ping them
+    // all for a while as long pointers, and keep the closest.
+    if (g_Preferences.pns_samples > 1) {
+	m_PNSNonces[nonce] = nonce;
+	m_PNSGroups[nonce] = vector<IPEndPoint> ();
+
+	for (int j = 1; j < g_Preferences.pns_samples && dist + j < nodeCount; j++) {
+	    Value v = GetNeighborValue (dist + j);
+	    if (v == VALUE_NONE)
+		continue;
+	    m_PNSNonces[SendNeighborRequest (v)] = nonce;
+	}
+
+	m_Scheduler->RaiseEvent (new refcounted<PNSPruneTimer> (this, nonce), m_Address, PNS_PROBE_TIME);
+    }
+}
+
+void PNSPruneTimer::OnTimeout () 
+{
+    m_LM->PrunePNSGroup (m_Group);
+}
+
+void LinkMaintainer::PrunePNSGroup (uint32 group)
+{
+    PNSGroupMapIter git = m_PNSGroups.find (group);
+    if (git == m_PNSGroups.end ())
+	return;
+
+    vector<IPEndPoint> cands = git->second;
+    m_PNSGroups.erase (git);
+
+    for (PNSNonceMapIter it = m_PNSNonces.begin (); it != m_PNSNonces.end (); ) {
+	PNSNonceMapIter cur = it++;
+	if (cur->second == group)
+	    m_PNSNonces.erase (cur);
+    }
+
+    // nodes not pinged yet lose to any which were
+    Peer *best = NULL;
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	Peer *p = m_Hub->LookupLongNeighbor (cands[i]);
+	if (p == NULL)
+	    continue;
+	if (best == NULL || 
+	    (p->HasRTTEstimate () && 
+	     (!best->HasRTTEstimate () || p->GetSmoothedRTT () < best->GetSmoothedRTT ())))
+	    best = p;
+    }
+    if (best == NULL)
+	return;
+
+    IPEndPoint keep = best->GetAddress ();
+    MDB (10) << " pns: keeping " << keep << " (rtt=" << best->GetSmoothedRTT () << ") of " << cands.size () << endl;
+
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	if (cands[i] != keep)
+	    m_Hub->RemoveLongNeighbor (cands[i]);
+    }
 }
 
 uint32 LinkMaintainer::SendNeighborRequest (Value& dest_val)
@@ -838,7 +914,13 @@ void LinkMaintainer::HandleNeighborResponse(IPEndPoint *from, MsgNeighborRespons
 {
     MDB (20) << "received long pointer neighbor RESPONSE from " << from << endl;
 
-    NRTMapIter it = m_NRTimers.find (resp->GetNonce ());
+    // any answer for a pointer will do for its timer
+    uint32 key = resp->GetNonce ();
+    PNSNonceMapIter pit = m_PNSNonces.find (key);
+    if (pit != m_PNSNonces.end ())
+	key = pit->second;
+
+    NRTMapIter it = m_NRTimers.find (key);
     if (it != m_NRTimers.end ()) {
 	it->second->Cancel ();
 	m_NRTimers.erase (it);
@@ -857,6 +939,12 @@ void LinkMaintainer::HandleNeighborResponse(IPEndPoint *from, MsgNeighborRespons
     }
 
     m_Hub->AddLongNeighbor (*from, resp->GetRange ());
+
+    if (pit != m_PNSNonces.end ()) {
+	PNSGroupMapIter git = m_PNSGroups.find (key);
+	if (git != m_PNSGroups.end ())
+	    git->second.push_back (*from);
+    }
 }
 
 #include <util/stacktrace.h>
@@ -100,12 +100,30 @@ class NeighborRequestTimer : public Timer {
 typedef map<uint32, ref<NeighborRequestTimer> > NRTMap;
 typedef NRTMap::iterator NRTMapIter;
 
+// --pns-samples: when it fires, keep the lowest-RTT node of the ones 
+// which answered requests for one long pointer
+class PNSPruneTimer : public Timer {
+    LinkMaintainer *m_LM;
+    uint32 m_Group;
+ public:
+    PNSPruneTimer (LinkMaintainer *lm, uint32 group) : 
+	Timer (0), m_LM (lm), m_Group (group) {}
+
+    void OnTimeout ();
+};
+
+typedef map<uint32, uint32> PNSNonceMap;                     // request nonce -> group
+typedef PNSNonceMap::iterator PNSNonceMapIter;
+typedef map<uint32, vector<IPEndPoint> > PNSGroupMap;        // group -> nodes which answered
+typedef PNSGroupMap::iterator PNSGroupMapIter;
+
 typedef SIDTimeValMap JRMap;
 typedef SIDTimeValMapIter JRMapIter;
 
 class LinkMaintainer : public MessageHandler
 {
     friend class NeighborRequestTimer;
+    friend class PNSPruneTimer;
     friend class LNContinuation;
 
     MemberHub              *m_Hub;
@@ -120,6 +138,8 @@ class LinkMaintainer : public MessageHandler
     int                     m_SLMaintInvocations;      // how many times has DoSuccListMaintenance () been invoked?
     JRMap                   m_JoinResponseSIDs;
     NRTMap                  m_NRTimers;                // timers associated with outstanding long neighbor requests
+    PNSNonceMap             m_PNSNonces;               // requests sent for one pointer share a group,
+    PNSGroupMap             m_PNSGroups;               // named by the first one's nonce (--pns-samples)
 
  public:
     LinkMaintainer(MemberHub *hub);
@@ -150,7 +170,9 @@ class LinkMaintainer : public MessageHandler
     void HandleLinkBreak (IPEndPoint *from, MsgLinkBreak *msg);
 
     bool IsRequestDuplicate (IPEndPoint *from);
-    Value GenerateHarmonicValue (int nodeCount);
+    Value GenerateHarmonicValue (int nodeCount, int *pdist);
+    Value GetNeighborValue (int dist);
+    void PrunePNSGroup (uint32 group);
     void SendLeaveNotification (IPEndPoint addr, NodeRange range, double currentload, IPEndPoint newsucc);
     void EndLeave (IPEndPoint newsucc);
 };
@@ -49,13 +49,16 @@
 #include <mercury/common.h>
 #include <mercury/MercuryID.h>
 #include <mercury/Packet.h>
+
+Value VALUE_NONE = Value ("-1", 10);
+
+#ifndef MERCURY_FIXED_VALUE   // else see FixedValue.cpp
+
 #include <gmp.h>
 
 const MercuryID MercuryID::ZERO = MercuryID(0);
 const MercuryID MercuryID::ONE  = MercuryID(1);
 
-Value VALUE_NONE = Value ("-1", 10);
-
 #define _MERCURY_ID_MPZ_SIZE  4      /* each word is 4 bytes */
 
 #undef min
@@ -504,6 +507,14 @@ MercuryID::MercuryID (Packet *pkt)
     mpz_set_raw (this, (const char *) sg_mpz_buffer, size);
 }
 
+MercuryID::MercuryID (PacketReader& r)
+{
+    uint32 size = r.Need (4).GetInt ();
+    r.Need (size).GetBuffer (sg_mpz_buffer, size);
+    mpz_init (this);
+    mpz_set_raw (this, (const char *) sg_mpz_buffer, size);
+}
+
 void MercuryID::Serialize (Packet *pkt) 
 {
     uint32 size = GetLength() - 4 /* subtract the size of the 'size' itself */;
@@ -513,6 +524,16 @@ void MercuryID::Serialize (Packet *pkt)
     pkt->WriteBuffer (sg_mpz_buffer, (int) size);
 }
 
+void MercuryID::Serialize (PacketWriter& w) 
+{
+    uint32 size = GetLength() - 4;
+    mpz_get_raw ((char*) sg_mpz_buffer, size, this);
+
+    w.Reserve (4 + size);
+    w.PutInt (size);
+    w.PutBuffer (sg_mpz_buffer, (int) size);
+}
+
 uint32 MercuryID::GetLength ()
 {
     /* copied mpz_rawsize () from dm's code - Ashwin [02/13/2005] */
@@ -536,6 +557,8 @@ void MercuryID::double_mul (double d)
     mpz_tdiv_q_ui (this, this, BIG_INT_NUM);
 }
 
+#endif // !MERCURY_FIXED_VALUE
+
 /*
  * check if 'test' is between (left) and (right) considering the fact 
  * that values could be wrapped 
@@ -603,6 +626,8 @@ bool IsBetween (const Value& test, const Value& left, const Value& right)
 	return test > left || test < right;
 }
 
+#ifndef MERCURY_FIXED_VALUE
+
 #ifdef MERCURYID_PRINT_HEX
 #define MERCURYID_PRINT_PAT "%ZX"
 #else
@@ -628,6 +653,8 @@ ostream &operator<< (ostream &out, const MercuryID &id)
     return out << &id;
 }
 
+#endif // !MERCURY_FIXED_VALUE
+
 /*
   int main()
   {
@@ -51,8 +51,27 @@
 
 #include <mercury/common.h>
 #include <string>
+
+struct AttrInfo;
+
+extern AttrInfo *g_MercuryAttrRegistry;
+extern int g_NumHubs;
+
+inline const char *G_GetTypeName(int attrindex);
+
+#ifdef MERCURY_FIXED_VALUE
+
+// machine-integer ids, without GMP (see FixedValue.h)
+#include <mercury/FixedValue.h>
+typedef FixedValue MercuryID;
+
+#else // !MERCURY_FIXED_VALUE
+
 #include <gmp.h>
 
+class PacketWriter;
+class PacketReader;
+
 /* XXX FIXME: this information will ultimately be found out by 'configure' 
  * when we migrate to the GNU auto* files for distribution. meanwhile, 
  * i have just hard-coded it since this will work for all Redhat 8/9
@@ -62,25 +81,6 @@
 #define SIZEOF_LONG  4
 #define SIZEOF_LONG_LONG 8
 
-struct AttrInfo {
-    int    index;
-    string name;
-};
-
-extern AttrInfo *g_MercuryAttrRegistry;
-extern int g_NumHubs;
-
-inline const char *G_GetTypeName(int attrindex) { 
-    if (g_NumHubs == 0)
-	return "(undef)";
-    if (g_MercuryAttrRegistry == NULL)
-	return "(undef)";
-    if (attrindex >= g_NumHubs || attrindex < 0)
-	return "(oob)"; 
-	
-    return g_MercuryAttrRegistry[attrindex].name.c_str();
-}
-
 /// bigint goo
 
 #undef ABS
@@ -201,6 +201,7 @@ class MercuryID : virtual public Serializable, public MP_INT {
 
     long getsi () const { return mpz_get_si (this); }
     u_long getui () const { return mpz_get_ui (this); }
+    double getd () const { return mpz_get_d (this); }
 
 #define ASSOPX(X, fn)				\
 	MercuryID &operator X (const MercuryID &b)		\
@@ -315,6 +316,8 @@ class MercuryID : virtual public Serializable, public MP_INT {
 
     MercuryID (Packet *pkt);
     void Serialize(Packet *pkt);
+    MercuryID (PacketReader& r);
+    void Serialize(PacketWriter& w);
     uint32 GetLength();
     void Print(FILE *stream);
 };
@@ -773,6 +776,8 @@ swap (MercuryID &a, MercuryID &b)
 ostream& operator<< (ostream& out, const MercuryID *id);
 ostream& operator<< (ostream& out, const MercuryID &id);
 
+#endif // !MERCURY_FIXED_VALUE
+
 typedef MercuryID Value;
 bool IsBetween (const Value& test, const Value& left, const Value& right);
 bool IsBetweenInclusive (const Value& test, const Value& left, const Value& right);
@@ -781,6 +786,24 @@ bool IsBetweenRightInclusive (const Value& test, const Value& left, const Value&
 
 extern Value VALUE_NONE;
 
+struct AttrInfo {
+    int    index;
+    string name;
+    Value  absmin;
+    Value  absmax;
+};
+
+inline const char *G_GetTypeName(int attrindex) { 
+    if (g_NumHubs == 0)
+	return "(undef)";
+    if (g_MercuryAttrRegistry == NULL)
+	return "(undef)";
+    if (attrindex >= g_NumHubs || attrindex < 0)
+	return "(oob)"; 
+	
+    return g_MercuryAttrRegistry[attrindex].name.c_str();
+}
+
 #endif // __MERCURYID__H
 // vim: set sw=4 sts=4 ts=8 noet: 
 // Local Variables:
@@ -50,6 +50,8 @@ copyright      :  (C) 2002-2005 Ashwin R. Bharambe (ashu@cs.cmu.edu)
 #include <mercury/BufferManager.h>
 #include <mercury/Sampling.h>
 #include <mercury/HubManager.h>
+#include <mercury/Hub.h>
+#include <mercury/PubsubRouter.h>
 #include <util/Utils.h>
 
 #include <mercury/ObjectLogs.h>       // FIXME: annoying
@@ -142,6 +144,7 @@ MercuryNode::MercuryNode(NetworkLayer *network, Scheduler *scheduler, IPEndPoint
 
     RegisterMessageHandler(MSG_CB_ALL_JOINED, this);
     RegisterMessageHandler(MSG_PUB, this);    // HACK: only for the matched-pubs; cleaner way might be to create a new message type
+    RegisterMessageHandler(MSG_PUB_BATCH, this);
 
     m_Scheduler->RaiseEvent (new refcounted<MNODE_CPP::PeriodicTimer>(this), m_Address, 0);
 
@@ -271,6 +274,8 @@ void MercuryNode::ProcessMessage(IPEndPoint * from, Message * msg)
     else if (t == MSG_PUB)
 	// ONLY matched pubs handled here
 	HandlePublication (from, (MsgPublication *) msg);
+    else if (t == MSG_PUB_BATCH)
+	HandlePubBatch (from, (MsgPubBatch *) msg);
     else 
 	MWARN << "MercuryNode: weird packet, type is: " << msg->TypeString() << endl;
 
@@ -302,6 +307,14 @@ void MercuryNode::HandlePublication (IPEndPoint *from, MsgPublication *pmsg)
     m_BufferManager->EnqueueNetworkEvent (ev->Clone ());
 }
 
+void MercuryNode::HandlePubBatch (IPEndPoint *from, MsgPubBatch *bmsg)
+{
+    for (list<MsgPublication *>::iterator it = bmsg->begin (); it != bmsg->end (); ++it) {
+	(*it)->recvTime = bmsg->recvTime;
+	HandlePublication (from, *it);
+    }
+}
+
 void MercuryNode::HandleAllJoined(IPEndPoint *from, MsgCB_AllJoined *msg)
 {
     m_AllJoined = true;
@@ -547,6 +560,22 @@ bool MercuryNode::SendPacket ()
     return true;
 }
 
+// Send out what the hubs' matching threads have finished (see
+// --hub-threads). Returns true if there was anything.
+bool MercuryNode::ReapHubWork ()
+{
+    bool reaped = false;
+
+    for (int i = 0; i < m_HubManager->GetNumHubs (); i++) {
+	Hub *h = m_HubManager->GetHubByIndex (i);
+	if (!h->IsMine ())
+	    continue;
+	if (((MemberHub *) h)->GetPubsubRouter ()->ReapMatches ())
+	    reaped = true;
+    }
+    return reaped;
+}
+
 void MercuryNode::SendApplicationPackets()
 {
     int numPubs = 0, numSubs = 0;
@@ -107,6 +107,7 @@ class MercuryNode : public Node, public Router, public MessageHandler {
 
     bool IsJoined();
     bool AllJoined() { return m_AllJoined; }
+    bool IsSimulating() { return m_Simulating; }
     uint32 GetIP() { return m_Address.GetIP(); }
     uint16 GetPort() { return m_Address.GetPort(); }
 
@@ -253,11 +254,13 @@ class MercuryNode : public Node, public Router, public MessageHandler {
     void DoPeriodic ();
  protected:
     bool SendPacket ();
+    bool ReapHubWork ();
  private:
 
     MemberHub *GetHub (int hubid);
     void HandleAllJoined(IPEndPoint *from, MsgCB_AllJoined *msg);
     void HandlePublication (IPEndPoint *from, MsgPublication *msg);
+    void HandlePubBatch (IPEndPoint *from, MsgPubBatch *msg);
     void PrintPeerList(FILE *stream);
 };
 
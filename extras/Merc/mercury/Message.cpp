@@ -32,11 +32,12 @@
 #include <mercury/Sampling.h>
 #include <mercury/Peer.h>
 
-MsgType MSG_INVALID, MSG_HEARTBEAT, MSG_LIVENESS_PING, MSG_LIVENESS_PONG, 
+MsgType MSG_INVALID, MSG_HEARTBEAT, MSG_LIVENESS_PING, MSG_LIVENESS_PONG, MSG_LOAD_HEARTBEAT,
     MSG_JOIN_REQUEST,  MSG_JOIN_RESPONSE,  MSG_NOTIFY_SUCCESSOR,
     MSG_GET_PRED, MSG_PRED, MSG_GET_SUCCLIST, MSG_SUCCLIST,
     MSG_NBR_REQ, MSG_NBR_RESP, MSG_LINK_BREAK,
     MSG_PUB, MSG_LINEAR_PUB, MSG_ACK, MSG_SUB, MSG_LINEAR_SUB, MSG_SUB_LIST, MSG_TRIG_LIST,
+    MSG_PUB_BATCH,
     MSG_BOOTSTRAP_REQUEST, MSG_BOOTSTRAP_RESPONSE,
 
     MSG_SAMPLE_REQ, MSG_SAMPLE_RESP,
@@ -49,7 +50,7 @@ MsgType MSG_INVALID, MSG_HEARTBEAT, MSG_LIVENESS_PING, MSG_LIVENESS_PONG,
     MSG_LCHECK_REQUEST, MSG_LCHECK_RESPONSE,
 
     MSG_CB_ALL_JOINED, MSG_CB_ESTIMATE_REQ, MSG_CB_ESTIMATE_RESP,
-    MSG_BLOB, MSG_COMPRESSED, MSG_PING,
+    MSG_BLOB, MSG_COMPRESSED, MSG_PING, MSG_FRAME,
     // XXX: Start
     MSG_MATCHED_PUB, MSG_RANGE_PUB, MSG_RANGE_MATCHED_PUB,
     MSG_RANGE_PUB_NOTROUTING, MSG_SUB_NOTROUTING,
@@ -63,6 +64,7 @@ void RegisterMessageTypes()
     MSG_HEARTBEAT = REGISTER_TYPE (Message, MsgHeartBeat);
     MSG_LIVENESS_PING = REGISTER_TYPE (Message, MsgLivenessPing);
     MSG_LIVENESS_PONG = REGISTER_TYPE (Message, MsgLivenessPong);
+    MSG_LOAD_HEARTBEAT = REGISTER_TYPE (Message, MsgLoadHeartBeat);
 
     MSG_JOIN_REQUEST = REGISTER_TYPE (Message, MsgJoinRequest);
     MSG_JOIN_RESPONSE = REGISTER_TYPE (Message, MsgJoinResponse);
@@ -82,6 +84,7 @@ void RegisterMessageTypes()
     MSG_LINEAR_SUB = REGISTER_TYPE (Message, MsgLinearSubscription);
     MSG_SUB_LIST = REGISTER_TYPE (Message, MsgSubscriptionList);
     MSG_TRIG_LIST = REGISTER_TYPE (Message, MsgTriggerList);
+    MSG_PUB_BATCH = REGISTER_TYPE (Message, MsgPubBatch);
 
     MSG_BOOTSTRAP_REQUEST = REGISTER_TYPE (Message, MsgBootstrapRequest);
     MSG_BOOTSTRAP_RESPONSE = REGISTER_TYPE (Message, MsgBootstrapResponse);
@@ -106,6 +109,7 @@ void RegisterMessageTypes()
     MSG_BLOB = REGISTER_TYPE (Message, MsgBlob);
     MSG_COMPRESSED = REGISTER_TYPE (Message, MsgCompressed);
     MSG_PING = REGISTER_TYPE (Message, MsgPing);
+    MSG_FRAME = REGISTER_TYPE (Message, MsgFrame);
 
     /// XXX: this is for logging purposes. if a message ever arrives with 
     //       this "type", it will cause an assertion failure
@@ -124,6 +128,21 @@ void RegisterMessageTypes()
     MSG_MERCURY_SENTINEL = REGISTER_TYPE (Message, MsgDummy);
 }
 
+// last size we saw for each message type: the first guess for the next
+// one. a wrong guess costs a doubling or two of the buffer.
+static POOL_LOCAL uint16 s_SizeHint[MAX_DER_TYPES];
+
+Packet *SerializeMessage(Message *msg)
+{
+    byte type = msg->GetType();
+    int hint = s_SizeHint[type] ? s_SizeHint[type] : Packet::DEFAULT_PACKET_SIZE;
+
+    Packet *pkt = new Packet(hint, true);
+    msg->Serialize(pkt);
+    s_SizeHint[type] = MIN(pkt->GetUsed(), 0xFFFF);
+    return pkt;
+}
+
 static void _dump_type (FILE *fp, char *str, MsgType t)
 {
     ASSERT (str != NULL);
@@ -144,6 +163,7 @@ void DumpMessageTypes (FILE *fp)
     DUMP_TYPE(MSG_HEARTBEAT);
     DUMP_TYPE(MSG_LIVENESS_PING);
     DUMP_TYPE(MSG_LIVENESS_PONG);
+    DUMP_TYPE(MSG_LOAD_HEARTBEAT);
 
     DUMP_TYPE(MSG_JOIN_REQUEST);
     DUMP_TYPE(MSG_JOIN_RESPONSE);
@@ -163,6 +183,7 @@ void DumpMessageTypes (FILE *fp)
     DUMP_TYPE(MSG_LINEAR_SUB);
     DUMP_TYPE(MSG_SUB_LIST);
     DUMP_TYPE(MSG_TRIG_LIST);
+    DUMP_TYPE(MSG_PUB_BATCH);
 
     DUMP_TYPE(MSG_BOOTSTRAP_REQUEST);
     DUMP_TYPE(MSG_BOOTSTRAP_RESPONSE);
@@ -187,6 +208,7 @@ void DumpMessageTypes (FILE *fp)
     DUMP_TYPE(MSG_BLOB);
     DUMP_TYPE(MSG_COMPRESSED);
     DUMP_TYPE(MSG_PING);
+    DUMP_TYPE(MSG_FRAME);
 
     /// XXX: this is for logging purposes. if a message ever arrives with 
     //       this "type", it will cause an assertion failure
@@ -234,31 +256,40 @@ Message::Message(byte hID, IPEndPoint& sder) : hubID (hID), sender (sder) {
 }
 
 Message::Message(Packet *pkt) {
-    MsgType type = (MsgType)pkt->ReadByte();
-    sender = IPEndPoint(pkt);
+    PacketReader r(pkt);
+
+    // all of the header but the hubID
+    r.Need(HEADER_LENGTH - 1);
+    MsgType type = (MsgType)r.GetByte();
+    sender = IPEndPoint(r);
 
     // Must check the type we just read and *not* GetType() because our
     // type is not set yet by the ConstructObject<> template!
     if (IsMercMsg(type)) {
-	hubID = pkt->ReadByte();
+	hubID = r.Need(1).GetByte();
     }
 
-    hopCount = pkt->ReadShort();
-    nonce = pkt->ReadInt();
+    hopCount = r.GetShort();
+    nonce = r.GetInt();
 }
 
 void Message::Serialize(Packet *pkt) {
+    PacketWriter w(pkt, HEADER_LENGTH);
+    SerializeHeader(w);
+}
+
+void Message::SerializeHeader(PacketWriter& w) {
     byte type = GetType();
 
     ASSERT(type != MSG_INVALID);
-    pkt->WriteByte (type);
+    w.PutByte (type);
 
-    sender.Serialize (pkt);
+    sender.Serialize (w);
     if (IsMercMsg())
-	pkt->WriteByte (hubID);
+	w.PutByte (hubID);
 
-    pkt->WriteShort (hopCount);
-    pkt->WriteInt (nonce);
+    w.PutShort (hopCount);
+    w.PutInt (nonce);
 }
 
 uint32 Message::GetLength() {
@@ -308,8 +339,9 @@ MsgHeartBeat::~MsgHeartBeat()
 
 void MsgHeartBeat::Serialize(Packet * pkt)
 {
-    Message::Serialize(pkt);
-    range.Serialize(pkt);
+    PacketWriter w(pkt, HEADER_LENGTH);
+    SerializeHeader(w);
+    range.Serialize(w);
 }
 
 uint32 MsgHeartBeat::GetLength()
@@ -631,18 +663,51 @@ void MsgBootstrapResponse::Print(ostream& os)
     os << "]";
 }
 
+///////////////////////////////////////////////////////////////////////
+// MSG_PUB and MSG_SUB 
+//
+// Every hop on the way to the rendezvous only needs the constraint it
+// routes on, so pubs and subs carry a copy of it up front, followed by 
+// the length of the event (interest). A forwarding hop decodes just 
+// that, and sends the event's bytes on as they came in.
+
+static void _SerializeRouteConstraint(PacketWriter& w, Constraint *cst)
+{
+    w.Reserve(1);
+    w.PutBool(cst != NULL);
+    if (cst)
+	cst->Serialize(w);
+}
+
+static uint32 _RouteConstraintLength(Constraint *cst)
+{
+    return 1 + (cst ? cst->GetLength() : 0);
+}
+
+static void _ReadRaw(PacketReader& r, Packet **raw, Constraint **cst)
+{
+    *cst = r.Need(1).GetBool() ? new Constraint(r) : NULL;
+    *raw = new Packet(r);
+}
+
 ///////////////////////////////////////////////////////////////////////
 // MSG_PUB
 MsgPublication::MsgPublication(byte hubID, IPEndPoint& sender, Event *p, IPEndPoint &cr) :
-    Message(hubID, sender), metadata(ROUTING_TO_LEFTEND), creator(cr)
+    Message(hubID, sender), metadata(ROUTING_TO_LEFTEND), creator(cr), 
+    raw(NULL), routeCst(NULL), routeHub(0)
 {
     pub = p->Clone();     // make a private copy
 }
 
 MsgPublication::MsgPublication (const MsgPublication& op) : 
-    Message (op), metadata (op.metadata), creator (op.creator)
+    Message (op), metadata (op.metadata), creator (op.creator), 
+    raw (NULL), routeCst (NULL), routeHub (op.routeHub)
 {
-    pub = op.pub->Clone ();
+    pub = op.pub ? op.pub->Clone () : NULL;
+    if (op.raw) {
+	raw = new Packet (*op.raw);
+	routeCst = op.routeCst ? new Constraint (*op.routeCst) : NULL;
+    }
 #ifdef RECORD_ROUTE
     routeTaken = op.routeTaken;
 #endif
@@ -657,7 +722,13 @@ MsgPublication& MsgPublication::operator= (const MsgPublication& op)
     creator = op.creator;
 
     delete pub;
-    pub = op.pub->Clone ();
+    DropRaw ();
+    pub = op.pub ? op.pub->Clone () : NULL;
+    if (op.raw) {
+	raw = new Packet (*op.raw);
+	routeCst = op.routeCst ? new Constraint (*op.routeCst) : NULL;
+	routeHub = op.routeHub;
+    }
 #ifdef RECORD_ROUTE
     routeTaken = op.routeTaken;
 #endif
@@ -665,10 +736,16 @@ MsgPublication& MsgPublication::operator= (const MsgPublication& op)
 }
 
 MsgPublication::MsgPublication(Packet * pkt)
-    : Message(pkt), creator(pkt)
+    : Message(pkt), pub(NULL)
 {
-    metadata = pkt->ReadByte();	
-    pub = CreateObject<Event>(pkt);
+    {
+	PacketReader r(pkt);
+	r.Need(IPEndPoint::WIRE_LENGTH + 1);
+	creator = IPEndPoint(r);
+	metadata = r.GetByte();	
+	_ReadRaw(r, &raw, &routeCst);
+    }
+    routeHub = hubID;
 
 #ifdef RECORD_ROUTE
     int routeLen = pkt->ReadInt();
@@ -682,15 +759,62 @@ MsgPublication::MsgPublication(Packet * pkt)
 
 MsgPublication::~MsgPublication()
 {
-    delete pub;
+    RecycleObject<Event> (pub);
+    DropRaw();
+}
+
+void MsgPublication::DropRaw()
+{
+    delete raw;
+    delete routeCst;
+    raw = NULL;
+    routeCst = NULL;
+}
+
+void MsgPublication::DecodeEvent()
+{
+    ASSERT(raw != NULL);
+
+    raw->ResetBufPosition();
+    pub = CreateObject<Event>(raw);
+    DropRaw();
+}
+
+Constraint *MsgPublication::GetRouteConstraint()
+{
+    if (raw && hubID == routeHub)
+	return routeCst;
+    return GetEvent()->GetConstraintByAttr(hubID);
+}
+
+uint32 MsgPublication::GetEventOffset()
+{
+    return Message::GetLength() + creator.GetLength() + 1 + 
+	_RouteConstraintLength(GetRouteConstraint()) + 4;
 }
 
 void MsgPublication::Serialize(Packet * pkt)
 {
-    Message::Serialize(pkt);
-    creator.Serialize(pkt);
-    pkt->WriteByte(metadata);
-    pub->Serialize(pkt);
+    int pos = -1;
+    {
+	PacketWriter w(pkt, HEADER_LENGTH + IPEndPoint::WIRE_LENGTH + 1);
+	SerializeHeader(w);
+	creator.Serialize(w);
+	w.PutByte(metadata);
+	_SerializeRouteConstraint(w, GetRouteConstraint());
+	if (raw)
+	    raw->Serialize(w);
+	else {
+	    // length first, filled in once we know it
+	    w.Reserve(4);
+	    pos = w.GetBufPosition();
+	    w.PutInt(0);
+	}
+    }
+    if (!raw) {
+	pub->Serialize(pkt);
+	pkt->PatchInt(pos, pkt->GetBufPosition() - pos - 4);
+    }
 
 #ifdef RECORD_ROUTE
     int routeLen = routeTaken.size();
@@ -704,7 +828,9 @@ void MsgPublication::Serialize(Packet * pkt)
 
 uint32 MsgPublication::GetLength()
 {
-    uint32 len = Message::GetLength() + creator.GetLength() + 1 + pub->GetLength();
+    uint32 len = Message::GetLength() + creator.GetLength() + 1 + 
+	_RouteConstraintLength(GetRouteConstraint());
+    len += raw ? raw->GetLength() : 4 + pub->GetLength();
 
 #ifdef RECORD_ROUTE
     len += 4;
@@ -722,15 +848,21 @@ void MsgPublication::Print(FILE * stream)
     Message::Print(stream);
     fprintf(stream, "pub-creator:");
     creator.Print(stream);
-    pub->Print(stream);
+    if (pub)
+	pub->Print(stream);
+    else
+	fprintf(stream, "(undecoded, %d bytes)", raw->GetUsed());
 }
 
 void MsgPublication::Print(ostream &os)
 {
     Message::Print(os);
-    os << " creator=" << creator
-       << " pub=" << pub
-       << " mode=" << (metadata & ROUTING_TO_LEFTEND ? "TOLEFT" : "LINEAR");
+    os << " creator=" << creator;
+    if (pub)
+	os << " pub=" << pub;
+    else
+	os << " pub=(undecoded route=" << routeCst << ")";
+    os << " mode=" << (metadata & ROUTING_TO_LEFTEND ? "TOLEFT" : "LINEAR");
 #ifdef RECORD_ROUTE
     os << " route=[";
     for (list<Neighbor>::iterator it = routeTaken.begin(); it != routeTaken.end(); it++)
@@ -746,16 +878,21 @@ void MsgPublication::Print(ostream &os)
 ///////////////////////////////////////////////////////////////////////
 // MSG_SUB
 MsgSubscription::MsgSubscription(byte hubID, IPEndPoint& sender, Interest *i, IPEndPoint &cr) :
-    Message(hubID, sender), creator(cr)
+    Message(hubID, sender), creator(cr), raw(NULL), routeCst(NULL), routeHub(0)
 {
     sub = i->Clone();
     metadata = ROUTING_TO_LEFTEND;
 }
 
 MsgSubscription::MsgSubscription (const MsgSubscription& op) : 
-    Message (op), metadata (op.metadata), creator (op.creator)
+    Message (op), metadata (op.metadata), creator (op.creator),
+    raw (NULL), routeCst (NULL), routeHub (op.routeHub)
 {
-    sub = op.sub->Clone ();
+    sub = op.sub ? op.sub->Clone () : NULL;
+    if (op.raw) {
+	raw = new Packet (*op.raw);
+	routeCst = op.routeCst ? new Constraint (*op.routeCst) : NULL;
+    }
 #ifdef RECORD_ROUTE
     routeTaken = op.routeTaken;
 #endif
@@ -769,16 +906,28 @@ MsgSubscription& MsgSubscription::operator= (const MsgSubscription& op)
     metadata = op.metadata;
     creator = op.creator;
     delete sub;
-    sub = op.sub->Clone ();
+    DropRaw ();
+    sub = op.sub ? op.sub->Clone () : NULL;
+    if (op.raw) {
+	raw = new Packet (*op.raw);
+	routeCst = op.routeCst ? new Constraint (*op.routeCst) : NULL;
+	routeHub = op.routeHub;
+    }
 #ifdef RECORD_ROUTE
     routeTaken = op.routeTaken;
 #endif
     return *this;
 }
-MsgSubscription::MsgSubscription(Packet * pkt): Message(pkt), creator(pkt)
+MsgSubscription::MsgSubscription(Packet * pkt): Message(pkt), sub(NULL)
 {
-    metadata = pkt->ReadByte();	
-    sub = CreateObject<Interest>(pkt);
+    {
+	PacketReader r(pkt);
+	r.Need(IPEndPoint::WIRE_LENGTH + 1);
+	creator = IPEndPoint(r);
+	metadata = r.GetByte();	
+	_ReadRaw(r, &raw, &routeCst);
+    }
+    routeHub = hubID;
 
 #ifdef RECORD_ROUTE
     int routeLen = pkt->ReadInt();
@@ -792,15 +941,56 @@ MsgSubscription::MsgSubscription(Packet * pkt): Message(pkt), creator(pkt)
 
 MsgSubscription::~MsgSubscription()
 {
-    delete sub;
+    RecycleObject<Interest> (sub);
+    DropRaw();
+}
+
+void MsgSubscription::DropRaw()
+{
+    delete raw;
+    delete routeCst;
+    raw = NULL;
+    routeCst = NULL;
+}
+
+void MsgSubscription::DecodeInterest()
+{
+    ASSERT(raw != NULL);
+
+    raw->ResetBufPosition();
+    sub = CreateObject<Interest>(raw);
+    DropRaw();
+}
+
+Constraint *MsgSubscription::GetRouteConstraint()
+{
+    if (raw && hubID == routeHub)
+	return routeCst;
+    return GetInterest()->GetConstraintByAttr(hubID);
 }
 
 void MsgSubscription::Serialize(Packet * pkt)
 {
-    Message::Serialize(pkt);
-    creator.Serialize(pkt);
-    pkt->WriteByte(metadata);
-    sub->Serialize(pkt);
+    int pos = -1;
+    {
+	PacketWriter w(pkt, HEADER_LENGTH + IPEndPoint::WIRE_LENGTH + 1);
+	SerializeHeader(w);
+	creator.Serialize(w);
+	w.PutByte(metadata);
+	_SerializeRouteConstraint(w, GetRouteConstraint());
+	if (raw)
+	    raw->Serialize(w);
+	else {
+	    // length first, filled in once we know it
+	    w.Reserve(4);
+	    pos = w.GetBufPosition();
+	    w.PutInt(0);
+	}
+    }
+    if (!raw) {
+	sub->Serialize(pkt);
+	pkt->PatchInt(pos, pkt->GetBufPosition() - pos - 4);
+    }
 
 #ifdef RECORD_ROUTE
     int routeLen = routeTaken.size();
@@ -814,9 +1004,10 @@ void MsgSubscription::Serialize(Packet * pkt)
 
 uint32 MsgSubscription::GetLength()
 {
-    /* header + creator + metadata + sub */
+    /* header + creator + metadata + route constraint + sub */
     uint32 len = Message::GetLength() + creator.GetLength() + 1 +
-	sub->GetLength();
+	_RouteConstraintLength(GetRouteConstraint());
+    len += raw ? raw->GetLength() : 4 + sub->GetLength();
 
 #ifdef RECORD_ROUTE
     len += 4;
@@ -836,15 +1027,21 @@ void MsgSubscription::Print(FILE * stream)
     creator.Print(stream);
     fprintf(stream, " unsubscribed:%s mode:%s\n", (metadata & UNSUB ? "yes" : "no"), 
 	    (metadata & ROUTING_TO_LEFTEND ? "TOLEFT" : "LINEAR"));
-    sub->Print(stream);
+    if (sub)
+	sub->Print(stream);
+    else
+	fprintf(stream, "(undecoded, %d bytes)", raw->GetUsed());
 }
 
 void MsgSubscription::Print(ostream& os)
 {
     Message::Print(os);
-    os << " creator=" << creator
-       << " sub=" << sub
-       << " unsub=" << (metadata & UNSUB ? "true" : "false")
+    os << " creator=" << creator;
+    if (sub)
+	os << " sub=" << sub;
+    else
+	os << " sub=(undecoded route=" << routeCst << ")";
+    os << " unsub=" << (metadata & UNSUB ? "true" : "false")
        << " mode=" << (metadata & ROUTING_TO_LEFTEND ? "TOLEFT" : "LINEAR");
 #ifdef RECORD_ROUTE
     os << " route=[";
@@ -987,6 +1184,67 @@ void MsgTriggerList::Print(FILE * stream) {
     fprintf(stream, "]");
 }
 
+/////////////////////////////////////////////////////////////////////////
+//// MSG_PUB_BATCH
+
+MsgPubBatch::MsgPubBatch(Packet * pkt) : Message(pkt) {
+    int nPubs = pkt->ReadInt();
+    for (int i = 0; i < nPubs; i++) {
+	pubs.push_back(new MsgPublication(pkt));
+    }
+}
+
+MsgPubBatch::MsgPubBatch (const MsgPubBatch& other) : Message (other) 
+{
+    MsgPubBatch& ooother = (MsgPubBatch &) other;
+
+    for (list<MsgPublication *>::iterator it = ooother.pubs.begin (); it != ooother.pubs.end (); ++it)
+	pubs.push_back ((*it)->Clone ());
+}
+
+MsgPubBatch::~MsgPubBatch() {
+    for (list<MsgPublication *>::iterator it = pubs.begin(); it != pubs.end(); it++)
+	delete *it;
+    pubs.clear();
+}
+
+void MsgPubBatch::Print(ostream& os) {
+    Message::Print(os);
+    os << " pubs=[";
+    for (list<MsgPublication *>::iterator i = pubs.begin();
+	 i != pubs.end(); i++) {
+	if (i != pubs.begin()) os << ",";
+	os << *i;
+    }
+    os << "]";
+}
+
+void MsgPubBatch::Serialize(Packet * pkt) {
+    Message::Serialize(pkt);
+    pkt->WriteInt(pubs.size());
+    for (list <MsgPublication *>::iterator it = pubs.begin(); it != pubs.end(); it++) {
+	(*it)->Serialize(pkt);
+    }
+}
+
+uint32 MsgPubBatch::GetLength() {
+    uint32 retval = Message::GetLength() + 4;
+    for (list <MsgPublication *>::iterator it = pubs.begin(); it != pubs.end(); it++) {
+	retval += (*it)->GetLength();
+    }
+    return retval;
+}
+
+void MsgPubBatch::Print(FILE * stream) {
+    Message::Print(stream);
+    fprintf(stream, " pubs=[");
+    for (list <MsgPublication*>::iterator it = pubs.begin(); it != pubs.end(); it++) {
+	if (it != pubs.begin()) fprintf(stream, ",");
+	(*it)->Print(stream);
+    }
+    fprintf(stream, "]");
+}
+
 //////////////////////////////////////////////////////////////////
 //// Sampling related messages
 
@@ -1363,22 +1621,32 @@ MsgCompressed::MsgCompressed(Message *msg) : Message(), orig(msg)
     hopCount  = orig->hopCount;
     hubID     = orig->hubID;
 
-    MakeCompressed();
+    Packet upkt(Packet::DEFAULT_PACKET_SIZE, true);
+    orig->Serialize(&upkt);
+    MakeCompressed(&upkt);
+}
+
+MsgCompressed::MsgCompressed(Message *msg, Packet *serialized) : Message(), orig(msg) 
+{
+    ASSERT(orig);
+    sender    = orig->sender;
+    nonce     = orig->nonce;
+    hopCount  = orig->hopCount;
+    hubID     = orig->hubID;
+
+    MakeCompressed(serialized);
 }
 
-void MsgCompressed::MakeCompressed()
+void MsgCompressed::MakeCompressed(Packet *upkt)
 {
     START(MSG_COMPRESS_OVERHEAD);
 
     ASSERT(orig);
 
-    Packet upkt(orig->GetLength());
-    orig->Serialize(&upkt);
-
-    origLen = upkt.GetMaxSize ();	
+    origLen = upkt->GetUsed ();	
     compLen = (uint32)(origLen*1.015 + 12);
     compBuf = new byte[compLen];
-    int ret = compress(compBuf, (uLongf *)&compLen, upkt.GetBuffer (), origLen);
+    int ret = compress(compBuf, (uLongf *)&compLen, upkt->GetBuffer (), origLen);
     ASSERT(ret == Z_OK);
 
     DB(5) << "orig=" << origLen << " comp=" << compLen << endl;
@@ -1440,6 +1708,55 @@ void MsgCompressed::Print(FILE * stream)
     fprintf(stream, "\n");
 }
 
+//////////////////////////////////////////////////////////////////////
+// MSG_FRAME
+
+MsgFrame::~MsgFrame()
+{
+    for (uint32 i = 0; i < parts.size(); i++)
+	delete parts[i];
+    for (uint32 i = 0; i < msgs.size(); i++)
+	delete msgs[i];
+}
+
+MsgFrame::MsgFrame(Packet * pkt) : Message()
+{
+    (void) pkt->ReadByte();     // strip off the leading byte
+
+    int n = pkt->ReadShort();
+    for (int i = 0; i < n; i++) {
+	Packet part(pkt);
+	msgs.push_back(CreateObject<Message>(&part));
+    }
+
+    if (msgs.size() > 0) {
+	sender = msgs[0]->sender;
+	hubID  = msgs[0]->hubID;
+    }
+}
+
+void MsgFrame::Serialize(Packet * pkt)
+{
+    pkt->WriteByte(GetType());
+    pkt->WriteShort(parts.size());
+    for (uint32 i = 0; i < parts.size(); i++)
+	parts[i]->Serialize(pkt);
+}
+
+uint32 MsgFrame::GetLength()
+{
+    uint32 len = GetHeaderLength();
+    for (uint32 i = 0; i < parts.size(); i++)
+	len += parts[i]->GetLength();
+    return len;
+}
+
+void MsgFrame::Print(FILE * stream)
+{
+    Message::Print(stream);
+    fprintf(stream, " parts=%d msgs=%d\n", parts.size(), msgs.size());
+}
+
 #if 0
 //////////////////////////////////////////////////////////////////////////
 // MSG_RANGE_PUB / MSG_MATCHED_RANGE_PUB
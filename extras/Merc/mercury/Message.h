@@ -42,7 +42,7 @@ class Packet;
 typedef byte MsgType;
 extern MsgType
 MSG_INVALID, 
-    MSG_HEARTBEAT, MSG_LIVENESS_PING, MSG_LIVENESS_PONG, 
+    MSG_HEARTBEAT, MSG_LIVENESS_PING, MSG_LIVENESS_PONG, MSG_LOAD_HEARTBEAT,
 
     /// Joining the ring
     MSG_JOIN_REQUEST,  MSG_JOIN_RESPONSE,  MSG_NOTIFY_SUCCESSOR,
@@ -56,6 +56,7 @@ MSG_INVALID,
 
     // Publication and subscriptions
     MSG_PUB, MSG_LINEAR_PUB, MSG_ACK, MSG_SUB, MSG_LINEAR_SUB, MSG_SUB_LIST, MSG_TRIG_LIST,
+    MSG_PUB_BATCH,
 
     // Communication with the bootstrap server
     MSG_BOOTSTRAP_REQUEST, MSG_BOOTSTRAP_RESPONSE,
@@ -76,7 +77,7 @@ MSG_INVALID,
     MSG_CB_ALL_JOINED, MSG_CB_ESTIMATE_REQ, MSG_CB_ESTIMATE_RESP,
 
     // utility
-    MSG_BLOB, MSG_COMPRESSED, MSG_PING,
+    MSG_BLOB, MSG_COMPRESSED, MSG_PING, MSG_FRAME,
 
     /// XXX: Start: These are just for logging purposes and 
     //       should NOT be used for other things -- Ashwin [10/08/2004]
@@ -90,6 +91,10 @@ MSG_INVALID,
 
 void RegisterMessageTypes();
 
+struct Message;
+// 'msg' on the wire, written in one pass; no GetLength() needed
+Packet *SerializeMessage(Message *msg);
+
 typedef Message* (*DeSerializer)(Packet *pkt);
 
 struct Message : public Serializable {
@@ -124,6 +129,17 @@ struct Message : public Serializable {
     virtual uint32 GetLength();
     virtual void Print(FILE *stream);
     virtual void Print(ostream& os);
+
+    // byte offsets at which Message::Serialize puts these; lets a 
+    // sender patch them in a message it has already serialized.
+    uint32 GetHopCountOffset() { return 1 + sender.GetLength() + (IsMercMsg() ? 1 : 0); }
+    uint32 GetNonceOffset() { return GetHopCountOffset() + 2; }
+
+    // what Message::Serialize writes, through a writer with room for 
+    // HEADER_LENGTH bytes. the hot messages (pubs, subs, pings) go on 
+    // writing the rest of themselves through the same writer.
+    static const int HEADER_LENGTH = 1 + IPEndPoint::WIRE_LENGTH + 1 + 2 + 4;
+    void SerializeHeader(PacketWriter& w);
 };
 
 ostream& operator<<(ostream& os, Message *msg);
@@ -181,13 +197,18 @@ struct MsgLivenessPing : public MsgHeartBeat {
     const bool IsLongNeighborPing () const { return peertype & PEER_LONG_NBR; }
 
     MsgLivenessPing (Packet *pkt) : MsgHeartBeat (pkt) {
-	seqno = pkt->ReadByte ();
-	peertype = pkt->ReadByte ();
+	PacketReader r (pkt);
+	r.Need (2);
+	seqno = r.GetByte ();
+	peertype = r.GetByte ();
     }
     void Serialize(Packet *pkt) { 
-	MsgHeartBeat::Serialize (pkt);
-	pkt->WriteByte (seqno);
-	pkt->WriteByte (peertype);
+	PacketWriter w (pkt, HEADER_LENGTH);
+	SerializeHeader (w);
+	GetRange ().Serialize (w);
+	w.Reserve (2);
+	w.PutByte (seqno);
+	w.PutByte (peertype);
     }
 
     uint32 GetLength() {
@@ -225,6 +246,42 @@ MsgLivenessPong (byte hubID, IPEndPoint& sender, NodeRange& r, byte seqno) : Msg
     const char *TypeString () { return "MSG_LIVENESS_PONG"; }
 };
 
+// heartbeat to the bootstrap server which also carries the routing
+// load of the sender, for the "load-aware" join placement policy. a
+// zero means "not measured yet".
+struct MsgLoadHeartBeat : public MsgHeartBeat {
+    float  load;
+    protected:
+    DECLARE_TYPE (Message, MsgLoadHeartBeat);
+    public:
+    MsgLoadHeartBeat (byte hubID, IPEndPoint& sender, NodeRange& r, float load)
+	: MsgHeartBeat (hubID, sender, r), load (load) {}
+    virtual ~MsgLoadHeartBeat () {}
+
+    MsgLoadHeartBeat (Packet *pkt) : MsgHeartBeat (pkt) {
+	load = pkt->ReadFloat ();
+    }
+    void Serialize(Packet *pkt) { 
+	MsgHeartBeat::Serialize (pkt);
+	pkt->WriteFloat (load);
+    }
+
+    uint32 GetLength() {
+	return MsgHeartBeat::GetLength () + 4;
+    }
+
+    void Print(FILE *stream) {
+	MsgHeartBeat::Print (stream);
+	fprintf (stream, " load=%.3f", load);
+    }
+
+    const char *TypeString () { return "MSG_LOAD_HEARTBEAT"; }
+    void Print (ostream& os) {
+	MsgHeartBeat::Print (os);
+	os << " load=" << load;
+    }
+};
+
 //////////////////////////////////////////////////////////////////////
 // Join-related messages
 
@@ -525,6 +582,16 @@ enum { ROUTING_TO_LEFTEND = 0x1, ROUTING_LINEARLY = 0x2};
     byte        metadata;
     Event      *pub;               // because events can be extended, and we must call Clone() on them.
     IPEndPoint  creator; 
+
+    // a received pub is not decoded until somebody asks for the event;
+    // till then, 'raw' holds its bytes and 'routeCst' the constraint 
+    // it is routed on in hub 'routeHub', which the sender put in front.
+    Packet     *raw;
+    Constraint *routeCst;
+    byte        routeHub;
+
+    void DecodeEvent();
+    void DropRaw();
     protected:
     DECLARE_TYPE(Message, MsgPublication);
     public:        
@@ -543,9 +610,19 @@ enum { ROUTING_TO_LEFTEND = 0x1, ROUTING_LINEARLY = 0x2};
     uint32  GetLength();
     void Print(FILE *stream);
 
-    Event *GetEvent() { return pub; }
+    // the caller may change the event, so the bytes it came in are 
+    // thrown away and it is serialized afresh from now on.
+    Event *GetEvent() { if (!pub) DecodeEvent(); return pub; }
+    bool IsEventDecoded() { return pub != NULL; }
     IPEndPoint &GetCreator() { return creator; }
 
+    // the constraint on the attribute of hub 'hubID', without decoding 
+    // the rest of the event if we can help it. 
+    Constraint *GetRouteConstraint();
+
+    // where the event starts in the serialized message
+    uint32 GetEventOffset();
+
     void ChangeModeToLinear() { metadata = ROUTING_LINEARLY; }
     bool IsRoutingModeLinear() { return metadata == ROUTING_LINEARLY; }
 
@@ -560,6 +637,14 @@ enum { UNSUB = 0x1, ROUTING_TO_LEFTEND = 0x2, ROUTING_LINEARLY = 0x4};
     byte        metadata;
     Interest   *sub;            // pointer, because Interests can be extended....
     IPEndPoint  creator;
+
+    // not decoded until asked for; see MsgPublication
+    Packet     *raw;
+    Constraint *routeCst;
+    byte        routeHub;
+
+    void DecodeInterest();
+    void DropRaw();
     protected:
     DECLARE_TYPE(Message, MsgSubscription);
 
@@ -582,7 +667,10 @@ enum { UNSUB = 0x1, ROUTING_TO_LEFTEND = 0x2, ROUTING_LINEARLY = 0x4};
     void Print(FILE *stream);
 
     IPEndPoint &GetCreator() { return creator; }
-    Interest   *GetInterest() { return sub; }
+    Interest   *GetInterest() { if (!sub) DecodeInterest(); return sub; }
+    bool IsInterestDecoded() { return sub != NULL; }
+
+    Constraint *GetRouteConstraint();
 
     void SetUnsubscribe() { metadata |= UNSUB; }
     void ChangeModeToLinear() { 
@@ -714,6 +802,35 @@ MsgTriggerList(byte hubID, IPEndPoint& sender) : Message(hubID, sender) {}
     void Print(ostream& os);
 };
 
+// Matched publications for one subscriber, sent by a rendezvous 
+// node which batches its deliveries (--pub-batch).
+struct MsgPubBatch : public Message {
+    private:
+list<MsgPublication *>    pubs;
+    protected:
+DECLARE_TYPE(Message, MsgPubBatch);
+
+    public:
+MsgPubBatch(byte hubID, IPEndPoint& sender) : Message(hubID, sender) {}
+    MsgPubBatch(const MsgPubBatch& m);
+    MsgPubBatch(Packet *pkt);
+
+    virtual ~MsgPubBatch();
+
+    // takes ownership of pmsg; no copy is made
+    void AddPublication(MsgPublication *pmsg) { pubs.push_back (pmsg); }
+    list<MsgPublication *>::iterator begin() { return pubs.begin(); }
+    list<MsgPublication *>::iterator end() { return pubs.end(); }
+    size_t size() { return pubs.size(); }
+
+    void  Serialize(Packet *pkt);
+    uint32 GetLength();
+    void  Print(FILE *stream);
+
+    const char *TypeString() { return "MSG_PUB_BATCH"; }
+    void Print(ostream& os);
+};
+
 struct MsgCB_AllJoined : public Message {
     DECLARE_TYPE(Message, MsgCB_AllJoined);
 
@@ -1275,9 +1392,11 @@ struct MsgCompressed : public Message {
     uint32 compLen;
 
     MsgCompressed(Message *msg);
+    // 'serialized' is 'msg' already serialized; saves doing it again
+    MsgCompressed(Message *msg, Packet *serialized);
     virtual ~MsgCompressed();
 
-    void MakeCompressed();
+    void MakeCompressed(Packet *upkt);
 
     MsgCompressed(Packet *pkt);
     void Serialize(Packet *pkt);
@@ -1287,6 +1406,32 @@ struct MsgCompressed : public Message {
     const char *TypeString() { return "MSG_COMPRESSED"; }
 };
 
+// several messages to the same peer sent as one packet (see
+// --frame-delay). like MSG_COMPRESSED, it has no header of its own.
+struct MsgFrame : public Message {
+    DECLARE_TYPE(Message, MsgFrame);
+
+    vector<Packet *>  parts;    // sending: the serialized messages
+    vector<Message *> msgs;     // received: whoever takes these out deletes them
+
+    MsgFrame() : Message() {}
+    virtual ~MsgFrame();
+
+    // takes ownership of pkt
+    void AddPacket(Packet *pkt) { parts.push_back(pkt); }
+
+    // what the frame adds to the messages in it
+    static uint32 GetHeaderLength() { return 1 + 2; }
+    static uint32 GetPartOverhead() { return 4; }
+
+    MsgFrame(Packet *pkt);
+    void Serialize(Packet *pkt);
+    uint32  GetLength();
+    void Print(FILE *stream);
+
+    const char *TypeString() { return "MSG_FRAME"; }
+};
+
 struct MsgPing : public Message {
     DECLARE_TYPE(Message, MsgPing);
 
@@ -28,6 +28,7 @@
 #include "common.h"
 
 class Message;
+class Packet;
 
 // XXX: In an ideal world, I would have liked to have an abstract 
 // EID class, and IPEndPoint would be valid only in a real 'wan' 
@@ -127,6 +128,19 @@ class NetworkLayer {
      */ 
     virtual int SendMessage(Message *msg, IPEndPoint *toWhom, TransportType proto) = 0;
 
+    /**
+     * Same as SendMessage, but 'pkt' already holds 'msg' as serialized 
+     * by msg->Serialize() (with msg->sender set to this node). Lets a 
+     * sender fanning one message out to many endpoints serialize it 
+     * only once. 'pkt' is not modified and stays owned by the caller;
+     * 'msg' comes back changed just as it would from SendMessage.
+     *
+     * The default ignores 'pkt' and serializes 'msg' again.
+     */
+    virtual int SendPacket(Message *msg, Packet *pkt, IPEndPoint *toWhom, TransportType proto) {
+	return SendMessage(msg, toWhom, proto);
+    }
+
     /**
      * Receives the next message from the network. the network allocates the 
      * message pointer for you. ref_fromWhom should be allocated by the 
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  OverwriteIndex.h
+
+  Publication overwriting (--puboverwrite): a store keeps at most one
+  trigger per object. Two events belong to the same object when neither
+  is Event::LessThan () the other; when a new trigger arrives for an 
+  object which already has one stored, Event::OverwriteEvent () decides
+  whether the new one replaces it or is dropped.
+
+  This index finds the stored trigger for an object. H is whatever the
+  store needs to get at that trigger quickly (an iterator, a record...).
+
+***************************************************************************/
+
+#ifndef __OVERWRITEINDEX__H
+#define __OVERWRITEINDEX__H
+
+#include <map>
+#include <mercury/Event.h>
+
+struct less_EventPtr {
+    bool operator() (const Event *a, const Event *b) const {
+	return a->LessThan (b);
+    }
+};
+
+template<class H>
+class OverwriteIndex {
+    typedef map<const Event *, H, less_EventPtr> EventMap;
+
+    EventMap  m_Map;
+
+ public:
+    /**
+     * If a trigger for the same object as 'ev' is indexed, set 'h'
+     * to its handle and return true.
+     **/
+    bool Find (const Event *ev, H *h) {
+	typename EventMap::iterator it = m_Map.find (ev);
+	if (it == m_Map.end ())
+	    return false;
+	*h = it->second;
+	return true;
+    }
+
+    /**
+     * 'ev' becomes the key, so it must be the stored copy's event 
+     * and stay alive until erased.
+     **/
+    void Insert (const Event *ev, H h) {
+	m_Map[ev] = h;
+    }
+
+    /**
+     * Forget 'ev'; does nothing unless 'ev' itself is the key.
+     **/
+    void Erase (const Event *ev) {
+	typename EventMap::iterator it = m_Map.find (ev);
+	if (it != m_Map.end () && it->first == ev)
+	    m_Map.erase (it);
+    }
+
+    int size () const { return m_Map.size (); }
+    void Clear () { m_Map.clear (); }
+};
+
+#endif // __OVERWRITEINDEX__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -24,15 +24,109 @@
 #include <mercury/Packet.h>
 #include <cstdlib>
 
+///////////////////////////////////////////////////////////////////////////////
+// --packet-pool: free lists of buffers, one per size class, linked
+// through the first word of each free buffer. buffers are always
+// allocated at their full class size, so one freed before the pool
+// was turned on can still go back to it.
+
+static POOL_LOCAL byte *s_FreeBuffers[Packet::POOL_CLASSES];
+static POOL_LOCAL int   s_NumFreeBuffers[Packet::POOL_CLASSES];
+
+// Packet objects themselves
+static POOL_LOCAL void *s_FreePackets;
+static POOL_LOCAL int   s_NumFreePackets;
+
+#define POOL_MAX_PACKETS 4096
+
+static inline int _SizeClass (int size)
+{
+    int k = 0;
+    while ((Packet::POOL_MIN_BUFFER << k) < size && k < Packet::POOL_CLASSES)
+	k++;
+    return k;
+}
+
+// what _AllocBuffer(size) really hands out
+static inline int _BufferCapacity (int size)
+{
+    int k = _SizeClass (size);
+    return k < Packet::POOL_CLASSES ? (Packet::POOL_MIN_BUFFER << k) : size;
+}
+
+byte *Packet::_AllocBuffer (int size)
+{
+    int k = _SizeClass (size);
+    if (k >= POOL_CLASSES)
+	return new byte[size];
+
+    byte *buf = s_FreeBuffers[k];
+    if (buf != NULL) {
+	s_FreeBuffers[k] = *(byte **) buf;
+	s_NumFreeBuffers[k]--;
+	return buf;
+    }
+    return new byte[POOL_MIN_BUFFER << k];
+}
+
+void Packet::_FreeBuffer (byte *buf, int size)
+{
+    int k = _SizeClass (size);
+    if (k >= POOL_CLASSES || !g_Preferences.packet_pool ||
+	s_NumFreeBuffers[k] >= MAX (8, POOL_CLASS_BYTES / (POOL_MIN_BUFFER << k))) {
+	delete[] buf;
+	return;
+    }
+
+    *(byte **) buf = s_FreeBuffers[k];
+    s_FreeBuffers[k] = buf;
+    s_NumFreeBuffers[k]++;
+}
+
+void *Packet::operator new (size_t size)
+{
+    if (size == sizeof (Packet) && s_FreePackets != NULL) {
+	void *ptr = s_FreePackets;
+	s_FreePackets = *(void **) ptr;
+	s_NumFreePackets--;
+	return ptr;
+    }
+    return ::operator new (size);
+}
+
+void Packet::operator delete (void *ptr, size_t size)
+{
+    if (ptr == NULL)
+	return;
+    if (size != sizeof (Packet) || !g_Preferences.packet_pool || 
+	s_NumFreePackets >= POOL_MAX_PACKETS) {
+	::operator delete (ptr);
+	return;
+    }
+
+    *(void **) ptr = s_FreePackets;
+    s_FreePackets = ptr;
+    s_NumFreePackets++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 // CHECK: do all constructors initialize everything?
-Packet::Packet():m_Size(DEFAULT_PACKET_SIZE), m_BufPosition(0), m_Used(0)
+Packet::Packet():m_Size(DEFAULT_PACKET_SIZE), m_BufPosition(0), m_Used(0), m_Growable(false)
+{
+    m_Buffer = _AllocBuffer(m_Size);
+}
+
+Packet::Packet(int size):m_Size(size), m_BufPosition(0), m_Used(0), m_Growable(false)
 {
-    m_Buffer = new byte[m_Size];
+    m_Buffer = _AllocBuffer(m_Size);
 }
 
-Packet::Packet(int size):m_Size(size), m_BufPosition(0), m_Used(0)
+// a growable packet may as well use all of the buffer it gets
+Packet::Packet(int size, bool growable):m_Size(growable ? _BufferCapacity(size) : size), 
+    m_BufPosition(0), m_Used(0), m_Growable(growable)
 {
-    m_Buffer = new byte[m_Size];
+    m_Buffer = _AllocBuffer(m_Size);
 }
 
 Packet::Packet(Packet * pkt)
@@ -40,32 +134,77 @@ Packet::Packet(Packet * pkt)
     m_Size = pkt->ReadInt();
     m_BufPosition = 0;
     m_Used = m_Size;	
-    m_Buffer = new byte[m_Size];
+    m_Growable = false;
+    m_Buffer = _AllocBuffer(m_Size);
     pkt->ReadBuffer(m_Buffer, m_Size);
 }
 
+Packet::Packet(PacketReader& r)
+{
+    m_Size = r.Need(4).GetInt();
+    m_BufPosition = 0;
+    m_Used = m_Size;
+    m_Growable = false;
+    m_Buffer = _AllocBuffer(m_Size);
+    r.Need(m_Size).GetBuffer(m_Buffer, m_Size);
+}
+
+// the copy is only as big as what has been written (a growable 
+// packet usually has room to spare)
 Packet::Packet(const Packet& pkt)
 {
-    m_Size = pkt.m_Size;
+    m_Size = pkt.m_Used;
     m_BufPosition = pkt.m_BufPosition;
-    m_Used = pkt.m_Size;	
-    m_Buffer = new byte[m_Size];
-    memcpy(m_Buffer, pkt.m_Buffer, m_Size);
+    m_Used = pkt.m_Used;	
+    m_Growable = false;
+    m_Buffer = _AllocBuffer(m_Size);
+    memcpy(m_Buffer, pkt.m_Buffer, m_Used);
 }
 
 Packet::~Packet()
 {
     if(m_Buffer != NULL)
-	delete[]m_Buffer;
+	_FreeBuffer(m_Buffer, m_Size);
     m_Buffer = NULL;
 }
 
+void Packet::_Grow(int len)
+{
+    ASSERT(m_Growable);
+
+    int size = _BufferCapacity(MAX(2 * m_Size, m_BufPosition + len));
+    byte *buf = _AllocBuffer(size);
+    memcpy(buf, m_Buffer, m_Used);
+    _FreeBuffer(m_Buffer, m_Size);
+
+    m_Buffer = buf;
+    m_Size = size;
+}
+
+void PacketWriter::_Grow(int len)
+{
+    int pos = m_Ptr - m_Pkt->m_Buffer;
+    m_Pkt->m_BufPosition = pos;
+    m_Pkt->m_Used = MAX(m_Pkt->m_Used, pos);
+    m_Pkt->_Grow(len);
+
+    m_Ptr = m_Pkt->m_Buffer + pos;
+    m_End = m_Pkt->m_Buffer + m_Pkt->m_Size;
+}
+
 void Packet::Serialize(Packet *pkt)
 {
     pkt->WriteInt(m_Used);
     pkt->WriteBuffer(m_Buffer, m_Used);
 }
 
+void Packet::Serialize(PacketWriter& w)
+{
+    w.Reserve(4 + m_Used);
+    w.PutInt(m_Used);
+    w.PutBuffer(m_Buffer, m_Used);
+}
+
 uint32 Packet::GetLength()
 {
     return 4 + m_Used;
@@ -120,7 +259,7 @@ void Packet::IncrBufPosition (int incr)
 
 void Packet::WriteBuffer(byte * buf, int len)
 {
-    ASSERT(m_BufPosition + len - 1 < m_Size);
+    _Reserve(len);
     memcpy(m_Buffer + m_BufPosition, buf, len);
     m_BufPosition += len;
     m_Used = MAX(m_Used, m_BufPosition);
@@ -135,7 +274,7 @@ void Packet::ReadBuffer(byte * buf, int len)
 
 void Packet::WriteByte(byte b)
 {
-    ASSERT(m_BufPosition < m_Size);
+    _Reserve(1);
     m_Buffer[m_BufPosition++] = b;
     m_Used = MAX(m_Used, m_BufPosition);
 }
@@ -168,7 +307,7 @@ bool Packet::ReadBool()
 
 void Packet::WriteShort(uint16 s)
 {
-    ASSERT(m_BufPosition + 1 < m_Size);
+    _Reserve(2);
     uint16 ns = htons(s);
     memcpy(m_Buffer + m_BufPosition, &ns, 2);
     m_BufPosition += 2;
@@ -187,7 +326,7 @@ uint16 Packet::ReadShort()
 
 void Packet::WriteInt(uint32 i)
 {
-    ASSERT(m_BufPosition + 3 < m_Size);
+    _Reserve(4);
     uint32 ni = htonl(i);
     memcpy(m_Buffer + m_BufPosition, &ni, 4);
     m_BufPosition += 4;
@@ -209,9 +348,31 @@ uint32 Packet::ReadInt()
 // We don't want to unnecessarily perform byte conversions on them. XXX Speaking of which,
 // the right thing to do probably is IPAddress::Serialize(). Duh!
 //
+void Packet::PatchShort(int pos, uint16 s)
+{
+    ASSERT(pos >= 0 && pos + 2 <= m_Used);
+    uint16 ns = htons(s);
+    memcpy(m_Buffer + pos, &ns, 2);
+}
+
+void Packet::PatchInt(int pos, uint32 i)
+{
+    ASSERT(pos >= 0 && pos + 4 <= m_Used);
+    uint32 ni = htonl(i);
+    memcpy(m_Buffer + pos, &ni, 4);
+}
+
+uint32 Packet::PeekInt(int pos)
+{
+    ASSERT(pos >= 0 && pos + 4 <= m_Used);
+    uint32 i;
+    memcpy(&i, m_Buffer + pos, 4);
+    return ntohl(i);
+}
+
 void Packet::WriteIntNoSwap(uint32 i)
 {
-    ASSERT(m_BufPosition + 3 < m_Size);
+    _Reserve(4);
     memcpy(m_Buffer + m_BufPosition, &i, 4);
     m_BufPosition += 4;
     m_Used = MAX(m_Used, m_BufPosition);
@@ -228,7 +389,7 @@ uint32 Packet::ReadIntNoSwap()
 
 void Packet::WriteFloat(float f)
 {
-    ASSERT(m_BufPosition + 3 < m_Size);
+    _Reserve(4);
 
     // careful! plain casting won't do because the compiler will try to be unnecessarily smart!
     union {
@@ -26,33 +26,66 @@
 #define __PACKET__H
 
 #include <mercury/common.h>
+#include <cstring>
 
 /* This class represents the "wire form" of a packet.
-   TODO: can perform a bunch of optimizations related to memory allocation, if needed.
-   For example, maintain a "buffer pool" of packets since too many packets won't be alive 
-   at any particular moment of time... */
+   Not too many packets are alive at any moment, so with --packet-pool
+   freed buffers (and Packet objects) are kept on free lists, one per
+   power-of-two size class, and handed out again by the constructors. */
+
+class PacketReader;
+class PacketWriter;
 
 class Packet  : public Serializable {
  protected:
-    Packet (void *dummy, bool junk) : m_Buffer(NULL) {}
+    Packet (void *dummy, bool junk) : m_Buffer(NULL), m_Growable(false) {}
 
     byte*  m_Buffer;
     int    m_BufPosition;  // overloaded use while writing and reading from network. Careful...
-    int    m_Size;         // max size of buffer. set at construct time.   
+    int    m_Size;         // max size of buffer. set at construct time (or when grown)
     int    m_Used;         // the total number of bytes in buffer used
+    bool   m_Growable;     // writes past m_Size grow the buffer
+
+    static byte *_AllocBuffer (int size);
+    static void  _FreeBuffer (byte *buf, int size);
+
+    // make room for 'len' more bytes at the buffer position
+    inline void _Reserve (int len) {
+	if (m_BufPosition + len > m_Size)
+	    _Grow (len);
+    }
+    void _Grow (int len);
+
+    friend class PacketWriter;
+    friend class PacketReader;
 
  public:                  
     static const int DEFAULT_PACKET_SIZE = 1400;
 
+    // size classes are 64 << k bytes; bigger buffers are not pooled
+    static const int POOL_MIN_BUFFER = 64;
+    static const int POOL_CLASSES    = 11;
+    // bytes each size class may hold on to (per thread)
+    static const int POOL_CLASS_BYTES = 512 * 1024;
+
+    static void *operator new (size_t size);
+    static void  operator delete (void *ptr, size_t size);
+
 
     Packet();         // allocate a default size buffer  
     Packet(int size); // so that we can allocate a buffer.. 
+    // a packet which grows as it is written, so a message can be 
+    // serialized without asking for its GetLength() first. 'size' is 
+    // only the starting guess.
+    Packet(int size, bool growable);
     Packet(Packet * pkt); // serializable
+    Packet(PacketReader& r);
     Packet(const Packet& other); // copy constructor
     virtual ~Packet();    
 
     // Assume serializing after packet is full and buf position is at end
     void Serialize(Packet *pkt);
+    void Serialize(PacketWriter& w);
     uint32 GetLength();
     void Print(FILE *) { ASSERT(0); }
 
@@ -100,6 +133,12 @@ class Packet  : public Serializable {
     virtual void WriteIntNoSwap(uint32 i);
     virtual uint32 ReadIntNoSwap();
 
+    // overwrite (or look at) a field written earlier at byte offset 
+    // 'pos'. the buffer position does not move.
+    void PatchShort(int pos, uint16 s);
+    void PatchInt(int pos, uint32 i);
+    uint32 PeekInt(int pos);
+
     virtual void WriteFloat(float f);
     virtual float ReadFloat();
 
@@ -116,6 +155,172 @@ class Packet  : public Serializable {
 ostream& operator<<(ostream& os, Packet& pkt);
 ostream& operator<<(ostream& os, Packet *pkt);
 
+///////////////////////////////////////////////////////////////////////////////
+// Inline wire writer and reader for the hot messages (pubs, subs,
+// pings, constraints). The Packet::Write*()/Read*() primitives are
+// virtual and each one checks and updates the buffer position; these
+// keep a cursor in a register instead, and the buffer is checked once
+// for a whole run of fixed-size fields (Reserve/Need). Components of
+// variable length (values, constraints) check their own room.
+//
+// The bytes on the wire are exactly what Packet::Write*() writes, so
+// either side may use either interface. Don't use the packet directly
+// while a writer or reader on it is alive: they hand the position back
+// when they go out of scope.
+
+// WIRE_NET fields are big-endian; WIRE_HOST ones are copied as they 
+// are (IP addresses, which are kept in network order already)
+enum WireOrder { WIRE_NET, WIRE_HOST };
+
+template<typename T, WireOrder O> struct WireField;
+
+template<WireOrder O> struct WireField<byte, O> {
+    static inline void Put (byte *p, byte v) { *p = v; }
+    static inline byte Get (const byte *p) { return *p; }
+};
+
+template<> struct WireField<uint16, WIRE_NET> {
+    static inline void Put (byte *p, uint16 v) { 
+	uint16 n = htons (v); 
+	memcpy (p, &n, 2); 
+    }
+    static inline uint16 Get (const byte *p) { 
+	uint16 n; 
+	memcpy (&n, p, 2); 
+	return ntohs (n); 
+    }
+};
+
+template<> struct WireField<uint32, WIRE_NET> {
+    static inline void Put (byte *p, uint32 v) { 
+	uint32 n = htonl (v); 
+	memcpy (p, &n, 4); 
+    }
+    static inline uint32 Get (const byte *p) { 
+	uint32 n; 
+	memcpy (&n, p, 4); 
+	return ntohl (n); 
+    }
+};
+
+template<> struct WireField<uint32, WIRE_HOST> {
+    static inline void Put (byte *p, uint32 v) { memcpy (p, &v, 4); }
+    static inline uint32 Get (const byte *p) { 
+	uint32 v; 
+	memcpy (&v, p, 4); 
+	return v; 
+    }
+};
+
+template<> struct WireField<float, WIRE_NET> {
+    static inline void Put (byte *p, float v) { 
+	uint32 i;
+	memcpy (&i, &v, 4);
+	WireField<uint32, WIRE_NET>::Put (p, i); 
+    }
+    static inline float Get (const byte *p) { 
+	uint32 i = WireField<uint32, WIRE_NET>::Get (p);
+	float v;
+	memcpy (&v, &i, 4);
+	return v; 
+    }
+};
+
+class PacketWriter {
+    Packet *m_Pkt;
+    byte   *m_Ptr;   // where the next field goes
+    byte   *m_End;   // end of the packet's buffer
+
+    void _Grow (int len);
+
+    template<WireOrder O, typename T> inline void _Put (T v) {
+	ASSERT (m_Ptr + (int) sizeof (T) <= m_End);
+	WireField<T, O>::Put (m_Ptr, v);
+	m_Ptr += sizeof (T);
+    }
+
+    PacketWriter (const PacketWriter& other);
+    PacketWriter& operator= (const PacketWriter& other);
+ public:
+    PacketWriter (Packet *pkt) : m_Pkt (pkt), 
+	m_Ptr (pkt->m_Buffer + pkt->m_BufPosition), 
+	m_End (pkt->m_Buffer + pkt->m_Size) {}
+    PacketWriter (Packet *pkt, int len) : m_Pkt (pkt), 
+	m_Ptr (pkt->m_Buffer + pkt->m_BufPosition), 
+	m_End (pkt->m_Buffer + pkt->m_Size) { Reserve (len); }
+    ~PacketWriter () {
+	m_Pkt->m_BufPosition = m_Ptr - m_Pkt->m_Buffer;
+	m_Pkt->m_Used = MAX (m_Pkt->m_Used, m_Pkt->m_BufPosition);
+    }
+
+    // make sure there is room for 'len' more bytes
+    inline void Reserve (int len) {
+	if (m_Ptr + len > m_End)
+	    _Grow (len);
+    }
+
+    int GetBufPosition () const { return m_Ptr - m_Pkt->m_Buffer; }
+
+    void PutByte (byte b) { _Put<WIRE_NET> (b); }
+    void PutBool (bool b) { _Put<WIRE_NET> ((byte) (b ? 0x1 : 0x0)); }
+    void PutShort (uint16 s) { _Put<WIRE_NET> (s); }
+    void PutInt (uint32 i) { _Put<WIRE_NET> (i); }
+    void PutIntNoSwap (uint32 i) { _Put<WIRE_HOST> (i); }
+    void PutFloat (float f) { _Put<WIRE_NET> (f); }
+    void PutBuffer (const byte *buf, int len) {
+	ASSERT (m_Ptr + len <= m_End);
+	memcpy (m_Ptr, buf, len);
+	m_Ptr += len;
+    }
+
+    // overwrite an int written earlier at byte offset 'pos'
+    void PatchInt (int pos, uint32 i) {
+	WireField<uint32, WIRE_NET>::Put (m_Pkt->m_Buffer + pos, i);
+    }
+};
+
+class PacketReader {
+    Packet     *m_Pkt;
+    const byte *m_Ptr;   // the next field
+    const byte *m_End;   // end of the packet's buffer
+
+    template<WireOrder O, typename T> inline T _Get () {
+	ASSERT (m_Ptr + (int) sizeof (T) <= m_End);
+	T v = WireField<T, O>::Get (m_Ptr);
+	m_Ptr += sizeof (T);
+	return v;
+    }
+
+    PacketReader (const PacketReader& other);
+    PacketReader& operator= (const PacketReader& other);
+ public:
+    PacketReader (Packet *pkt) : m_Pkt (pkt), 
+	m_Ptr (pkt->m_Buffer + pkt->m_BufPosition), 
+	m_End (pkt->m_Buffer + pkt->m_Size) {}
+    ~PacketReader () { m_Pkt->m_BufPosition = m_Ptr - m_Pkt->m_Buffer; }
+
+    // the next 'len' bytes must be in the packet. as with 
+    // Packet::Read*(), a short packet is only caught by assertions.
+    inline PacketReader& Need (int len) {
+	ASSERT (m_Ptr + len <= m_End);
+	return *this;
+    }
+
+    int GetBufPosition () const { return m_Ptr - m_Pkt->m_Buffer; }
+
+    byte GetByte () { return _Get<WIRE_NET, byte> (); }
+    bool GetBool () { return _Get<WIRE_NET, byte> () != 0x0; }
+    uint16 GetShort () { return _Get<WIRE_NET, uint16> (); }
+    uint32 GetInt () { return _Get<WIRE_NET, uint32> (); }
+    uint32 GetIntNoSwap () { return _Get<WIRE_HOST, uint32> (); }
+    float GetFloat () { return _Get<WIRE_NET, float> (); }
+    void GetBuffer (byte *buf, int len) {
+	ASSERT (m_Ptr + len <= m_End);
+	memcpy (buf, m_Ptr, len);
+	m_Ptr += len;
+    }
+};
+
 #endif // __PACKET__H
 // vim: set sw=4 sts=4 ts=8 noet: 
 // Local Variables:
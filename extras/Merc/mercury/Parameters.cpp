@@ -27,6 +27,7 @@ namespace Parameters {
     int MaxBootstrapRequestAttempts      = 20; 
 
     int BootstrapRequestTimeout          = 1000;                 // period to wait before being upset about the bootstrap server
+    int PlaceProbeTimeout                = 1000;                // how long a joiner waits for pongs from the ring positions offered
     int JoinRequestTimeout               = 2000;                // period to wait before being upset about a successor
     int TCPFailureTimeout                = 10000;               // if message hasn't gone for this much time, it is lost!    
     int SuccessorMaintenanceTimeout      = 1000;                 // time to wait before checking on the successor
@@ -56,6 +57,7 @@ namespace Parameters {
     int LeaveJoinResponseTimeout         = 60000;               // how much to wait for a "response" to leave-join request
 
     int KickOldPeersTimeout              = 60000;               // keep them around for a while; you can use old peers for some time...
+    int CacheEntryTimeout                = 30000;               // send straight to a cached node only this long after its last ack
 
     TransportType TransportProto         = PROTO_UDP;           // transport protocol to use for mercury
     int NSuccessorsToKeep                = 10;                  // ideal for <= 2^10 = 1K nodes
@@ -75,6 +77,7 @@ void ScaleMercuryParameters (float factor)
 #define scale_by_factor(var)  var = (int) (var * factor);
 
     scale_by_factor (BootstrapRequestTimeout);                            
+    scale_by_factor (PlaceProbeTimeout);
     scale_by_factor (JoinRequestTimeout);                                 
 
     // scale_by_factor (XXX);  ideally this should not need to be scaled 
@@ -100,6 +103,7 @@ void ScaleMercuryParameters (float factor)
     scale_by_factor (LeaveJoinResponseTimeout);
 
     scale_by_factor (KickOldPeersTimeout);                              
+    scale_by_factor (CacheEntryTimeout);
 #undef scale_by_factor
 }
 
@@ -120,6 +124,7 @@ void PrintMercuryParameters ()
     fprintf (stderr, "\tMaxBootstrapRequestAttempts=%d\n", MaxBootstrapRequestAttempts);       
 
     fprintf (stderr, "\tBootstrapRequestTimeout=%d\n", BootstrapRequestTimeout);                           
+    fprintf (stderr, "\tPlaceProbeTimeout=%d\n", PlaceProbeTimeout);
     fprintf (stderr, "\tJoinRequestTimeout=%d\n", JoinRequestTimeout);                                
     fprintf (stderr, "\tTCPFailureTimeout=%d\n", TCPFailureTimeout);                                
     fprintf (stderr, "\tSuccessorMaintenanceTimeout=%d\n", SuccessorMaintenanceTimeout);                       
@@ -141,6 +146,7 @@ void PrintMercuryParameters ()
     fprintf (stderr, "\tLeaveJoinResponseTimeout=%d\n", LeaveJoinResponseTimeout);                                
 
     fprintf (stderr, "\tKickOldPeersTimeout=%d\n", KickOldPeersTimeout);                             
+    fprintf (stderr, "\tCacheEntryTimeout=%d\n", CacheEntryTimeout);
 
     fprintf (stderr, "\tTransportProto=%s\n", PROTO_UDP ? "PROTO_UDP" : "OTHER");
     fprintf (stderr, "\tNSuccessorsToKeep=%d\n", NSuccessorsToKeep);                         
@@ -161,6 +167,7 @@ typedef struct {
 static Param params[] = {
     P(OPT_INT, MaxJoinAttempts),
     P(OPT_INT, BootstrapRequestTimeout),
+    P(OPT_INT, PlaceProbeTimeout),
     P(OPT_INT, JoinRequestTimeout),
 
     P(OPT_INT, PeerPingInterval),
@@ -172,6 +179,7 @@ static Param params[] = {
 
     P(OPT_INT, BootstrapSamplingInterval),
     P(OPT_INT, KickOldPeersTimeout),
+    P(OPT_INT, CacheEntryTimeout),
 
     P(OPT_INT, SuccessorMaintenanceTimeout),
     P(OPT_INT, LocalSamplingInterval),
@@ -43,6 +43,7 @@ copyright       : (C) 2004 Ashwin R. Bharambe ( ashu@cs.cmu.edu   )
     extern int MaxJoinAttempts                  ; 
     extern int MaxBootstrapRequestAttempts      ; 
     extern int BootstrapRequestTimeout          ;               // period to wait before being upset about the bootstrap server
+    extern int PlaceProbeTimeout                ;               // how long a joiner waits for pongs from the ring positions offered
     extern int JoinRequestTimeout               ;               // period to wait before being upset about a successor
     extern int TCPFailureTimeout                ;               // if message hasn't gone for this much time, it is lost!
 
@@ -66,6 +67,7 @@ copyright       : (C) 2004 Ashwin R. Bharambe ( ashu@cs.cmu.edu   )
     extern int LeaveJoinResponseTimeout         ;               // how much to wait for a "response" to leave-join request
 
     extern int KickOldPeersTimeout              ;               // keep them around for a while; you can use old peers for some time...
+    extern int CacheEntryTimeout                ;               // send straight to a cached node only this long after its last ack
 
     extern TransportType TransportProto         ;               // transport protocol to use for mercury
     extern int NSuccessorsToKeep                ;               // number of successors to maintain in the successor list
@@ -26,10 +26,12 @@
 #include <mercury/Constraint.h>
 #include <mercury/MercuryNode.h>
 #include <mercury/Hub.h>
+#include <mercury/RoutingTable.h>
 #include <mercury/Parameters.h>
 
 #define PING_CACHE_SIZE 10             // maintain info about last <k> pings when matching pongs
 #define RTT_SAMPLES     20             // maintain past <k> RTT samples
+#define RTT_GAIN        0.125          // weight of a new sample in m_SRTT
 
 // I would ideally like to not explicitly get rid of this 'const' thing
 // as I have done here, but this just escalates to const's not being
@@ -44,7 +46,7 @@
 
 Peer::Peer (const IPEndPoint &address,  const NodeRange &range, const MercuryNode *node, const Hub *h):
     m_Address(address), m_Range(range), m_MercuryNode ((MercuryNode *) node), m_Hub ((Hub *) h), m_Seqno (1),
-    m_PeerType (PEER_NONE)
+    m_PeerType (PEER_NONE), m_RoutingTable (NULL), m_SRTT (0)
 {
     m_LastMsgTime = m_LastSuccessorPingReceived = m_LastLongNeighborPingReceived = m_MercuryNode->GetScheduler ()->TimeNow ();
     memset (&m_LastPingSent, 0, sizeof (TimeVal));
@@ -54,6 +56,8 @@ Peer::~Peer() {}
 
 void Peer::SetRange(const NodeRange &range) {
     m_Range = NodeRange(range);
+    if (m_RoutingTable)
+	m_RoutingTable->Update (this);
 }
 
 u_long Peer::GetRTTEstimate ()
@@ -174,7 +178,7 @@ void Peer::HandleLivenessPong (MsgLivenessPong *pong)
     byte seqno = pong->GetSeqno ();
 
     m_LastMsgTime = m_MercuryNode->GetScheduler ()->TimeNow ();
-    m_Range = pong->GetRange ();
+    SetRange (pong->GetRange ());
 
     MTDB (-10) << " got pong from " << m_Address << " for hub " << (int) pong->hubID << endl;
 
@@ -201,6 +205,11 @@ void Peer::UpdateRTTEstimate (MsgLivenessPong *pong)
 	    m_RTTSamples.pop_front ();
 	m_RTTSamples.push_back (rtt_millis);
 
+	if (m_RTTSamples.size () == 1)
+	    m_SRTT = rtt_millis;
+	else
+	    m_SRTT += RTT_GAIN * ((double) rtt_millis - m_SRTT);
+
 	// dont continue any further
 	m_SentPings.erase (it);
 	return;
@@ -56,6 +56,7 @@ copyright      : (C) 2002-2003 Ashwin R. Bharambe ( ashu@cs.cmu.edu   )
 struct MsgLivenessPong;
 class MercuryNode;
 class Hub;
+class RoutingTable;
 
 struct PingInfo {
     TimeVal time;
@@ -80,9 +81,11 @@ class Peer {
     Hub           *m_Hub;
 
     list<uint32>   m_RTTSamples;
+    double         m_SRTT;                    // moving average of the samples, TCP style
     PingInfoList   m_SentPings;
     byte           m_Seqno; 
     byte           m_PeerType;
+    RoutingTable  *m_RoutingTable;            // the table we are in, if any
  public:        
     Peer (const IPEndPoint &address, const NodeRange &range, const MercuryNode *node, const Hub *hub);
     // default copy-constructs fine...
@@ -104,6 +107,7 @@ class Peer {
 
     const NodeRange& GetRange() const { return m_Range; }
     void SetRange (const NodeRange &range);
+    void SetRoutingTable (RoutingTable *t) { m_RoutingTable = t; }
 
     TimeVal GetLastMsgTime () const { return m_LastMsgTime; }
     TimeVal GetLastPingTime () const { return m_LastPingSent; }
@@ -124,6 +128,8 @@ class Peer {
     void Print(FILE *stream);
 
     u_long GetRTTEstimate ();
+    bool HasRTTEstimate () const { return !m_RTTSamples.empty (); }
+    double GetSmoothedRTT () const { return m_SRTT; }
  private:
     void UpdateRTTEstimate (MsgLivenessPong *pong);
     bool IsFartherSuccessor ();
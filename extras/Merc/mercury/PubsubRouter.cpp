@@ -29,11 +29,14 @@
 #include <mercury/Interest.h>
 #include <mercury/Event.h>
 #include <mercury/Message.h>
+#include <mercury/Packet.h>
 #include <mercury/Parameters.h>
 #include <mercury/LinkMaintainer.h>
 #include <mercury/ObjectLogs.h>      // XXX
 #include <mercury/RoutingLogs.h>
 #include <mercury/Application.h>
+#include <mercury/PubsubStore.h>
+#include <mercury/HubWorker.h>
 #include <mercury/LoadBalancer.h>
 #include <mercury/Scheduler.h>
 #include <mercury/MercuryNode.h>
@@ -45,76 +48,6 @@
 
 const uint32 NUM_LOAD_WINDOWS = 30;      // each window is worth `Parameters::LoadAggregationInterval' milliseconds
 
-// A default, very simple publication, subscription
-// store.
-
-class MercPubsubStore : public PubsubStore {
-public:
-    typedef list<MsgPublication *> PubMsgLst;
-    typedef PubMsgLst::iterator    PubMsgLstIter;
-
-    typedef list<Interest *> IntLst;
-    typedef IntLst::iterator IntLstIter;
-private:
-    PubMsgLst            m_TriggerList;
-    IntLst               m_SubList;
-
-public:
-    MercPubsubStore () {}
-    virtual ~MercPubsubStore () {}
-
-    void StoreTrigger (MsgPublication *pmsg) { m_TriggerList.push_back (pmsg->Clone ()); }
-    void StoreSub (Interest *in) { m_SubList.push_back (in->Clone ()); }
-
-    void DeleteTriggers (callback<bool, MsgPublication *>::ref delpred) {
-	for (PubMsgLstIter it = m_TriggerList.begin (); it != m_TriggerList.end (); /* ++it */) {
-	    if (delpred (*it)) {
-		delete *it;
-		it = m_TriggerList.erase (it);
-	    }
-	    else {
-		++it;
-	    }
-	}
-    }
-    void DeleteSubs (callback<bool, Interest *>::ref delpred) {
-	for (IntLstIter it = m_SubList.begin (); it != m_SubList.end (); /* ++it */)
-	{
-	    if (delpred (*it)) {
-		delete *it;
-		it = m_SubList.erase (it);
-	    }
-	    else {
-		++it;
-	    }
-	}			
-    }
-
-    void GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch) {
-	Event *pub = pmsg->GetEvent ();
-	for (IntLstIter it = m_SubList.begin (); it != m_SubList.end (); ++it) {
-	    if ((*it)->Overlaps (pub))
-		pmatch->push_back (*it);
-	}
-    }
-
-    void GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch) {
-	for (PubMsgLstIter it = m_TriggerList.begin (); it != m_TriggerList.end (); ++it) {
-	    Event *pub = (*it)->GetEvent ();
-	    if (in->Overlaps (pub))
-		pmatch->push_back (*it);
-	}		
-    }
-
-    void Clear () {
-	DeleteSubs (wrap (this, &MercPubsubStore::delsub_pred));
-	DeleteTriggers (wrap (this, &MercPubsubStore::deltrigger_pred));
-    }
-private:
-    bool delsub_pred (Interest *i) { return true; }
-    bool deltrigger_pred (MsgPublication *pmsg) { return true; }
-};
-
 extern ofstream g_MercEventsLog;
 static void DoMeasurementLog(Message *msg, MemberHub *hub, IPEndPoint *from);
 
@@ -129,29 +62,29 @@ public:
     }
 };
 
+// Fires once the current receive cycle is done (a zero timeout runs
+// after the messages already being processed).
+class FlushPubBatch : public Timer {
+    PubsubRouter *m_PR;
+public:
+    FlushPubBatch (PubsubRouter *pr) : Timer (0), m_PR (pr) {} 
+    void OnTimeout () {
+	m_PR->m_FlushPubBatchTimer = NULL;
+	m_PR->DeliverPendingPubs ();
+    }
+};
+
 namespace PS_RTR {
     static const int EXPIRY_TIMEOUT = 1000;
 
     class ExpiryTimer : public Timer {
-	PubsubStore *store;
-	Scheduler *sched;
+	PubsubRouter *router;
     public:
-	ExpiryTimer (Scheduler *sched, PubsubStore *store) : Timer (0), sched (sched), store (store)
+	ExpiryTimer (PubsubRouter *router) : Timer (0), router (router)
 	    {}
 
-	bool expiretrigger_predicate (MsgPublication *pmsg) {
-	    Event *ev = pmsg->GetEvent();
-	    return (ev->GetDeathTime() < sched->TimeNow ());
-	}
-
-	bool expiresub_predicate (Interest *i) {
-	    return (i->GetDeathTime () < sched->TimeNow ());
-	}
-
 	void OnTimeout () {
-	    store->DeleteTriggers (wrap (this, &ExpiryTimer::expiretrigger_predicate));
-	    store->DeleteSubs (wrap (this, &ExpiryTimer::expiresub_predicate));
-
+	    router->ExpireData ();
 	    _RescheduleTimer (EXPIRY_TIMEOUT);
 	}
     };
@@ -159,8 +92,8 @@ namespace PS_RTR {
 
 PubsubRouter::PubsubRouter(MemberHub *hub, BufferManager *bm, LinkMaintainer *lm) 
     : m_Hub(hub), m_BufferManager(bm), m_LinkMaintainer(lm), m_RoutedPubs (0), 
-      m_RoutedSubs (0), m_RoutingLoad (0), m_LastHop (SID_NONE),
-      m_StopRangeChangeTimer (NULL), m_WindowIndexAtChange (0), m_RangeRatioAtChange (1.0)
+      m_Worker (NULL), m_StoreAccesses (0), m_RoutedSubs (0), m_MergedSubs (0), m_ReplacedSubs (0), m_RoutingLoad (0), m_LastHop (SID_NONE),
+      m_StopRangeChangeTimer (NULL), m_FlushPubBatchTimer (NULL), m_WindowIndexAtChange (0), m_RangeRatioAtChange (1.0)
 {
     m_MercuryNode = m_Hub->GetMercuryNode ();
     m_Network = m_Hub->GetNetwork();
@@ -170,7 +103,17 @@ PubsubRouter::PubsubRouter(MemberHub *hub, BufferManager *bm, LinkMaintainer *lm
 
     m_Store = m_MercuryNode->GetApplication ()->GetPubsubStore (m_Hub->GetID ());
     if (!m_Store)
-	m_Store = new MercPubsubStore ();
+	m_Store = CreatePubsubStore (m_Hub->GetID ());
+
+    // threads would make the simulator non-deterministic
+    if (g_Preferences.hub_threads && g_Preferences.pub_batch == 0 && !m_MercuryNode->IsSimulating ()) {
+	m_Worker = new HubWorker (m_Store);
+	if (m_Worker->Start () != 0) {
+	    WARN << "could not start matching thread for hub " << m_Hub->GetName () << endl;
+	    delete m_Worker;
+	    m_Worker = NULL;
+	}
+    }
 
     MsgType msgs[] = { MSG_PUB, MSG_SUB, MSG_LINEAR_PUB, MSG_LINEAR_SUB, MSG_SUB_LIST, MSG_TRIG_LIST };
 
@@ -179,15 +122,25 @@ PubsubRouter::PubsubRouter(MemberHub *hub, BufferManager *bm, LinkMaintainer *lm
 
     if (g_Preferences.loadbal_routeload)
 	m_Scheduler->RaiseEvent (new refcounted<CountResetter> (this), m_Address, Parameters::LoadAggregationInterval);
-    m_Scheduler->RaiseEvent (new refcounted<PS_RTR::ExpiryTimer> (m_Scheduler, m_Store), m_Address, PS_RTR::EXPIRY_TIMEOUT);
+    m_Scheduler->RaiseEvent (new refcounted<PS_RTR::ExpiryTimer> (this), m_Address, PS_RTR::EXPIRY_TIMEOUT);
 }
 
 PubsubRouter::~PubsubRouter() {
+    if (m_FlushPubBatchTimer != NULL)
+	m_FlushPubBatchTimer->Cancel ();
+    for (uint32 i = 0; i < m_PendingPubs.size (); i++)
+	delete m_PendingPubs[i].pmsg;
+    if (m_Worker) {
+	m_Worker->Shutdown ();
+	delete m_Worker;
+    }
     delete m_Store;
 }
 
 void PubsubRouter::ClearData () 
 {
+    DeliverPendingPubs ();
+    StoreAccess access (this);
     m_Store->Clear ();
     m_LoadWindows.clear ();
 }
@@ -278,8 +231,9 @@ void PubsubRouter::NewLoadWindow ()
 	index++;
     }
 
-    // log 
-    double avg = m_Hub->GetLoadBalancer ()->GetAverageLoad ();
+    // log (without --load-balance, the load is only measured for the
+    // bootstrap's "load-aware" join placement)
+    double avg = m_Hub->GetLoadBalancer () ? m_Hub->GetLoadBalancer ()->GetAverageLoad () : 0.0;
     if (avg < LoadBalancer::EPSILON)
 	avg = 0.0;
     LoadBalEntry ent (LoadBalEntry::LOADREP, (float) m_RoutingLoad, (float) avg);
@@ -337,9 +291,10 @@ void PubsubRouter::ProcessMessage(IPEndPoint *from, Message *msg)
 #endif
 
     if (t == MSG_PUB) {
-	Event *evt = ((MsgPublication *) msg)->GetEvent();
+	MsgPublication *pmsg = (MsgPublication *) msg;
 
-	ASSERT (!evt->IsMatched ());
+	// matched pubs go to hub 0xff; dont decode the event just to check
+	ASSERT (!pmsg->IsEventDecoded () || !pmsg->GetEvent ()->IsMatched ());
 
 	m_RoutedPubs++;
 	RouteData(from, msg);
@@ -432,6 +387,8 @@ bool PubsubRouter::CheckAppRoute (Message *msg)
     int proceed = 1;
 
     Application *app = m_MercuryNode->GetApplication ();
+    if (!app->InspectsRoutedData ())
+	return true;
 
     if (t == MSG_SUB)
 	proceed = app->InterestRoute (SUB_TO_IN (msg), m_LastHop);
@@ -451,13 +408,106 @@ static void _SetStopVal (Message *msg, const Value &v)
 	((MsgLinearPublication *) msg)->SetStopVal (v);
 }
 
+// GetCoveringPeers lists peers in absolute order, but a constraint
+// which wraps past absmax wants the ones after its min first. Order
+// them by how far clockwise of the constraint's min their ranges start
+// (0 for the one holding the min); 'offsets' gets those distances.
+
+struct _RingSlot {
+    Value off;
+    Peer *peer;
+
+    bool operator< (const _RingSlot& o) const { return off < o.off; }
+};
+
+static void _RingOrder (Constraint *cst, vector<Peer *> *eligible, vector<Value> *offsets,
+			const Value& absmin, const Value& absmax)
+{
+    vector<_RingSlot> slots (eligible->size ());
+    for (int i = 0, n = eligible->size (); i < n; i++) {
+	const NodeRange& r = (*eligible)[i]->GetRange ();
+	slots[i].peer = (*eligible)[i];
+	slots[i].off = Value (0);
+	if (IsBetweenLeftInclusive (cst->GetMin (), r.GetMin (), r.GetMax ()))
+	    continue;
+
+	slots[i].off = r.GetMin ();
+	if (r.GetMin () >= cst->GetMin ())
+	    slots[i].off -= cst->GetMin ();
+	else {
+	    slots[i].off += absmax;
+	    slots[i].off -= cst->GetMin ();
+	    slots[i].off -= absmin;
+	}
+    }
+    stable_sort (slots.begin (), slots.end ());
+
+    offsets->resize (slots.size ());
+    for (int i = 0, n = slots.size (); i < n; i++) {
+	(*eligible)[i] = slots[i].peer;
+	(*offsets)[i] = slots[i].off;
+    }
+}
+
+// Every peer we fan out to gets the slice of the range up to the next
+// one, and fans that out in turn (see HandleLinearPublication), so the
+// fanout is a tree. Which peers we happen to know decides its shape:
+// the successors get tiny slices, the farthest long pointer most of
+// the range. With --fanout-degree, keep at most 'degree' of the
+// covering peers, the ones nearest to splitting the range evenly; each
+// node then hands on about 1/degree of what it got, and a range over m
+// nodes is done in about log_degree (m) levels. The first peer always
+// stays, since nobody else covers the part right after us. 'eligible'
+// is in ring order from the constraint's min, 'offsets' how far along
+// each one starts and 'span' the constraint's length (see _RingOrder).
+
+static void _PickFanoutPeers (const Value& span, vector<Peer *> *eligible, 
+			      const vector<Value>& offsets, int degree)
+{
+    int n = eligible->size ();
+    if (degree <= 0 || n <= degree)
+	return;
+
+    Value step = span;
+    step /= (u_long) degree;
+
+    vector<Peer *> picked;
+    picked.push_back ((*eligible)[0]);
+
+    Value target = Value (0);
+    int i = 1;
+    for (int j = 1; j < degree && i < n; j++) {
+	target += step;
+
+	// the last peer starting at or before 'target', or the one
+	// after it if that is closer
+	while (i + 1 < n && offsets[i + 1] <= target)
+	    i++;
+	if (i + 1 < n && offsets[i] < target) {
+	    Value before = target;
+	    before -= offsets[i];
+	    Value after = offsets[i + 1];
+	    after -= target;
+	    if (after < before)
+		i++;
+	}
+	picked.push_back ((*eligible)[i]);
+	i++;
+    }
+    *eligible = picked;
+}
+
 void PubsubRouter::DoFanout (Constraint *newcst, Message *msg)
 {
     if (!CheckAppLinear (msg))
 	return;
 
     vector<Peer *> eligible;
+    vector<Value> offsets;
     m_Hub->GetCoveringPeers (newcst, &eligible);
+    _RingOrder (newcst, &eligible, &offsets, m_Hub->GetAbsMin (), m_Hub->GetAbsMax ());
+    _PickFanoutPeers (newcst->GetSpan (m_Hub->GetAbsMin (), m_Hub->GetAbsMax ()), 
+		      &eligible, offsets, g_Preferences.fanout_degree);
 
     for (int i = 0, len = eligible.size (); i < len; i++) {
 	if (i == len - 1) 
@@ -563,19 +613,27 @@ void PubsubRouter::HandlePubAtRendezvous(IPEndPoint *from, MsgPublication *pmsg,
     }
     ///// MEASUREMENT
 
-    if (app_action == EV_MATCH || app_action == EV_MATCH_AND_STORE) {
-	DeliverPubToSubscribers(pmsg, pubMatchesLeft, pubMatchesRight);
-    }
+    bool match = app_action == EV_MATCH || app_action == EV_MATCH_AND_STORE;
+    bool store = g_Preferences.enable_pubtriggers && 
+	(app_action == EV_STORE || app_action == EV_MATCH_AND_STORE);
 
-    if (g_Preferences.enable_pubtriggers) {
-	if (app_action == EV_STORE || app_action == EV_MATCH_AND_STORE) {
-	    Event *ev = pmsg->GetEvent ();
-	    DBG_DO { g_MercEventsLog << "==hub== " << m_Hub->GetName() << " storing trigger " << ev << endl; g_MercEventsLog.flush(); }
-	    DBG << " storing trigger " << ev << endl;
+    if (store) {
+	Event *ev = pmsg->GetEvent ();
+	DBG_DO { g_MercEventsLog << "==hub== " << m_Hub->GetName() << " storing trigger " << ev << endl; g_MercEventsLog.flush(); }
+	DBG << " storing trigger " << ev << endl;
 
-	    ev->SetDeathTime (m_Scheduler->TimeNow () + ev->GetLifeTime() );
-	    m_Store->StoreTrigger (pmsg);
-	}
+	ev->SetDeathTime (m_Scheduler->TimeNow () + ev->GetLifeTime() );
+    }
+
+    if (match && !SubmitToWorker (pmsg, pubMatchesLeft)) {
+	if (g_Preferences.pub_batch > 0)
+	    QueuePubForDelivery(pmsg, pubMatchesLeft);
+	else
+	    DeliverPubToSubscribers(pmsg, pubMatchesLeft, pubMatchesRight);
+    }
+    if (store) {
+	StoreAccess access (this);
+	m_Store->StoreTrigger (pmsg);
     }
     STOP(PubAtRDV::ALL);
 }
@@ -593,13 +651,13 @@ bool PubsubRouter::RouteRangeData(IPEndPoint *from, Message *msg, const IPEndPoi
     if (msg->GetType() == MSG_SUB) {
 	MsgSubscription *smsg = (MsgSubscription *) msg;
 
-	cst = (Constraint *) smsg->GetInterest()->GetConstraintByAttr (m_Hub->GetID());
+	cst = smsg->GetRouteConstraint ();
 	is_linear = smsg->IsRoutingModeLinear();
     }
     else {
 	MsgPublication *pmsg = (MsgPublication *) msg;
 
-	cst = (Constraint *) pmsg->GetEvent()->GetConstraintByAttr (m_Hub->GetID());
+	cst = pmsg->GetRouteConstraint ();
 	is_linear = pmsg->IsRoutingModeLinear();
     }
 
@@ -619,6 +677,12 @@ bool PubsubRouter::RouteRangeData(IPEndPoint *from, Message *msg, const IPEndPoi
     cst->Clamp(m_Hub->GetAbsMin(), m_Hub->GetAbsMax());
     DB_DO(20) { MDB(1) << " constraints = " << cst << endl; }
 
+    // an undecoded message owns its route constraint only until the
+    // event (interest) gets decoded, which the app callbacks and the
+    // rendezvous handlers below may do; keep our own copy.
+    Constraint route = *cst;
+    cst = &route;
+
     if (cst->GetMin() > cst->GetMax()) { 
 	DBG_DO { WARN << "Very stupid sub/rangepub -- min=(" << cst->GetMin() << ") > max=(" << cst->GetMax() << ")" << endl; }
 	return false;
@@ -701,7 +765,7 @@ bool PubsubRouter::RouteRangeData(IPEndPoint *from, Message *msg, const IPEndPoi
 	    if (!CheckAppRoute (msg))
 		return false;
 
-	    next_hop = ComputeNextHop (cst->GetMin());
+	    next_hop = ComputeNextHop (cst->GetMin(), true);
 	    STOP(PubsubRouter::ComputeNextHop);
 	}
     }
@@ -770,6 +834,8 @@ void PubsubRouter::TriggerPublications(MsgSubscription *smsg)
     // go through the list of all publications; expire the ones which need expiring
 
     list<MsgPublication *> matches;
+    if (m_Store->HasExpiryIndex ())
+	m_Store->ExpireTriggers (now);
     m_Store->GetOverlapTriggers (interest, &matches);
 
     for (list<MsgPublication *>::iterator it = matches.begin (); it != matches.end (); ++it) {
@@ -834,10 +900,19 @@ void PubsubRouter::HandleSubAtRendezvous(IPEndPoint * from,  MsgSubscription * s
     if (!sub)
 	return;
 
+    // pubs queued before this sub arrived must not see it, else it 
+    // would get them both as matches and as triggers. without triggers
+    // it does not matter if the worker's queued pubs see it or not.
+    DeliverPendingPubs ();
+    if (g_Preferences.enable_pubtriggers)
+	SyncStore ();
+
     InterestProcessType app_action = m_MercuryNode->GetApplication ()->InterestAtRendezvous (sub, m_LastHop);
     if (app_action == IN_NUKE)
 	return;
 
+    StoreAccess access (this);
+
     START(SubAtRDV::Log);
     ///// MEASUREMENT
     if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
@@ -855,7 +930,8 @@ void PubsubRouter::HandleSubAtRendezvous(IPEndPoint * from,  MsgSubscription * s
 	if (g_Preferences.use_softsubs) 
 	    sub->SetDeathTime (m_Scheduler->TimeNow () + sub->GetLifeTime ());
 
-	m_Store->StoreSub (sub);
+	if (CoverSubscription (sub))
+	    m_Store->StoreSub (sub);
     }
     STOP(SubAtRDV::Log);
 
@@ -897,7 +973,7 @@ static bool IsCloser(const Value &start, const Value &first, const Value &second
  *
  */
 
-const IPEndPoint *PubsubRouter::ComputeNextHop (const Value& val)
+const IPEndPoint *PubsubRouter::ComputeNextHop (const Value& val, bool forwarding)
 {
     DB_DO (-5) {
 	if (loopingMessage) {
@@ -927,10 +1003,15 @@ const IPEndPoint *PubsubRouter::ComputeNextHop (const Value& val)
 	// now we have two candidates; find the closer one
 	if (entry && 
 	    IsCloser(m_Hub->GetRange()->GetMin(), entry->GetRange().GetMin(), 
-		     peer->GetRange().GetMin())) 
+		     peer->GetRange().GetMin())) {
+	    m_Cache->Used (entry);
 	    return &entry->GetAddress();
+	}
     }
 
+    if (forwarding && g_Preferences.prs_slack > 0 && !loopingMessage)
+	peer = m_Hub->GetNearbyPeer (val, peer);
+
     // sending to our immediate pred is stupidity unless its range 
     // covers the value (checked above)
     Peer *pred = m_Hub->GetPredecessor ();
@@ -947,14 +1028,9 @@ const IPEndPoint *PubsubRouter::ComputeNextHop (const Value& val)
 void PubsubRouter::DeliverPubToSubscribers(MsgPublication * pmsg, 
 					   bool pubMatchesLeft, bool pubMatchesRight)
 {
-    map<SID, list<Interest *> , less_SID> matched_map;
-    Event *pub;
-    Application *app = m_MercuryNode->GetApplication ();
-
-    MemberHub *hub = m_Hub;
-    pub = pmsg->GetEvent();
-
+    SubscriberMatchList groups;
     TimeVal now = m_Scheduler->TimeNow ();
+    StoreAccess access (this);
 
     START(PubsubRouter::DeliverPubToSubscribers);
     START(PubsubRouter::DeliverPubToSubscribers::Matching);
@@ -962,11 +1038,38 @@ void PubsubRouter::DeliverPubToSubscribers(MsgPublication * pmsg,
     list<Interest *> matches;
 #ifdef PUBSUB_DEBUG
     {
-	DebugEntry ent (false, NULL, pub);
+	DebugEntry ent (false, NULL, pmsg->GetEvent());
 	LOG(DebugLog, ent);
     }
 #endif
+    if (m_Store->HasExpiryIndex ())
+	m_Store->ExpireSubs (now);
     m_Store->GetOverlapSubs (pmsg, &matches);
+    GroupMatchesBySubscriber (pmsg, pubMatchesLeft, matches, now, &groups);
+
+    STOP(PubsubRouter::DeliverPubToSubscribers::Matching);
+
+    NOTE(MATCHED_PEOPLE_COUNT, groups.size());
+
+    START(PubsubRouter::DeliverPubToSubscribers::AggregateSending);
+    // what to do about so many TCP connections?
+    FanoutMatchedPub (pmsg, groups, now);
+    STOP(PubsubRouter::DeliverPubToSubscribers::AggregateSending);
+
+    STOP(PubsubRouter::DeliverPubToSubscribers);
+}
+
+// Pick the subs in 'matches' which pmsg should really be delivered
+// to, grouped by subscriber (in the order subscribers first show up).
+void PubsubRouter::GroupMatchesBySubscriber(MsgPublication *pmsg, bool pubMatchesLeft, 
+					    list<Interest *>& matches, TimeVal& now, 
+					    SubscriberMatchList *groups)
+{
+    Event *pub = pmsg->GetEvent();
+    // the worker does not expire anything; the expiry timer does
+    bool check_expiry = m_Worker != NULL || !m_Store->HasExpiryIndex ();
+
+    m_SubscriberSlots.clear ();
 
     for (list<Interest *>::iterator it = matches.begin (); it != matches.end (); ++it) 
     {
@@ -980,8 +1083,8 @@ void PubsubRouter::DeliverPubToSubscribers(MsgPublication * pmsg,
 	    continue;
 	}
 
-	// might be expired
-	if (interest->GetDeathTime() <= now) {
+	// might be expired (unless the store already dropped those)
+	if (check_expiry && interest->GetDeathTime() <= now) {
 	    MDB (10) << "expired subscription " << interest << endl;
 	    continue;
 	}
@@ -1003,104 +1106,323 @@ void PubsubRouter::DeliverPubToSubscribers(MsgPublication * pmsg,
 	if (subMatchesLeft && pubMatchesLeft)
 	    covers = false;
 
-	if (covers) {			
-	    SID *subscriber = (SID *) &interest->GetSubscriber();
+	if (!covers) 
+	    continue;
 
-	    map<SID, list<Interest *> , less_SID>::iterator map_iter;
+	hash_map<SID, int, hash_SID, equal_SID>::iterator slot = 
+	    m_SubscriberSlots.find (interest->GetSubscriber());
+	if (slot == m_SubscriberSlots.end ()) {
+	    slot = m_SubscriberSlots.insert (make_pair (interest->GetSubscriber(), (int) groups->size ())).first;
+	    groups->push_back (SubscriberMatches ());
+	    groups->back ().subscriber = interest->GetSubscriber();
+	}
+	(*groups)[slot->second].subs.push_back(interest);
+    }
+}
 
-	    map_iter = matched_map.find(*subscriber);
+// Make the matched copy of pmsg; FillMatchedPub then makes it the
+// one for a particular subscriber. The caller owns the result.
+MsgPublication *PubsubRouter::PrepareMatchedPub(MsgPublication *pmsg)
+{
+    MsgPublication *smsg = pmsg->Clone(); 
+    smsg->GetEvent()->SetMatched();
+
+    // TOTALLY GRUESOME hack -- cross hub pubs are marked 
+    // with this hubID. sometime, i should redo this stupid
+    // MessageHandler thing. - Ashwin [03/11/2005]  
+    smsg->hubID = 0xff; 
+    return smsg;
+}
 
-	    if (map_iter == matched_map.end()) {
-		list<Interest *>  l;
-		l.push_back(interest);
-		matched_map.insert(
-		    map<SID, list<Interest *> , less_SID>::value_type(*subscriber, l));
-	    }
-	    else {
-		map_iter->second.push_back(interest);
-	    }
-	}
+// Fill in the parts of smsg (from PrepareMatchedPub) which depend on 
+// the subscriber: the nonce alias and the lifetime. Only these change
+// from one subscriber to the next (see FanoutMatchedPub).
+void PubsubRouter::FillMatchedPub(MsgPublication *smsg, MsgPublication *pmsg, const SID& subscriber, 
+				  vector<Interest *> *l, TimeVal& now)
+{
+    Application *app = m_MercuryNode->GetApplication ();
+    Event *pub = smsg->GetEvent();
+
+    ///// MEASUREMENT
+    // We have to alias both the pubs and subs here because they can
+    // be matched more than once; if we did not alias them then we might
+    // not be able to reconstruct the "tree" formed by spread of 
+    // matched pubs.
+    uint32 new_nonce = CreateNonce();
+    if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
+	DiscoveryLatEntry alias(DiscoveryLatEntry::ALIAS, 0, 
+				pmsg->GetEvent()->GetNonce(), new_nonce);
+	LOG(DiscoveryLatLog, alias);
+	pub->SetNonce(new_nonce);
     }
-    STOP(PubsubRouter::DeliverPubToSubscribers::Matching);
+    ///// MEASUREMENT
 
-    NOTE(MATCHED_PEOPLE_COUNT, matched_map.size());
+    uint32 maxSubTTLLeft = 0;
 
-    START(PubsubRouter::DeliverPubToSubscribers::AggregateSending);
-    for (map<SID, list<Interest *> , less_SID>::iterator map_iter = matched_map.begin();
-	 map_iter != matched_map.end(); 
-	 map_iter++) 
-    {
-	SID subscriber = map_iter->first;
-	list<Interest *>  *l = &(map_iter->second);
+    for (vector<Interest *>::iterator iter = l->begin(); iter != l->end(); iter++) {
+	app->EventInterestMatch (pub, *iter, subscriber);
 
-	MsgPublication *smsg = pmsg->Clone(); 
-	pub = smsg->GetEvent();
-	pub->SetMatched();
+	maxSubTTLLeft = (uint32)MAX( (sint64)maxSubTTLLeft, (*iter)->GetDeathTime() - now );
 
 	///// MEASUREMENT
-	// We have to alias both the pubs and subs here because they can
-	// be matched more than once; if we did not alias them then we might
-	// not be able to reconstruct the "tree" formed by spread of 
-	// matched pubs.
-	uint32 new_nonce = CreateNonce();
 	if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
 	    DiscoveryLatEntry alias(DiscoveryLatEntry::ALIAS, 0, 
-				    pub->GetNonce(), new_nonce);
+				    (*iter)->GetNonce(), new_nonce);
 	    LOG(DiscoveryLatLog, alias);
-	    pub->SetNonce(new_nonce);
 	}
 	///// MEASUREMENT
+    }
+    DBG_DO{ g_MercEventsLog << "sending matched publication " << pub << " ==to== " << &(subscriber) << endl; }
+    DBG_DO { g_MercEventsLog.flush(); }
+
+    // set the matched pub's lifetime to be the time remaining
+    // let this be the min of the pub's life remaining and the max
+    // time remaining of the matched subs
+    pub->SetLifeTime( MIN(pmsg->GetEvent()->GetLifeTime(), maxSubTTLLeft) );
+
+    ///// MEASUREMENT
+    if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
+	DiscoveryLatEntry ent(DiscoveryLatEntry::MATCH_SEND, 
+			      0, pub->GetNonce());
+	LOG(DiscoveryLatLog, ent);
+    }
+    ///// MEASUREMENT
 
-	uint32 maxSubTTLLeft = 0;
+#ifdef PUBSUB_DEBUG
+    {
+	DebugEntry ent (false /* is_trigger */, l->front () /* use somebody? */, pub);
+	LOG(DebugLog, ent);
+    }
+#endif
+}
 
-	for (list<Interest *>::iterator iter = l->begin(); iter != l->end(); iter++) {
-	    app->EventInterestMatch (pub, *iter, subscriber);
+// Make the copy of pmsg which goes to 'subscriber', whose matching 
+// subs are 'l'. The caller owns (and sends) the result.
+MsgPublication *PubsubRouter::MakeMatchedPub(MsgPublication *pmsg, const SID& subscriber, 
+					     vector<Interest *> *l, TimeVal& now)
+{
+    MsgPublication *smsg = PrepareMatchedPub (pmsg);
+    FillMatchedPub (smsg, pmsg, subscriber, l, now);
+    return smsg;
+}
 
-	    maxSubTTLLeft = (uint32)MAX( (sint64)maxSubTTLLeft, (*iter)->GetDeathTime() - now );
+// Send pmsg to every subscriber in 'groups'. The matched pub is 
+// serialized once; each subscriber's copy only differs in the event's 
+// lifetime and nonce, which are patched into the bytes before sending.
+void PubsubRouter::FanoutMatchedPub(MsgPublication *pmsg, SubscriberMatchList& groups, TimeVal& now)
+{
+    if (groups.size () == 0)
+	return;
 
-	    ///// MEASUREMENT
-	    if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
-		DiscoveryLatEntry alias(DiscoveryLatEntry::ALIAS, 0, 
-					(*iter)->GetNonce(), new_nonce);
-		LOG(DiscoveryLatLog, alias);
-	    }
-	    ///// MEASUREMENT
+    MsgPublication *smsg = PrepareMatchedPub (pmsg);
+    // the network layer would set this anyway; the bytes need it now.
+    smsg->sender = m_Address;
+    uint16 hopCount = smsg->hopCount;
+
+    Packet *pkt = NULL;
+    uint32 evoff = smsg->GetEventOffset ();
+    // events serialize their own fields after Event's; if the app's
+    // does not, the lifetime will not be where we think it is.
+    bool patchable = true;
+
+    for (SubscriberMatchList::iterator it = groups.begin (); it != groups.end (); ++it) {
+	FillMatchedPub (smsg, pmsg, it->subscriber, &it->subs, now);
+	Event *pub = smsg->GetEvent ();
+	smsg->hopCount = hopCount;
+
+	if (pkt == NULL) {
+	    pkt = SerializeMessage (smsg);
+	    patchable = pkt->PeekInt (evoff + Event::GetLifeTimeOffset ()) == pub->GetLifeTime ();
+	}
+	else if (patchable) {
+	    pkt->PatchInt (evoff + Event::GetLifeTimeOffset (), pub->GetLifeTime ());
+	    OBJECT_LOG_DO( pkt->PatchInt (evoff + Event::GetNonceOffset (), pub->GetNonce ()) );
+	}
+	else {
+	    delete pkt;
+	    pkt = SerializeMessage (smsg);
 	}
-	DBG_DO{ g_MercEventsLog << "sending matched publication " << pub << " ==to== " << &(subscriber) << endl; }
-	DBG_DO { g_MercEventsLog.flush(); }
 
-	// set the matched pub's lifetime to be the time remaining
-	// let this be the min of the pub's life remaining and the max
-	// time remaining of the matched subs
-	pub->SetLifeTime( MIN(pmsg->GetEvent()->GetLifeTime(), maxSubTTLLeft) );
+	m_Network->SendPacket (smsg, pkt, &it->subscriber, Parameters::TransportProto);
+    }
 
-	///// MEASUREMENT
-	if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
-	    DiscoveryLatEntry ent(DiscoveryLatEntry::MATCH_SEND, 
-				  0, pub->GetNonce());
-	    LOG(DiscoveryLatLog, ent);
+    delete pkt;
+    delete smsg;
+}
+
+// With --hub-threads, the worker matches pubs against m_Store while
+// the network thread goes on. Anything else that touches the store 
+// holds it for its scope with a StoreAccess: that waits for at most 
+// the pub being matched, and sends out what the worker has matched so
+// far, since those matches point at subs which may be about to go.
+PubsubRouter::StoreAccess::StoreAccess (PubsubRouter *pr) : m_PR (pr)
+{
+    if (!m_PR->m_Worker || m_PR->m_StoreAccesses++ > 0)
+	return;
+
+    START(PubsubRouter::StoreAccess);
+    m_PR->m_Worker->LockStore ();
+    m_PR->ReapMatches ();
+    STOP(PubsubRouter::StoreAccess);
+}
+
+PubsubRouter::StoreAccess::~StoreAccess ()
+{
+    if (m_PR->m_Worker && --m_PR->m_StoreAccesses == 0)
+	m_PR->m_Worker->UnlockStore ();
+}
+
+// Wait until the worker has matched every pub it was given, sending
+// them out. Only for when the order of pubs and subs matters.
+void PubsubRouter::SyncStore ()
+{
+    if (!m_Worker)
+	return;
+
+    START(PubsubRouter::SyncStore);
+    // (while we hold the store it can't get anywhere; but then it 
+    // has nothing half done either)
+    while (m_Worker->Busy () && m_StoreAccesses == 0) {
+	if (!ReapMatches ())
+	    Thread::Yield ();
+    }
+    STOP(PubsubRouter::SyncStore);
+}
+
+// Have the worker match pmsg; ReapMatches sends the matched pub out.
+// False if there is no worker, or it can't take pmsg now (its queue 
+// is full, or we hold the store); then match it here instead.
+bool PubsubRouter::SubmitToWorker (MsgPublication *pmsg, bool pubMatchesLeft)
+{
+    if (!m_Worker || m_StoreAccesses > 0)
+	return false;
+
+    HubWorker::Job *job = new HubWorker::Job ();
+    job->pmsg = pmsg->Clone ();
+    job->pubMatchesLeft = pubMatchesLeft;
+    job->submitted = REAL_CurrentTimeTicks ();
+
+    if (!m_Worker->Submit (job)) {
+	ReapMatches ();
+	if (!m_Worker->Submit (job)) {
+	    HubWorker::DeleteJob (job);
+	    return false;
 	}
-	///// MEASUREMENT
+    }
+    return true;
+}
 
-#ifdef PUBSUB_DEBUG
-	{
-	    DebugEntry ent (false /* is_trigger */, l->front () /* use somebody? */, pub);
-	    LOG(DebugLog, ent);
+// Send out the pubs the worker has matched; true if there were any.
+bool PubsubRouter::ReapMatches ()
+{
+    if (!m_Worker)
+	return false;
+
+    HubWorker::Job *job = m_Worker->Reap ();
+    if (!job)
+	return false;
+
+    START(PubsubRouter::ReapMatches);
+    TimeVal now = m_Scheduler->TimeNow ();
+    do {
+	// the worker can't time itself (it must stay off the benchmark
+	// state), so this is the match as seen from here: queueing included.
+	STOP_SINCE(PubsubRouter::WorkerMatch, job->submitted);
+
+	SubscriberMatchList groups;
+	GroupMatchesBySubscriber (job->pmsg, job->pubMatchesLeft, job->matches, now, &groups);
+	NOTE(MATCHED_PEOPLE_COUNT, groups.size());
+	FanoutMatchedPub (job->pmsg, groups, now);
+	HubWorker::DeleteJob (job);
+    } while ((job = m_Worker->Reap ()) != NULL);
+    STOP(PubsubRouter::ReapMatches);
+
+    return true;
+}
+
+void PubsubRouter::QueuePubForDelivery(MsgPublication *pmsg, bool pubMatchesLeft)
+{
+    PendingPub p;
+    p.pmsg = pmsg->Clone ();
+    p.pubMatchesLeft = pubMatchesLeft;
+    m_PendingPubs.push_back (p);
+
+    if ((int) m_PendingPubs.size () >= g_Preferences.pub_batch) {
+	DeliverPendingPubs ();
+	return;
+    }
+
+    if (m_FlushPubBatchTimer == NULL) {
+	m_FlushPubBatchTimer = new refcounted<FlushPubBatch> (this);
+	m_Scheduler->RaiseEvent (m_FlushPubBatchTimer, m_Address, 0);
+    }
+}
+
+// Match all pending pubs with one pass over the store and send each 
+// subscriber a single message carrying everything it matched.
+void PubsubRouter::DeliverPendingPubs()
+{
+    if (m_FlushPubBatchTimer != NULL) {
+	m_FlushPubBatchTimer->Cancel ();
+	m_FlushPubBatchTimer = NULL;
+    }
+    if (m_PendingPubs.size () == 0)
+	return;
+
+    START(PubsubRouter::DeliverPendingPubs);
+    TimeVal now = m_Scheduler->TimeNow ();
+    int npubs = m_PendingPubs.size ();
+
+    START(PubsubRouter::DeliverPendingPubs::Matching);
+    vector<MsgPublication *> pubs (npubs);
+    for (int i = 0; i < npubs; i++)
+	pubs[i] = m_PendingPubs[i].pmsg;
+
+    vector< list<Interest *> > matches;
+    if (m_Store->HasExpiryIndex ())
+	m_Store->ExpireSubs (now);
+    m_Store->GetOverlapSubsBatch (pubs, &matches);
+    STOP(PubsubRouter::DeliverPendingPubs::Matching);
+
+    NOTE(PubsubRouter::DeliverPendingPubs::BatchSize, npubs);
+
+    START(PubsubRouter::DeliverPendingPubs::AggregateSending);
+    map<SID, MsgPubBatch *, less_SID> batches;
+
+    for (int i = 0; i < npubs; i++) {
+	SubscriberMatchList groups;
+	GroupMatchesBySubscriber (pubs[i], m_PendingPubs[i].pubMatchesLeft, matches[i], now, &groups);
+
+	for (SubscriberMatchList::iterator it = groups.begin (); it != groups.end (); ++it) {
+	    MsgPubBatch *&bmsg = batches[it->subscriber];
+	    if (bmsg == NULL) {
+		bmsg = new MsgPubBatch (m_Hub->GetID (), m_Address);
+		bmsg->hubID = 0xff;      // see PrepareMatchedPub
+	    }
+	    bmsg->AddPublication (MakeMatchedPub (pubs[i], it->subscriber, &it->subs, now));
 	}
-#endif
+    }
+
+    NOTE(MATCHED_PEOPLE_COUNT, batches.size());
 
-	// what to do about so many TCP connections?
+    for (map<SID, MsgPubBatch *, less_SID>::iterator it = batches.begin (); it != batches.end (); ++it) {
+	SID subscriber = it->first;
+	MsgPubBatch *bmsg = it->second;
 
-	// TOTALLY GRUESOME hack -- cross hub pubs are marked 
-	// with this hubID. sometime, i should redo this stupid
-	// MessageHandler thing. - Ashwin [03/11/2005]  
-	smsg->hubID = 0xff; 
-	m_Network->SendMessage(smsg, &(subscriber), Parameters::TransportProto);
-	delete smsg;
+	// a batch of one goes out as a plain pub
+	if (bmsg->size () == 1)
+	    m_Network->SendMessage(*bmsg->begin (), &subscriber, Parameters::TransportProto);
+	else
+	    m_Network->SendMessage(bmsg, &subscriber, Parameters::TransportProto);
+	delete bmsg;
     }
-    STOP(PubsubRouter::DeliverPubToSubscribers::AggregateSending);
+    STOP(PubsubRouter::DeliverPendingPubs::AggregateSending);
 
-    STOP(PubsubRouter::DeliverPubToSubscribers);
+    for (int i = 0; i < npubs; i++)
+	delete pubs[i];
+    m_PendingPubs.clear ();
+
+    STOP(PubsubRouter::DeliverPendingPubs);
 }
 
 static bool matchsub_predicate (MemberHub *h, const NodeRange *range, list<Interest *> *ml, Interest *i)
@@ -1115,7 +1437,8 @@ static bool matchsub_predicate (MemberHub *h, const NodeRange *range, list<Inter
 
 void PubsubRouter::GetMatchingSubscriptions (const NodeRange& range, list<Interest *>& matched)
 {
-    m_Store->DeleteSubs (wrap (matchsub_predicate, m_Hub, &range, &matched));
+    StoreAccess access (this);
+    m_Store->DeleteSubsInRange (m_Hub->GetID (), range, wrap (matchsub_predicate, m_Hub, &range, &matched));
 }
 
 static bool matchtrigger_predicate (MemberHub *h, const NodeRange* range, list<MsgPublication *> *ml, MsgPublication *tr)
@@ -1129,7 +1452,8 @@ static bool matchtrigger_predicate (MemberHub *h, const NodeRange* range, list<M
 
 void PubsubRouter::GetMatchingTriggers (const NodeRange& range, list<MsgPublication *>& matched)
 {
-    m_Store->DeleteTriggers (wrap (matchtrigger_predicate, m_Hub, &range, &matched));
+    StoreAccess access (this);
+    m_Store->DeleteTriggersInRange (m_Hub->GetID (), range, wrap (matchtrigger_predicate, m_Hub, &range, &matched));
 }
 
 static bool handovertrigger_predicate (MemberHub *h, const NodeRange *range, MsgTriggerList *tlm, TimeVal *now, MsgPublication *tr)
@@ -1170,13 +1494,22 @@ vector<int> PubsubRouter::HandoverTriggers(IPEndPoint *to)
 {
     vector<int> stats;
 
+    StoreAccess access (this);
+
     TimeVal now = m_Scheduler->TimeNow ();
     MsgTriggerList *tlmsg = new MsgTriggerList(m_Hub->GetID(), m_Address);
 
     bool is_pred = (*to == m_Hub->GetPredecessor ()->GetAddress ()); 
     const NodeRange& nbr_range = is_pred ? m_Hub->GetPredecessor ()->GetRange () : m_Hub->GetSuccessor ()->GetRange ();	
 
-    m_Store->DeleteTriggers (wrap (handovertrigger_predicate, m_Hub, &nbr_range, tlmsg, &m_Scheduler->TimeNow ()));
+    // only the items overlapping the neighbor's range are visited;
+    // with an expiry index, get the dead ones out of the way first.
+    if (m_Store->HasExpiryIndex ())
+	m_Store->ExpireTriggers (now);
+
+    START(PubsubRouter::HandoverTriggers);
+    m_Store->DeleteTriggersInRange (m_Hub->GetID (), nbr_range, wrap (handovertrigger_predicate, m_Hub, &nbr_range, tlmsg, &now));
+    STOP(PubsubRouter::HandoverTriggers);
 
     stats.push_back (tlmsg->size ());      // #triggers
     stats.push_back (tlmsg->GetLength ()); // size in bytes
@@ -1204,13 +1537,22 @@ vector<int> PubsubRouter::HandoverSubscriptions(IPEndPoint *to)
 {
     vector<int> stats;
 
+    // match queued pubs while we still hold the subs
+    DeliverPendingPubs ();
+    StoreAccess access (this);
+
     TimeVal now = m_Scheduler->TimeNow ();
     MsgSubscriptionList *slmsg = new MsgSubscriptionList (m_Hub->GetID(), m_Address);
 
     bool is_pred = (*to == m_Hub->GetPredecessor ()->GetAddress ());
     const NodeRange& nbr_range = is_pred ? m_Hub->GetPredecessor ()->GetRange () : m_Hub->GetSuccessor ()->GetRange ();
 
-    m_Store->DeleteSubs (wrap (handoversub_predicate, m_Hub, &nbr_range, slmsg, &m_Scheduler->TimeNow ()));
+    if (m_Store->HasExpiryIndex ())
+	m_Store->ExpireSubs (now);
+
+    START(PubsubRouter::HandoverSubscriptions);
+    m_Store->DeleteSubsInRange (m_Hub->GetID (), nbr_range, wrap (handoversub_predicate, m_Hub, &nbr_range, slmsg, &now));
+    STOP(PubsubRouter::HandoverSubscriptions);
 
     stats.push_back (slmsg->size ());          // #subscriptions
     stats.push_back (slmsg->GetLength ());     // size in bytes
@@ -1250,10 +1592,21 @@ static bool oortrigger_predicate (MemberHub *h, const NodeRange *range, TimeVal
 
 void PubsubRouter::PurgeOutofRangeData ()
 {
+    StoreAccess access (this);
     m_Store->DeleteSubs (wrap (oorsub_predicate, m_Hub, m_Hub->GetRange (), &m_Scheduler->TimeNow ()));
     m_Store->DeleteTriggers (wrap (oortrigger_predicate, m_Hub, m_Hub->GetRange (), &m_Scheduler->TimeNow ()));
 }
 
+// drop expired soft-state; run every PS_RTR::EXPIRY_TIMEOUT
+void PubsubRouter::ExpireData ()
+{
+    StoreAccess access (this);
+
+    TimeVal now = m_Scheduler->TimeNow ();
+    m_Store->ExpireTriggers (now);
+    m_Store->ExpireSubs (now);
+}
+
 void PubsubRouter::AddNewTrigger (MsgPublication *pmsg)
 {
     Event *ev = pmsg->GetEvent ();
@@ -1263,6 +1616,7 @@ void PubsubRouter::AddNewTrigger (MsgPublication *pmsg)
 	return;
 
     ev->SetDeathTime (m_Scheduler->TimeNow () + ev->GetLifeTime() );
+    StoreAccess access (this);
     m_Store->StoreTrigger (pmsg);
 }
 
@@ -1272,7 +1626,37 @@ void PubsubRouter::AddNewInterest (Interest *nin)
     if (!cst->OverlapsNodeRange (*m_Hub->GetRange ()))
 	return;
 
-    m_Store->StoreSub (nin);
+    StoreAccess access (this);
+    if (CoverSubscription (nin))
+	m_Store->StoreSub (nin);
+}
+
+/**
+ * With --subcover the store keeps one sub per GUID and subscriber. 
+ * 'sub' is the subscriber's newer interest, so it takes the old one's
+ * place (replaced) -- even if the old one was wider, since the 
+ * subscriber no longer wants what it does not cover. If it is the 
+ * same interest and lives no longer, storing it would change nothing
+ * (merged). Returns true if 'sub' is to be stored.
+ **/
+bool PubsubRouter::CoverSubscription (Interest *sub)
+{
+    if (!g_Preferences.enable_subcovering || sub->GetGUID () == GUID_NONE)
+	return true;
+
+    Interest *old = m_Store->FindSub (sub->GetGUID ());
+    if (old == NULL || old->GetSubscriber () != sub->GetSubscriber ())
+	return true;
+
+    if (old->Covers (sub) && sub->Covers (old) && !(old->GetDeathTime () < sub->GetDeathTime ())) {
+	m_MergedSubs++;
+	return false;
+    }
+
+    bool deleted = m_Store->DeleteSub (old);
+    ASSERT (deleted);
+    m_ReplacedSubs++;
+    return true;
 }
 
 void PubsubRouter::HandleSubscriptionList(IPEndPoint * from, MsgSubscriptionList * slmsg)
@@ -1295,6 +1679,7 @@ static bool printsub_predicate (ostream *os, Interest *i)
 
 void PubsubRouter::PrintSubscriptionList(ostream& stream)
 {
+    StoreAccess access (this);
     m_Store->DeleteSubs (wrap (printsub_predicate, &stream));
 }
 
@@ -1306,6 +1691,7 @@ static bool printpub_predicate (ostream *os, MsgPublication *pmsg)
 
 void PubsubRouter::PrintPublicationList(ostream& stream)
 {
+    StoreAccess access (this);
     m_Store->DeleteTriggers (wrap (printpub_predicate, &stream));
 }
 
@@ -1314,17 +1700,20 @@ static void DoMeasurementLog(Message *msg, MemberHub *hub, IPEndPoint *from)
 {   
     MsgType t = msg->GetType();
 
+    // only decode what is being forwarded if something here needs it
+
     if (t == MSG_SUB) {
-	Interest *sub = ((MsgSubscription *) msg)->GetInterest();
+	MsgSubscription *smsg = (MsgSubscription *) msg;
 
-	DBG_DO { g_MercEventsLog << __FILE__ << ":" << __LINE__ << "==hub== " << hub->GetName() << " routing sub " << sub << endl; g_MercEventsLog.flush(); }
+	DBG_DO { g_MercEventsLog << __FILE__ << ":" << __LINE__ << "==hub== " << hub->GetName() << " routing sub " << smsg->GetInterest () << endl; g_MercEventsLog.flush(); }
 	DBG_DO { 
 	    MercuryNode *m_MercuryNode = hub->GetMercuryNode ();
-	    MDB(1) << "==hub== " << hub->GetName() << " routing sub " << sub << endl; g_MercEventsLog.flush(); 
+	    MDB(1) << "==hub== " << hub->GetName() << " routing sub " << smsg->GetInterest () << endl; g_MercEventsLog.flush(); 
 	}
 
 	//// MEASUREMENT
 	if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
+	    Interest *sub = smsg->GetInterest ();
 	    DiscoveryLatEntry ent(DiscoveryLatEntry::SUB_ROUTE_RECV, 
 				  msg->hopCount, sub->GetNonce());
 	    if (from == NULL)
@@ -1335,17 +1724,18 @@ static void DoMeasurementLog(Message *msg, MemberHub *hub, IPEndPoint *from)
 	//// MEASUREMENT
     }
     else if (t == MSG_PUB) {
-	Event *evt = ((MsgPublication *) msg)->GetEvent();
+	MsgPublication *pmsg = (MsgPublication *) msg;
 
 	// Matched publications should be handled by MercuryNode directly..
-	DBG_DO { g_MercEventsLog << __FILE__ << ":" << __LINE__ << " ==hub== " << hub->GetName() << " routing event " << evt << endl; g_MercEventsLog.flush(); }
+	DBG_DO { g_MercEventsLog << __FILE__ << ":" << __LINE__ << " ==hub== " << hub->GetName() << " routing event " << pmsg->GetEvent () << endl; g_MercEventsLog.flush(); }
 	DBG_DO { 
 	    MercuryNode *m_MercuryNode = hub->GetMercuryNode ();
-	    MDB(1) << "==hub== " << hub->GetName() << " routing event " << evt << endl; g_MercEventsLog.flush(); 
+	    MDB(1) << "==hub== " << hub->GetName() << " routing event " << pmsg->GetEvent () << endl; g_MercEventsLog.flush(); 
 	}
 
 	//// MEASUREMENT
 	if (g_MeasurementParams.enabled /* && !g_MeasurementParams.aggregateLog */) {
+	    Event *evt = pmsg->GetEvent ();
 	    DiscoveryLatEntry ent(DiscoveryLatEntry::PUB_ROUTE_RECV, 
 				  msg->hopCount, evt->GetNonce());
 	    if (from == NULL)
@@ -24,7 +24,10 @@
 #define __PUBSUBROUTER__H
 
 #include <list>
+#include <map>
+#include <hash_map.h>
 #include <mercury/Event.h>
+#include <mercury/ID.h>
 #include <mercury/IPEndPoint.h>
 #include <mercury/Sampling.h>
 
@@ -54,7 +57,9 @@ class CountResetter;
 // STL wrappers
 
 class StopRangeChange;
+class FlushPubBatch;
 class PubsubStore;
+class HubWorker;
 
 #define MAX_PUBSUB_TTL 20
 //////////////////////////////////////////////////////////////////////////
@@ -65,6 +70,7 @@ class PubsubRouter  : public MessageHandler
 {
     friend class CountResetter;
     friend class StopRangeChange;
+    friend class FlushPubBatch;
 
     MemberHub           *m_Hub;
     BufferManager       *m_BufferManager;
@@ -83,8 +89,13 @@ class PubsubRouter  : public MessageHandler
     Cache               *m_Cache;          // Cache of nodes I have seen when sending to this hub!
 
     PubsubStore         *m_Store;
+    HubWorker           *m_Worker;         // matches pubs on its own thread (--hub-threads); or NULL
+    int                  m_StoreAccesses;  // nested StoreAccess scopes
 
     int m_RoutedSubs, m_RoutedPubs;
+
+    // re-registered subs which were not stored as a second copy (--subcover)
+    int m_MergedSubs, m_ReplacedSubs;
     float m_RoutingLoad;
     list<float> m_LoadWindows;
     int m_WindowIndexAtChange;
@@ -93,6 +104,24 @@ class PubsubRouter  : public MessageHandler
     bool m_RangeChanged;
     ptr<StopRangeChange> m_StopRangeChangeTimer;
     IPEndPoint m_LastHop;
+
+    // pubs which reached the rendezvous during this receive cycle
+    // and are waiting to be matched together (--pub-batch)
+    struct PendingPub {
+	MsgPublication *pmsg;
+	bool pubMatchesLeft;
+    };
+    vector<PendingPub>   m_PendingPubs;
+    ptr<FlushPubBatch>   m_FlushPubBatchTimer;
+
+    // the subs a pub matched, grouped by subscriber. m_SubscriberSlots
+    // maps a subscriber to its group while a list is being built.
+    struct SubscriberMatches {
+	SID subscriber;
+	vector<Interest *> subs;
+    };
+    typedef vector<SubscriberMatches> SubscriberMatchList;
+    hash_map<SID, int, hash_SID, equal_SID> m_SubscriberSlots;
  public:
     PubsubRouter(MemberHub *hub, BufferManager *bm, LinkMaintainer *lm);
     virtual ~PubsubRouter();
@@ -113,6 +142,8 @@ class PubsubRouter  : public MessageHandler
     void PrintPublicationList(ostream& stream);
 
     float GetRoutingLoad () { return m_RoutingLoad; }
+    int GetMergedSubs () { return m_MergedSubs; }
+    int GetReplacedSubs () { return m_ReplacedSubs; }
     void SetRangeChanged ();
     void UpdateRangeLoad (const NodeRange& newrange);
 
@@ -121,8 +152,12 @@ class PubsubRouter  : public MessageHandler
     void GetMatchingTriggers (const NodeRange& range, list<MsgPublication *>& matched);
     void AddNewTrigger (MsgPublication *pmsg);
     void AddNewInterest (Interest *in);
+    void ExpireData ();
+    bool ReapMatches ();
 
-    const IPEndPoint *ComputeNextHop(const Value &val );
+    // 'forwarding' => a pub or sub being routed, which may go to a 
+    // lower-RTT peer than the nearest (--prs-slack)
+    const IPEndPoint *ComputeNextHop(const Value &val, bool forwarding = false);
 
     void SendQuickPong (IPEndPoint *from);
  private:
@@ -139,9 +174,32 @@ class PubsubRouter  : public MessageHandler
     void HandleSubscriptionList(IPEndPoint *from, MsgSubscriptionList *slmsg);
     void HandleTriggerList(IPEndPoint *from, MsgTriggerList *slmsg);
 
+    // holds m_Store against the worker for its scope (see HubWorker.h);
+    // they nest, since app callbacks made while holding it may call back in
+    class StoreAccess {
+	PubsubRouter *m_PR;
+    public:
+	StoreAccess (PubsubRouter *pr);
+	~StoreAccess ();
+    };
+    friend class StoreAccess;
+
+    void SyncStore ();
+    bool SubmitToWorker (MsgPublication *pmsg, bool pubMatchesLeft);
+
     void TriggerPublications(MsgSubscription *smsg);
+    bool CoverSubscription(Interest *sub);
 
     void DeliverPubToSubscribers(MsgPublication *pmsg, bool pubMatchesLeft, bool pubMatchesRight);
+    void QueuePubForDelivery(MsgPublication *pmsg, bool pubMatchesLeft);
+    void DeliverPendingPubs();
+    void GroupMatchesBySubscriber(MsgPublication *pmsg, bool pubMatchesLeft, list<Interest *>& matches, 
+				  TimeVal& now, SubscriberMatchList *groups);
+    MsgPublication *PrepareMatchedPub(MsgPublication *pmsg);
+    void FillMatchedPub(MsgPublication *smsg, MsgPublication *pmsg, const SID& subscriber, 
+			vector<Interest *> *l, TimeVal& now);
+    MsgPublication *MakeMatchedPub(MsgPublication *pmsg, const SID& subscriber, vector<Interest *> *l, TimeVal& now);
+    void FanoutMatchedPub(MsgPublication *pmsg, SubscriberMatchList& groups, TimeVal& now);
     void SendAck(MsgPublication *pmsg);
 
     bool CheckAppLinear (Message *msg);
@@ -0,0 +1,1044 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+#include <algorithm>
+#include <mercury/PubsubStore.h>
+#include <mercury/Interest.h>
+#include <mercury/Event.h>
+#include <mercury/Message.h>
+#include <util/Benchmark.h>
+
+PubsubStoreType GetPubsubStoreByName (const char *name)
+{
+    if (!strcasecmp (name, "LIST")) {
+	return PUBSUB_STORE_LIST;
+    } else if (!strcasecmp (name, "INTERVAL")) {
+	return PUBSUB_STORE_INTERVAL;
+    } else if (!strcasecmp (name, "RTREE")) {
+	return PUBSUB_STORE_RTREE;
+    } else if (!strcasecmp (name, "SOA")) {
+	return PUBSUB_STORE_SOA;
+    } else {
+	WARN << "unknown pubsub store: " << name << endl;
+	ASSERT (0);
+    }
+    return PUBSUB_STORE_LIST;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PubsubStore defaults
+
+static bool _sub_expired (TimeVal *now, Interest *in)
+{
+    return in->GetDeathTime () < *now;
+}
+
+static bool _trigger_expired (TimeVal *now, MsgPublication *pmsg)
+{
+    return pmsg->GetEvent ()->GetDeathTime () < *now;
+}
+
+void PubsubStore::ExpireSubs (const TimeVal& now)
+{
+    TimeVal t = now;
+    DeleteSubs (wrap (_sub_expired, &t));
+}
+
+void PubsubStore::ExpireTriggers (const TimeVal& now)
+{
+    TimeVal t = now;
+    DeleteTriggers (wrap (_trigger_expired, &t));
+}
+
+// items which do not constrain 'attr' span it, so they are in range
+static bool _sub_in_range (int attr, const NodeRange *range, callback<bool, Interest *>::ref *delpred, Interest *in)
+{
+    Constraint *cst = in->GetConstraintByAttr (attr);
+    if (cst != NULL && !cst->OverlapsNodeRange (*range))
+	return false;
+    return (*delpred) (in);
+}
+
+static bool _trigger_in_range (int attr, const NodeRange *range, callback<bool, MsgPublication *>::ref *delpred, MsgPublication *pmsg)
+{
+    Constraint *cst = pmsg->GetEvent ()->GetConstraintByAttr (attr);
+    if (cst != NULL && !cst->OverlapsNodeRange (*range))
+	return false;
+    return (*delpred) (pmsg);
+}
+
+void PubsubStore::DeleteSubsInRange (int attr, const NodeRange& range, callback<bool, Interest *>::ref delpred)
+{
+    DeleteSubs (wrap (_sub_in_range, attr, &range, &delpred));
+}
+
+void PubsubStore::DeleteTriggersInRange (int attr, const NodeRange& range, callback<bool, MsgPublication *>::ref delpred)
+{
+    DeleteTriggers (wrap (_trigger_in_range, attr, &range, &delpred));
+}
+
+static bool _is_sub (Interest *which, bool *found, Interest *in)
+{
+    if (in != which)
+	return false;
+    *found = true;
+    return true;
+}
+
+bool PubsubStore::DeleteSub (Interest *in)
+{
+    bool found = false;
+    DeleteSubs (wrap (_is_sub, in, &found));
+    return found;
+}
+
+// absolute range of every attribute in the schema
+static vector<Constraint> _GetSchemaBounds ()
+{
+    vector<Constraint> bounds;
+    for (int i = 0; i < g_NumHubs; i++)
+	bounds.push_back (Constraint (i, g_MercuryAttrRegistry[i].absmin, g_MercuryAttrRegistry[i].absmax));
+    return bounds;
+}
+
+PubsubStore *CreatePubsubStore (int hubID)
+{
+    switch (GetPubsubStoreByName (g_Preferences.pubsub_store)) {
+    case PUBSUB_STORE_INTERVAL:
+	return new IntervalPubsubStore (hubID);
+    case PUBSUB_STORE_RTREE:
+	return new RTreePubsubStore (hubID, _GetSchemaBounds ());
+    case PUBSUB_STORE_SOA:
+	return new SoAPubsubStore (hubID, _GetSchemaBounds ());
+    case PUBSUB_STORE_LIST:
+    default:
+	return new MercPubsubStore ();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MercPubsubStore
+
+void MercPubsubStore::StoreSub (Interest *in)
+{
+    IntLstIter it = m_SubList.insert (m_SubList.end (), in->Clone ());
+    m_SubExpiry.Insert ((*it)->GetDeathTime (), it);
+    if (g_Preferences.enable_subcovering)
+	m_SubsByGUID.Insert (*it, it);
+}
+
+void MercPubsubStore::StoreTrigger (MsgPublication *pmsg) 
+{
+    PubMsgLstIter it;
+    if (!g_Preferences.enable_puboverwriting) {
+	it = m_TriggerList.insert (m_TriggerList.end (), pmsg->Clone ());
+	m_TriggerExpiry.Insert ((*it)->GetEvent ()->GetDeathTime (), it);
+	return;
+    }
+
+    PubMsgLstIter old;
+    if (m_Overwrites.Find (pmsg->GetEvent (), &old)) {
+	if (!pmsg->GetEvent ()->OverwriteEvent ((*old)->GetEvent ()))
+	    return;
+
+	// replace in place; the position stays, the death time moves
+	m_Overwrites.Erase ((*old)->GetEvent ());
+	m_TriggerExpiry.Erase (old);
+	delete *old;
+	*old = pmsg->Clone ();
+	m_Overwrites.Insert ((*old)->GetEvent (), old);
+	m_TriggerExpiry.Insert ((*old)->GetEvent ()->GetDeathTime (), old);
+	return;
+    }
+
+    it = m_TriggerList.insert (m_TriggerList.end (), pmsg->Clone ());
+    m_Overwrites.Insert ((*it)->GetEvent (), it);
+    m_TriggerExpiry.Insert ((*it)->GetEvent ()->GetDeathTime (), it);
+}
+
+// pick the victims first, so the expiry index drops them in one pass
+void MercPubsubStore::DeleteTriggers (callback<bool, MsgPublication *>::ref delpred) 
+{
+    vector<PubMsgLstIter> gone;
+    for (PubMsgLstIter it = m_TriggerList.begin (); it != m_TriggerList.end (); ++it) {
+	if (delpred (*it))
+	    gone.push_back (it);
+    }
+
+    m_TriggerExpiry.Erase (gone);
+    for (int i = 0, len = gone.size (); i < len; i++) {
+	m_Overwrites.Erase ((*gone[i])->GetEvent ());
+	delete *gone[i];
+	m_TriggerList.erase (gone[i]);
+    }
+}
+
+void MercPubsubStore::DeleteSubs (callback<bool, Interest *>::ref delpred) 
+{
+    vector<IntLstIter> gone;
+    for (IntLstIter it = m_SubList.begin (); it != m_SubList.end (); ++it) {
+	if (delpred (*it))
+	    gone.push_back (it);
+    }
+
+    m_SubExpiry.Erase (gone);
+    for (int i = 0, len = gone.size (); i < len; i++) {
+	m_SubsByGUID.Erase (*gone[i]);
+	delete *gone[i];
+	m_SubList.erase (gone[i]);
+    }
+}
+
+void MercPubsubStore::ExpireSubs (const TimeVal& now)
+{
+    vector<IntLstIter> dead;
+    m_SubExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	m_SubsByGUID.Erase (*dead[i]);
+	delete *dead[i];
+	m_SubList.erase (dead[i]);
+    }
+}
+
+void MercPubsubStore::ExpireTriggers (const TimeVal& now)
+{
+    vector<PubMsgLstIter> dead;
+    m_TriggerExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	m_Overwrites.Erase ((*dead[i])->GetEvent ());
+	delete *dead[i];
+	m_TriggerList.erase (dead[i]);
+    }
+}
+
+void MercPubsubStore::GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch) 
+{
+    Event *pub = pmsg->GetEvent ();
+    for (IntLstIter it = m_SubList.begin (); it != m_SubList.end (); ++it) {
+	if ((*it)->Overlaps (pub))
+	    pmatch->push_back (*it);
+    }
+}
+
+// walk the (long) sub list once for the whole batch instead of 
+// once per publication
+void MercPubsubStore::GetOverlapSubsBatch (vector<MsgPublication *>& pubs, vector< list<Interest *> > *pmatch) 
+{
+    int npubs = pubs.size ();
+    vector<Event *> evs (npubs);
+    for (int i = 0; i < npubs; i++)
+	evs[i] = pubs[i]->GetEvent ();
+
+    pmatch->resize (npubs);
+    for (IntLstIter it = m_SubList.begin (); it != m_SubList.end (); ++it) {
+	for (int i = 0; i < npubs; i++) {
+	    if ((*it)->Overlaps (evs[i]))
+		(*pmatch)[i].push_back (*it);
+	}
+    }
+}
+
+void MercPubsubStore::GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch) 
+{
+    for (PubMsgLstIter it = m_TriggerList.begin (); it != m_TriggerList.end (); ++it) {
+	Event *pub = (*it)->GetEvent ();
+	if (in->Overlaps (pub))
+	    pmatch->push_back (*it);
+    }		
+}
+
+Interest *MercPubsubStore::FindSub (const guid_t& g)
+{
+    Interest *in;
+    IntLstIter it;
+    return m_SubsByGUID.Find (g, &in, &it) ? in : NULL;
+}
+
+bool MercPubsubStore::DeleteSub (Interest *in)
+{
+    Interest *found;
+    IntLstIter it;
+    if (!m_SubsByGUID.Find (in->GetGUID (), &found, &it) || found != in)
+	return PubsubStore::DeleteSub (in);
+
+    m_SubsByGUID.Erase (in);
+    m_SubExpiry.Erase (it);
+    m_SubList.erase (it);
+    delete in;
+    return true;
+}
+
+void MercPubsubStore::Clear () 
+{
+    DeleteSubs (wrap (this, &MercPubsubStore::delsub_pred));
+    DeleteTriggers (wrap (this, &MercPubsubStore::deltrigger_pred));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// IntervalPubsubStore
+
+void IntervalPubsubStore::StoreSub (Interest *in)
+{
+    Interest *nin = in->Clone ();
+    Constraint *cst = nin->GetConstraintByAttr (m_HubID);
+
+    if (cst == NULL) 
+	m_UnindexedSubs.push_back (nin);
+    else 
+	m_Subs.Insert (&cst->GetMin (), &cst->GetMax (), nin);
+    m_SubExpiry.Insert (nin->GetDeathTime (), nin);
+
+    if (g_Preferences.enable_subcovering)
+	m_SubsByGUID.Insert (nin, nin);
+}
+
+void IntervalPubsubStore::StoreTrigger (MsgPublication *pmsg)
+{
+    MsgPublication *old;
+    if (g_Preferences.enable_puboverwriting && m_Overwrites.Find (pmsg->GetEvent (), &old)) {
+	if (!pmsg->GetEvent ()->OverwriteEvent (old->GetEvent ()))
+	    return;
+
+	// the range moved, most likely; so re-insert, not in place
+	_UnlinkTrigger (old);
+	m_TriggerExpiry.Erase (old);
+	delete old;
+    }
+
+    MsgPublication *npmsg = pmsg->Clone ();
+    Constraint *cst = npmsg->GetEvent ()->GetConstraintByAttr (m_HubID);
+
+    if (cst == NULL) 
+	m_UnindexedTriggers.push_back (npmsg);
+    else 
+	m_Triggers.Insert (&cst->GetMin (), &cst->GetMax (), npmsg);
+    m_TriggerExpiry.Insert (npmsg->GetEvent ()->GetDeathTime (), npmsg);
+
+    if (g_Preferences.enable_puboverwriting)
+	m_Overwrites.Insert (npmsg->GetEvent (), npmsg);
+}
+
+// take a trigger out of the tree (or side list) and the overwrite index
+void IntervalPubsubStore::_UnlinkTrigger (MsgPublication *pmsg)
+{
+    Constraint *cst = pmsg->GetEvent ()->GetConstraintByAttr (m_HubID);
+
+    if (cst == NULL)
+	m_UnindexedTriggers.remove (pmsg);
+    else
+	m_Triggers.Erase (cst->GetMin (), pmsg);
+    m_Overwrites.Erase (pmsg->GetEvent ());
+}
+
+void IntervalPubsubStore::DeleteSubs (callback<bool, Interest *>::ref delpred)
+{
+    // the predicate must see every item, so there is no way around 
+    // a full walk here. snapshot first; erasing re-shapes the tree.
+    vector<Interest *> all;
+    m_Subs.GetAll (&all);
+
+    for (int i = 0, len = all.size (); i < len; i++) {
+	Interest *in = all[i];
+	if (!delpred (in))
+	    continue;
+
+	m_Subs.Erase (in->GetConstraintByAttr (m_HubID)->GetMin (), in);
+	m_SubExpiry.Erase (in);
+	m_SubsByGUID.Erase (in);
+	delete in;
+    }
+
+    for (list<Interest *>::iterator it = m_UnindexedSubs.begin (); it != m_UnindexedSubs.end (); /* ++it */) {
+	if (delpred (*it)) {
+	    m_SubExpiry.Erase (*it);
+	    m_SubsByGUID.Erase (*it);
+	    delete *it;
+	    it = m_UnindexedSubs.erase (it);
+	}
+	else {
+	    ++it;
+	}
+    }
+}
+
+void IntervalPubsubStore::DeleteTriggers (callback<bool, MsgPublication *>::ref delpred)
+{
+    vector<MsgPublication *> all;
+    m_Triggers.GetAll (&all);
+
+    for (int i = 0, len = all.size (); i < len; i++) {
+	MsgPublication *pmsg = all[i];
+	if (!delpred (pmsg))
+	    continue;
+
+	m_Triggers.Erase (pmsg->GetEvent ()->GetConstraintByAttr (m_HubID)->GetMin (), pmsg);
+	m_TriggerExpiry.Erase (pmsg);
+	m_Overwrites.Erase (pmsg->GetEvent ());
+	delete pmsg;
+    }
+
+    for (list<MsgPublication *>::iterator it = m_UnindexedTriggers.begin (); it != m_UnindexedTriggers.end (); /* ++it */) {
+	if (delpred (*it)) {
+	    m_TriggerExpiry.Erase (*it);
+	    m_Overwrites.Erase ((*it)->GetEvent ());
+	    delete *it;
+	    it = m_UnindexedTriggers.erase (it);
+	}
+	else {
+	    ++it;
+	}
+    }
+}
+
+// the tree only offers the items overlapping 'range', but its notion
+// of overlap is the closed one; _sub_in_range has the final say.
+void IntervalPubsubStore::DeleteSubsInRange (int attr, const NodeRange& range, callback<bool, Interest *>::ref delpred)
+{
+    if (attr != m_HubID) {
+	PubsubStore::DeleteSubsInRange (attr, range, delpred);
+	return;
+    }
+
+    START(IntervalPubsubStore::DeleteSubsInRange);
+    vector<Interest *> taken;
+    m_Subs.Extract (range.GetMin (), range.GetMax (), wrap (_sub_in_range, m_HubID, &range, &delpred), &taken);
+
+    // out of the tree already; one pass for the other indexes
+    m_SubExpiry.Erase (taken);
+    for (int i = 0, len = taken.size (); i < len; i++) {
+	m_SubsByGUID.Erase (taken[i]);
+	delete taken[i];
+    }
+
+    // these span the hub attribute, so they are always in range
+    for (list<Interest *>::iterator it = m_UnindexedSubs.begin (); it != m_UnindexedSubs.end (); /* ++it */) {
+	if (delpred (*it)) {
+	    m_SubExpiry.Erase (*it);
+	    m_SubsByGUID.Erase (*it);
+	    delete *it;
+	    it = m_UnindexedSubs.erase (it);
+	}
+	else {
+	    ++it;
+	}
+    }
+    STOP(IntervalPubsubStore::DeleteSubsInRange);
+}
+
+void IntervalPubsubStore::DeleteTriggersInRange (int attr, const NodeRange& range, callback<bool, MsgPublication *>::ref delpred)
+{
+    if (attr != m_HubID) {
+	PubsubStore::DeleteTriggersInRange (attr, range, delpred);
+	return;
+    }
+
+    START(IntervalPubsubStore::DeleteTriggersInRange);
+    vector<MsgPublication *> taken;
+    m_Triggers.Extract (range.GetMin (), range.GetMax (), wrap (_trigger_in_range, m_HubID, &range, &delpred), &taken);
+
+    m_TriggerExpiry.Erase (taken);
+    for (int i = 0, len = taken.size (); i < len; i++) {
+	m_Overwrites.Erase (taken[i]->GetEvent ());
+	delete taken[i];
+    }
+
+    for (list<MsgPublication *>::iterator it = m_UnindexedTriggers.begin (); it != m_UnindexedTriggers.end (); /* ++it */) {
+	if (delpred (*it)) {
+	    m_TriggerExpiry.Erase (*it);
+	    m_Overwrites.Erase ((*it)->GetEvent ());
+	    delete *it;
+	    it = m_UnindexedTriggers.erase (it);
+	}
+	else {
+	    ++it;
+	}
+    }
+    STOP(IntervalPubsubStore::DeleteTriggersInRange);
+}
+
+void IntervalPubsubStore::ExpireSubs (const TimeVal& now)
+{
+    vector<Interest *> dead;
+    m_SubExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	Interest *in = dead[i];
+	Constraint *cst = in->GetConstraintByAttr (m_HubID);
+
+	if (cst == NULL)
+	    m_UnindexedSubs.remove (in);
+	else
+	    m_Subs.Erase (cst->GetMin (), in);
+	m_SubsByGUID.Erase (in);
+	delete in;
+    }
+}
+
+void IntervalPubsubStore::ExpireTriggers (const TimeVal& now)
+{
+    vector<MsgPublication *> dead;
+    m_TriggerExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	_UnlinkTrigger (dead[i]);
+	delete dead[i];
+    }
+}
+
+void IntervalPubsubStore::GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch)
+{
+    Event *pub = pmsg->GetEvent ();
+    Constraint *cst = pub->GetConstraintByAttr (m_HubID);
+
+    vector<Interest *> cands;
+    if (cst == NULL) 
+	m_Subs.GetAll (&cands);
+    else 
+	m_Subs.GetOverlaps (cst->GetMin (), cst->GetMax (), &cands);
+
+    // the hub constraint overlaps already; Overlaps () checks the rest
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	if (cands[i]->Overlaps (pub))
+	    pmatch->push_back (cands[i]);
+    }
+
+    for (list<Interest *>::iterator it = m_UnindexedSubs.begin (); it != m_UnindexedSubs.end (); ++it) {
+	if ((*it)->Overlaps (pub))
+	    pmatch->push_back (*it);
+    }
+}
+
+void IntervalPubsubStore::GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch)
+{
+    START(IntervalPubsubStore::GetOverlapTriggers);
+    Constraint *cst = in->GetConstraintByAttr (m_HubID);
+
+    vector<MsgPublication *> cands;
+    if (cst == NULL) 
+	m_Triggers.GetAll (&cands);
+    else 
+	m_Triggers.GetOverlaps (cst->GetMin (), cst->GetMax (), &cands);
+
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	if (in->Overlaps (cands[i]->GetEvent ()))
+	    pmatch->push_back (cands[i]);
+    }
+
+    for (list<MsgPublication *>::iterator it = m_UnindexedTriggers.begin (); it != m_UnindexedTriggers.end (); ++it) {
+	if (in->Overlaps ((*it)->GetEvent ()))
+	    pmatch->push_back (*it);
+    }
+    STOP(IntervalPubsubStore::GetOverlapTriggers);
+}
+
+Interest *IntervalPubsubStore::FindSub (const guid_t& g)
+{
+    Interest *in, *h;
+    return m_SubsByGUID.Find (g, &in, &h) ? in : NULL;
+}
+
+bool IntervalPubsubStore::DeleteSub (Interest *in)
+{
+    Constraint *cst = in->GetConstraintByAttr (m_HubID);
+
+    if (cst == NULL) {
+	list<Interest *>::iterator it = find (m_UnindexedSubs.begin (), m_UnindexedSubs.end (), in);
+	if (it == m_UnindexedSubs.end ())
+	    return false;
+	m_UnindexedSubs.erase (it);
+    }
+    else if (!m_Subs.Erase (cst->GetMin (), in))
+	return false;
+    m_SubExpiry.Erase (in);
+    m_SubsByGUID.Erase (in);
+    delete in;
+    return true;
+}
+
+void IntervalPubsubStore::Clear ()
+{
+    vector<Interest *> subs;
+    m_Subs.GetAll (&subs);
+    m_Subs.Clear ();
+    for (int i = 0, len = subs.size (); i < len; i++)
+	delete subs[i];
+
+    vector<MsgPublication *> trigs;
+    m_Triggers.GetAll (&trigs);
+    m_Triggers.Clear ();
+    for (int i = 0, len = trigs.size (); i < len; i++)
+	delete trigs[i];
+
+    for (list<Interest *>::iterator it = m_UnindexedSubs.begin (); it != m_UnindexedSubs.end (); ++it)
+	delete *it;
+    m_UnindexedSubs.clear ();
+
+    for (list<MsgPublication *>::iterator it = m_UnindexedTriggers.begin (); it != m_UnindexedTriggers.end (); ++it)
+	delete *it;
+    m_UnindexedTriggers.clear ();
+
+    m_SubExpiry.Clear ();
+    m_TriggerExpiry.Clear ();
+    m_Overwrites.Clear ();
+    m_SubsByGUID.Clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// RTreePubsubStore
+
+RTreePubsubStore::RTreePubsubStore (int hubID, const vector<Constraint>& bounds) 
+    : m_HubID (hubID), m_Dim (bounds.size ())
+{
+    ASSERT (m_Dim > 0);
+
+    for (int d = 0; d < m_Dim; d++) {
+	ASSERT (bounds[d].GetAttrIndex () == d);
+
+	double lo = bounds[d].GetMin ().getd ();
+	double hi = bounds[d].GetMax ().getd ();
+
+	m_Min.push_back (lo);
+	m_Span.push_back (hi > lo ? hi - lo : 1.0);
+    }
+
+    m_Subs = new RTree<SubRecord, double> (m_Dim);
+    m_Triggers = new RTree<TriggerRecord, double> (m_Dim);
+}
+
+RTreePubsubStore::~RTreePubsubStore ()
+{
+    Clear ();
+    delete m_Subs;
+    delete m_Triggers;
+}
+
+// getd truncates, and the rest is monotone too; so 
+// a <= b implies _ToCoord (a) <= _ToCoord (b). that is all 
+// we need for the tree to never miss a match.
+double RTreePubsubStore::_ToCoord (int d, const Value& v) const
+{
+    double c = (v.getd () - m_Min[d]) / m_Span[d];
+    if (c < 0.0) 
+	return 0.0;
+    if (c > 1.0)
+	return 1.0;
+    return c;
+}
+
+void RTreePubsubStore::StoreSub (Interest *in)
+{
+    SubRecord *rec = new SubRecord (in->Clone (), m_Dim);
+    _FillExtent (rec->item, &rec->extent);
+
+    rec->pos = m_SubRecords.insert (m_SubRecords.end (), rec);
+    m_Subs->Insert (rec);
+    m_SubExpiry.Insert (rec->item->GetDeathTime (), rec);
+
+    if (g_Preferences.enable_subcovering)
+	m_SubsByGUID.Insert (rec->item, rec);
+}
+
+void RTreePubsubStore::StoreTrigger (MsgPublication *pmsg)
+{
+    TriggerRecord *old;
+    if (g_Preferences.enable_puboverwriting && m_Overwrites.Find (pmsg->GetEvent (), &old)) {
+	if (!pmsg->GetEvent ()->OverwriteEvent (old->item->GetEvent ()))
+	    return;
+
+	_UnlinkTrigger (old);
+	m_TriggerExpiry.Erase (old);
+	delete old->item;
+	delete old;
+    }
+
+    TriggerRecord *rec = new TriggerRecord (pmsg->Clone (), m_Dim);
+    _FillExtent (rec->item->GetEvent (), &rec->extent);
+
+    rec->pos = m_TriggerRecords.insert (m_TriggerRecords.end (), rec);
+    m_Triggers->Insert (rec);
+    m_TriggerExpiry.Insert (rec->item->GetEvent ()->GetDeathTime (), rec);
+
+    if (g_Preferences.enable_puboverwriting)
+	m_Overwrites.Insert (rec->item->GetEvent (), rec);
+}
+
+// take a trigger out of the tree, the record list and the overwrite index
+void RTreePubsubStore::_UnlinkTrigger (TriggerRecord *rec)
+{
+    m_Triggers->Erase (rec);
+    m_TriggerRecords.erase (rec->pos);
+    m_Overwrites.Erase (rec->item->GetEvent ());
+}
+
+void RTreePubsubStore::DeleteSubs (callback<bool, Interest *>::ref delpred)
+{
+    for (list<SubRecord *>::iterator it = m_SubRecords.begin (); it != m_SubRecords.end (); /* ++it */) {
+	SubRecord *rec = *it;
+	if (!delpred (rec->item)) {
+	    ++it;
+	    continue;
+	}
+
+	m_Subs->Erase (rec);
+	m_SubExpiry.Erase (rec);
+	m_SubsByGUID.Erase (rec->item);
+	it = m_SubRecords.erase (it);
+	delete rec->item;
+	delete rec;
+    }
+}
+
+void RTreePubsubStore::DeleteTriggers (callback<bool, MsgPublication *>::ref delpred)
+{
+    for (list<TriggerRecord *>::iterator it = m_TriggerRecords.begin (); it != m_TriggerRecords.end (); /* ++it */) {
+	TriggerRecord *rec = *it;
+	if (!delpred (rec->item)) {
+	    ++it;
+	    continue;
+	}
+
+	m_Triggers->Erase (rec);
+	m_TriggerExpiry.Erase (rec);
+	m_Overwrites.Erase (rec->item->GetEvent ());
+	it = m_TriggerRecords.erase (it);
+	delete rec->item;
+	delete rec;
+    }
+}
+
+void RTreePubsubStore::ExpireSubs (const TimeVal& now)
+{
+    vector<SubRecord *> dead;
+    m_SubExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	SubRecord *rec = dead[i];
+	m_Subs->Erase (rec);
+	m_SubsByGUID.Erase (rec->item);
+	m_SubRecords.erase (rec->pos);
+	delete rec->item;
+	delete rec;
+    }
+}
+
+void RTreePubsubStore::ExpireTriggers (const TimeVal& now)
+{
+    vector<TriggerRecord *> dead;
+    m_TriggerExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	TriggerRecord *rec = dead[i];
+	_UnlinkTrigger (rec);
+	delete rec->item;
+	delete rec;
+    }
+}
+
+template<class R>
+static void collect_record (vector<R *> *out, R *rec)
+{
+    out->push_back (rec);
+}
+
+void RTreePubsubStore::GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch)
+{
+    Event *pub = pmsg->GetEvent ();
+
+    SubRecord query (NULL, m_Dim);
+    _FillExtent (pub, &query.extent);
+
+    vector<SubRecord *> cands;
+    m_Subs->GetOverlaps (&query, wrap (collect_record<SubRecord>, &cands));
+
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	if (cands[i]->item->Overlaps (pub))
+	    pmatch->push_back (cands[i]->item);
+    }
+}
+
+void RTreePubsubStore::GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch)
+{
+    START(RTreePubsubStore::GetOverlapTriggers);
+    TriggerRecord query (NULL, m_Dim);
+    _FillExtent (in, &query.extent);
+
+    vector<TriggerRecord *> cands;
+    m_Triggers->GetOverlaps (&query, wrap (collect_record<TriggerRecord>, &cands));
+
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	if (in->Overlaps (cands[i]->item->GetEvent ()))
+	    pmatch->push_back (cands[i]->item);
+    }
+    STOP(RTreePubsubStore::GetOverlapTriggers);
+}
+
+Interest *RTreePubsubStore::FindSub (const guid_t& g)
+{
+    Interest *in;
+    SubRecord *rec;
+    return m_SubsByGUID.Find (g, &in, &rec) ? in : NULL;
+}
+
+bool RTreePubsubStore::DeleteSub (Interest *in)
+{
+    Interest *found;
+    SubRecord *rec;
+    if (!m_SubsByGUID.Find (in->GetGUID (), &found, &rec) || found != in)
+	return PubsubStore::DeleteSub (in);
+
+    m_Subs->Erase (rec);
+    m_SubExpiry.Erase (rec);
+    m_SubsByGUID.Erase (in);
+    m_SubRecords.erase (rec->pos);
+    delete rec->item;
+    delete rec;
+    return true;
+}
+
+void RTreePubsubStore::Clear ()
+{
+    for (list<SubRecord *>::iterator it = m_SubRecords.begin (); it != m_SubRecords.end (); ++it) {
+	delete (*it)->item;
+	delete *it;
+    }
+    m_SubRecords.clear ();
+
+    for (list<TriggerRecord *>::iterator it = m_TriggerRecords.begin (); it != m_TriggerRecords.end (); ++it) {
+	delete (*it)->item;
+	delete *it;
+    }
+    m_TriggerRecords.clear ();
+
+    m_SubExpiry.Clear ();
+    m_TriggerExpiry.Clear ();
+    m_Overwrites.Clear ();
+    m_SubsByGUID.Clear ();
+
+    // RTree has no "clear"; records are gone, so just start afresh
+    delete m_Subs;
+    delete m_Triggers;
+    m_Subs = new RTree<SubRecord, double> (m_Dim);
+    m_Triggers = new RTree<TriggerRecord, double> (m_Dim);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SoAPubsubStore
+
+SoAPubsubStore::SoAPubsubStore (int hubID, const vector<Constraint>& bounds) 
+    : m_HubID (hubID), m_Dim (bounds.size ()), m_Subs (bounds.size ()), m_Triggers (bounds.size ()),
+      m_BoxMin (bounds.size ()), m_BoxMax (bounds.size ())
+{
+    ASSERT (m_Dim > 0);
+
+    for (int d = 0; d < m_Dim; d++) {
+	ASSERT (bounds[d].GetAttrIndex () == d);
+
+	double lo = bounds[d].GetMin ().getd ();
+	double hi = bounds[d].GetMax ().getd ();
+
+	m_Min.push_back (lo);
+	m_Span.push_back (hi > lo ? hi - lo : 1.0);
+    }
+}
+
+// same mapping as RTreePubsubStore::_ToCoord, stretched over 
+// the unsigned 32-bit range and then shifted so that signed 
+// compares (all SSE/AVX2 have) preserve the order.
+sint32 SoAPubsubStore::_Quantize (int d, const Value& v) const
+{
+    double c = (v.getd () - m_Min[d]) / m_Span[d];
+    if (c < 0.0) 
+	c = 0.0;
+    if (c > 1.0)
+	c = 1.0;
+
+    uint32 u = (uint32) (c * 4294967295.0);
+    return (sint32) (u ^ 0x80000000U);
+}
+
+void SoAPubsubStore::StoreSub (Interest *in)
+{
+    Interest *copy = in->Clone ();
+
+    _FillBox (copy, &m_BoxMin[0], &m_BoxMax[0]);
+    m_Subs.Add (copy, &m_BoxMin[0], &m_BoxMax[0]);
+    m_SubExpiry.Insert (copy->GetDeathTime (), copy);
+
+    if (g_Preferences.enable_subcovering)
+	m_SubsByGUID.Insert (copy, copy);
+}
+
+void SoAPubsubStore::StoreTrigger (MsgPublication *pmsg)
+{
+    MsgPublication *old;
+    if (g_Preferences.enable_puboverwriting && m_Overwrites.Find (pmsg->GetEvent (), &old)) {
+	if (!pmsg->GetEvent ()->OverwriteEvent (old->GetEvent ()))
+	    return;
+
+	_UnlinkTrigger (old);
+	m_TriggerExpiry.Erase (old);
+	delete old;
+    }
+
+    MsgPublication *copy = pmsg->Clone ();
+
+    _FillBox (copy->GetEvent (), &m_BoxMin[0], &m_BoxMax[0]);
+    m_Triggers.Add (copy, &m_BoxMin[0], &m_BoxMax[0]);
+    m_TriggerExpiry.Insert (copy->GetEvent ()->GetDeathTime (), copy);
+
+    if (g_Preferences.enable_puboverwriting)
+	m_Overwrites.Insert (copy->GetEvent (), copy);
+}
+
+void SoAPubsubStore::_UnlinkTrigger (MsgPublication *pmsg)
+{
+    m_Triggers.RemoveItem (pmsg);
+    m_Overwrites.Erase (pmsg->GetEvent ());
+}
+
+void SoAPubsubStore::DeleteSubs (callback<bool, Interest *>::ref delpred)
+{
+    for (int r = 0; r < m_Subs.size (); /* r++ */) {
+	Interest *in = m_Subs.GetItem (r);
+	if (!delpred (in)) {
+	    r++;
+	    continue;
+	}
+
+	// the last row moves into 'r'; look at it next
+	m_Subs.Remove (r);
+	m_SubExpiry.Erase (in);
+	m_SubsByGUID.Erase (in);
+	delete in;
+    }
+}
+
+void SoAPubsubStore::DeleteTriggers (callback<bool, MsgPublication *>::ref delpred)
+{
+    for (int r = 0; r < m_Triggers.size (); /* r++ */) {
+	MsgPublication *pmsg = m_Triggers.GetItem (r);
+	if (!delpred (pmsg)) {
+	    r++;
+	    continue;
+	}
+
+	m_Triggers.Remove (r);
+	m_TriggerExpiry.Erase (pmsg);
+	m_Overwrites.Erase (pmsg->GetEvent ());
+	delete pmsg;
+    }
+}
+
+void SoAPubsubStore::ExpireSubs (const TimeVal& now)
+{
+    vector<Interest *> dead;
+    m_SubExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	m_Subs.RemoveItem (dead[i]);
+	m_SubsByGUID.Erase (dead[i]);
+	delete dead[i];
+    }
+}
+
+void SoAPubsubStore::ExpireTriggers (const TimeVal& now)
+{
+    vector<MsgPublication *> dead;
+    m_TriggerExpiry.PopExpired (now, &dead);
+
+    for (int i = 0, len = dead.size (); i < len; i++) {
+	_UnlinkTrigger (dead[i]);
+	delete dead[i];
+    }
+}
+
+void SoAPubsubStore::GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch)
+{
+    Event *pub = pmsg->GetEvent ();
+
+    _FillBox (pub, &m_BoxMin[0], &m_BoxMax[0]);
+
+    vector<Interest *> cands;
+    m_Subs.GetOverlaps (&m_BoxMin[0], &m_BoxMax[0], &cands);
+
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	if (cands[i]->Overlaps (pub))
+	    pmatch->push_back (cands[i]);
+    }
+}
+
+void SoAPubsubStore::GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch)
+{
+    START(SoAPubsubStore::GetOverlapTriggers);
+    _FillBox (in, &m_BoxMin[0], &m_BoxMax[0]);
+
+    vector<MsgPublication *> cands;
+    m_Triggers.GetOverlaps (&m_BoxMin[0], &m_BoxMax[0], &cands);
+
+    for (int i = 0, len = cands.size (); i < len; i++) {
+	if (in->Overlaps (cands[i]->GetEvent ()))
+	    pmatch->push_back (cands[i]);
+    }
+    STOP(SoAPubsubStore::GetOverlapTriggers);
+}
+
+Interest *SoAPubsubStore::FindSub (const guid_t& g)
+{
+    Interest *in, *h;
+    return m_SubsByGUID.Find (g, &in, &h) ? in : NULL;
+}
+
+bool SoAPubsubStore::DeleteSub (Interest *in)
+{
+    if (!m_Subs.RemoveItem (in))
+	return false;
+    m_SubExpiry.Erase (in);
+    m_SubsByGUID.Erase (in);
+    delete in;
+    return true;
+}
+
+void SoAPubsubStore::Clear ()
+{
+    for (int r = 0; r < m_Subs.size (); r++)
+	delete m_Subs.GetItem (r);
+    m_Subs.Clear ();
+
+    for (int r = 0; r < m_Triggers.size (); r++)
+	delete m_Triggers.GetItem (r);
+    m_Triggers.Clear ();
+
+    m_SubExpiry.Clear ();
+    m_TriggerExpiry.Clear ();
+    m_Overwrites.Clear ();
+    m_SubsByGUID.Clear ();
+}
+
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -0,0 +1,353 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  PubsubStore.h
+
+  Built-in implementations of the PubsubStore interface (Application.h).
+  Mercury uses one of these for a hub when the application does not 
+  supply its own store; the choice is made with --pubsub-store.
+
+***************************************************************************/
+
+#ifndef __PUBSUBSTORE__H
+#define __PUBSUBSTORE__H
+
+#include <list>
+#include <vector>
+#include <mercury/Application.h>
+#include <mercury/IntervalTree.h>
+#include <mercury/BoxTable.h>
+#include <mercury/ExpiryIndex.h>
+#include <mercury/OverwriteIndex.h>
+#include <mercury/SubGUIDIndex.h>
+#include <util/RTree.h>
+
+typedef enum { 
+    PUBSUB_STORE_LIST,         // linear scan over all items
+    PUBSUB_STORE_INTERVAL,     // interval tree on the hub attribute
+    PUBSUB_STORE_RTREE,        // R-tree over all attributes
+    PUBSUB_STORE_SOA           // batched (SIMD) scan over packed columns
+} PubsubStoreType;
+
+PubsubStoreType GetPubsubStoreByName (const char *name);
+
+/**
+ * Create the built-in store selected by g_Preferences.pubsub_store 
+ * for hub 'hubID'.
+ **/
+PubsubStore *CreatePubsubStore (int hubID);
+
+// list positions stay put until erased, so they can key an index
+template<class I>
+struct hash_iter {
+    hash_ptr H;
+    size_t operator() (const I& it) const { return H (&*it); }
+};
+
+template<class I>
+struct equal_iter {
+    bool operator() (const I& a, const I& b) const { return a == b; }
+};
+
+// A default, very simple publication, subscription
+// store.
+
+class MercPubsubStore : public PubsubStore {
+public:
+    typedef list<MsgPublication *> PubMsgLst;
+    typedef PubMsgLst::iterator    PubMsgLstIter;
+
+    typedef list<Interest *> IntLst;
+    typedef IntLst::iterator IntLstIter;
+private:
+    PubMsgLst            m_TriggerList;
+    IntLst               m_SubList;
+
+    ExpiryIndex<IntLstIter, hash_iter<IntLstIter>, equal_iter<IntLstIter> >          m_SubExpiry;
+    ExpiryIndex<PubMsgLstIter, hash_iter<PubMsgLstIter>, equal_iter<PubMsgLstIter> > m_TriggerExpiry;
+    OverwriteIndex<PubMsgLstIter> m_Overwrites;
+    SubGUIDIndex<IntLstIter>      m_SubsByGUID;
+
+public:
+    MercPubsubStore () {}
+    virtual ~MercPubsubStore () {}
+
+    void StoreTrigger (MsgPublication *pmsg);
+    void StoreSub (Interest *in);
+
+    void DeleteTriggers (callback<bool, MsgPublication *>::ref delpred);
+    void DeleteSubs (callback<bool, Interest *>::ref delpred);
+
+    void GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch);
+    void GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch);
+    void GetOverlapSubsBatch (vector<MsgPublication *>& pubs, vector< list<Interest *> > *pmatch);
+
+    Interest *FindSub (const guid_t& g);
+    bool DeleteSub (Interest *in);
+
+    void Clear ();
+
+    void ExpireSubs (const TimeVal& now);
+    void ExpireTriggers (const TimeVal& now);
+    bool HasExpiryIndex () { return true; }
+private:
+    bool delsub_pred (Interest *i) { return true; }
+    bool deltrigger_pred (MsgPublication *pmsg) { return true; }
+};
+
+/**
+ * Indexes subscriptions and triggers by their constraint on the hub 
+ * attribute. A publication (or a new subscription looking for triggers)
+ * is only checked against items whose range on this hub overlaps its 
+ * own, so matching cost grows with the number of candidates rather 
+ * than with the number of stored items. The same goes for handing 
+ * items over when the node's range changes (Delete*InRange).
+ *
+ * Items which do not constrain the hub attribute (should not happen 
+ * for items routed through this hub, but apps can do strange things)
+ * are kept on the side and always checked.
+ **/
+class IntervalPubsubStore : public PubsubStore {
+    typedef IntervalTree<Interest *>       SubTree;
+    typedef IntervalTree<MsgPublication *> TriggerTree;
+
+    int                     m_HubID;
+
+    SubTree                 m_Subs;
+    TriggerTree             m_Triggers;
+
+    list<Interest *>        m_UnindexedSubs;
+    list<MsgPublication *>  m_UnindexedTriggers;
+
+    ExpiryIndex<Interest *>       m_SubExpiry;
+    ExpiryIndex<MsgPublication *> m_TriggerExpiry;
+    OverwriteIndex<MsgPublication *> m_Overwrites;
+    SubGUIDIndex<Interest *>      m_SubsByGUID;
+
+public:
+    IntervalPubsubStore (int hubID) : m_HubID (hubID) {}
+    virtual ~IntervalPubsubStore () { Clear (); }
+
+    void StoreTrigger (MsgPublication *pmsg);
+    void StoreSub (Interest *in);
+
+    void DeleteTriggers (callback<bool, MsgPublication *>::ref delpred);
+    void DeleteSubs (callback<bool, Interest *>::ref delpred);
+    void DeleteTriggersInRange (int attr, const NodeRange& range, callback<bool, MsgPublication *>::ref delpred);
+    void DeleteSubsInRange (int attr, const NodeRange& range, callback<bool, Interest *>::ref delpred);
+
+    void GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch);
+    void GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch);
+
+    Interest *FindSub (const guid_t& g);
+    bool DeleteSub (Interest *in);
+
+    void Clear ();
+
+    void ExpireSubs (const TimeVal& now);
+    void ExpireTriggers (const TimeVal& now);
+    bool HasExpiryIndex () { return true; }
+
+    int GetNumSubs () const { return m_Subs.size () + m_UnindexedSubs.size (); }
+    int GetNumTriggers () const { return m_Triggers.size () + m_UnindexedTriggers.size (); }
+private:
+    void _UnlinkTrigger (MsgPublication *pmsg);
+};
+
+/**
+ * Wraps a stored item for RTree<>, which wants records that can 
+ * report their extent.
+ **/
+template<class T>
+struct RTreeStoreRecord {
+    T             item;
+    Rect<double>  extent;
+    typename list<RTreeStoreRecord<T> *>::iterator pos;   // in the store's record list
+
+    RTreeStoreRecord (T it, int dim) : item (it), extent (dim) {}
+    void GetExtent (Rect<double> *e) { *e = extent; }
+};
+
+/**
+ * Puts every subscription and trigger into an N-dimensional R-tree, 
+ * one dimension per attribute in the schema, so a match is a single 
+ * window query over all attributes instead of a filter on the hub 
+ * attribute alone.
+ *
+ * The tree works on doubles: each value is mapped into [0, 1] using 
+ * the attribute's absolute range. The mapping is monotone, so the 
+ * tree returns a superset of the true matches; candidates are then 
+ * checked exactly with Interest::Overlaps (). An item which does not 
+ * constrain an attribute spans that whole dimension.
+ **/
+class RTreePubsubStore : public PubsubStore {
+public:
+    typedef RTreeStoreRecord<Interest *>       SubRecord;
+    typedef RTreeStoreRecord<MsgPublication *> TriggerRecord;
+private:
+    int                           m_HubID;
+    int                           m_Dim;
+    vector<double>                m_Min, m_Span;    // per dimension
+
+    RTree<SubRecord, double>     *m_Subs;
+    RTree<TriggerRecord, double> *m_Triggers;
+
+    list<SubRecord *>             m_SubRecords;
+    list<TriggerRecord *>         m_TriggerRecords;
+
+    ExpiryIndex<SubRecord *>      m_SubExpiry;
+    ExpiryIndex<TriggerRecord *>  m_TriggerExpiry;
+    OverwriteIndex<TriggerRecord *> m_Overwrites;
+    SubGUIDIndex<SubRecord *>     m_SubsByGUID;
+
+public:
+    /**
+     * @bounds gives the absolute range of every attribute; the 
+     * constraint at index 'i' must be for attribute 'i'.
+     **/
+    RTreePubsubStore (int hubID, const vector<Constraint>& bounds);
+    virtual ~RTreePubsubStore ();
+
+    void StoreTrigger (MsgPublication *pmsg);
+    void StoreSub (Interest *in);
+
+    void DeleteTriggers (callback<bool, MsgPublication *>::ref delpred);
+    void DeleteSubs (callback<bool, Interest *>::ref delpred);
+
+    void GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch);
+    void GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch);
+
+    Interest *FindSub (const guid_t& g);
+    bool DeleteSub (Interest *in);
+
+    void Clear ();
+
+    void ExpireSubs (const TimeVal& now);
+    void ExpireTriggers (const TimeVal& now);
+    bool HasExpiryIndex () { return true; }
+
+    int GetNumSubs () const { return m_SubRecords.size (); }
+    int GetNumTriggers () const { return m_TriggerRecords.size (); }
+private:
+    double _ToCoord (int dim, const Value& v) const;
+    void _UnlinkTrigger (TriggerRecord *rec);
+
+    template<class C> 
+	void _FillExtent (C *obj, Rect<double> *rect) const {
+	for (int d = 0; d < m_Dim; d++) {
+	    Constraint *cst = obj->GetConstraintByAttr (d);
+	    if (cst == NULL) {
+		rect->min[d] = 0.0, rect->max[d] = 1.0;
+	    }
+	    else {
+		rect->min[d] = _ToCoord (d, cst->GetMin ());
+		rect->max[d] = _ToCoord (d, cst->GetMax ());
+	    }
+	}
+    }
+};
+
+/**
+ * Keeps every item as a row of a BoxTable: one column of 32-bit 
+ * minimums and one of maximums per attribute, so a match is a tight
+ * vectorized scan (4 to 16 rows per compare; see BoxTable.h) rather 
+ * than a pointer chase through Interest/Constraint objects and GMP 
+ * compares.
+ *
+ * Values are squeezed into 32 bits the same way RTreePubsubStore maps
+ * them into [0, 1]; the mapping is monotone so the scan returns a 
+ * superset of the matches, which are then checked exactly. 
+ *
+ * Better than the trees when items are wide or few; worse when a 
+ * publication touches a tiny fraction of a large store.
+ **/
+class SoAPubsubStore : public PubsubStore {
+    int                        m_HubID;
+    int                        m_Dim;
+    vector<double>             m_Min, m_Span;    // per attribute
+
+    BoxTable<Interest *>       m_Subs;
+    BoxTable<MsgPublication *> m_Triggers;
+
+    // scratch for the quantized box of the item at hand
+    vector<sint32>             m_BoxMin, m_BoxMax;
+
+    ExpiryIndex<Interest *>       m_SubExpiry;
+    ExpiryIndex<MsgPublication *> m_TriggerExpiry;
+    OverwriteIndex<MsgPublication *> m_Overwrites;
+    SubGUIDIndex<Interest *>      m_SubsByGUID;
+
+public:
+    /**
+     * @bounds as for RTreePubsubStore.
+     **/
+    SoAPubsubStore (int hubID, const vector<Constraint>& bounds);
+    virtual ~SoAPubsubStore () { Clear (); }
+
+    void StoreTrigger (MsgPublication *pmsg);
+    void StoreSub (Interest *in);
+
+    void DeleteTriggers (callback<bool, MsgPublication *>::ref delpred);
+    void DeleteSubs (callback<bool, Interest *>::ref delpred);
+
+    void GetOverlapSubs (MsgPublication *pmsg, list<Interest *> *pmatch);
+    void GetOverlapTriggers (Interest *in, list<MsgPublication *> *pmatch);
+
+    Interest *FindSub (const guid_t& g);
+    bool DeleteSub (Interest *in);
+
+    void Clear ();
+
+    void ExpireSubs (const TimeVal& now);
+    void ExpireTriggers (const TimeVal& now);
+    bool HasExpiryIndex () { return true; }
+
+    int GetNumSubs () const { return m_Subs.size (); }
+    int GetNumTriggers () const { return m_Triggers.size (); }
+private:
+    sint32 _Quantize (int dim, const Value& v) const;
+    void _UnlinkTrigger (MsgPublication *pmsg);
+
+    template<class C> 
+	void _FillBox (C *obj, sint32 *min, sint32 *max) const {
+	for (int d = 0; d < m_Dim; d++) {
+	    Constraint *cst = obj->GetConstraintByAttr (d);
+	    if (cst == NULL) {
+		min[d] = INT_MIN, max[d] = INT_MAX;
+	    }
+	    else {
+		min[d] = _Quantize (d, cst->GetMin ());
+		max[d] = _Quantize (d, cst->GetMax ());
+	    }
+	}
+    }
+};
+
+#endif // __PUBSUBSTORE__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
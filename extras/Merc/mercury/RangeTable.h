@@ -0,0 +1,308 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  RangeTable.h
+
+  Items with ranges on one ring (peers, cached routes), as one flat
+  array of (range min, range max, item) sorted by range min, and the
+  nearest-range lookup which routing does over them. T must have a
+  GetRange (). The table keeps a copy of each item's range; call
+  Update () when one changes.
+
+  Lookup () is a binary search when the table is in ring order, which 
+  is the usual case. Stale ranges can put it out of order; lookups then
+  walk it from the start, which is what routing always used to do. 
+  Whether it is in order is kept up as items come and go, from just 
+  the entries next to them.
+
+***************************************************************************/
+
+#ifndef __RANGETABLE__H
+#define __RANGETABLE__H
+
+#include <vector>
+#include <mercury/common.h>
+#include <mercury/Constraint.h>
+
+template<class T>
+class RangeTable {
+ public:
+    struct Entry {
+	Value  min, max;      // copy of item->GetRange ()
+	T     *item;
+    };
+ protected:
+    vector<Entry> m_Entries;
+    Value         m_AbsMax;
+    int           m_Disorder;    // adjacent entries out of order (see PairOrder)
+    bool          m_Ordered;     // true => Lookup () can binary search
+
+    int Find (const T *item) const {
+	for (int i = 0, n = m_Entries.size (); i < n; i++)
+	    if (m_Entries[i].item == item)
+		return i;
+	return -1;
+    }
+
+    // Find (), by binary search on the item's range min; that is the 
+    // one in the table unless it changed without an Update ().
+    int Locate (T *item) const {
+	const Value& min = item->GetRange ().GetMin ();
+	int n = m_Entries.size ();
+	int lo = 0, hi = n;
+	while (lo < hi) {
+	    int mid = (lo + hi) / 2;
+	    if (m_Entries[mid].min < min)
+		lo = mid + 1;
+	    else
+		hi = mid;
+	}
+	for ( ; lo < n && m_Entries[lo].min == min; lo++)
+	    if (m_Entries[lo].item == item)
+		return lo;
+	return Find (item);
+    }
+
+    // after any items with the same range min, so the first one to get 
+    // a position keeps it
+    void Place (T *item) {
+	Entry e;
+	e.min = item->GetRange ().GetMin ();
+	e.max = item->GetRange ().GetMax ();
+	e.item = item;
+
+	int lo = 0, hi = m_Entries.size ();
+	while (lo < hi) {
+	    int mid = (lo + hi) / 2;
+	    if (e.min < m_Entries[mid].min)
+		hi = mid;
+	    else
+		lo = mid + 1;
+	}
+
+	CountPairs (lo, lo, -1);
+	m_Entries.insert (m_Entries.begin () + lo, e);
+	CountPairs (lo, lo + 1, 1);
+	SetOrdered ();
+	DBG_DO { CheckOrder (); }
+    }
+
+    void Remove (int i) {
+	CountPairs (i, i + 1, -1);
+	m_Entries.erase (m_Entries.begin () + i);
+	CountPairs (i, i, 1);
+	SetOrdered ();
+	DBG_DO { CheckOrder (); }
+    }
+
+    // the end of entry i, for deciding whether 'val' is past it. GetMax ()
+    // for a peer remains same even when other nodes join near that peer
+    // (they install themselves as its predecessors), so it is less 
+    // likely to be stale than GetMin ().
+    const Value& GetEnd (int i) const {
+	const Entry& e = m_Entries[i];
+	return e.min > e.max ? m_AbsMax : e.max;
+    }
+    bool Less (const Value& val, const Value& other) const {
+	return val == m_AbsMax ? val <= other : val < other;
+    }
+
+    // Lookup () binary searches on the ends of the ranges, so it needs 
+    // them in the same order as the starts. that is always true of a 
+    // consistent ring (only the last range can wrap), but not of stale
+    // ranges. PairOrder () says how entries i-1 and i are out of order;
+    // m_Disorder counts the pairs which are, in any way. that depends
+    // only on the two entries, so it can be kept up as they come and 
+    // go; but the last pair may have its maxes out of order (the last
+    // range can wrap) and the first its ends, so those are checked 
+    // again here.
+    enum { MIN_ORDER = 1, MAX_ORDER = 2, END_ORDER = 4 };
+
+    int PairOrder (int i) const {
+	int bad = 0;
+	if (!(m_Entries[i - 1].min < m_Entries[i].min))
+	    bad |= MIN_ORDER;
+	if (m_Entries[i].max < m_Entries[i - 1].max)
+	    bad |= MAX_ORDER;
+	if (GetEnd (i) < GetEnd (i - 1))
+	    bad |= END_ORDER;
+	return bad;
+    }
+
+    // count pairs from..to (where they exist) in (sign 1) or out (-1)
+    void CountPairs (int from, int to, int sign) {
+	int n = m_Entries.size ();
+	for (int i = MAX (from, 1); i <= to && i < n; i++) {
+	    if (PairOrder (i))
+		m_Disorder += sign;
+	}
+    }
+
+    // 1 if pair i is out of order only in the way it may be
+    int Excused (int i) const {
+	int n = m_Entries.size ();
+	int allowed = (i == 1 ? END_ORDER : 0) | (i == n - 1 ? MAX_ORDER : 0);
+	int o = PairOrder (i);
+	return o != 0 && (o & ~allowed) == 0 ? 1 : 0;
+    }
+
+    void SetOrdered () {
+	int n = m_Entries.size ();
+	int bad = m_Disorder;
+
+	if (n > 1)
+	    bad -= Excused (1);
+	if (n > 2)
+	    bad -= Excused (n - 1);
+	m_Ordered = bad == 0;
+    }
+
+    // the slow way, to check on the above
+    void CheckOrder () const {
+	int n = m_Entries.size ();
+
+	bool ordered = true;
+	for (int i = 1; i < n && ordered; i++) {
+	    if (!(m_Entries[i - 1].min < m_Entries[i].min))
+		ordered = false;
+	    else if (i < n - 1 && m_Entries[i].max < m_Entries[i - 1].max)
+		ordered = false;
+	    else if (i > 1 && GetEnd (i) < GetEnd (i - 1))
+		ordered = false;
+	}
+	ASSERT (ordered == m_Ordered);
+    }
+
+    // (---- p1 --- p2 --- p3 --- val --- p4 --- p5 --- p6 ----)
+    //
+    // 'val' goes to the item whose range holds it, or else to the 
+    // closest item before it. items sharing a range min count once.
+    T *LookupLinear (const Value& val) const {
+	int n = m_Entries.size ();
+	int i = 0;
+
+	while (true) {
+	    int next = i + 1;
+	    while (next < n && m_Entries[next].min == m_Entries[i].min)
+		next++;
+
+	    const Entry& cur = m_Entries[i];
+	    if (next == n) {
+		if (val >= cur.max)
+		    return cur.item;
+
+		// this can only happen when val < first.max
+		const Entry& first = m_Entries[0];
+		ASSERT (val < first.max);
+		return val >= first.min ? first.item : cur.item;
+	    }
+
+	    if (val >= cur.max && Less (val, GetEnd (next)))
+		return val < m_Entries[next].min ? cur.item : m_Entries[next].item;
+	    i = next;
+	}
+    }
+ public:
+    RangeTable (const Value& absmax) : m_AbsMax (absmax), m_Disorder (0), m_Ordered (true) {}
+
+    // adds 'item', or re-sorts it if it is already here
+    void Insert (T *item) {
+	if (Locate (item) >= 0) {
+	    Update (item);
+	    return;
+	}
+	Place (item);
+    }
+
+    void Erase (T *item) {
+	int i = Locate (item);
+	if (i >= 0)
+	    Remove (i);
+    }
+
+    // call when item's range changes; no-op unless it is in the table
+    void Update (T *item) {
+	int i = Find (item);
+	if (i < 0)
+	    return;
+
+	const NodeRange& r = item->GetRange ();
+	if (m_Entries[i].min == r.GetMin () && m_Entries[i].max == r.GetMax ())
+	    return;
+
+	Remove (i);
+	Place (item);
+    }
+
+    void Clear () {
+	m_Entries.clear ();
+	m_Disorder = 0;
+	m_Ordered = true;
+    }
+
+    // the item to forward 'val' to. the table must not be empty.
+    T *Lookup (const Value& val) const {
+	ASSERT (!m_Entries.empty ());
+	if (!m_Ordered)
+	    return LookupLinear (val);
+
+	// the first i such that val is before the end of range i+1. when
+	// ordered, that is the only place the walk above can stop early.
+
+	int n = m_Entries.size ();
+	int lo = 0, hi = n - 1;
+	while (lo < hi) {
+	    int mid = (lo + hi) / 2;
+	    if (Less (val, GetEnd (mid + 1)))
+		hi = mid;
+	    else
+		lo = mid + 1;
+	}
+
+	if (lo < n - 1 && val >= m_Entries[lo].max) {
+	    const Entry& next = m_Entries[lo + 1];
+	    return val < next.min ? m_Entries[lo].item : next.item;
+	}
+
+	const Entry& last = m_Entries[n - 1];
+	if (val >= last.max)
+	    return last.item;
+
+	const Entry& first = m_Entries[0];
+	ASSERT (val < first.max);
+	return val >= first.min ? first.item : last.item;
+    }
+
+    int Size () const { return (int) m_Entries.size (); }
+    bool Empty () const { return m_Entries.empty (); }
+    const Entry& operator[] (int i) const { return m_Entries[i]; }
+};
+
+#endif // __RANGETABLE__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
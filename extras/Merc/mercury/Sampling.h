@@ -319,6 +319,7 @@ class HistogramMaintainer : public MessageHandler
     int  EstimateNodeCount();
     int  GetNodeCountWhenLastRepaired () { return m_NodeCountWhenLastRepaired; }
     void SetHistogram (Histogram *h) { m_NodeCountHistogram = h; }
+    Histogram *GetHistogram () { return m_NodeCountHistogram; }
 
  private:
     void HandleEstimateResponse(IPEndPoint *from, MsgCB_EstimateResp *msg);
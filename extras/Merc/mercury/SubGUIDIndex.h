@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+
+/**************************************************************************
+  SubGUIDIndex.h
+
+  Subscription covering (--subcover): a store keeps at most one 
+  subscription per GUID, so an object re-registering its (slightly 
+  moved) interest does not leave the old copies around to be matched
+  until they expire. PubsubRouter decides whether a new sub replaces
+  the stored one; see PubsubRouter::CoverSubscription.
+
+  This index finds the stored sub for a GUID (the last one inserted, 
+  should two subscribers use the same GUID). H is whatever the store
+  needs to get at that sub quickly (an iterator, a record...). Subs 
+  without a GUID (GUID_NONE) are never indexed.
+
+***************************************************************************/
+
+#ifndef __SUBGUIDINDEX__H
+#define __SUBGUIDINDEX__H
+
+#include <hash_map.h>
+#include <mercury/ID.h>
+#include <mercury/Interest.h>
+
+template<class H>
+class SubGUIDIndex {
+    struct Entry {
+	Interest *in;
+	H         handle;
+    };
+    typedef hash_map<guid_t, Entry, hash_GUID, equal_GUID> GUIDMap;
+
+    GUIDMap  m_Map;
+
+ public:
+    /**
+     * If a sub with GUID 'g' is indexed, set 'in' and 'h' to it 
+     * and its handle and return true.
+     **/
+    bool Find (const guid_t& g, Interest **in, H *h) {
+	typename GUIDMap::iterator it = m_Map.find (g);
+	if (it == m_Map.end ())
+	    return false;
+	*in = it->second.in;
+	*h = it->second.handle;
+	return true;
+    }
+
+    /**
+     * 'in' must be the stored copy and stay alive until erased.
+     **/
+    void Insert (Interest *in, H h) {
+	if (in->GetGUID () == GUID_NONE)
+	    return;
+	Entry& e = m_Map[in->GetGUID ()];
+	e.in = in;
+	e.handle = h;
+    }
+
+    /**
+     * Forget 'in'; does nothing unless 'in' itself is indexed.
+     **/
+    void Erase (Interest *in) {
+	typename GUIDMap::iterator it = m_Map.find (in->GetGUID ());
+	if (it != m_Map.end () && it->second.in == in)
+	    m_Map.erase (it);
+    }
+
+    int size () const { return m_Map.size (); }
+    void Clear () { m_Map.clear (); }
+};
+
+#endif // __SUBGUIDINDEX__H
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -71,6 +71,24 @@ typedef long int       DWORD;
 #pragma GCC poison TODO
 #endif
 
+//
+// If defined, then we use a separate thread to periodically call DoWork()
+// to process pending RealNet events. If not defined, the application is
+// responsible for periodically calling DoWork(). (see wan-env/RealNet.h)
+//
+//#define ENABLE_REALNET_THREAD 1
+#undef ENABLE_REALNET_THREAD
+
+// free lists (Packet buffers, recycled messages) are kept per thread:
+// besides the RealNet thread, the --hub-threads workers decode messages
+// too, which allocates and frees. Whatever a thread frees goes on its
+// own list.
+#ifdef _WIN32
+#define POOL_LOCAL __declspec(thread)
+#else
+#define POOL_LOCAL __thread
+#endif
+
 typedef struct {
     unsigned int ip;
     int port;
@@ -92,21 +110,34 @@ typedef struct {
 
     bool    use_softsubs;       // use softstate subs
     bool    enable_pubtriggers; // enable publication triggers
+    char    pubsub_store[255];  // built-in pubsub store to use {LIST, INTERVAL, RTREE, SOA}
+    int     pub_batch;          // match up to this many pubs per receive cycle together (0 = off)
+    bool    hub_threads;        // match pubs on a thread per member hub (not with pub_batch)
 
-    //  bool    enable_puboverwriting; // enable publication triggers to be overwritten -- dont store stale pubs
+    bool    enable_puboverwriting; // enable publication triggers to be overwritten -- dont store stale pubs
+    bool    enable_subcovering; // keep one sub per GUID and subscriber at the rendezvous; re-registrations replace it
     //  int     pub_lifetime;   // how long softstate pubs live for (msec)
     int     sub_lifetime;       // how long softstate subs live for (msec)
     bool    send_backpub;       // send a pub back to the creator (false = no)
     char    merctrans[255];     // transport proto to use for mercury
     bool    use_poll;           // use poll instead of select for waiting
+    bool    use_epoll;          // use edge-triggered epoll (overrides use_poll)
+    int     udp_batch;          // datagrams per recvmmsg/sendmmsg (0 = one syscall each)
+    bool    packet_pool;        // reuse freed packet buffers and received messages
 
     bool    msg_compress;       // enable message compression
     int     msg_compminsz;      // min size of messages to compress
+    int     frame_delay;        // hold pubs/subs up to this many msec to send them to a peer together (0 = off)
+    int     frame_size;         // max bytes in one such frame
     bool    latency;            // enable artificial latency 
     char    latency_file[255];  // file with artificial latencies
     int     max_tcp_connections;// max open tcp connections (xxx: only for async realnet now)
 
     bool    fanout_pubs;        // enable "fanning out" of range pubs
+    int     fanout_degree;      // max peers each node fans a range out to (0 = all it knows)
+    bool    sub_selectivity;    // send subs to the hub where they span the fewest nodes (else a random one)
+    float   prs_slack;          // next hop: lowest-RTT peer within this fraction of the best progress (0 = off)
+    int     pns_samples;        // long pointers: candidates tried per pointer, lowest RTT kept (1 = off)
     bool    distrib_sampling;   // perform random-walk based sampling
     bool    do_loadbal;         // perform load balancing
     bool    loadbal_routeload;  // load balance using mercury's routing load
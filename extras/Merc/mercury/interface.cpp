@@ -53,6 +53,11 @@ OptionType g_MercuryOptions[] = {
       "0", (void *) "1"},
     { '#', "compress-minsize", OPT_INT,
       "min size to compress", &(g_Preferences.msg_compminsz), "128", NULL},
+    { '#', "frame-delay", OPT_INT,
+      "latency budget (msec) for coalescing pubs/subs to the same peer into one packet (0 = off)", 
+      &(g_Preferences.frame_delay), "0", NULL},
+    { '#', "frame-size", OPT_INT,
+      "max bytes in a coalesced packet", &(g_Preferences.frame_size), "1400", NULL},
     { '#', "latency", OPT_NOARG | OPT_BOOL, 
       "enable artificial latency graph", &(g_Preferences.latency),
       "0", (void *) "1"},
@@ -72,6 +77,15 @@ OptionType g_MercuryOptions[] = {
     { '#', "use-poll", OPT_NOARG | OPT_BOOL,
       "Use poll instead of select",
       &g_Preferences.use_poll, "0", (void *) "1" },
+    { '#', "use-epoll", OPT_NOARG | OPT_BOOL,
+      "Use edge-triggered epoll instead of select/poll",
+      &g_Preferences.use_epoll, "0", (void *) "1" },
+    { '#', "udp-batch", OPT_INT,
+      "UDP datagrams to receive (send) per recvmmsg (sendmmsg) call; sends wait for the next event-loop turn (0 = off)",
+      &g_Preferences.udp_batch, "0", NULL },
+    { '#', "packet-pool", OPT_NOARG | OPT_BOOL,
+      "keep freed packet buffers and received messages on free lists for reuse",
+      &g_Preferences.packet_pool, "0", (void *) "1" },
 
 
     ///// MERCURY PARAMS
@@ -98,6 +112,18 @@ OptionType g_MercuryOptions[] = {
     { '#', "fanoutpubs", OPT_NOARG | OPT_BOOL, 
       "enable \"fanning out\" of range pubs", &(g_Preferences.fanout_pubs), 
       "0", (void *) "1"},
+    { '#', "fanout-degree", OPT_INT,
+      "with --fanoutpubs, split each node's part of a range among at most this many peers (0 = all covering peers)",
+      &(g_Preferences.fanout_degree), "0", NULL },
+    { '#', "subselect", OPT_NOARG | OPT_BOOL,
+      "send each sub to the hub where, by the node-count histogram, it spans the fewest nodes",
+      &(g_Preferences.sub_selectivity), "0", (void *) "1"},
+    { '#', "prs-slack", OPT_FLT,
+      "route to the lowest-RTT peer which makes at least (1 - this) of the best peer's progress (0 = off)",
+      &(g_Preferences.prs_slack), "0", NULL },
+    { '#', "pns-samples", OPT_INT,
+      "try this many nodes near each long pointer's target and keep the lowest-RTT one (1 = off)",
+      &(g_Preferences.pns_samples), "1", NULL },
     { 's', "softsubs", OPT_NOARG | OPT_BOOL,
       "use softstate subscriptions", 
       &(g_Preferences.use_softsubs), "1", (void *) "1"},
@@ -107,6 +133,21 @@ OptionType g_MercuryOptions[] = {
     { '#', "pubtriggers", OPT_NOARG | OPT_BOOL, 
       "enable publication triggers", &(g_Preferences.enable_pubtriggers),
       "0", (void *) "1"},
+    { '#', "puboverwrite", OPT_NOARG | OPT_BOOL, 
+      "keep one trigger per object (see Event::OverwriteEvent)", 
+      &(g_Preferences.enable_puboverwriting), "0", (void *) "1"},
+    { '#', "subcover", OPT_NOARG | OPT_BOOL, 
+      "keep one sub per GUID and subscriber; re-registrations replace it", 
+      &(g_Preferences.enable_subcovering), "0", (void *) "1"},
+    { '#', "pubsub-store", OPT_STR,
+      "pubsub store used when the app does not supply one {LIST, INTERVAL, RTREE, SOA}",
+      g_Preferences.pubsub_store, "LIST", NULL},
+    { '#', "pub-batch", OPT_INT,
+      "match pubs arriving in one receive cycle together, up to this many (0 = off)",
+      &(g_Preferences.pub_batch), "0", NULL },
+    { '#', "hub-threads", OPT_NOARG | OPT_BOOL,
+      "match pubs on a thread per member hub (wan only; ignored with --pub-batch)",
+      &(g_Preferences.hub_threads), "0", (void *) "1"},
 
     // other mercury parameters
     { '#', "cache", OPT_NOARG | OPT_BOOL, 
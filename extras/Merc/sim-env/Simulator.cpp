@@ -36,6 +36,7 @@ NodeMap s_NodeMap;
 Simulator::Simulator() : m_CurrentTime (TIME_NONE)
 {
     m_Queue = new EventQueue ();
+    m_CurrentNode = NULL;
     m_LatencyFunc = NULL;
     // srand (42);
 }
@@ -86,29 +87,21 @@ void Simulator::ProcessTill (TimeVal& limit)
 		break;
 
 	    m_CurrentTime = ev->firetime;
+	    m_CurrentNode = &ev->node;
 	    ev->ev->Execute (ev->node, m_CurrentTime);
+	    m_CurrentNode = NULL;
 	    m_Queue->Pop ();
 	}
 }
 
-static Packet* _MakePacket (Message *msg)
-{
-    int len = msg->GetLength ();
-    Packet *pkt = new Packet (len);
-
-    msg->Serialize (pkt);
-
-    // if this isn't true, some component of the msg
-    // allocated too much or too little space!
-    ASSERT (pkt->GetBufPosition () == len);
-    return pkt;
-}
-
 class MessageEvent : public SchedulerEvent {
     Packet *pkt;
 public:
     MessageEvent (Message *m) {
-	pkt = _MakePacket (m);
+	pkt = SerializeMessage (m);
+    }
+    MessageEvent (Packet *p) {
+	pkt = new Packet (*p);
     }
     ~MessageEvent () { delete pkt; }
 
@@ -122,28 +115,51 @@ public:
     }
 };
 
-int Simulator::SendMessage (Message *msg, IPEndPoint *toWhom, TransportType proto)
+// the node a message leaves from: the one whose event sends it. a
+// forwarded message still carries its creator as its sender, but its
+// next hop should cost what it does from the forwarder (as in the WAN,
+// where DelayedTransport delays by connection).
+IPEndPoint& Simulator::_GetSender (Message *msg)
 {
-    ASSERT (toWhom != NULL);
-
-    // INFO << "sending message to " << *toWhom << endl;	
-    // INFO << "msg=" << msg << endl;
+    if (m_CurrentNode == NULL || m_CurrentNode == &s_DummyNode)
+	return msg->sender;
+    return m_CurrentNode->GetAddress ();
+}
 
+u_long Simulator::_GetLatency (IPEndPoint& from, IPEndPoint& to)
+{
     u_long latency = 0;
     if (m_LatencyFunc)
-	latency = (*m_LatencyFunc) (msg->sender, *toWhom);
+	latency = (*m_LatencyFunc) (from, to);
     else 
 	latency = (u_long) (1 + 0.5 * drand48()) * NODE_TO_NODE_LATENCY;
 
     if (g_Slowdown > 1.0f)
 	latency = (u_long) (latency * g_Slowdown);
+    return latency;
+}
+
+int Simulator::SendMessage (Message *msg, IPEndPoint *toWhom, TransportType proto)
+{
+    ASSERT (toWhom != NULL);
+
+    // INFO << "sending message to " << *toWhom << endl;	
+    // INFO << "msg=" << msg << endl;
+
+    RaiseEvent (new refcounted<MessageEvent>(msg), *toWhom, _GetLatency (_GetSender (msg), *toWhom));
+    return 0;
+}
+
+int Simulator::SendPacket (Message *msg, Packet *pkt, IPEndPoint *toWhom, TransportType proto)
+{
+    ASSERT (toWhom != NULL);
 
-    RaiseEvent (new refcounted<MessageEvent>(msg), *toWhom, latency);
+    RaiseEvent (new refcounted<MessageEvent>(pkt), *toWhom, _GetLatency (_GetSender (msg), *toWhom));
     return 0;
 }
 
 void Simulator::FreeMessage (Message *msg) {
-    delete msg;
+    RecycleObject<Message> (msg);
 }
 
 // vim: set sw=4 sts=4 ts=8 noet: 
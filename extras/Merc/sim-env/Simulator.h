@@ -36,7 +36,11 @@ class Simulator : public NetworkLayer, public Scheduler {
 
     EventQueue    *m_Queue;
     TimeVal        m_CurrentTime;
+    Node          *m_CurrentNode;    // whose event is executing
     LatencyFunc    m_LatencyFunc;
+
+    IPEndPoint& _GetSender (Message *msg);
+    u_long _GetLatency (IPEndPoint& from, IPEndPoint& to);
  public:
     Simulator ();
     virtual ~Simulator ();
@@ -51,6 +55,7 @@ class Simulator : public NetworkLayer, public Scheduler {
     //============================================================================
     /////// Networklayer 
     virtual int SendMessage(Message *msg, IPEndPoint *toWhom, TransportType proto);
+    virtual int SendPacket(Message *msg, Packet *pkt, IPEndPoint *toWhom, TransportType proto);
 
     // This is irrelevant for the simulator
     virtual void StartListening (TransportType proto) {}
@@ -59,7 +59,8 @@ copyright       : (C) 2003      Jeff Pang        ( jeffpang@cs.cmu.edu )
      * you must define BENCHMARK_REQUIRED. No initialization is required,
      * though if you have more than MAX_BMARK_ENTRIES different timers or
      * samplers then you will get an assertion failure (assuming DEBUG is
-     * enabled). You can increase the value at compile time.
+     * enabled). You can increase the value at compile time. Nothing is
+     * locked: use the macros from one thread only.
      *
      * Initialize:
      *
@@ -79,6 +80,12 @@ copyright       : (C) 2003      Jeff Pang        ( jeffpang@cs.cmu.edu )
      *
      * Sample the value "value" and associate it with token "My Other Label".
      *
+     *
+     * STOP_SINCE(My Label, ticks);
+     *
+     * Same as STOP, for a timer started at "ticks" (REAL_CurrentTimeTicks)
+     * instead of by START; for spans which overlap one another.
+     *
      * 
      * TIME( do stuff ... );
      *
@@ -139,6 +146,7 @@ copyright       : (C) 2003      Jeff Pang        ( jeffpang@cs.cmu.edu )
 #define STOP(token)                 BMARK_DO(stop(_bmark_key), token)
 #define STOP_ASSIGN(var, token)     BMARK_ASSIGN(var, stop_ret(_bmark_key), token)
 #define NOTE(token, value)          BMARK_DO(note(_bmark_key, value), token)
+#define STOP_SINCE(token, ticks)    BMARK_DO(stop_since(_bmark_key, ticks), token)
 #define RESTART(token)              BMARK_DO(restart(_bmark_key), token)
 #define PRINT(token)                BMARK_DO(print(_bmark_key), token)
 #define AVERAGE_ASSIGN(var, token)  BMARK_ASSIGN(var, avg(_bmark_key), token)
@@ -146,6 +154,7 @@ copyright       : (C) 2003      Jeff Pang        ( jeffpang@cs.cmu.edu )
 #define START(token) 
 #define STOP(token) 
 #define NOTE(token, value)
+#define STOP_SINCE(token, ticks)
 #define RESTART(token)
 #define PRINT(token)
 // the *_ASSIGN macros should cause a compile error if not defined, since
@@ -261,6 +270,14 @@ class Benchmark {
 	// avoid the expensive division at the end
     }
 
+    // as stop, for a timer started at 'start' (REAL_CurrentTimeTicks)
+    // rather than by start(); for spans which overlap one another.
+    inline
+	static void stop_since(int key, uint64 start) {
+	_bmark_timers[key].start = start;
+	stop(key);
+    }
+
     inline
 	static double stop_ret(int key) {
 	_STOP_COMMON;
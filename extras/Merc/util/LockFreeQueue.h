@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////
+// Mercury and Colyseus Software Distribution 
+// 
+// Copyright (C) 2004-2005 Ashwin Bharambe (ashu@cs.cmu.edu)
+//               2004-2005 Jeffrey Pang    (jeffpang@cs.cmu.edu)
+//                    2004 Mukesh Agrawal  (mukesh@cs.cmu.edu)
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2, or (at
+// your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+// USA
+/**
+ * LockFreeQueue.h
+ *
+ * A bounded queue between exactly one producer thread and exactly one
+ * consumer thread which never takes a lock. Neither side blocks: Push
+ * fails when the queue is full and Pop when it is empty, so callers
+ * decide how to wait (see HubWorker). Use Queue for anything else.
+ *
+ */
+
+#ifndef __LOCKFREEQUEUE_H__
+#define __LOCKFREEQUEUE_H__
+
+#include <util/types.h>
+#include <util/debug.h>
+
+template<class T>
+class LockFreeQueue {
+ private:
+    T *slots;
+    uint32 mask;
+
+    // only the consumer writes head, only the producer writes tail;
+    // both only ever grow (and wrap around together).
+    volatile uint32 head;
+    volatile uint32 tail;
+
+ public:
+    /**
+     * Holds up to 'size' elements, rounded up to a power of two.
+     */
+    LockFreeQueue(uint32 size) : head(0), tail(0) {
+	uint32 n = 1;
+	while (n < size)
+	    n <<= 1;
+	slots = new T[n];
+	mask = n - 1;
+    }
+    virtual ~LockFreeQueue() { delete[] slots; }
+
+    /**
+     * Producer only. False if the queue is full.
+     */
+    bool Push(const T& elem) {
+	uint32 t = tail;
+	if (t - head > mask)
+	    return false;
+	slots[t & mask] = elem;
+	__sync_synchronize();      // the slot is written before it is published
+	tail = t + 1;
+	return true;
+    }
+
+    /**
+     * Consumer only. False if the queue is empty.
+     */
+    bool Pop(T *elem) {
+	uint32 h = head;
+	if (h == tail)
+	    return false;
+	__sync_synchronize();      // see the slot the producer published
+	*elem = slots[h & mask];
+	__sync_synchronize();      // done reading before the slot is reused
+	head = h + 1;
+	return true;
+    }
+
+    bool Empty() { return head == tail; }
+};
+
+#endif
+// vim: set sw=4 sts=4 ts=8 noet: 
+// Local Variables:
+// Mode: c++
+// c-basic-offset: 4
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -59,6 +59,8 @@ class DelayedTransport : public Transport {
     int   FillReadSet(fd_set *tofill);
     void  DoWork(fd_set *isset, u_long timeout_usecs);
     uint32 GetPriority() { return m_Trans->GetPriority(); }
+    bool  HasBacklog() { return m_Trans->HasBacklog(); }
+    void  FlushSends() { m_Trans->FlushSends(); }
 
     Connection *GetConnection(IPEndPoint *target);
     ConnStatusType GetReadyConnection(Connection **connp);
@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <netinet/tcp.h>
+#include <sys/epoll.h>
 #include <wan-env/RealNet.h>
 #include <mercury/IPEndPoint.h>
 #include <mercury/NetworkLayer.h>
@@ -51,6 +52,9 @@ Mutex          RealNet::m_Lock;
 TransportMap   RealNet::m_Transports;
 fd_set         RealNet::m_ReadFileDescs;
 struct pollfd  RealNet::m_PollFileDescs[MAX_FILE_DESC];
+int            RealNet::m_EpollFD = -1;
+vector<EpollWatch> RealNet::m_EpollWatches;
+int            RealNet::m_NumUnframed = 0;
 
 void RealNet::InitWorker()
 {
@@ -86,15 +90,30 @@ void RealNet::DoWorkUsec (u_long usecs)
 	usecs % USEC_IN_SEC 
     };
 
+    // messages of a frame not handed out yet: look, but do not wait
+    if (m_NumUnframed > 0) {
+	selectTimeout.tv_sec = 0;
+	selectTimeout.tv_usec = 0;
+    }
+
     u_long msecs = (usecs / USEC_IN_MSEC);
     NOTE(REALNET:TIMEOUT, msecs);
 
     START(RealNet::DoWork);
 
+    // sends held back for batching go out before we (maybe) block
+    Lock();
+    for (TransportMapIter it = m_Transports.begin(); it != m_Transports.end(); ++it)
+	it->second->FlushSends();
+    Unlock();
+
     START(RealNet::SELECT);
 
     unsigned long long t1 = CurrentTimeUsec ();
-    _DoSelect(selectTimeout);
+    if (UsingEpoll ())
+	_DoEpoll(selectTimeout);
+    else
+	_DoSelect(selectTimeout);
     u_long consumed = (u_long) (CurrentTimeUsec () - t1);
     STOP(RealNet::SELECT);
 
@@ -201,6 +220,100 @@ void RealNet::_DoSelect(TimeVal timeout) {
     }
 }
 
+void RealNet::_InitEpoll()
+{
+    m_EpollFD = epoll_create(MAX_EPOLL_EVENTS); // the size is only a hint
+    if (m_EpollFD < 0)
+	Debug::die ("epoll_create failed: %s\n", strerror(errno));
+}
+
+void RealNet::WatchSocket(Socket sock, Transport *trans, Connection *conn)
+{
+    if (!UsingEpoll() || sock < 0)
+	return;
+    if (m_EpollFD < 0)
+	_InitEpoll();
+
+    if ((int) m_EpollWatches.size() <= sock)
+	m_EpollWatches.resize(sock + 1);
+    m_EpollWatches[sock].trans = trans;
+    m_EpollWatches[sock].conn  = conn;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN | EPOLLET;
+    ev.data.fd = sock;
+
+    // if data is already waiting, the add itself reports it
+    if (epoll_ctl(m_EpollFD, EPOLL_CTL_ADD, sock, &ev) < 0) {
+	if (errno != EEXIST || epoll_ctl(m_EpollFD, EPOLL_CTL_MOD, sock, &ev) < 0)
+	    WARN << "epoll_ctl(" << sock << ") error: " << strerror(errno) << endl;
+    }
+}
+
+void RealNet::UnwatchSocket(Socket sock, Connection *conn)
+{
+    if (m_EpollFD < 0 || sock < 0 || sock >= (int) m_EpollWatches.size())
+	return;
+
+    EpollWatch& w = m_EpollWatches[sock];
+    if (w.trans == NULL || (conn != NULL && w.conn != conn))
+	return;
+    w = EpollWatch();
+
+    // fails harmlessly if the socket has already been closed (closing
+    // it drops it from the epoll set anyway)
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    epoll_ctl(m_EpollFD, EPOLL_CTL_DEL, sock, &ev);
+}
+
+//
+// Sockets are registered with the epoll set when they are opened, so
+// unlike _DoSelect this costs O(#ready sockets), not O(#sockets). The
+// transports hear about readiness through OnReadable(); m_ReadFileDescs 
+// is left empty.
+//
+void RealNet::_DoEpoll(TimeVal timeout) {
+    static struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    FD_ZERO(&m_ReadFileDescs);
+    if (m_EpollFD < 0)
+	_InitEpoll();
+
+    int millis = (int) (timeout.tv_sec * MSEC_IN_SEC + timeout.tv_usec / USEC_IN_MSEC);
+
+    // edge-triggered: input which was reported but not read yet will
+    // not be reported again, so don't sleep on it
+    Lock();
+    for (TransportMapIter it = m_Transports.begin(); it != m_Transports.end(); it++) {
+	if (it->second->HasBacklog()) {
+	    millis = 0;
+	    break;
+	}
+    }
+    Unlock();
+
+    int ret = epoll_wait(m_EpollFD, events, MAX_EPOLL_EVENTS, millis);
+    if (ret < 0) {
+	if (errno != EINTR)
+	    WARN << "epoll error: " << strerror(errno) << endl;
+	return;
+    }
+
+    // EPOLLHUP and EPOLLERR are handed out as "readable" too; the read
+    // will find out what happened, as it does after a select.
+    for (int i = 0; i < ret; i++) {
+	Socket sock = events[i].data.fd;
+	if (sock >= (int) m_EpollWatches.size())
+	    continue;
+
+	EpollWatch& w = m_EpollWatches[sock];
+	if (w.trans != NULL)
+	    w.trans->OnReadable(w.conn);
+    }
+}
+
 Transport *RealNet::_LookupTransport(const ProtoID& proto)
 {
     Lock();
@@ -295,6 +408,13 @@ RealNet::RealNet(Scheduler *scheduler, IPEndPoint appID, bool recordBwidthUsage,
 // delete the connections only once - since the entries in the hash and list are the same!
 // 
 RealNet::~RealNet() {
+    // also cancels the frames' flush timers, which point back at us
+    FlushFrames();
+
+    for (UnframedList::iterator it = m_Unframed.begin(); it != m_Unframed.end(); ++it)
+	delete it->second;
+    m_NumUnframed -= m_Unframed.size();
+
     StopListening();
 }
 
@@ -367,8 +487,9 @@ int RealNet::SendMessage(Message *msg, IPEndPoint *toWhom, TransportType p) {
 
     //STOP( SendMessage::1 );
 
-    //START( SendMessage::2::GetLength );
-    int len = msg->GetLength();
+    // serialized once; the length falls out of that
+    Packet *pkt = SerializeMessage(msg);
+    int len = pkt->GetUsed();
 
     if (len > 65 * 1000) {
 	WARN << " humonguous packet length in RealNet::SendMessage len=" << len << endl;
@@ -376,23 +497,24 @@ int RealNet::SendMessage(Message *msg, IPEndPoint *toWhom, TransportType p) {
 	ASSERT (len <= 65 * 1000);
     }
 
-    //STOP( SendMessage::2::GetLength );
     int ret;
     ///// Message compression
     if (g_Preferences.msg_compress &&
 	msg->sender != *toWhom && 
 	len > g_Preferences.msg_compminsz) {
 	//START( SendMessage::2::Compress );
-	MsgCompressed cmsg = MsgCompressed(msg);
+	MsgCompressed cmsg(msg, pkt);
 	int clen = cmsg.GetLength();
 	//STOP( SendMessage::2::Compress );
 	// only send compressed if compressed message is smaller
-	if (len > clen)
+	if (len > clen) {
+	    delete pkt;
 	    ret = _SendMessage(&cmsg, connection);
+	}
 	else
-	    ret = _SendMessage(msg, connection);
+	    ret = _SendPacket(msg, pkt, connection);
     } else {
-	ret = _SendMessage(msg, connection);
+	ret = _SendPacket(msg, pkt, connection);
     }
     /////
 
@@ -409,6 +531,41 @@ int RealNet::SendMessage(Message *msg, IPEndPoint *toWhom, TransportType p) {
     return ret;
 }
 
+int RealNet::SendPacket(Message *msg, Packet *pkt, IPEndPoint *toWhom, TransportType p) {
+    // compression works on messages; and if the bytes do not say they
+    // come from us, they have to be made again anyway.
+    if (g_Preferences.msg_compress || (msg->IsMercMsg() && msg->sender != m_AppID)) {
+	return SendMessage(msg, toWhom, p);
+    }
+
+    ProtoID proto(m_AppID, p);
+
+    Transport *t = _LookupTransport(proto);
+
+    Connection *connection = t->GetConnection(toWhom);
+    if (connection == NULL) {
+	// connect failed
+	return -1;
+    }
+    m_SentMessages++;
+
+    // SendMessage bumps the hop count before serializing and picks a
+    // new nonce after; do the same to our copy of the bytes.
+    Packet *copy = new Packet(*pkt);
+    msg->hopCount++;
+    copy->PatchShort(msg->GetHopCountOffset(), msg->hopCount);
+    copy->PatchInt(msg->GetNonceOffset(), msg->nonce);
+
+    int ret = _SendPacket(msg, copy, connection);
+    msg->nonce = (uint32)(drand48()*0xFFFFFFFFUL);
+
+    if (ret < 0) {
+	WARN << "failed to send to " << *toWhom << " of " << msg 
+	     << " errno=" << errno << "(" << strerror(errno) << ")" << endl;
+    }
+    return ret;
+}
+
 MsgType __GetSubTypeForLogging (Message *msg) {
     Interest *in = ((MsgSubscription *) msg)->GetInterest ();
 
@@ -451,6 +608,31 @@ MsgType __GetPubTypeForLogging(Message *msg) {
     return MSG_PUB;
 }
 
+// what --frame-delay holds back: pubs and subs, not the control 
+// traffic (pings would make peers look further away than they are)
+static bool __IsFramed (Message *msg)
+{
+    byte type = msg->GetType ();
+    if (type == MSG_COMPRESSED)
+	type = ((MsgCompressed *)msg)->orig->GetType();
+
+    return type == MSG_PUB || type == MSG_LINEAR_PUB || type == MSG_PUB_BATCH ||
+	type == MSG_SUB || type == MSG_LINEAR_SUB;
+}
+
+// the message inside a MSG_COMPRESSED; others are returned as they are
+static Message *__Uncompress (Message *msg)
+{
+    if (msg->GetType() != MSG_COMPRESSED)
+	return msg;
+
+    MsgCompressed *cmsg = (MsgCompressed *) msg;
+    Message *orig = cmsg->orig;
+    orig->recvTime = cmsg->recvTime;
+    delete cmsg;
+    return orig;
+}
+
 static byte __GetMsgType (Message *msg)
 {
     byte type = msg->GetType ();
@@ -478,27 +660,12 @@ static byte __GetMsgType (Message *msg)
     return type;
 }
 
-static Packet* _MakePacket (Message *msg)
-{
-    int len = msg->GetLength ();
-    Packet *pkt = new Packet (len);
-
-    msg->Serialize (pkt);
-
-    // if this isn't true, some component of the msg
-    // allocated too much or too little space!
-    ASSERT (pkt->GetBufPosition () == len);
-    return pkt;
-}
-
 int RealNet::_SendMessage(Message *msg, Connection *connection) {
-    int err = 0;
     Packet *pkt = 0;
     //try {
     //START( _SendMessage::Packet );
 
-    pkt = _MakePacket (msg);
-    ASSERT ((uint32) pkt->GetUsed () == msg->GetLength ());
+    pkt = SerializeMessage (msg);
 
     // pkt = new Packet(msg);
     //STOP( _SendMessage::Packet );
@@ -507,6 +674,11 @@ int RealNet::_SendMessage(Message *msg, Connection *connection) {
     //    return -1;
     //}
 
+    return _SendPacket (msg, pkt, connection);
+}
+
+// 'pkt' is 'msg' serialized; the connection takes it over.
+int RealNet::_SendPacket(Message *msg, Packet *pkt, Connection *connection) {
     //START( _SendMessage::Logging );
 
     TimeVal& now = m_Scheduler->TimeNow ();
@@ -585,9 +757,116 @@ int RealNet::_SendMessage(Message *msg, Connection *connection) {
 	    }
     }
     /// MEASUREMENT
+
+    if (g_Preferences.frame_delay > 0) {
+	if (__IsFramed (msg))
+	    return _QueueFramed(pkt, connection);
+
+	// anything else must not overtake what is held back
+	_FlushFrame(ProtoID(*connection->GetAppPeerAddress(), connection->GetProtocol()));
+    }
     return connection->SendMessage(pkt);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Framing (--frame-delay): at game update rates most packets are small
+// pubs, and the per-packet cost (syscall, headers) dominates. pubs and
+// subs to a peer are held for up to frame_delay msec, or until 
+// frame_size bytes are waiting, and sent as one MSG_FRAME. 
+//
+// So a pub or sub is only queued when SendMessage returns: it fails
+// right away if the connection already has, but a send that fails at
+// the flush can only be logged.
+
+class FrameFlushTimer : public Timer {
+    RealNet *m_RealNet;
+    ProtoID  m_To;
+public:
+    FrameFlushTimer (RealNet *realnet, const ProtoID& to) : 
+	Timer (0), m_RealNet (realnet), m_To (to) {}
+    void OnTimeout () {
+	// _FlushFrame drops the frame's reference to us
+	ref<Timer> self = mkref (this);
+	m_RealNet->_FlushFrame (m_To);
+    }
+};
+
+int RealNet::_QueueFramed(Packet *pkt, Connection *connection) {
+    ProtoID to(*connection->GetAppPeerAddress(), connection->GetProtocol());
+    uint32 size = (uint32) g_Preferences.frame_size;
+    uint32 need = MsgFrame::GetPartOverhead() + pkt->GetUsed();
+
+    if (connection->GetStatus() == CONN_CLOSED || connection->GetStatus() == CONN_ERROR) {
+	delete pkt;
+	return -1;
+    }
+
+    if (MsgFrame::GetHeaderLength() + need > size) {
+	_FlushFrame(to);
+	return connection->SendMessage(pkt);
+    }
+
+    PendingFrame& frame = m_PendingFrames[to];
+    if (MsgFrame::GetHeaderLength() + frame.bytes + need > size)
+	_FlushFrame(to);
+
+    int len = pkt->GetUsed();
+    frame.pkts.push_back(pkt);
+    frame.bytes += need;
+
+    if (frame.pkts.size() == 1) {
+	frame.flush = new refcounted<FrameFlushTimer>(this, to);
+	m_Scheduler->RaiseEvent(frame.flush, m_AppID, g_Preferences.frame_delay);
+    }
+    return len;
+}
+
+void RealNet::_FlushFrame(const ProtoID& to) {
+    PendingFrameMapIter it = m_PendingFrames.find(to);
+    if (it == m_PendingFrames.end() || it->second.pkts.size() == 0)
+	return;
+
+    PendingFrame& frame = it->second;
+    uint32 nmsgs = frame.pkts.size();
+    Packet *pkt;
+
+    if (frame.flush) {
+	frame.flush->Cancel();
+	frame.flush = NULL;
+    }
+
+    // a lone message goes out as it is
+    if (frame.pkts.size() == 1)
+	pkt = frame.pkts[0];
+    else {
+	MsgFrame fmsg;
+	for (uint32 i = 0; i < frame.pkts.size(); i++)
+	    fmsg.AddPacket(frame.pkts[i]);
+	pkt = SerializeMessage(&fmsg);
+    }
+
+    frame.pkts.clear();
+    frame.bytes = 0;
+
+    Transport *t = _LookupTransport(ProtoID(m_AppID, to.proto));
+    Connection *connection = t->GetConnection((IPEndPoint *) &to.id);
+    if (connection == NULL) {
+	WARN << "no connection to " << to.id << "; dropped " << nmsgs << " framed messages" << endl;
+	delete pkt;
+	return;
+    }
+
+    if (connection->SendMessage(pkt) < 0) {
+	WARN << "failed to send frame of " << nmsgs << " messages to " << to.id 
+	     << " errno=" << errno << "(" << strerror(errno) << ")" << endl;
+    }
+}
+
+void RealNet::FlushFrames() {
+    for (PendingFrameMapIter it = m_PendingFrames.begin(); it != m_PendingFrames.end(); ++it)
+	_FlushFrame(it->first);
+}
+
 //
 // lookup the socket corresponding to the endpoint
 // and close the socket.
@@ -618,6 +897,15 @@ ConnStatusType RealNet::GetNextMessage(IPEndPoint *ref_fromWhom, Message **ref_m
     ConnStatusType status = CONN_NOMSG;
     Connection *connection = 0;
 
+    if (!m_Unframed.empty ()) {
+	*ref_fromWhom = m_Unframed.front ().first;
+	*ref_msg = m_Unframed.front ().second;
+	m_Unframed.pop_front ();
+	m_NumUnframed--;
+	m_RecvMessages++;
+	return CONN_OK;
+    }
+
     TimeVal now = m_Scheduler->TimeNow ();
 
     // XXX not sure what could be more efficient :P
@@ -727,11 +1015,29 @@ ConnStatusType RealNet::GetNextMessage(IPEndPoint *ref_fromWhom, Message **ref_m
 	}
 
 	//// Decompression
-	if ((*ref_msg) && (*ref_msg)->GetType() == MSG_COMPRESSED) {
-	    MsgCompressed *cmsg = (MsgCompressed *)*ref_msg;
-	    *ref_msg = cmsg->orig;
-	    (*ref_msg)->recvTime = cmsg->recvTime;
-	    delete cmsg;
+	*ref_msg = __Uncompress (*ref_msg);
+	/////
+
+	//// Framing: hand out the first message now, the rest on the next calls
+	if ((*ref_msg)->GetType() == MSG_FRAME) {
+	    MsgFrame *fmsg = (MsgFrame *) *ref_msg;
+	    for (uint32 i = 0; i < fmsg->msgs.size(); i++) {
+		Message *msg = __Uncompress (fmsg->msgs[i]);
+		msg->recvTime = fmsg->recvTime;
+		m_Unframed.push_back (UnframedList::value_type (*ref_fromWhom, msg));
+		m_NumUnframed++;
+	    }
+	    fmsg->msgs.clear ();
+	    delete fmsg;
+
+	    *ref_msg = NULL;
+	    if (m_Unframed.empty ()) {
+		ret = CONN_NOMSG;
+		break;
+	    }
+	    *ref_msg = m_Unframed.front ().second;
+	    m_Unframed.pop_front ();
+	    m_NumUnframed--;
 	}
 	/////
 
@@ -749,25 +1055,26 @@ ConnStatusType RealNet::GetNextMessage(IPEndPoint *ref_fromWhom, Message **ref_m
 }
 
 //
-// One could implement a message buffer pool as well! 
+// With --packet-pool, the message's storage goes back to the free list
+// for its type; the next one CreateObject() decodes will reuse it.
 //
 void RealNet::FreeMessage(Message *msg) {
-    delete msg;
+    RecycleObject<Message> (msg);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-bool RealNet::IsDataWaiting(Socket sock) {
-    TimeVal t;
-    t.tv_sec  = 0;
-    t.tv_usec = 0;
+// these use poll rather than select since, with --use-epoll, sockets
+// can be numbered past FD_SETSIZE
 
-    fd_set ready;
-    FD_ZERO(&ready);
-    FD_SET(sock, &ready);
+bool RealNet::IsDataWaiting(Socket sock) {
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
 
-    select((int) sock + 1, &ready, 0, 0, &t);
-    if (FD_ISSET(sock, &ready) != 0)
+    // select would also call a socket with a pending error or EOF readable
+    if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR)))
 	return true;
     else
 	return false;
@@ -800,7 +1107,6 @@ int RealNet::ReadDatagramTime (Socket sock, IPEndPoint *fromWhom,
     char ctrl[CMSG_SPACE(sizeof(struct timeval))];
     struct sockaddr_in junk;
 
-    struct cmsghdr *cmsg = (struct cmsghdr *) &ctrl;
     msg.msg_control = (caddr_t) ctrl;
     msg.msg_controllen = sizeof(ctrl);
     msg.msg_name = &junk;
@@ -812,7 +1118,21 @@ int RealNet::ReadDatagramTime (Socket sock, IPEndPoint *fromWhom,
 
     error = recvmsg (sock, &msg, 0);
 
-    if (cmsg->cmsg_level == SOL_SOCKET &&
+    if (error >= 0) { 
+	GetDatagramTime (&msg, tv);
+	fromWhom->m_IP = junk.sin_addr.s_addr;
+	fromWhom->m_Port = ntohs (junk.sin_port);
+    }
+
+    return error;
+}
+
+void RealNet::GetDatagramTime(struct msghdr *msg, TimeVal *tv)
+{
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR (msg);
+
+    if (cmsg != NULL &&
+	cmsg->cmsg_level == SOL_SOCKET &&
 	cmsg->cmsg_type == SCM_TIMESTAMP &&
 	cmsg->cmsg_len == CMSG_LEN (sizeof (struct timeval))) { 
 	/* Copy to avoid alignment problems: */
@@ -824,22 +1144,16 @@ int RealNet::ReadDatagramTime (Socket sock, IPEndPoint *fromWhom,
 	    ApplySlowdown(*tv);
 	}
     }
-
-    if (error >= 0) { 
-	fromWhom->m_IP = junk.sin_addr.s_addr;
-	fromWhom->m_Port = ntohs (junk.sin_port);
-    }
-
-    return error;
 }
 
 bool RealNet::WaitForWritable(Socket sock, TimeVal *t) {
-    fd_set ready;
-    FD_ZERO(&ready);
-    FD_SET(sock, &ready);
-	
-    select((int) sock + 1, 0, &ready, 0, t);
-    if (FD_ISSET(sock, &ready) != 0)
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    int millis = (t == NULL) ? -1 : (int) (t->tv_sec * MSEC_IN_SEC + t->tv_usec / USEC_IN_MSEC);
+    if (poll(&pfd, 1, millis) > 0 && (pfd.revents & (POLLOUT | POLLHUP | POLLERR)))
         return true;
     else
         return false;
@@ -888,6 +1202,32 @@ int RealNet::WriteDatagram(Socket sock, IPEndPoint *toWhom,
     return error;
 }
 
+int RealNet::WriteDatagrams(Socket sock, struct mmsghdr *msgs, int n)
+{
+    TimeVal wait = { 0, 100*1000 }; // XXX HACK (see WriteDatagram)
+    int sent = 0;
+
+    while (sent < n) {
+	int error = sendmmsg(sock, msgs + sent, n - sent, 0);
+	if (error >= 0) {
+	    sent += error;
+	    continue;
+	}
+
+	if (errno == EAGAIN || errno == ENOBUFS || 
+	    errno == EINTR || errno == ENOMEM) {
+	    WaitForWritable(sock, &wait);
+	    continue;
+	}
+
+	// sendmmsg only fails if the first datagram does; skip it
+	WARN << "errno: " << errno << " str: " << strerror(errno) << endl;
+	sent++;
+    }
+
+    return sent;
+}
+
 int RealNet::WriteBlock(Socket fd, byte *buffer, int length) {
     int totalWritten = 0;
     while (totalWritten < length) {
@@ -36,17 +36,13 @@ typedef float bwidth_t;    // XXX HACK: - Ashwin [03/06/2006]
 #include <wan-env/Connection.h>
 #include <wan-env/Transport.h>
 #include <mercury/RoutingLogs.h>
+#include <mercury/Timer.h>
 #include <sys/poll.h>
+#include <sys/socket.h>
 
 //#define ENABLE_TEST 1
 
-//
-// If defined, then we use a separate thread to periodically call DoWork()
-// to process pending RealNet events. If not defined, the application is
-// responsible for periodically calling DoWork().
-//
-//#define ENABLE_REALNET_THREAD 1
-#undef ENABLE_REALNET_THREAD
+// ENABLE_REALNET_THREAD is set in mercury/common.h
 
 ///////////////////////////////////////////////////////////////////////////////
 //////// For estimating bandwidth usage. *Very* simple moving window based
@@ -90,6 +86,22 @@ typedef TransportMap::iterator TransportMapIter;
 typedef set<ProtoID, less_ProtoID> ProtoIDSet;
 typedef ProtoIDSet::iterator ProtoIDSetIter;
 
+// pubs and subs waiting to be sent to one peer in a single frame 
+// (--frame-delay); keyed by the peer's address and the protocol.
+struct PendingFrame {
+    vector<Packet *> pkts;
+    uint32           bytes;     // as they will be in the frame
+    ptr<Timer>       flush;     // sends it after frame_delay; cancelled by any earlier flush
+
+    PendingFrame() : bytes(0), flush(NULL) {}
+};
+
+typedef map<ProtoID, PendingFrame, less_ProtoID> PendingFrameMap;
+typedef PendingFrameMap::iterator PendingFrameMapIter;
+
+// messages which came in a frame and have not been handed out yet
+typedef list< pair<IPEndPoint, Message *> > UnframedList;
+
 ///////////////////////////////////////////////////////////////////////////////
 
 class RealNetWorker;
@@ -97,11 +109,22 @@ class Scheduler;
 
 #include <util/debug.h>
 #define MAX_FILE_DESC 40960      // 40K file descriptors!
+#define MAX_EPOLL_EVENTS 1024    // readiness events taken per epoll_wait
+
+// who gets told when a socket watched by the epoll backend becomes
+// readable; see RealNet::WatchSocket.
+struct EpollWatch {
+    Transport  *trans;
+    Connection *conn;           // NULL for the transport's own socket
+
+    EpollWatch() : trans(NULL), conn(NULL) {}
+};
 
 class RealNet : public NetworkLayer {
     friend class Connection;
     friend class Transport;
     friend class RealNetWorker;
+    friend class FrameFlushTimer;
 
     ///// GLOBAL VARIABLES /////
 
@@ -123,6 +146,9 @@ class RealNet : public NetworkLayer {
     static TransportMap          m_Transports;
     static fd_set                m_ReadFileDescs;      // for select
     static struct pollfd         m_PollFileDescs [MAX_FILE_DESC];      // for poll
+    static int                   m_EpollFD;            // for epoll; -1 = not yet
+    static vector<EpollWatch>    m_EpollWatches;       // indexed by socket
+    static int                   m_NumUnframed;        // in all the instances' m_Unframed
 
     //
     // Start the singleton worker thread
@@ -142,6 +168,8 @@ class RealNet : public NetworkLayer {
 
     static Transport *_LookupTransport(const ProtoID& proto);
     static void       _DoSelect(TimeVal timeout);
+    static void       _DoEpoll(TimeVal timeout);
+    static void       _InitEpoll();
 
 #ifndef ENABLE_REALNET_THREAD
  public:
@@ -161,6 +189,17 @@ class RealNet : public NetworkLayer {
     //
     static void InterruptWorker();
 
+    //
+    // epoll backend (--use-epoll): sockets are registered once, when
+    // they are opened, instead of being collected by FillReadSet on
+    // every loop. readiness is edge-triggered and handed to
+    // trans->OnReadable(conn). these are no-ops for select and poll.
+    //
+    static bool UsingEpoll() { return g_Preferences.use_epoll; }
+    static void WatchSocket(Socket sock, Transport *trans, Connection *conn = NULL);
+    // if conn is given, only drop the watch if it is still conn's
+    static void UnwatchSocket(Socket sock, Connection *conn = NULL);
+
  private:
 
     ///////////////////////////////////////////////////////////////////////////
@@ -184,6 +223,9 @@ class RealNet : public NetworkLayer {
     uint32 m_SentMessages, m_RecvMessages;
     TimeVal m_StartTime;
 
+    PendingFrameMap m_PendingFrames;
+    UnframedList    m_Unframed;
+
     Scheduler *GetScheduler () { return m_Scheduler; }
  public:
 
@@ -215,6 +257,10 @@ class RealNet : public NetworkLayer {
     void CloseConnection(IPEndPoint *otherEnd, TransportType proto);
 
     int SendMessage(Message *msg, IPEndPoint *toWhom, TransportType proto);
+    int SendPacket(Message *msg, Packet *pkt, IPEndPoint *toWhom, TransportType proto);
+
+    // send out everything held back for framing right away
+    void FlushFrames();
 
     bwidth_t GetOutboundUsage(TimeVal& now); /* in bytes/sec */
     bwidth_t GetInboundUsage(TimeVal& now);  /* in bytes/sec */
@@ -234,8 +280,12 @@ class RealNet : public NetworkLayer {
 				byte *buffer, int length);
     static int    ReadDatagramTime (Socket sock, IPEndPoint *fromWhom,
 				    byte *buffer, int length, TimeVal *tv);
+    // the SO_TIMESTAMP of a datagram read with recvmsg/recvmmsg, if any
+    static void   GetDatagramTime (struct msghdr *msg, TimeVal *tv);
     static int    WriteDatagram (Socket sock, IPEndPoint *toWhom,
 				 byte *buffer, int length);
+    // sendmmsg() all 'n' datagrams, retrying like WriteDatagram
+    static int    WriteDatagrams (Socket sock, struct mmsghdr *msgs, int n);
     static int    WriteBlock   (Socket sock, byte *buffer, int length);
     static int    ReadNoBlock  (Socket sock, byte *buffer, int length);
     static int    ReadBlock    (Socket sock, byte *buffer, int length);
@@ -249,6 +299,9 @@ class RealNet : public NetworkLayer {
  private:
 
     int    _SendMessage(Message *msg, Connection *connection);
+    int    _SendPacket(Message *msg, Packet *pkt, Connection *connection);
+    int    _QueueFramed(Packet *pkt, Connection *connection);
+    void   _FlushFrame(const ProtoID& to);
 
     void   RecordOutbound(uint32 size, TimeVal& now);
     void   RecordInbound(uint32 size, TimeVal& now);
@@ -27,7 +27,7 @@
 #include <wan-env/RealNet.h>
 
 TCPConnection::TCPConnection(Transport *t, Socket sock, IPEndPoint *otherEnd) :
-    UnbufferedConnection(t, sock, otherEnd)
+    UnbufferedConnection(t, sock, otherEnd), m_Ready(false)
 {
     SetSocketPeerAddress();
 }
@@ -32,6 +32,8 @@ class TCPConnection : public UnbufferedConnection {
 
     friend class TCPTransport;
 
+    bool m_Ready;       // on TCPTransport's ready list (epoll backend)
+
     int _InitNewMessage();
     int _ReadMessage_TCP();
 
@@ -76,6 +76,17 @@ void TCPTransport::StartListening()
 		    m_ID.m_Port);
     }
 
+    if (RealNet::UsingEpoll()) {
+	// edge-triggered: we accept until EAGAIN, which must not block
+	int n;
+	if ((n = fcntl (m_ListenSocket, F_GETFL)) < 0
+	    || fcntl (m_ListenSocket, F_SETFL, n | O_NONBLOCK) < 0) {
+	    perror ("fcntl");
+	    Debug::die ("error while setting the socket to nonblocking");
+	}
+	RealNet::WatchSocket(m_ListenSocket, this);
+    }
+
     DB(1) << "Started [PROTO_TCP] server at port " 
 	  << m_ID.m_Port << " successfully..." << endl;
     return;
@@ -83,8 +94,10 @@ void TCPTransport::StartListening()
 
 void  TCPTransport::StopListening()
 {
-    if (m_ListenSocket > 0)
+    if (m_ListenSocket > 0) {
+	RealNet::UnwatchSocket(m_ListenSocket);
 	OS::CloseSocket(m_ListenSocket);
+    }
 
     _ClearConnections();
 }
@@ -159,6 +172,8 @@ Connection *TCPTransport::GetConnection(IPEndPoint *toWhom)
 	m_AppConnHash.Insert(connection->GetAppPeerAddress(), connection);
 	Unlock();
 
+	RealNet::WatchSocket(sock, this, connection);
+
 	// added a socket, so must interrupt select
 	GetNetwork()->InterruptWorker();
     }
@@ -166,15 +181,91 @@ Connection *TCPTransport::GetConnection(IPEndPoint *toWhom)
     return connection;
 }
 
-ConnStatusType TCPTransport::GetReadyConnection(Connection **connp)
+void TCPTransport::OnReadable(Connection *conn)
 {
-    // XXX: more efficient please!
+    if (conn == NULL) {
+	m_ListenReady = true;
+	return;
+    }
+
+    TCPConnection *connection = (TCPConnection *) conn;
+    if (!connection->m_Ready) {
+	connection->m_Ready = true;
+	m_ReadyList.push_back(connection);
+    }
+}
+
+//
+// Try to read a message from this connection
+//
+ConnStatusType TCPTransport::_ReadFrom(TCPConnection *connection, Connection **connp)
+{
+    ConnStatusType ret = CONN_NOMSG;
 
+    switch (connection->PerformRead()) {
+    case NetworkLayer::READ_CLOSE:
+	DB(1) << "connection close!" << endl;
+	connection->SetStatus(CONN_CLOSED);
+	*connp = connection;
+	ret = CONN_CLOSED;
+	break;
+    case NetworkLayer::READ_ERROR:
+	DB(1) << "connection error!" << endl;
+	connection->SetStatus(CONN_ERROR);
+	*connp = connection;
+	ret = CONN_ERROR;
+	break;
+    case NetworkLayer::READ_INCOMPLETE:
+	DBG << "Read Incomplete" << endl;
+	break;
+    case NetworkLayer::READ_COMPLETE:
+	*connp = connection;
+	ret = connection->GetStatus();
+	connection->SetStatus(CONN_OK);
+	break;
+    }
+
+    return ret;
+}
+
+ConnStatusType TCPTransport::GetReadyConnection(Connection **connp)
+{
     *connp = 0;
     ConnStatusType ret = CONN_NOMSG;
 
     Lock();
 
+    if (RealNet::UsingEpoll()) {
+	// only look at connections epoll said became readable
+	for (ConnectionListIter iter = m_ReadyList.begin(); 
+	     iter != m_ReadyList.end(); /* !!! */ ) {
+	    TCPConnection *connection = (TCPConnection *)(*iter);
+
+	    if ( connection->GetStatus() == CONN_CLOSED || 
+		 connection->GetStatus() == CONN_ERROR  ||
+		 !RealNet::IsDataWaiting(connection->GetSocket()) ) {
+		// read dry; the next edge puts it back
+		connection->m_Ready = false;
+		iter = m_ReadyList.erase(iter);
+		continue;
+	    }
+
+	    ret = _ReadFrom(connection, connp);
+	    if (*connp) {
+		// let the other ready guys have a chance
+		m_ReadyList.erase(iter);
+		m_ReadyList.push_back(connection);
+		break;
+	    }
+	    iter++;
+	}
+
+	Unlock();
+	return ret;
+    }
+
+    // XXX: more efficient please!
+
     for (ConnectionListIter iter = m_ConnectionList.begin(); 
 	 iter != m_ConnectionList.end(); iter++) {
 	TCPConnection *connection = (TCPConnection *)(*iter);
@@ -184,29 +275,7 @@ ConnStatusType TCPTransport::GetReadyConnection(Connection **connp)
 	     !RealNet::IsDataWaiting(connection->GetSocket()) )
 	    continue;
 
-	// Try to read a message from this connection
-	switch (connection->PerformRead()) {
-	case NetworkLayer::READ_CLOSE:
-	    DB(1) << "connection close!" << endl;
-	    connection->SetStatus(CONN_CLOSED);
-	    *connp = connection;
-	    ret = CONN_CLOSED;
-	    break;
-	case NetworkLayer::READ_ERROR:
-	    DB(1) << "connection error!" << endl;
-	    connection->SetStatus(CONN_ERROR);
-	    *connp = connection;
-	    ret = CONN_ERROR;
-	    break;
-	case NetworkLayer::READ_INCOMPLETE:
-	    DBG << "Read Incomplete" << endl;
-	    break;
-	case NetworkLayer::READ_COMPLETE:
-	    *connp = connection;
-	    ret = connection->GetStatus();
-	    connection->SetStatus(CONN_OK);
-	    break;
-	}
+	ret = _ReadFrom(connection, connp);
 
 	if (*connp) {
 	    // we serviced this fellow now - let the other guys have a chance!
@@ -229,6 +298,7 @@ void TCPTransport::CloseConnection(IPEndPoint *target) {
     if (!connection)
 	return;
 
+    RealNet::UnwatchSocket(connection->GetSocket(), connection);
     OS::CloseSocket(connection->GetSocket()); // do it ourselves.
     connection->SetStatus(CONN_CLOSED);
 }
@@ -335,7 +405,10 @@ void TCPTransport::_RegisterNewTCPConnections(fd_set *isset) {
     if (m_ListenSocket <= 0)
 	return;
 
-    if (FD_ISSET(m_ListenSocket, isset)) {
+    // (with epoll, the listen socket may not even fit in an fd_set)
+    bool ready = RealNet::UsingEpoll() ? m_ListenReady : FD_ISSET(m_ListenSocket, isset);
+
+    if (ready) {
 	struct sockaddr_in address;
 	int addrlen = sizeof(sockaddr_in);
 
@@ -345,6 +418,9 @@ void TCPTransport::_RegisterNewTCPConnections(fd_set *isset) {
 			     (socklen_t *) &addrlen);
 	if (ret < 0 && errno == EINTR) {
 	    // interrupted, just ignore this
+	} else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+	    // (epoll) accepted everything; wait for the next edge
+	    m_ListenReady = false;
 	} else if (ret < 0) {
 	    WARN << "Error while accepting a connection... " << endl;
 	} else {
@@ -362,6 +438,7 @@ void TCPTransport::_RegisterNewTCPConnections(fd_set *isset) {
 	    Connection *connection = 
 		new TCPConnection(this, newsock, &otherEnd);
 	    connection->SetStatus(CONN_NEWINCOMING);
+	    RealNet::WatchSocket(newsock, this, connection);
 
 	    Lock();
 	    Connection *old = m_AppConnHash.Lookup(&otherEnd);
@@ -423,6 +500,35 @@ void TCPTransport::_RegisterNewTCPConnections(fd_set *isset) {
     }
 
 }
+
+void TCPTransport::_ClearConnections() {
+    Lock();
+    m_ReadyList.clear();
+    Unlock();
+    // parent will actually delete the connections
+    Transport::_ClearConnections();
+}
+
+void TCPTransport::_CleanupConnections() {
+    Lock();
+    for (ConnectionListIter iter = m_ReadyList.begin();
+	 iter != m_ReadyList.end(); /* !!! */ ) {
+	Connection *connection = *iter;
+
+	if (connection->GetStatus() == CONN_CLOSED ||
+	    connection->GetStatus() == CONN_ERROR) {
+	    ((TCPConnection *) connection)->m_Ready = false;
+	    iter = m_ReadyList.erase(iter);
+	}
+	else {
+	    iter++;
+	}
+    }
+    Unlock();
+    // parent will remove conn from m_ConnectionList and m_AppConnHash
+    // as well as actually delete the connection
+    Transport::_CleanupConnections();
+}
 // vim: set sw=4 sts=4 ts=8 noet: 
 // Local Variables:
 // Mode: c++
@@ -28,6 +28,8 @@
 #include <wan-env/Transport.h>
 #include <wan-env/TCPConnection.h>
 
+class TCPConnection;
+
 /**
  * Basic interface to kernel level TCP Transport.
  */
@@ -39,11 +41,20 @@ class TCPTransport : public Transport {
 
     Socket m_ListenSocket;
 
+    // epoll backend: readiness which has not been read dry yet
+    bool           m_ListenReady;
+    ConnectionList m_ReadyList;
+
     int  _DoConnect(Socket *pSock, IPEndPoint *otherEnd, 
 		    int maxTrials = 720 /* XXX UNDO ME IF UNRELIABLE! :) */);
     int  _Connect_TCP(Socket *pSock, IPEndPoint *otherEnd);
     int  _Send_TCP(Socket fd, byte* buffer, uint32 length);
     void _RegisterNewTCPConnections(fd_set *isset);
+    ConnStatusType _ReadFrom(TCPConnection *connection, Connection **connp);
+
+    // Overloaded to remove connections from the ready list also
+    void _ClearConnections();
+    void _CleanupConnections();
 
  public:
 
@@ -52,7 +63,7 @@ class TCPTransport : public Transport {
     static const int CONNECT_SLEEP_TIME   = 500;   //  milliseconds
     static const int MAX_TCP_MSGSIZE      = 512*1024; // bytes
 
-    TCPTransport() {}
+    TCPTransport() : m_ListenReady(false) {}
     virtual ~TCPTransport() {}
 
     void  StartListening();
@@ -60,6 +71,8 @@ class TCPTransport : public Transport {
     int   FillReadSet(fd_set *tofill);
     void  DoWork(fd_set *isset, u_long timeout_usecs);
     uint32 GetPriority() { return 3 /* m_ReadPackets */; }
+    void  OnReadable(Connection *conn);
+    bool  HasBacklog() { return m_ListenReady || !m_ReadyList.empty(); }
 
     Connection *GetConnection(IPEndPoint *target);
     ConnStatusType GetReadyConnection(Connection **connp);
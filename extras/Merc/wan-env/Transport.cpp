@@ -121,6 +121,7 @@ void Transport::_ClearConnections() {
 	if (connection) {
 	    DBG << "deleting connection to: " 
 		<< connection->GetAppPeerAddress() << endl;
+	    RealNet::UnwatchSocket( connection->GetSocket(), connection );
 	    OS::CloseSocket( connection->GetSocket() );
 	    delete connection;
 	}
@@ -152,6 +153,7 @@ void Transport::_CleanupConnections() {
 	    ConnectionListIter oiter = iter;
 	    oiter++;
 	    m_ConnectionList.erase(iter);
+	    RealNet::UnwatchSocket(connection->GetSocket(), connection);
 	    delete connection;
 
 	    iter = oiter;
@@ -180,6 +180,29 @@ class Transport {
      */
     virtual void  DoWork(fd_set *isset, u_long timeoutUsecs)      = 0;
 
+    /**
+     * Only used with the epoll backend: called when a socket registered
+     * with RealNet::WatchSocket() becomes readable. conn is what it was
+     * registered with (NULL for the transport's own socket). Readiness
+     * is edge-triggered, so it has to be remembered until the socket
+     * has been read dry.
+     */
+    virtual void  OnReadable(Connection *conn)                    {}
+
+    /**
+     * Only used with the epoll backend: true if some socket which was 
+     * reported readable has not been read dry yet. RealNet then polls
+     * instead of blocking for the next edge.
+     */
+    virtual bool  HasBacklog()                                    { return false; }
+
+    /**
+     * Push out sends the transport has been holding back to batch
+     * them. RealNet calls this once per event-loop turn, before it
+     * waits for input.
+     */
+    virtual void  FlushSends()                                    {}
+
     /**
      * Returns processing priority of the transport. This is used by 
      * RealNet to allocate DoWork() timeslices to each transport. One
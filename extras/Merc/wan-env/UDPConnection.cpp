@@ -66,6 +66,9 @@ UDPConnection::~UDPConnection() {
 }
 
 int UDPConnection::Send(Packet *pkt) {
+    if (g_Preferences.udp_batch > 0)
+	return ((UDPTransport *)GetTransport())->_Queue_UDP(GetAppPeerAddress(), pkt);
+
     int ret = ((UDPTransport *)GetTransport())->_Send_UDP(GetAppPeerAddress(),
 							  pkt->GetBuffer (),
 							  pkt->GetUsed ());
@@ -69,6 +69,33 @@ void UDPTransport::StartListening()
 	Debug::die ("StartListening: could not bind server socket to port [%d]\n", m_ID.m_Port);
     }
 
+    // DoWork() reads regardless; this is only so epoll wakes us up
+    RealNet::WatchSocket(m_ListenSocket, this);
+
+    int batch = g_Preferences.udp_batch;
+    if (batch > 0) {
+	int ctrllen = CMSG_SPACE(sizeof(struct timeval));
+
+	m_RecvBufs.resize(batch * MAX_UDP_MSGSIZE);
+	m_RecvHdrs.resize(batch);
+	m_RecvIovs.resize(batch);
+	m_RecvAddrs.resize(batch);
+	m_RecvCtrl.resize(batch * ctrllen);
+
+	for (int i = 0; i < batch; i++) {
+	    struct msghdr *msg = &m_RecvHdrs[i].msg_hdr;
+
+	    m_RecvIovs[i].iov_base = &m_RecvBufs[i * MAX_UDP_MSGSIZE];
+	    m_RecvIovs[i].iov_len  = MAX_UDP_MSGSIZE;
+
+	    memset(msg, 0, sizeof(*msg));
+	    msg->msg_name    = &m_RecvAddrs[i];
+	    msg->msg_iov     = &m_RecvIovs[i];
+	    msg->msg_iovlen  = 1;
+	    msg->msg_control = &m_RecvCtrl[i * ctrllen];
+	}
+    }
+
     DB(1) << "Started [PROTO_UDP] server at port " 
 	  << m_ID.m_Port << " successfully..." << endl;
     return;
@@ -76,8 +103,11 @@ void UDPTransport::StartListening()
 
 void UDPTransport::StopListening()
 {
-    if (m_ListenSocket > 0)
+    if (m_ListenSocket > 0) {
+	FlushSends();
+	RealNet::UnwatchSocket(m_ListenSocket);
 	OS::CloseSocket(m_ListenSocket);
+    }
 
     _ClearConnections();
 }
@@ -103,17 +133,42 @@ void UDPTransport::DoWork(fd_set *isset, u_long timeout_usecs)
 
     int i = 0;
 
-    while (true) {
+    // cleared once we have read the socket dry
+    m_Backlog = true;
+
+    // with --udp-batch, a short recvmmsg() tells us the socket is dry
+    // so there is no need to ask the kernel separately
+    while (g_Preferences.udp_batch > 0) {
+	if (i >= MAX_PKTS_SERVICE)
+	    break;
+
+	int n = 0;
+	int error = _ServiceBatch (&rcv, &n);
+	i += n;
+	if (error == EAGAIN || (error != 0 && n == 0)) {
+	    m_Backlog = false;
+	    break;
+	}
+
+	if (CurrentTimeUsec() > stoptime)
+	    break;
+    }
+
+    while (g_Preferences.udp_batch <= 0) {
 	if (i++ >= MAX_PKTS_SERVICE)
 	    break;
 
-	if (_ServiceOnce (&rcv) == EAGAIN) 
+	if (_ServiceOnce (&rcv) == EAGAIN) {
+	    m_Backlog = false;
 	    break;
+	}
 
 	if (CurrentTimeUsec() > stoptime)
 	    break;
-	if (!RealNet::IsDataWaiting(m_ListenSocket))
+	if (!RealNet::IsDataWaiting(m_ListenSocket)) {
+	    m_Backlog = false;
 	    break;
+	}
 
 	//if (rcv > now) 
 	//    break;
@@ -162,6 +217,66 @@ UDPTransport::_ServiceOnce(TimeVal *tv)
 	return error; 
     }
 
+    _Deliver (pkt, fromWhom, *tv);
+    return 0;
+}
+
+/**
+ * Read up to --udp-batch datagrams with one recvmmsg() and queue them
+ * on their connections. Sets *nread to the number read; returns EAGAIN
+ * if that drained the socket.
+ */
+int /* errno */
+UDPTransport::_ServiceBatch(TimeVal *tv, int *nread)
+{
+    int batch = (int) m_RecvHdrs.size();
+    int ctrllen = CMSG_SPACE(sizeof(struct timeval));
+
+    for (int i = 0; i < batch; i++) {
+	m_RecvHdrs[i].msg_hdr.msg_namelen    = sizeof(struct sockaddr_in);
+	m_RecvHdrs[i].msg_hdr.msg_controllen = ctrllen;
+    }
+
+    START(_ServiceBatch::ReadDatagrams);
+    int n = recvmmsg (m_ListenSocket, &m_RecvHdrs[0], batch, MSG_DONTWAIT, NULL);
+    int error = errno;
+    STOP(_ServiceBatch::ReadDatagrams);
+
+    *nread = 0;
+    if (n < 0) {
+	if (error != EAGAIN) 
+	    WARN << "UDP Socket on port " << m_ID.m_Port
+		 << " error: " << strerror(error) << endl;
+	return error;
+    }
+
+    for (int i = 0; i < n; i++) {
+	int len = m_RecvHdrs[i].msg_len;
+	IPEndPoint fromWhom(m_RecvAddrs[i].sin_addr.s_addr,
+			    ntohs(m_RecvAddrs[i].sin_port));
+
+	// the ring slot is reused by the next call, so copy out
+	Packet *pkt = new Packet(MAX(len, 1));
+	memcpy (pkt->GetBuffer (), &m_RecvBufs[i * MAX_UDP_MSGSIZE], len);
+	pkt->ResetBufPosition ();
+	pkt->IncrBufPosition (len);
+
+	*tv = TIME_NONE;
+	RealNet::GetDatagramTime (&m_RecvHdrs[i].msg_hdr, tv);
+
+	_Deliver (pkt, fromWhom, *tv);
+    }
+
+    *nread = n;
+    return n < batch ? EAGAIN : 0;
+}
+
+/**
+ * Queue a datagram just read from 'fromWhom' on its connection
+ * (creating one if need be). Takes ownership of 'pkt'.
+ */
+void UDPTransport::_Deliver(Packet *pkt, IPEndPoint& fromWhom, TimeVal& tv)
+{
     Lock();
     UDPConnection *conn = (UDPConnection *)m_AppConnHash.Lookup(&fromWhom);
     Unlock();
@@ -205,7 +320,7 @@ UDPTransport::_ServiceOnce(TimeVal *tv)
 	switch (QUEUING_DISCIPLINE) {
 	case Q_DROPTAIL: {
 	    delete pkt;
-	    return len;
+	    return;
 	}
 	case Q_DROPHEAD: {
 	    PacketInfo info = conn->Pop();
@@ -222,10 +337,7 @@ UDPTransport::_ServiceOnce(TimeVal *tv)
     DB(20) << "servicing: " << *conn->GetAppPeerAddress() << endl;
 
     // *tv = OS::GetSockTimeStamp(m_ListenSocket); -- no longer needed
-    conn->Insert(pkt, *tv);
-
-    return 0;
-#undef RETURN
+    conn->Insert(pkt, tv);
 }
 
 UDPConnection *UDPTransport::CreateConnection(Socket sock, 
@@ -385,6 +497,70 @@ int UDPTransport::_Send_UDP(IPEndPoint *otherEnd,
 
     return RealNet::WriteDatagram(m_ListenSocket, otherEnd, buffer, length);
 }
+
+//
+// --udp-batch: hold on to 'pkt' (which we now own) until FlushSends(),
+// which RealNet calls before it next waits for input, or until a full
+// batch has built up.
+//
+int UDPTransport::_Queue_UDP(IPEndPoint *otherEnd, Packet *pkt) {
+    int length = pkt->GetUsed ();
+    if (length > MAX_UDP_MSGSIZE) {
+	// can't send, too big!
+	delete pkt;
+	return -1;
+    }
+
+    Lock();
+    m_SendQueue.push_back(pkt);
+    m_SendAddrs.push_back(*otherEnd);
+    bool full = m_SendQueue.size() >= (uint32) g_Preferences.udp_batch;
+    Unlock();
+
+    if (full)
+	FlushSends();
+    return length;
+}
+
+void UDPTransport::FlushSends()
+{
+    Lock();
+
+    int n = (int) m_SendQueue.size();
+    if (n == 0) {
+	Unlock();
+	return;
+    }
+
+    m_SendHdrs.resize(n);
+    m_SendIovs.resize(n);
+    m_SendSockAddrs.resize(n);
+
+    for (int i = 0; i < n; i++) {
+	struct msghdr *msg = &m_SendHdrs[i].msg_hdr;
+
+	memset(msg, 0, sizeof(*msg));
+	memset(&m_SendSockAddrs[i], 0, sizeof(struct sockaddr_in));
+	m_SendAddrs[i].ToSockAddr(&m_SendSockAddrs[i]);
+
+	m_SendIovs[i].iov_base = m_SendQueue[i]->GetBuffer ();
+	m_SendIovs[i].iov_len  = m_SendQueue[i]->GetUsed ();
+
+	msg->msg_name    = &m_SendSockAddrs[i];
+	msg->msg_namelen = sizeof(struct sockaddr_in);
+	msg->msg_iov     = &m_SendIovs[i];
+	msg->msg_iovlen  = 1;
+    }
+
+    RealNet::WriteDatagrams(m_ListenSocket, &m_SendHdrs[0], n);
+
+    for (int i = 0; i < n; i++)
+	delete m_SendQueue[i];
+    m_SendQueue.clear();
+    m_SendAddrs.clear();
+
+    Unlock();
+}
 // vim: set sw=4 sts=4 ts=8 noet: 
 // Local Variables:
 // Mode: c++
@@ -25,6 +25,8 @@
 #ifndef __UDP_TRANSPORT__H
 #define __UDP_TRANSPORT__H
 
+#include <sys/socket.h>
+#include <vector>
 #include <wan-env/Transport.h>
 #include <wan-env/UDPConnection.h>
 
@@ -40,10 +42,29 @@ class UDPTransport : public Transport {
  protected:
 
     Socket m_ListenSocket;
+    bool   m_Backlog;       // DoWork() left datagrams in the kernel
+
+    // --udp-batch: recvmmsg() lands datagrams here before they are
+    // copied into exactly-sized packets
+    vector<byte>               m_RecvBufs;
+    vector<struct mmsghdr>     m_RecvHdrs;
+    vector<struct iovec>       m_RecvIovs;
+    vector<struct sockaddr_in> m_RecvAddrs;
+    vector<char>               m_RecvCtrl;
+
+    // --udp-batch: sends held for the next sendmmsg()
+    vector<Packet *>           m_SendQueue;
+    vector<IPEndPoint>         m_SendAddrs;
+    vector<struct mmsghdr>     m_SendHdrs;
+    vector<struct iovec>       m_SendIovs;
+    vector<struct sockaddr_in> m_SendSockAddrs;
 
     int  _Connect_UDP(Socket *pSock, IPEndPoint *otherEnd);
     int  _Send_UDP(IPEndPoint *toWhom, byte* buffer, uint32 length);
+    int  _Queue_UDP(IPEndPoint *toWhom, Packet *pkt);
     int _ServiceOnce(TimeVal *tv);
+    int _ServiceBatch(TimeVal *tv, int *nread);
+    void _Deliver(Packet *pkt, IPEndPoint& fromWhom, TimeVal& tv);
 
     /**
      * Construct an appropriate UDP connection (or subclass) for this 
@@ -71,7 +92,7 @@ class UDPTransport : public Transport {
     /** Max number of packets to dequeue from kernel at a time in DoWork() */
     static const int MAX_PKTS_SERVICE               = 1280000;
 
-    UDPTransport() {}
+    UDPTransport() : m_Backlog(false) {}
     virtual ~UDPTransport() {}
 
     void  StartListening();
@@ -79,6 +100,8 @@ class UDPTransport : public Transport {
     int   FillReadSet(fd_set *tofill);
     void  DoWork(fd_set *isset, u_long timeout_usecs);
     uint32 GetPriority() { return 10 /* m_ReadPackets */; }	
+    bool  HasBacklog() { return m_Backlog; }
+    void  FlushSends();
 
     Connection *GetConnection(IPEndPoint *target);
     ConnStatusType GetReadyConnection(Connection **connp);
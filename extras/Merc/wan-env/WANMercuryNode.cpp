@@ -120,6 +120,8 @@ void WANMercuryNode::Recv (u_long timeout)
 
     NOTE(WANRECV::processed, i);
 
+    ReapHubWork ();
+
     if (CurrentTimeUsec () < stoptime)
 	m_Scheduler->ProcessTill (m_Scheduler->TimeNow ());
 
@@ -171,7 +173,7 @@ void WANMercuryNode::DoWork (u_long timeout)
 {
     IPEndPoint from;
     Message *msg = NULL;
-    bool processed, sent;
+    bool processed, sent, reaped;
 
     NOTE(WAN_DOWORK:TIMEOUT, timeout);
 
@@ -185,8 +187,9 @@ void WANMercuryNode::DoWork (u_long timeout)
 	{	
 	    sent = MercuryNode::SendPacket ();
 	    processed = ProcessOnePacket ();
+	    reaped = ReapHubWork ();
 
-	    if (!processed && !sent) 
+	    if (!processed && !sent && !reaped) 
 		break;
 	}
 